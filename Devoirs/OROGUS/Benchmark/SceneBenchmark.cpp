@@ -0,0 +1,429 @@
+#include <glew/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "SceneBenchmark.h"
+
+#include "../Camera/Camera.h"
+#include "../Geometry/GeometryManager.h"
+#include "../Geometry/MeshCache.h"
+#include "../Geometry/MeshOptimizer.h"
+#include "../Controller/InputRecorder.h"
+#include "../Render/RenderTarget.h"
+#include "../Render/UploadQueue.h"
+#include "../ResourcesManager/ResourcesManager.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneLoader.h"
+#include "../Utilities/AllocationTracker.h"
+#include "../Utilities/FrameArena.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/RenderStats.h"
+#include "../Utilities/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+    bool ParseUnsigned(const char* text, uint32& value)
+    {
+        char* end = nullptr;
+        unsigned long parsed = std::strtoul(text, &end, 10);
+        if (end == text || *end != '\0')
+        {
+            return false;
+        }
+        value = (uint32)parsed;
+        return true;
+    }
+
+    bool ParseSize(const char* text, uint32& width, uint32& height)
+    {
+        char* end = nullptr;
+        unsigned long w = std::strtoul(text, &end, 10);
+        if (end == text || (*end != 'x' && *end != 'X'))
+        {
+            return false;
+        }
+        const char* heightText = end + 1;
+        unsigned long h = std::strtoul(heightText, &end, 10);
+        if (end == heightText || *end != '\0' || w == 0 || h == 0)
+        {
+            return false;
+        }
+        width = (uint32)w;
+        height = (uint32)h;
+        return true;
+    }
+
+    // Centile par rang le plus proche sur des valeurs triees
+    double Percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    }
+
+    GLFWwindow* CreateHiddenContext()
+    {
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        // Le rendu se fait dans un framebuffer : la fenetre ne sert qu'a porter le contexte
+        GLFWwindow* window = glfwCreateWindow(1, 1, "OROGUS benchmark", nullptr, nullptr);
+        if (window == nullptr)
+        {
+            // Sans pilote natif (ex. Mesa llvmpipe sans serveur graphique), on tente OSMesa puis EGL
+            const int fallbacks[] = { GLFW_OSMESA_CONTEXT_API, GLFW_EGL_CONTEXT_API };
+            for (int api : fallbacks)
+            {
+                glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+                window = glfwCreateWindow(1, 1, "OROGUS benchmark", nullptr, nullptr);
+                if (window != nullptr)
+                {
+                    break;
+                }
+            }
+        }
+        return window;
+    }
+
+    void WriteStats(std::ostream& out, const RenderStats& total, double frames)
+    {
+        out << "  \"stats_per_frame\": {\n"
+            << "    \"draw_calls\": " << total.DrawCalls / frames << ",\n"
+            << "    \"triangles\": " << total.Triangles / frames << ",\n"
+            << "    \"vertices\": " << total.Vertices / frames << ",\n"
+            << "    \"program_binds\": " << total.ProgramBinds / frames << ",\n"
+            << "    \"vao_binds\": " << total.VertexArrayBinds / frames << ",\n"
+            << "    \"texture_binds\": " << total.TextureBinds / frames << ",\n"
+            << "    \"uniform_uploads\": " << total.UniformUploads / frames << ",\n"
+            << "    \"buffer_bytes\": " << total.BufferBytesUploaded / frames << ",\n"
+            << "    \"culled_objects\": " << total.CulledObjects / frames << ",\n"
+            << "    \"lights_evaluated\": " << total.LightsEvaluated / frames << ",\n"
+            << "    \"allocations\": " << total.Allocations / frames << ",\n"
+            << "    \"frame_arena_bytes\": " << total.FrameArenaBytes / frames << ",\n"
+            << "    \"streamed_bytes\": " << total.StreamedBytes / frames << ",\n"
+            << "    \"upload_queue_depth\": " << total.UploadQueueDepth / frames << "\n"
+            << "  }\n";
+    }
+
+    bool WriteResults(const BenchmarkSettings& settings, std::vector<double> frameTimes, const RenderStats& total, uint64 sceneAllocations, double loadTime)
+    {
+        std::ofstream out(settings.OutputFile);
+        if (!out.is_open())
+        {
+            Log() << "--Erreur : Impossible d'ecrire les resultats " << settings.OutputFile << std::endl;
+            return false;
+        }
+
+        std::sort(frameTimes.begin(), frameTimes.end());
+        double frames = (double)frameTimes.size();
+        double sum = 0.0;
+        for (double t : frameTimes)
+        {
+            sum += t;
+        }
+
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        const char* version = (const char*)glGetString(GL_VERSION);
+
+        size_t geometryCpuBytes = 0;
+        size_t geometryGpuBytes = 0;
+        GeometryManager::GetInstance()->getMemoryUsage(geometryCpuBytes, geometryGpuBytes);
+
+        out << std::fixed << std::setprecision(4);
+        out << "{\n"
+            << "  \"scene\": \"" << settings.SceneFile << "\",\n"
+            << "  \"camera_path\": \"" << (settings.ReplayFile.empty() ? "orbit" : settings.ReplayFile) << "\",\n"
+            << "  \"renderer\": \"" << (renderer != nullptr ? renderer : "") << "\",\n"
+            << "  \"gl_version\": \"" << (version != nullptr ? version : "") << "\",\n"
+            << "  \"width\": " << settings.Width << ",\n"
+            << "  \"height\": " << settings.Height << ",\n"
+            << "  \"anti_aliasing\": \"" << FramePipeline::GetAntiAliasingName(settings.AntiAliasingMode) << "\",\n"
+            << "  \"warmup_frames\": " << settings.WarmupFrames << ",\n"
+            << "  \"measured_frames\": " << settings.MeasuredFrames << ",\n"
+            << "  \"mesh_cache\": " << (settings.UseMeshCache ? "true" : "false") << ",\n"
+            << "  \"load_time_ms\": " << loadTime << ",\n"
+            << "  \"geometry_cpu_bytes\": " << geometryCpuBytes << ",\n"
+            << "  \"geometry_gpu_bytes\": " << geometryGpuBytes << ",\n"
+            << "  \"frame_time_ms\": {\n"
+            << "    \"mean\": " << sum / frames << ",\n"
+            << "    \"min\": " << frameTimes.front() << ",\n"
+            << "    \"p50\": " << Percentile(frameTimes, 50.0) << ",\n"
+            << "    \"p95\": " << Percentile(frameTimes, 95.0) << ",\n"
+            << "    \"p99\": " << Percentile(frameTimes, 99.0) << ",\n"
+            << "    \"max\": " << frameTimes.back() << "\n"
+            << "  },\n"
+            << "  \"cpu_submit_ms\": " << total.CpuFrameTime / frames << ",\n"
+            << "  \"gpu_ms\": " << total.GpuFrameTime / frames << ",\n"
+            << "  \"allocation_tracking\": " << (AllocationTracker::IsEnabled() ? "true" : "false") << ",\n"
+            << "  \"scene_render_allocations\": " << sceneAllocations << ",\n";
+        WriteStats(out, total, frames);
+        out << "}\n";
+
+        Log() << "Resultats du benchmark ecrits dans " << settings.OutputFile
+              << " (moyenne " << sum / frames << " ms, p99 " << Percentile(frameTimes, 99.0) << " ms)" << std::endl;
+        return true;
+    }
+}
+
+bool SceneBenchmark::ParseArguments(int argc, char** argv, BenchmarkSettings& settings, bool& valid)
+{
+    bool requested = false;
+    valid = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool consumed = value != nullptr;
+
+        if (std::strcmp(arg, "--benchmark") == 0 && value != nullptr)
+        {
+            requested = true;
+            settings.SceneFile = value;
+        }
+        else if (std::strcmp(arg, "--warmup") == 0 && value != nullptr)
+        {
+            valid &= ParseUnsigned(value, settings.WarmupFrames);
+        }
+        else if (std::strcmp(arg, "--frames") == 0 && value != nullptr)
+        {
+            valid &= ParseUnsigned(value, settings.MeasuredFrames) && settings.MeasuredFrames > 0;
+        }
+        else if (std::strcmp(arg, "--size") == 0 && value != nullptr)
+        {
+            valid &= ParseSize(value, settings.Width, settings.Height);
+        }
+        else if (std::strcmp(arg, "--output") == 0 && value != nullptr)
+        {
+            settings.OutputFile = value;
+        }
+        else if (std::strcmp(arg, "--replay") == 0 && value != nullptr)
+        {
+            settings.ReplayFile = value;
+        }
+        else if (std::strcmp(arg, "--aa") == 0 && value != nullptr)
+        {
+            valid &= FramePipeline::ParseAntiAliasing(value, settings.AntiAliasingMode);
+        }
+        else if (std::strcmp(arg, "--require-no-alloc") == 0)
+        {
+            settings.RequireNoAllocations = true;
+            consumed = false;
+        }
+        else if (std::strcmp(arg, "--no-mesh-cache") == 0)
+        {
+            settings.UseMeshCache = false;
+            consumed = false;
+        }
+        else if (std::strcmp(arg, "--mesh-stats") == 0)
+        {
+            settings.LogMeshStatistics = true;
+            consumed = false;
+        }
+        else
+        {
+            Log() << "--Erreur : Argument invalide " << arg << std::endl;
+            valid = false;
+            consumed = false;
+        }
+
+        if (consumed)
+        {
+            ++i;
+        }
+    }
+    return requested;
+}
+
+int SceneBenchmark::Run(const BenchmarkSettings& settings)
+{
+    if (!glfwInit())
+    {
+        Log() << "--Erreur : Impossible d'initialiser GLFW" << std::endl;
+        return -1;
+    }
+
+    GLFWwindow* window = CreateHiddenContext();
+    if (window == nullptr)
+    {
+        Log() << "--Erreur : Impossible de creer un contexte OpenGL 3.3" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    glewExperimental = true;
+    if (GLEW_OK != glewInit())
+    {
+        Log() << "--Erreur : Impossible d'initialiser GLEW" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+
+    Profiler::Initialize();
+    Profiler::SetThreadName("Main");
+    ThreadPool::Initialize();
+    ResourcesManager::Initialize();
+    FrameArena::Initialize();
+    UploadQueue::Initialize();
+
+    // Separe le dossier de la scene de son nom de fichier, comme l'attend SceneLoader
+    size_t separator = settings.SceneFile.find_last_of("/\\");
+    std::string scenePath = separator == std::string::npos ? "" : settings.SceneFile.substr(0, separator + 1);
+    std::string sceneFile = separator == std::string::npos ? settings.SceneFile : settings.SceneFile.substr(separator + 1);
+
+    int result = -1;
+    std::vector<CameraSample> cameraPath;
+    MeshCache::SetEnabled(settings.UseMeshCache);
+    MeshOptimizer::Settings().LogStatistics = settings.LogMeshStatistics;
+    auto loadStart = std::chrono::steady_clock::now();
+    Scene* scene = SceneLoader::LoadScene(scenePath, sceneFile);
+    if (scene != nullptr)
+    {
+        // Les mesures commencent une fois toutes les geometries attachees
+        GeometryManager::GetInstance()->waitForPendingGeometries();
+        scene->update();
+        UploadQueue::Flush();
+    }
+    double loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    RenderTarget* target = new RenderTarget(settings.Width, settings.Height);
+
+    // Taille fixe : seul l'anticrenelage passe par des cibles intermediaires
+    FramePipeline* pipeline = new FramePipeline(settings.Width, settings.Height, 0.0f);
+    pipeline->getDynamicResolution().setEnabled(false);
+    pipeline->setAntiAliasing(settings.AntiAliasingMode);
+    if (scene == nullptr)
+    {
+        Log() << "--Erreur : Impossible de charger la scene " << settings.SceneFile << std::endl;
+    }
+    else if (!settings.ReplayFile.empty() && !InputRecorder::LoadCameraPath(settings.ReplayFile, cameraPath))
+    {
+        Log() << "--Erreur : Trajectoire de camera invalide " << settings.ReplayFile << std::endl;
+    }
+    else if (target->isComplete())
+    {
+        glDepthFunc(GL_LESS);
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+
+        Camera& camera = scene->getCamera();
+        camera.setCameraMode(false);
+        camera.ratio() = settings.Width / (float)settings.Height;
+
+        // Trajectoire par defaut : un tour complet autour du point de visee de la scene,
+        // parcouru sur les images mesurees (l'echauffement suit le meme chemin)
+        const Point3<Metre> lookAt = camera.lookAt();
+        const float offsetX = (camera.position().x() - lookAt.x()).Value();
+        const float offsetY = (camera.position().y() - lookAt.y()).Value();
+        const float offsetZ = (camera.position().z() - lookAt.z()).Value();
+
+        std::vector<double> frameTimes;
+        frameTimes.reserve(settings.MeasuredFrames);
+        RenderStats total;
+        uint64 sceneAllocations = 0;
+
+        uint32 frameCount = settings.WarmupFrames + settings.MeasuredFrames;
+        for (uint32 frame = 0; frame < frameCount; ++frame)
+        {
+            float progress = (float)(frame % settings.MeasuredFrames) / settings.MeasuredFrames;
+            if (!cameraPath.empty())
+            {
+                // Dernier echantillon atteint a cet instant de l'enregistrement
+                float time = progress * cameraPath.back().Time;
+                auto next = std::upper_bound(cameraPath.begin(), cameraPath.end(), time,
+                                             [](float t, const CameraSample& sample) { return t < sample.Time; });
+                InputRecorder::ApplyCameraSample(next == cameraPath.begin() ? *next : *(next - 1), camera);
+            }
+            else
+            {
+                float angle = 2.0f * 3.14159265f * progress;
+                float c = std::cos(angle);
+                float s = std::sin(angle);
+                Point3<Metre> position(lookAt.x() + Metre(c * offsetX + s * offsetZ),
+                                       lookAt.y() + Metre(offsetY),
+                                       lookAt.z() + Metre(c * offsetZ - s * offsetX));
+                camera.setCoordinate(lookAt, position);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            FrameArena::Reset();
+            Profiler::BeginFrame();
+            RenderCounters::BeginFrame();
+            {
+                PROFILE_SCOPE("Frame");
+
+                // Comme la boucle principale : le streaming (terrain, geometries) et les
+                // envois etales de UploadQueue font partie du cout d'une image
+                GeometryManager::GetInstance()->processLoadedGeometries();
+                scene->update();
+                UploadQueue::Process();
+
+                pipeline->beginFrame(target);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                // L'echauffement laisse les caches (noms d'uniformes, requetes GPU) atteindre leur taille finale
+                AllocationScope allocations;
+                scene->render();
+                if (frame >= settings.WarmupFrames)
+                {
+                    sceneAllocations += allocations.getAllocationCount();
+                }
+                pipeline->endFrame();
+            }
+            Profiler::EndFrame();
+            RenderCounters::EndFrame(Profiler::GetLastGpuFrameTime());
+
+            // Attend le GPU pour que le temps mesure couvre toute l'image
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+
+            if (frame >= settings.WarmupFrames)
+            {
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                total.accumulate(RenderCounters::LastFrame());
+            }
+        }
+        RenderTarget::BindDefault();
+
+        result = WriteResults(settings, frameTimes, total, sceneAllocations, loadTime) ? 0 : -1;
+
+        if (settings.RequireNoAllocations && !AllocationTracker::IsEnabled())
+        {
+            Log() << "--Erreur : --require-no-alloc demande une compilation avec OROGUS_TRACK_ALLOCATIONS" << std::endl;
+            result = -1;
+        }
+        else if (settings.RequireNoAllocations && sceneAllocations > 0)
+        {
+            Log() << "--Erreur : " << sceneAllocations << " allocations dans Scene::render sur "
+                  << settings.MeasuredFrames << " images mesurees" << std::endl;
+            result = -1;
+        }
+    }
+
+    delete pipeline;
+    delete target;
+    delete scene;
+
+    ResourcesManager::Uninitialize();
+    UploadQueue::Uninitialize();
+    FrameArena::Uninitialize();
+    ThreadPool::Uninitialize();
+    Profiler::Uninitialize();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
@@ -0,0 +1,47 @@
+#ifndef _BENCHMARK_SCENEBENCHMARK_H_
+#define _BENCHMARK_SCENEBENCHMARK_H_
+
+#include "../Render/FramePipeline.h"
+#include "../Utilities/Types.h"
+
+#include <string>
+
+struct BenchmarkSettings
+{
+    std::string SceneFile;
+    std::string OutputFile = "Benchmark.json";
+    std::string ReplayFile;     // Trajectoire de camera enregistree (InputRecorder)
+    uint32 Width = 1280;
+    uint32 Height = 720;
+    uint32 WarmupFrames = 60;
+    uint32 MeasuredFrames = 600;
+    AntiAliasing AntiAliasingMode = AntiAliasing::Msaa4;
+    bool RequireNoAllocations = false;  // Echec si Scene::render alloue pendant les images mesurees
+    bool UseMeshCache = true;           // Faux pour mesurer un chargement depuis les fichiers OBJ
+    bool LogMeshStatistics = false;     // Statistiques de cache de sommets de chaque maillage optimise
+};
+
+// Rendu sans affichage d'une scene dans un framebuffer de taille fixe. La camera
+// fait un tour complet autour de son point de visee, ou suit la trajectoire d'un
+// enregistrement d'entrees repartie sur les images mesurees.
+//
+// Ligne de commande :
+//   OROGUS --benchmark Scenes/Scene.scn [--warmup N] [--frames M]
+//          [--size LxH] [--output Resultat.json] [--replay Input.rec]
+//          [--aa off|msaa2|msaa4|msaa8|fxaa] [--require-no-alloc]
+//          [--no-mesh-cache] [--mesh-stats]
+//
+// --require-no-alloc echoue (code de retour non nul) si Scene::render alloue sur le
+// thread de rendu pendant les images mesurees. Il demande OROGUS_TRACK_ALLOCATIONS,
+// defini dans toutes les configurations du projet.
+class SceneBenchmark
+{
+public:
+    // Retourne vrai si --benchmark est present ; valid indique si les arguments sont corrects
+    static bool ParseArguments(int argc, char** argv, BenchmarkSettings& settings, bool& valid);
+
+    // Cree son propre contexte GL cache et retourne le code de sortie du programme
+    static int Run(const BenchmarkSettings& settings);
+};
+
+#endif
@@ -0,0 +1,456 @@
+#include <GLFW/glfw3.h>
+
+#include "InputRecorder.h"
+
+#include "../Camera/Camera.h"
+#include "../Utilities/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    const char FILE_MAGIC[4] = { 'O', 'I', 'N', 'P' };
+    const uint32 FILE_VERSION = 1;
+
+    enum class InputEventType : uint8
+    {
+        Key,
+        MouseButton,
+        MousePosition,
+        Scroll
+    };
+
+    // 17 octets sur disque
+    struct InputEvent
+    {
+        float Time;
+        InputEventType Type;
+        int16 Code;     // Touche ou bouton
+        uint8 Action;
+        uint8 Mods;
+        float X;        // Position du curseur ou defilement
+        float Y;
+    };
+
+    enum class RecorderState
+    {
+        Idle,
+        Recording,
+        Replaying
+    };
+
+    struct Recording
+    {
+        std::vector<InputEvent> Events;
+        std::vector<CameraSample> Samples;
+        float Duration = 0.0f;
+    };
+
+    RecorderState s_state = RecorderState::Idle;
+    InputRecorder::Handlers s_handlers = {};
+    Recording s_recording;
+    std::string s_fileName;
+    float s_time = 0.0f;
+
+    // Relecture
+    size_t s_nextEvent = 0;
+    bool s_dispatching = false;
+    bool s_keys[GLFW_KEY_LAST + 1] = {};
+
+    template<typename T>
+    void Write(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool Read(std::istream& in, T& value)
+    {
+        return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(std::ostream& out, const T (&values)[3])
+    {
+        for (const T& v : values)
+        {
+            Write(out, v);
+        }
+    }
+
+    template<typename T>
+    bool ReadArray(std::istream& in, T (&values)[3])
+    {
+        return Read(in, values[0]) && Read(in, values[1]) && Read(in, values[2]);
+    }
+
+    CameraSample SampleCamera(const Camera& camera, float time)
+    {
+        CameraSample sample;
+        sample.Time = time;
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            sample.Position[i] = camera.position().constValues()[i];
+            sample.LookAt[i] = camera.lookAt().constValues()[i];
+            sample.Up[i] = camera.upVector().constValues()[i];
+        }
+        sample.FirstPerson = camera.isFirstPerson();
+        return sample;
+    }
+
+    bool SaveRecording(const std::string& fileName, const Recording& recording)
+    {
+        std::ofstream out(fileName, std::ios::binary);
+        if (!out.is_open())
+        {
+            return false;
+        }
+
+        out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        Write(out, FILE_VERSION);
+        Write(out, (uint32)recording.Events.size());
+        Write(out, (uint32)recording.Samples.size());
+        Write(out, recording.Duration);
+
+        for (const InputEvent& e : recording.Events)
+        {
+            Write(out, e.Time);
+            Write(out, (uint8)e.Type);
+            Write(out, e.Code);
+            Write(out, e.Action);
+            Write(out, e.Mods);
+            Write(out, e.X);
+            Write(out, e.Y);
+        }
+
+        for (const CameraSample& s : recording.Samples)
+        {
+            Write(out, s.Time);
+            WriteArray(out, s.Position);
+            WriteArray(out, s.LookAt);
+            WriteArray(out, s.Up);
+            Write(out, (uint8)(s.FirstPerson ? 1 : 0));
+        }
+        return (bool)out;
+    }
+
+    bool LoadRecording(const std::string& fileName, Recording& recording)
+    {
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in.is_open())
+        {
+            Log() << "--Erreur : Impossible d'ouvrir l'enregistrement " << fileName << std::endl;
+            return false;
+        }
+
+        char magic[4];
+        uint32 version = 0;
+        uint32 eventCount = 0;
+        uint32 sampleCount = 0;
+        in.read(magic, sizeof(magic));
+        if (!in || std::string(magic, 4) != std::string(FILE_MAGIC, 4)
+            || !Read(in, version) || version != FILE_VERSION
+            || !Read(in, eventCount) || !Read(in, sampleCount) || !Read(in, recording.Duration))
+        {
+            Log() << "--Erreur : Enregistrement invalide " << fileName << std::endl;
+            return false;
+        }
+
+        recording.Events.resize(eventCount);
+        for (InputEvent& e : recording.Events)
+        {
+            uint8 type = 0;
+            if (!Read(in, e.Time) || !Read(in, type) || !Read(in, e.Code) || !Read(in, e.Action)
+                || !Read(in, e.Mods) || !Read(in, e.X) || !Read(in, e.Y))
+            {
+                Log() << "--Erreur : Enregistrement tronque " << fileName << std::endl;
+                return false;
+            }
+            e.Type = (InputEventType)type;
+        }
+
+        recording.Samples.resize(sampleCount);
+        for (CameraSample& s : recording.Samples)
+        {
+            uint8 firstPerson = 0;
+            if (!Read(in, s.Time) || !ReadArray(in, s.Position) || !ReadArray(in, s.LookAt)
+                || !ReadArray(in, s.Up) || !Read(in, firstPerson))
+            {
+                Log() << "--Erreur : Enregistrement tronque " << fileName << std::endl;
+                return false;
+            }
+            s.FirstPerson = firstPerson != 0;
+        }
+        return true;
+    }
+
+    void RecordEvent(InputEventType type, int code, int action, int mods, double x, double y)
+    {
+        InputEvent e = { s_time, type, (int16)code, (uint8)action, (uint8)mods, (float)x, (float)y };
+        s_recording.Events.push_back(e);
+    }
+
+    // Vrai si l'evenement doit etre traite par le callback
+    bool AcceptEvent(InputEventType type, int code, int action, int mods, double x, double y)
+    {
+        if (s_state == RecorderState::Replaying)
+        {
+            return s_dispatching;
+        }
+        if (s_state == RecorderState::Recording)
+        {
+            RecordEvent(type, code, action, mods, x, y);
+        }
+        return true;
+    }
+
+    void Dispatch(GLFWwindow* window, const InputEvent& e)
+    {
+        s_dispatching = true;
+        switch (e.Type)
+        {
+        case InputEventType::Key:
+            if (s_handlers.Key != nullptr)
+            {
+                s_handlers.Key(window, e.Code, 0, e.Action, e.Mods);
+            }
+            break;
+        case InputEventType::MouseButton:
+            if (s_handlers.MouseButton != nullptr)
+            {
+                s_handlers.MouseButton(window, e.Code, e.Action, e.Mods);
+            }
+            break;
+        case InputEventType::MousePosition:
+            if (s_handlers.MousePosition != nullptr)
+            {
+                s_handlers.MousePosition(window, e.X, e.Y);
+            }
+            break;
+        case InputEventType::Scroll:
+            if (s_handlers.Scroll != nullptr)
+            {
+                s_handlers.Scroll(window, e.X, e.Y);
+            }
+            break;
+        }
+        s_dispatching = false;
+    }
+
+    float Distance(const float a[3], const float b[3])
+    {
+        float dx = a[0] - b[0];
+        float dy = a[1] - b[1];
+        float dz = a[2] - b[2];
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+const float InputRecorder::REPLAY_TIME_STEP = 1.0f / 60.0f;
+
+void InputRecorder::SetHandlers(const Handlers& handlers)
+{
+    s_handlers = handlers;
+}
+
+bool InputRecorder::StartRecording(const std::string& fileName, GLFWwindow* window)
+{
+    if (s_state != RecorderState::Idle)
+    {
+        return false;
+    }
+
+    s_state = RecorderState::Recording;
+    s_recording = Recording();
+    s_fileName = fileName;
+    s_time = 0.0f;
+
+    // Position initiale du curseur, pour que les deplacements relus partent du meme point
+    double x = 0.0;
+    double y = 0.0;
+    glfwGetCursorPos(window, &x, &y);
+    RecordEvent(InputEventType::MousePosition, 0, 0, 0, x, y);
+
+    Log() << "Enregistrement des entrees dans " << fileName << std::endl;
+    return true;
+}
+
+bool InputRecorder::StopRecording()
+{
+    if (s_state != RecorderState::Recording)
+    {
+        return false;
+    }
+
+    s_state = RecorderState::Idle;
+    s_recording.Duration = s_time;
+    if (s_handlers.CurrentCamera != nullptr)
+    {
+        s_recording.Samples.push_back(SampleCamera(s_handlers.CurrentCamera(), s_time));
+    }
+
+    if (!SaveRecording(s_fileName, s_recording))
+    {
+        Log() << "--Erreur : Impossible d'ecrire l'enregistrement " << s_fileName << std::endl;
+        return false;
+    }
+
+    Log() << "Enregistrement termine : " << s_recording.Events.size() << " evenements, "
+          << s_recording.Duration << " s" << std::endl;
+    return true;
+}
+
+bool InputRecorder::IsRecording()
+{
+    return s_state == RecorderState::Recording;
+}
+
+bool InputRecorder::StartReplay(const std::string& fileName)
+{
+    if (s_state != RecorderState::Idle)
+    {
+        return false;
+    }
+
+    Recording recording;
+    if (!LoadRecording(fileName, recording))
+    {
+        return false;
+    }
+
+    s_recording = std::move(recording);
+    s_state = RecorderState::Replaying;
+    s_time = 0.0f;
+    s_nextEvent = 0;
+    std::fill(std::begin(s_keys), std::end(s_keys), false);
+
+    if (!s_recording.Samples.empty() && s_handlers.CurrentCamera != nullptr)
+    {
+        ApplyCameraSample(s_recording.Samples.front(), s_handlers.CurrentCamera());
+    }
+
+    Log() << "Relecture de " << fileName << " (" << s_recording.Duration << " s)" << std::endl;
+    return true;
+}
+
+void InputRecorder::StopReplay()
+{
+    if (s_state == RecorderState::Replaying)
+    {
+        s_state = RecorderState::Idle;
+        std::fill(std::begin(s_keys), std::end(s_keys), false);
+        Log() << "Fin de la relecture" << std::endl;
+    }
+}
+
+bool InputRecorder::IsReplaying()
+{
+    return s_state == RecorderState::Replaying;
+}
+
+bool InputRecorder::OnKey(int key, int /*scancode*/, int action, int mods)
+{
+    if (!AcceptEvent(InputEventType::Key, key, action, mods, 0.0, 0.0))
+    {
+        return false;
+    }
+    if (s_dispatching && key >= 0 && key <= GLFW_KEY_LAST && action != GLFW_REPEAT)
+    {
+        s_keys[key] = action == GLFW_PRESS;
+    }
+    return true;
+}
+
+bool InputRecorder::OnMouseButton(int button, int action, int mods)
+{
+    return AcceptEvent(InputEventType::MouseButton, button, action, mods, 0.0, 0.0);
+}
+
+bool InputRecorder::OnMousePosition(double x, double y)
+{
+    return AcceptEvent(InputEventType::MousePosition, 0, 0, 0, x, y);
+}
+
+bool InputRecorder::OnScroll(double x, double y)
+{
+    return AcceptEvent(InputEventType::Scroll, 0, 0, 0, x, y);
+}
+
+Second InputRecorder::Update(GLFWwindow* window, Second elapsed)
+{
+    if (s_state == RecorderState::Recording)
+    {
+        // Etat affiche a l'image precedente, horodate avec les evenements qui l'ont suivie
+        if (s_handlers.CurrentCamera != nullptr)
+        {
+            s_recording.Samples.push_back(SampleCamera(s_handlers.CurrentCamera(), s_time));
+        }
+        s_time += elapsed.Value();
+        return elapsed;
+    }
+
+    if (s_state != RecorderState::Replaying)
+    {
+        return elapsed;
+    }
+
+    const std::vector<InputEvent>& events = s_recording.Events;
+    if (s_nextEvent == events.size() && s_time >= s_recording.Duration)
+    {
+        // Ecart avec l'etat final enregistre, du au pas de temps fixe
+        if (!s_recording.Samples.empty() && s_handlers.CurrentCamera != nullptr)
+        {
+            CameraSample expected = s_recording.Samples.back();
+            CameraSample actual = SampleCamera(s_handlers.CurrentCamera(), s_time);
+            Log() << "Ecart de la camera en fin de relecture : " << Distance(expected.Position, actual.Position)
+                  << " m (position), " << Distance(expected.LookAt, actual.LookAt) << " m (visee)" << std::endl;
+        }
+        StopReplay();
+        return elapsed;
+    }
+
+    while (s_nextEvent < events.size() && events[s_nextEvent].Time <= s_time)
+    {
+        Dispatch(window, events[s_nextEvent]);
+        ++s_nextEvent;
+        // Un callback a pu arreter la relecture (ex. rechargement qui echoue)
+        if (s_state != RecorderState::Replaying)
+        {
+            return elapsed;
+        }
+    }
+
+    s_time += REPLAY_TIME_STEP;
+    return Second(REPLAY_TIME_STEP);
+}
+
+bool InputRecorder::IsKeyDown(GLFWwindow* window, int key)
+{
+    if (s_state == RecorderState::Replaying)
+    {
+        return key >= 0 && key <= GLFW_KEY_LAST && s_keys[key];
+    }
+    return glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+bool InputRecorder::LoadCameraPath(const std::string& fileName, std::vector<CameraSample>& samples)
+{
+    Recording recording;
+    if (!LoadRecording(fileName, recording) || recording.Samples.empty())
+    {
+        return false;
+    }
+    samples = std::move(recording.Samples);
+    return true;
+}
+
+void InputRecorder::ApplyCameraSample(const CameraSample& sample, Camera& camera)
+{
+    camera.setCoordinate(Point3<Metre>(Metre(sample.LookAt[0]), Metre(sample.LookAt[1]), Metre(sample.LookAt[2])),
+                         Point3<Metre>(Metre(sample.Position[0]), Metre(sample.Position[1]), Metre(sample.Position[2])));
+    camera.upVector() = Vector3<Real>(sample.Up[0], sample.Up[1], sample.Up[2]);
+    camera.setCameraMode(sample.FirstPerson);
+}
@@ -0,0 +1,74 @@
+#ifndef _CONTROLLER_INPUTRECORDER_H_
+#define _CONTROLLER_INPUTRECORDER_H_
+
+#include "../Utilities/Types.h"
+#include "../Utilities/Units.h"
+
+#include <string>
+#include <vector>
+
+class Camera;
+struct GLFWwindow;
+
+// Etat de la camera a un instant de l'enregistrement
+struct CameraSample
+{
+    float Time;
+    float Position[3];
+    float LookAt[3];
+    float Up[3];
+    bool FirstPerson;
+};
+
+// Enregistrement des evenements clavier/souris et de la camera dans un fichier
+// binaire, puis relecture a pas de temps fixe : la simulation ne depend plus de
+// l'horloge de la machine, donc la relecture donne les memes vues partout.
+//
+// Les callbacks GLFW passent par les filtres On* avant de traiter un evenement.
+// Pendant la relecture, les evenements reels sont ignores et ceux du fichier
+// sont renvoyes aux memes callbacks.
+class InputRecorder
+{
+public:
+    struct Handlers
+    {
+        void (*Key)(GLFWwindow* window, int key, int scancode, int action, int mods);
+        void (*MouseButton)(GLFWwindow* window, int button, int action, int mods);
+        void (*MousePosition)(GLFWwindow* window, double x, double y);
+        void (*Scroll)(GLFWwindow* window, double x, double y);
+        Camera& (*CurrentCamera)();
+    };
+
+    // Pas de temps de la relecture, en secondes
+    static const float REPLAY_TIME_STEP;
+
+    static void SetHandlers(const Handlers& handlers);
+
+    static bool StartRecording(const std::string& fileName, GLFWwindow* window);
+    static bool StopRecording();
+    static bool IsRecording();
+
+    // Replace la camera dans son etat initial enregistre
+    static bool StartReplay(const std::string& fileName);
+    static void StopReplay();
+    static bool IsReplaying();
+
+    // Filtres des callbacks : retournent faux si l'evenement doit etre ignore
+    static bool OnKey(int key, int scancode, int action, int mods);
+    static bool OnMouseButton(int button, int action, int mods);
+    static bool OnMousePosition(double x, double y);
+    static bool OnScroll(double x, double y);
+
+    // Debut d'image : retourne le pas de temps a simuler. En relecture, renvoie
+    // aux callbacks les evenements de l'intervalle et ignore elapsed.
+    static Second Update(GLFWwindow* window, Second elapsed);
+
+    // Remplace glfwGetKey : pendant la relecture, l'etat vient du fichier
+    static bool IsKeyDown(GLFWwindow* window, int key);
+
+    // Trajectoire de camera seule, pour le benchmark
+    static bool LoadCameraPath(const std::string& fileName, std::vector<CameraSample>& samples);
+    static void ApplyCameraSample(const CameraSample& sample, Camera& camera);
+};
+
+#endif
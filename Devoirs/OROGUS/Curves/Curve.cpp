@@ -2,6 +2,7 @@
 #include "../Material/Material.h"
 #include "../Material/ShaderHelper.h"
 #include "../Scene/Scene.h"
+#include "../Utilities/RenderStats.h"
 
 #include <cmath>
 
@@ -61,7 +62,10 @@ void BaseCurve::setCurvePrecision(int precision)
 
 void BaseCurve::render() const
 {
+    RenderStats& stats = RenderCounters::Current();
+
     glBindVertexArray(m_vao[1]);
+    stats.VertexArrayBinds++;
     if (m_material != nullptr)
     {
         m_material->bind();
@@ -70,12 +74,15 @@ void BaseCurve::render() const
 
         glPointSize(10.0f);
         glDrawArrays(GL_POINTS, 0, (int)m_controlPoints.size());
+        stats.DrawCalls++;
+        stats.Vertices += m_controlPoints.size();
 
         m_material->unbind();
     }
     glBindVertexArray(0);
 
     glBindVertexArray(m_vao[0]);
+    stats.VertexArrayBinds++;
     if (m_material != nullptr)
     {
         m_material->bind();
@@ -83,6 +90,8 @@ void BaseCurve::render() const
         m_material->setColor("gColor", m_color);
 
         glDrawArrays(GL_LINE_STRIP, 0, (int)m_vertices.size() - 1);
+        stats.DrawCalls++;
+        stats.Vertices += m_vertices.size() - 1;
 
         m_material->unbind();
     }
@@ -105,6 +114,7 @@ void BaseCurve::updateVAO()
 {
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer[0]);
     glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(CurveVertex), &(m_vertices[0]), GL_STATIC_DRAW);
+    RenderCounters::Current().BufferBytesUploaded += m_vertices.size() * sizeof(CurveVertex);
 
     glBindVertexArray(m_vao[0]);
     uint32 posAttribute = m_material->attribute("aPosition");
@@ -118,15 +128,13 @@ void BaseCurve::updateVAO()
     glBindVertexArray(0);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer[1]);
-    CurveVertex* points = new CurveVertex[m_controlPoints.size()];
-    int i = 0;
-    for (const Vector3<Metre>& p : m_controlPoints)
+    std::vector<CurveVertex> points(m_controlPoints.size());
+    for (size_t i = 0; i < m_controlPoints.size(); ++i)
     {
-        points[i].Position = p;
-        ++i;
+        points[i].Position = m_controlPoints[i];
     }
-    glBufferData(GL_ARRAY_BUFFER, m_controlPoints.size() * sizeof(CurveVertex), points, GL_STATIC_DRAW);
-    delete points;
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(CurveVertex), points.data(), GL_STATIC_DRAW);
+    RenderCounters::Current().BufferBytesUploaded += points.size() * sizeof(CurveVertex);
 
     glBindVertexArray(m_vao[1]);
     posAttribute = m_material->attribute("aPosition");
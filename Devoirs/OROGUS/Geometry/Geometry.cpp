@@ -1,31 +1,418 @@
 #include <glew/glew.h>
 
 #include "Geometry.h"
+#include "MeshOptimizer.h"
+#include "TangentSpace.h"
+#include "TriangleBVH.h"
 #include "../Material/Material.h"
+#include "../Render/UploadQueue.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/RenderStats.h"
+#include "../Utilities/ThreadPool.h"
 #include "../Utilities/Transforms.h"
 
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
+namespace
+{
+    // Sommets par tache de transformation (multiple de 4)
+    const uint32 VERTICES_PER_TRANSFORM_TASK = 64 * 1024;
+
+    // Matrices diffusees sur les quatre voies, ligne par ligne
+    struct VertexTransform
+    {
+        __m128 Position[12];    // 3 lignes de la matrice 4x4, translation comprise
+        __m128 Normal[9];       // Inverse transposee de la partie 3x3
+        __m128 Tangent[9];      // Partie 3x3
+        bool Mirror;            // Determinant negatif : la bitangente change de signe
+    };
+
+    // Quatre vecteurs 3D, un par voie
+    struct Lanes3
+    {
+        __m128 X;
+        __m128 Y;
+        __m128 Z;
+    };
+
+    VertexTransform MakeVertexTransform(const Transform& t)
+    {
+        // Matrice rangee par colonnes
+        const float* m = reinterpret_cast<const float*>(t.constValues());
+        float a[9];
+        for (uint32 row = 0; row < 3; ++row)
+        {
+            for (uint32 col = 0; col < 3; ++col)
+            {
+                a[row * 3 + col] = m[col * 4 + row];
+            }
+        }
+
+        // Cofacteurs : inverse transposee = cofacteurs / determinant
+        float cofactors[9] = {
+            a[4] * a[8] - a[5] * a[7], a[5] * a[6] - a[3] * a[8], a[3] * a[7] - a[4] * a[6],
+            a[2] * a[7] - a[1] * a[8], a[0] * a[8] - a[2] * a[6], a[1] * a[6] - a[0] * a[7],
+            a[1] * a[5] - a[2] * a[4], a[2] * a[3] - a[0] * a[5], a[0] * a[4] - a[1] * a[3]
+        };
+        float determinant = a[0] * cofactors[0] + a[1] * cofactors[1] + a[2] * cofactors[2];
+
+        // Les normales sont renormalisees : seul le signe du determinant compte, et une
+        // matrice singuliere garde ses cofacteurs
+        float normalScale = determinant < 0.0f ? -1.0f : 1.0f;
+
+        VertexTransform transform;
+        for (uint32 row = 0; row < 3; ++row)
+        {
+            for (uint32 col = 0; col < 4; ++col)
+            {
+                transform.Position[row * 4 + col] = _mm_set1_ps(m[col * 4 + row]);
+            }
+        }
+        for (uint32 i = 0; i < 9; ++i)
+        {
+            transform.Normal[i] = _mm_set1_ps(cofactors[i] * normalScale);
+            transform.Tangent[i] = _mm_set1_ps(a[i]);
+        }
+        transform.Mirror = determinant < 0.0f;
+        return transform;
+    }
+
+    inline Lanes3 Gather(const float* const values[4])
+    {
+        return {
+            _mm_setr_ps(values[0][0], values[1][0], values[2][0], values[3][0]),
+            _mm_setr_ps(values[0][1], values[1][1], values[2][1], values[3][1]),
+            _mm_setr_ps(values[0][2], values[1][2], values[2][2], values[3][2])
+        };
+    }
+
+    inline Lanes3 Multiply3x3(const __m128 m[9], const Lanes3& v)
+    {
+        return {
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], v.X), _mm_mul_ps(m[1], v.Y)), _mm_mul_ps(m[2], v.Z)),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], v.X), _mm_mul_ps(m[4], v.Y)), _mm_mul_ps(m[5], v.Z)),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[6], v.X), _mm_mul_ps(m[7], v.Y)), _mm_mul_ps(m[8], v.Z))
+        };
+    }
+
+    inline __m128 Dot(const Lanes3& a, const Lanes3& b)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.X, b.X), _mm_mul_ps(a.Y, b.Y)), _mm_mul_ps(a.Z, b.Z));
+    }
+
+    // Un vecteur nul reste nul
+    inline Lanes3 Normalize(const Lanes3& v)
+    {
+        __m128 length = _mm_sqrt_ps(Dot(v, v));
+        __m128 valid = _mm_cmpneq_ps(length, _mm_setzero_ps());
+        __m128 inverse = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), length));
+        return { _mm_mul_ps(v.X, inverse), _mm_mul_ps(v.Y, inverse), _mm_mul_ps(v.Z, inverse) };
+    }
+
+    // Tableaux alignes recevant les quatre voies d'un Lanes3
+    struct LaneStore
+    {
+        alignas(16) float X[4];
+        alignas(16) float Y[4];
+        alignas(16) float Z[4];
+
+        explicit LaneStore(const Lanes3& value)
+        {
+            _mm_store_ps(X, value.X);
+            _mm_store_ps(Y, value.Y);
+            _mm_store_ps(Z, value.Z);
+        }
+    };
+
+    // Transforme vertices[0..count[, count <= 4 ; les voies en trop reprennent le premier sommet
+    void TransformVertexBatch(const VertexTransform& t, Vertex* vertices, uint32 count)
+    {
+        const float* positions[4];
+        const float* normals[4];
+        const float* tangents[4];
+        for (uint32 lane = 0; lane < 4; ++lane)
+        {
+            const Vertex& v = vertices[lane < count ? lane : 0];
+            positions[lane] = v.Position.constValues();
+            normals[lane] = v.Normal.constValues();
+            tangents[lane] = v.Tangent.constValues();
+        }
+
+        const __m128* m = t.Position;
+        Lanes3 p = Gather(positions);
+        Lanes3 position = {
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], p.X), _mm_mul_ps(m[1], p.Y)), _mm_add_ps(_mm_mul_ps(m[2], p.Z), m[3])),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], p.X), _mm_mul_ps(m[5], p.Y)), _mm_add_ps(_mm_mul_ps(m[6], p.Z), m[7])),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[8], p.X), _mm_mul_ps(m[9], p.Y)), _mm_add_ps(_mm_mul_ps(m[10], p.Z), m[11]))
+        };
+        Lanes3 normal = Normalize(Multiply3x3(t.Normal, Gather(normals)));
+
+        // Une echelle non uniforme desorthogonalise la tangente : Gram-Schmidt
+        Lanes3 tangent = Multiply3x3(t.Tangent, Gather(tangents));
+        __m128 d = Dot(normal, tangent);
+        tangent = Normalize({ _mm_sub_ps(tangent.X, _mm_mul_ps(normal.X, d)),
+                              _mm_sub_ps(tangent.Y, _mm_mul_ps(normal.Y, d)),
+                              _mm_sub_ps(tangent.Z, _mm_mul_ps(normal.Z, d)) });
+
+        LaneStore outPosition(position);
+        LaneStore outNormal(normal);
+        LaneStore outTangent(tangent);
+        for (uint32 lane = 0; lane < count; ++lane)
+        {
+            Vertex& v = vertices[lane];
+            v.Position = Point3<Metre>(outPosition.X[lane], outPosition.Y[lane], outPosition.Z[lane]);
+            v.Normal = Vector3<Real>(outNormal.X[lane], outNormal.Y[lane], outNormal.Z[lane]);
+            v.Tangent = Vector3<Real>(outTangent.X[lane], outTangent.Y[lane], outTangent.Z[lane]);
+            if (t.Mirror)
+            {
+                v.Handedness = -v.Handedness;
+            }
+        }
+    }
+
+    void TransformVertexBlock(const VertexTransform& t, Vertex* vertices, uint32 count)
+    {
+        for (uint32 i = 0; i < count; i += 4)
+        {
+            TransformVertexBatch(t, vertices + i, std::min(4u, count - i));
+        }
+    }
+
+    // Les grandes plages sont reparties sur le ThreadPool
+    void TransformVertices(const VertexTransform& t, Vertex* vertices, uint32 count)
+    {
+        if (count <= VERTICES_PER_TRANSFORM_TASK)
+        {
+            TransformVertexBlock(t, vertices, count);
+            return;
+        }
+
+        uint32 blocks = (count + VERTICES_PER_TRANSFORM_TASK - 1) / VERTICES_PER_TRANSFORM_TASK;
+        ThreadPool::ParallelFor(blocks, [&](uint32 block)
+        {
+            uint32 begin = block * VERTICES_PER_TRANSFORM_TASK;
+            TransformVertexBlock(t, vertices + begin, std::min(VERTICES_PER_TRANSFORM_TASK, count - begin));
+        });
+    }
+
+    void ComputeRangeBounds(const Vertex* vertices, uint32 count, Point3<Metre>& boundsMin, Point3<Metre>& boundsMax)
+    {
+        float minimum[3] = { 0.0f, 0.0f, 0.0f };
+        float maximum[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32 i = 0; i < count; ++i)
+        {
+            const float* p = vertices[i].Position.constValues();
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                minimum[axis] = i == 0 ? p[axis] : std::min(minimum[axis], p[axis]);
+                maximum[axis] = i == 0 ? p[axis] : std::max(maximum[axis], p[axis]);
+            }
+        }
+        boundsMin = Point3<Metre>(minimum[0], minimum[1], minimum[2]);
+        boundsMax = Point3<Metre>(maximum[0], maximum[1], maximum[2]);
+    }
+
+    // Deux points par sommet : la position et le bout de la normale
+    void BuildNormalLines(const Vertex* vertices, uint32 count, Point3<Metre>* out)
+    {
+        for (uint32 i = 0; i < count; ++i)
+        {
+            out[i * 2] = vertices[i].Position;
+            out[i * 2 + 1] = vertices[i].Position + (vertices[i].Normal * Metre(1));
+        }
+    }
+
+    // Preparation des mises a jour partielles, gardee d'une image a l'autre pour les
+    // geometries modifiees a chaque image (thread GL seulement). BufferSubData ecrit
+    // ou copie les donnees avant de retourner : le tampon peut etre reutilise aussitot.
+    std::vector<Point3<Metre>> s_normalRangeStaging;
+    std::vector<uint8> s_vertexRangeStaging;
+
+    template<typename T>
+    T* GrowStaging(std::vector<T>& staging, size_t count)
+    {
+        if (staging.size() < count)
+        {
+            staging.resize(count);
+        }
+        return staging.data();
+    }
+}
+
 Geometry* Geometry::CreateGeometry(const std::string& name, std::vector<Vertex>&& vertices, std::vector<uint32>&& indices)
 {
-    Geometry* geom = new Geometry(name);
-    geom->setGeometryData(std::move(vertices), std::move(indices));
+    GeometryData data;
+    data.Vertices = std::move(vertices);
+    data.Indices = std::move(indices);
+    Prepare(name, data);
+	return CreatePrepared(name, std::move(data));
+}
+
+void Geometry::Prepare(const std::string& name, GeometryData& data)
+{
+    // Reordonne les triangles et les sommets avant le calcul des normales,
+    // pour que l'ordre d'accumulation soit celui des triangles optimises
+    if (data.Optimize)
+    {
+        MeshOptimizer::Optimize(data.Vertices, data.Indices, name);
+    }
+
+    if (data.ComputeNormals)
+    {
+        TangentSpace::ComputeNormals(data.Vertices, data.Indices);
+        data.ComputeNormals = false;
+    }
+}
+
+Geometry* Geometry::CreatePrepared(const std::string& name, GeometryData&& data, const VertexFormat& format)
+{
+    Geometry* geom = new Geometry(name, format);
+    geom->m_vertices = std::move(data.Vertices);
+    geom->m_indices = std::move(data.Indices);
+    geom->updateVertexBuffer();
+    geom->updateIndexBuffer();
 	return geom;
 }
 
+Geometry* Geometry::CreateFromEncoded(const std::string& name, const Vertex* vertices, uint32 vertexCount,
+                                      const void* indices, uint32 indexCount, bool shortIndices, const EncodedGeometry& encoded,
+                                      const VertexFormat& format)
+{
+    PROFILE_SCOPE("Geometry::CreateFromEncoded");
+
+    Geometry* geom = new Geometry(name, format);
+    geom->m_vertices.assign(vertices, vertices + vertexCount);
+    if (shortIndices)
+    {
+        const uint16* source = static_cast<const uint16*>(indices);
+        geom->m_indices.assign(source, source + indexCount);
+    }
+    else
+    {
+        const uint32* source = static_cast<const uint32*>(indices);
+        geom->m_indices.assign(source, source + indexCount);
+    }
+    geom->m_vertexCount = vertexCount;
+    geom->m_indexCount = indexCount;
+
+    bool encodedStreams = encoded.Format == geom->m_layout.getFormat();
+    for (uint32 stream = 0; stream < VERTEX_STREAM_COUNT; ++stream)
+    {
+        encodedStreams = encodedStreams && (stream == VERTEX_STREAM_TANGENT || encoded.Streams[stream] != nullptr);
+    }
+
+    if (encodedStreams)
+    {
+        geom->m_boundsMin = encoded.BoundsMin;
+        geom->m_boundsMax = encoded.BoundsMax;
+        geom->m_positionOffset = encoded.PositionOffset;
+        geom->m_positionScale = encoded.PositionScale;
+        geom->updateNormalVertexBuffer();
+
+        for (uint32 stream = VERTEX_STREAM_POSITION; stream <= VERTEX_STREAM_SHADING; ++stream)
+        {
+            size_t size = (size_t)vertexCount * geom->m_layout.getStride(stream);
+            geom->uploadBuffer(geom->m_vertexBuffers[stream], size, encoded.Streams[stream]);
+        }
+    }
+    else
+    {
+        geom->updateVertexBuffer();
+    }
+
+    size_t indexSize = shortIndices ? sizeof(uint16) : sizeof(uint32);
+    geom->m_indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    geom->uploadBuffer(geom->m_indexBuffer, indexCount * indexSize, indices);
+    return geom;
+}
+
 Geometry* Geometry::Combine(const std::string& name, const Geometry& first, const Geometry& second)
 {
+    Transform identity;
+    return CreateBatch(name, { &first, &second }, { identity, identity });
+}
+
+Geometry* Geometry::CreateBatch(const std::string& name, const std::vector<const Geometry*>& parts, const std::vector<Transform>& transforms)
+{
+    PROFILE_SCOPE("Geometry::CreateBatch");
+
     Geometry* geom = new Geometry(name);
-    geom->merge(first);
-    geom->merge(second);
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (const Geometry* part : parts)
+    {
+        vertexCount += part->m_vertices.size();
+        indexCount += part->m_indices.size();
+    }
+    geom->m_vertices.reserve(vertexCount);
+    geom->m_indices.reserve(indexCount);
+    geom->m_ranges.reserve(parts.size());
+
+    bool partialTangents = false;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        const Geometry& part = *parts[i];
+        if (!part.requireVertexData("Geometry::CreateBatch"))
+        {
+            continue;
+        }
+
+        if (geom->m_ranges.empty())
+        {
+            // Le lot prend le format et la couleur de sa premiere partie
+            geom->m_layout = part.m_layout;
+            geom->m_color = part.m_color;
+        }
+        partialTangents = partialTangents || (geom->m_requiresTangents != part.m_requiresTangents && !geom->m_ranges.empty());
+        geom->m_requiresTangents = geom->m_requiresTangents || part.m_requiresTangents;
+
+        uint32 firstVertex = (uint32)geom->m_vertices.size();
+        uint32 firstIndex = (uint32)geom->m_indices.size();
+        geom->append(part, &transforms[i]);
+
+        GeometryRange range;
+        range.FirstIndex = firstIndex;
+        range.IndexCount = (uint32)geom->m_indices.size() - firstIndex;
+        ComputeRangeBounds(&geom->m_vertices[firstVertex], (uint32)part.m_vertices.size(), range.BoundsMin, range.BoundsMax);
+        geom->m_ranges.push_back(range);
+    }
+
+    if (partialTangents)
+    {
+        geom->updateTangents();
+    }
+    geom->updateVertexBuffer();
+    geom->updateIndexBuffer();
     return geom;
 }
 
 Geometry::Geometry(const std::string& name)
-    : m_color(Color::White())
+    : Geometry(name, VertexFormat::Default())
+{
+}
+
+Geometry::Geometry(const std::string& name, const VertexFormat& format)
+    : m_indexType(GL_UNSIGNED_INT)
+    , m_vertexCount(0)
+    , m_indexCount(0)
+    , m_residency(GeometryResidency::KeepAll)
+    , m_uploadTicket(0)
+    , m_requiresTangents(false)
+    , m_dirtyBegin(0)
+    , m_dirtyEnd(0)
+    , m_color(Color::White())
+    , m_layout(format)
+    , m_positionOffset(0.0f, 0.0f, 0.0f)
+    , m_positionScale(1.0f, 1.0f, 1.0f)
     , m_name(name)
+    , m_bvh(nullptr)
 {
-    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(VERTEX_STREAM_COUNT, m_vertexBuffers);
     glGenBuffers(1, &m_indexBuffer);
     glGenBuffers(1, &m_normalVertexBuffer);
 }
@@ -52,19 +439,205 @@ void Geometry::setColor(const Color& c)
 
 void Geometry::render(const Material& mat) const
 {
-    mat.setColor("uColor", getColor());    
-    glDrawElements(GL_TRIANGLES, (int)m_indices.size(), GL_UNSIGNED_INT, 0);
+    if (!isUploaded())
+    {
+        return;
+    }
+
+    mat.setDrawColor(getColor());
+    mat.setVertexDecoding(m_layout.getFormat(), m_positionOffset, m_positionScale);
+    glDrawElements(GL_TRIANGLES, (int)m_indexCount, m_indexType, 0);
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.DrawCalls++;
+    stats.Triangles += m_indexCount / 3;
+    stats.Vertices += m_indexCount;
 }
 
 void Geometry::renderNormal() const
 {
-    glDrawArrays(GL_LINES, 0, (int)m_normalVertices.size());
+    if (!isUploaded())
+    {
+        return;
+    }
+
+    // Deux extremites par sommet
+    glDrawArrays(GL_LINES, 0, (int)m_vertexCount * 2);
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.DrawCalls++;
+    stats.Vertices += m_vertexCount * 2;
+}
+
+const Point3<Metre>& Geometry::getBoundsMin() const
+{
+    return m_boundsMin;
+}
+
+const Point3<Metre>& Geometry::getBoundsMax() const
+{
+    return m_boundsMax;
+}
+
+GeometryResidency Geometry::getResidency() const
+{
+    return m_residency;
+}
+
+void Geometry::setResidency(GeometryResidency residency)
+{
+    if (residency <= m_residency)
+    {
+        return;
+    }
+
+    if (m_residency == GeometryResidency::KeepAll)
+    {
+        // Les tangentes non demandees avant ce point ne seront jamais envoyees
+        // (requireAttributes) : elles ne coutent rien aux maillages qui ne les lisent pas
+        commitVertexChanges();
+
+        if (residency == GeometryResidency::PickingOnly)
+        {
+            m_positions.reserve(m_vertices.size());
+            for (const Vertex& v : m_vertices)
+            {
+                m_positions.push_back(v.Position);
+            }
+        }
+        std::vector<Vertex>().swap(m_vertices);
+    }
+
+    if (residency == GeometryResidency::GpuOnly)
+    {
+        invalidateBVH();
+        std::vector<Point3<Metre>>().swap(m_positions);
+        std::vector<uint32>().swap(m_indices);
+    }
+    m_residency = residency;
+}
+
+const std::vector<Vertex>& Geometry::getVertices() const
+{
+    return m_vertices;
+}
+
+const std::vector<uint32>& Geometry::getIndices() const
+{
+    return m_indices;
+}
+
+const std::vector<GeometryRange>& Geometry::getRanges() const
+{
+    return m_ranges;
+}
+
+bool Geometry::hasPickingData() const
+{
+    return m_residency != GeometryResidency::GpuOnly;
+}
+
+uint32 Geometry::getVertexCount() const
+{
+    return m_vertexCount;
 }
 
-void Geometry::bindBuffersVAO() const
+uint32 Geometry::getTriangleCount() const
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    return m_indexCount / 3;
+}
+
+const Point3<Metre>& Geometry::getPosition(uint32 vertex) const
+{
+    return m_residency == GeometryResidency::KeepAll ? m_vertices[vertex].Position : m_positions[vertex];
+}
+
+const TriangleBVH* Geometry::getBVH() const
+{
+    if (m_bvh == nullptr && hasPickingData())
+    {
+        m_bvh = new TriangleBVH(*this);
+    }
+    return m_bvh;
+}
+
+size_t Geometry::getCpuMemoryBytes() const
+{
+    return m_vertices.capacity() * sizeof(Vertex)
+         + m_indices.capacity() * sizeof(uint32)
+         + m_positions.capacity() * sizeof(Point3<Metre>)
+         + (m_bvh != nullptr ? m_bvh->getMemoryBytes() : 0);
+}
+
+size_t Geometry::getGpuMemoryBytes() const
+{
+    size_t bytes = (size_t)m_indexCount * (m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16) : sizeof(uint32));
+    bytes += (size_t)m_vertexCount * 2 * sizeof(Point3<Metre>);
+    for (uint32 stream = 0; stream < VERTEX_STREAM_COUNT; ++stream)
+    {
+        if (stream != VERTEX_STREAM_TANGENT || m_requiresTangents)
+        {
+            bytes += (size_t)m_vertexCount * m_layout.getStride(stream);
+        }
+    }
+    return bytes;
+}
+
+bool Geometry::requireVertexData(const char* operation) const
+{
+    if (m_residency != GeometryResidency::KeepAll)
+    {
+        Log() << "--Erreur : " << operation << " impossible, les sommets de " << m_name << " ne sont plus en memoire" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Geometry::isUploaded() const
+{
+    return UploadQueue::IsComplete(m_uploadTicket);
+}
+
+const VertexLayout& Geometry::getVertexLayout() const
+{
+    return m_layout;
+}
+
+bool Geometry::requireAttributes(uint32 attributeMask)
+{
+    if ((attributeMask & VERTEX_TANGENT) == 0 || m_requiresTangents)
+    {
+        return true;
+    }
+
+    if (!canProvideAttributes(attributeMask))
+    {
+        Log() << "--Erreur : " << m_name << " n'a pas de tangentes et ses sommets ne sont plus en memoire ; "
+              << "le materiel doit etre connu au chargement ou la residence doit etre complete" << std::endl;
+        return false;
+    }
+
+    m_requiresTangents = true;
+    updateTangents();
+    updateVertexStream(VERTEX_STREAM_TANGENT, m_positionOffset.constValues(), m_positionScale.constValues());
+    return true;
+}
+
+bool Geometry::canProvideAttributes(uint32 attributeMask) const
+{
+    return (attributeMask & VERTEX_TANGENT) == 0 || m_requiresTangents || m_residency == GeometryResidency::KeepAll;
+}
+
+void Geometry::bindBuffersVAO(const Material& mat)
+{
+    uint32 attributeMask = mat.getAttributeMask();
+    if (!requireAttributes(attributeMask))
+    {
+        attributeMask &= ~(uint32)VERTEX_TANGENT;
+    }
+
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    m_layout.setupAttributes(attributeMask, mat, m_vertexBuffers);
 }
 
 void Geometry::bindBuffersNormalVAO() const
@@ -74,141 +647,316 @@ void Geometry::bindBuffersNormalVAO() const
 
 void Geometry::unload()
 {
-    glDeleteBuffers(1, &m_vertexBuffer);
+    for (uint32 stream = 0; stream < VERTEX_STREAM_COUNT; ++stream)
+    {
+        UploadQueue::CancelBuffer(m_vertexBuffers[stream]);
+    }
+    UploadQueue::CancelBuffer(m_indexBuffer);
+    UploadQueue::CancelBuffer(m_normalVertexBuffer);
+    glDeleteBuffers(VERTEX_STREAM_COUNT, m_vertexBuffers);
     glDeleteBuffers(1, &m_indexBuffer);
     glDeleteBuffers(1, &m_normalVertexBuffer);
     unloadData();    
 }
 
-void Geometry::setGeometryData(std::vector<Vertex>&& vertices, std::vector<uint32>&& indices)
+void Geometry::updateIndexBuffer()
 {
-	unloadData();
+    PROFILE_SCOPE("Geometry::updateIndexBuffer");
+    m_indexCount = (uint32)m_indices.size();
+    if (m_vertices.size() < 0x10000)
+    {
+        // Tous les indices tiennent sur 16 bits
+        std::vector<uint16> shortIndices(m_indices.begin(), m_indices.end());
+        m_indexType = GL_UNSIGNED_SHORT;
+        uploadBuffer(m_indexBuffer, shortIndices.size() * sizeof(uint16), shortIndices.data());
+    }
+    else
+    {
+        m_indexType = GL_UNSIGNED_INT;
+        uploadBuffer(m_indexBuffer, m_indices.size() * sizeof(uint32), m_indices.data());
+    }
+}
+
+// Retourne vrai si le decodage des positions quantifiees a change
+bool Geometry::updateBounds()
+{
+    float minimum[3];
+    float maximum[3];
+    float offset[3];
+    float scale[3];
+    ComputeBounds(m_vertices, m_layout.getFormat(), minimum, maximum, offset, scale);
+    m_boundsMin = Point3<Metre>(minimum[0], minimum[1], minimum[2]);
+    m_boundsMax = Point3<Metre>(maximum[0], maximum[1], maximum[2]);
+
+    Vector3<Real> positionOffset(offset[0], offset[1], offset[2]);
+    Vector3<Real> positionScale(scale[0], scale[1], scale[2]);
+    bool changed = positionOffset != m_positionOffset || positionScale != m_positionScale;
+    m_positionOffset = positionOffset;
+    m_positionScale = positionScale;
+    return changed;
+}
 
-	m_vertices = std::move(vertices);
-	m_indices = std::move(indices);
+void Geometry::updateVertexBuffer()
+{
+    PROFILE_SCOPE("Geometry::updateVertexBuffer");
+    m_vertexCount = (uint32)m_vertices.size();
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+    updateNormalVertexBuffer();
+    updateBounds();
+
+    const float* offset = m_positionOffset.constValues();
+    const float* scale = m_positionScale.constValues();
+    updateVertexStream(VERTEX_STREAM_POSITION, offset, scale);
+    updateVertexStream(VERTEX_STREAM_SHADING, offset, scale);
+    if (m_requiresTangents)
+    {
+        updateVertexStream(VERTEX_STREAM_TANGENT, offset, scale);
+    }
+}
 
-	constructTrianglesList();
-	updateTangents();
+void Geometry::updateNormalVertexBuffer()
+{
+    // Envoi complet, fait au chargement : la copie est liberee aussitot
+    std::vector<Point3<Metre>> normalVertices(m_vertices.size() * 2);
+    BuildNormalLines(m_vertices.data(), (uint32)m_vertices.size(), normalVertices.data());
 
-	updateVertexBuffer();
-	updateIndexBuffer();
+    uploadBuffer(m_normalVertexBuffer, normalVertices.size() * sizeof(Point3<Metre>), normalVertices.data());
 }
 
-void Geometry::updateIndexBuffer() const 
+void Geometry::updateVertexRange(uint32 first, uint32 count)
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32), &(m_indices[0]), GL_STATIC_DRAW);
+    PROFILE_SCOPE("Geometry::updateVertexRange");
+    const Vertex* vertices = &m_vertices[first];
+
+    Point3<Metre>* normalVertices = GrowStaging(s_normalRangeStaging, (size_t)count * 2);
+    BuildNormalLines(vertices, count, normalVertices);
+    UploadQueue::BufferSubData(m_normalVertexBuffer, (size_t)first * 2 * sizeof(Point3<Metre>),
+                               (size_t)count * 2 * sizeof(Point3<Metre>), normalVertices);
+
+    const float* offset = m_positionOffset.constValues();
+    const float* scale = m_positionScale.constValues();
+    uint32 lastStream = m_requiresTangents ? VERTEX_STREAM_TANGENT : VERTEX_STREAM_SHADING;
+    for (uint32 stream = VERTEX_STREAM_POSITION; stream <= lastStream; ++stream)
+    {
+        uint32 stride = m_layout.getStride(stream);
+        uint8* vertexData = GrowStaging(s_vertexRangeStaging, (size_t)count * stride);
+        m_layout.encode(vertices, count, stream, offset, scale, vertexData);
+        UploadQueue::BufferSubData(m_vertexBuffers[stream], (size_t)first * stride, (size_t)count * stride, vertexData);
+    }
 }
 
-void Geometry::updateVertexBuffer()
+void Geometry::markDirty(uint32 first, uint32 count)
 {
-    m_normalVertices.clear();
-    for (Vertex& v : m_vertices)
+    invalidateBVH();
+    if (m_dirtyBegin == m_dirtyEnd)
     {
-        Point3<Metre> first = v.Position;
-        Point3<Metre> second = v.Position + (v.Normal * Metre(1));
-        m_normalVertices.push_back(first);
-        m_normalVertices.push_back(second);
+        m_dirtyBegin = first;
+        m_dirtyEnd = first + count;
     }
+    else
+    {
+        m_dirtyBegin = std::min(m_dirtyBegin, first);
+        m_dirtyEnd = std::max(m_dirtyEnd, first + count);
+    }
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_normalVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_normalVertices.size() * sizeof(Point3<Metre>), &(m_normalVertices[0]), GL_STATIC_DRAW);
+void Geometry::updateVertexStream(uint32 stream, const float positionOffset[3], const float positionScale[3])
+{
+    std::vector<uint8> vertexData(m_vertices.size() * m_layout.getStride(stream));
+    m_layout.encode(m_vertices, stream, positionOffset, positionScale, vertexData.data());
+
+    uploadBuffer(m_vertexBuffers[stream], vertexData.size(), vertexData.data());
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), &(m_vertices[0]), GL_STATIC_DRAW);	
+void Geometry::uploadBuffer(uint32 buffer, size_t size, const void* data)
+{
+    // Les gros tampons sont copies et envoyes par morceaux sur les images suivantes
+    m_uploadTicket = std::max(m_uploadTicket, UploadQueue::BufferData(buffer, size, data));
 }
 
 void Geometry::updateTangents()
 {
-    for (Triangle& t : m_triangles)
+    TangentSpace::ComputeTangents(m_vertices, m_indices);
+}
+
+void Geometry::updateNormals()
+{
+    if (!requireVertexData("Geometry::updateNormals"))
     {
-        Vertex& v1 = t.Vertex1;
-        Vertex& v2 = t.Vertex2;
-        Vertex& v3 = t.Vertex3;
+        return;
+    }
 
-        Vector3<Metre> edge1 = v2.Position - v1.Position;
-        Vector3<Metre> edge2 = v3.Position - v1.Position;
-        Vector2<Real> dUV1 = v2.TexCoord - v1.TexCoord;
-        Vector2<Real> dUV2 = v3.TexCoord - v1.TexCoord;
+    TangentSpace::ComputeNormals(m_vertices, m_indices);
+    if (m_requiresTangents)
+    {
+        // L'orthogonalisation des tangentes depend des normales
+        updateTangents();
+    }
+    updateVertexBuffer();
+}
 
-        float f = 1.0f / (dUV1.x() * dUV2.y() - dUV2.x() * dUV1.y());
+void Geometry::ComputeBounds(const std::vector<Vertex>& vertices, const VertexFormat& format,
+                             float boundsMin[3], float boundsMax[3], float positionOffset[3], float positionScale[3])
+{
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        boundsMin[i] = 0.0f;
+        boundsMax[i] = 0.0f;
+        positionOffset[i] = 0.0f;
+        positionScale[i] = 1.0f;
+    }
 
-        v1.Tangent = Vector3<Metre>(f * (dUV2.y() * edge1.x() - dUV1.y() * edge2.x()), f * (dUV2.y() * edge1.y() - dUV1.y() * edge2.y()), f * (dUV2.y() * edge1.z() - dUV1.y() * edge2.z())).normalized();
-        v2.Tangent = v1.Tangent;
-        v3.Tangent = v1.Tangent;
+    if (!vertices.empty())
+    {
+        const float* first = vertices[0].Position.constValues();
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            boundsMin[i] = first[i];
+            boundsMax[i] = first[i];
+        }
+        for (const Vertex& v : vertices)
+        {
+            const float* p = v.Position.constValues();
+            for (uint32 i = 0; i < 3; ++i)
+            {
+                boundsMin[i] = std::min(boundsMin[i], p[i]);
+                boundsMax[i] = std::max(boundsMax[i], p[i]);
+            }
+        }
     }
 
-    for (Vertex& v : m_vertices)
+    if (format.Position == PositionEncoding::Unorm16)
     {
-        v.Tangent = v.Tangent.normalized();
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            positionOffset[i] = boundsMin[i];
+            positionScale[i] = boundsMax[i] - boundsMin[i];
+        }
     }
 }
 
-void Geometry::updateNormals()
+void Geometry::unloadData()
+{
+    invalidateBVH();
+    m_indices.clear();
+    m_vertices.clear();
+    m_positions.clear();
+}
+
+void Geometry::invalidateBVH()
 {
-	// TP3 : � compl�ter
-    for (Triangle triangle : m_triangles) {
-        Point3<Metre> p1 = triangle.Vertex1.Position;
-        Point3<Metre> p2 = triangle.Vertex2.Position;
-        Point3<Metre> p3 = triangle.Vertex3.Position;
+    delete m_bvh;
+    m_bvh = nullptr;
+}
+
+void Geometry::transform(const Transform& t)
+{
+    transformVertices(t, 0, (uint32)m_vertices.size());
+    commitVertexChanges();
+}
 
-        Vector3<Real> normal = (p2 - p1).normalized().crossProduct((p3 - p1).normalized());
-        triangle.Vertex1.Normal += normal.normalized();
-        triangle.Vertex2.Normal += normal.normalized();
-        triangle.Vertex3.Normal += normal.normalized();
+void Geometry::transformVertices(const Transform& t, uint32 first, uint32 count)
+{
+    if (!requireVertexData("Geometry::transformVertices"))
+    {
+        return;
+    }
+    if (first > m_vertices.size() || count > m_vertices.size() - first)
+    {
+        Log() << "--Erreur : Geometry::transformVertices hors limites sur " << m_name << std::endl;
+        return;
     }
-    for (Triangle triangle : m_triangles) {
-        triangle.Vertex1.Normal = triangle.Vertex1.Normal.normalized();
-        triangle.Vertex2.Normal = triangle.Vertex2.Normal.normalized();
-        triangle.Vertex3.Normal = triangle.Vertex3.Normal.normalized();
+    if (count == 0)
+    {
+        return;
     }
-    updateVertexBuffer();
+
+    PROFILE_SCOPE("Geometry::transformVertices");
+    TransformVertices(MakeVertexTransform(t), &m_vertices[first], count);
+    markDirty(first, count);
 }
 
-void Geometry::constructTrianglesList()
+void Geometry::updateVertices(uint32 first, const Vertex* vertices, uint32 count)
 {
-    for (uint32 i = 0; i < m_indices.size(); i += 3)
+    if (!requireVertexData("Geometry::updateVertices"))
+    {
+        return;
+    }
+    if (first > m_vertices.size() || count > m_vertices.size() - first)
+    {
+        Log() << "--Erreur : Geometry::updateVertices hors limites sur " << m_name << std::endl;
+        return;
+    }
+    if (count == 0)
     {
-        Triangle t(m_vertices[m_indices[i]], m_vertices[m_indices[i + 1]], m_vertices[m_indices[i + 2]]);
-        m_triangles.push_back(t);
+        return;
     }
+
+    std::copy(vertices, vertices + count, m_vertices.begin() + first);
+    markDirty(first, count);
 }
 
-void Geometry::unloadData()
+void Geometry::commitVertexChanges()
 {
-    m_triangles.clear();
-    m_indices.clear();
-    m_vertices.clear();
-	m_normalVertices.clear();
+    if (m_dirtyBegin == m_dirtyEnd)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("Geometry::commitVertexChanges");
+    uint32 first = m_dirtyBegin;
+    uint32 count = m_dirtyEnd - m_dirtyBegin;
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+
+    // Des positions quantifiees dans l'ancienne boite ne decodent plus correctement
+    // si la boite change : tout le flux est alors reencode
+    bool decodingChanged = updateBounds();
+    if (m_vertexCount != m_vertices.size() ||
+        (decodingChanged && m_layout.getFormat().Position == PositionEncoding::Unorm16))
+    {
+        updateVertexBuffer();
+        return;
+    }
+
+    updateVertexRange(first, count);
 }
 
-void Geometry::transform(const Transform& t)
+void Geometry::append(const Geometry& other, const Transform* t)
 {
-    for (Vertex& v : m_vertices)
+    uint32 firstVertex = (uint32)m_vertices.size();
+    m_vertices.insert(m_vertices.end(), other.m_vertices.begin(), other.m_vertices.end());
+    if (t != nullptr && !t->isIdentity())
     {
-        v.Position = t * v.Position;
+        TransformVertices(MakeVertexTransform(*t), &m_vertices[firstVertex], (uint32)other.m_vertices.size());
     }
 
-	updateVertexBuffer();
+    size_t firstIndex = m_indices.size();
+    m_indices.resize(firstIndex + other.m_indices.size());
+    std::transform(other.m_indices.begin(), other.m_indices.end(), m_indices.begin() + firstIndex,
+                   [firstVertex](uint32 index) { return firstVertex + index; });
 }
 
 void Geometry::merge(const Geometry& other)
 {
-    uint32 nbVertex = (uint32)m_vertices.size();
-    for (Vertex v : other.m_vertices)
+    if (!requireVertexData("Geometry::merge") || !other.requireVertexData("Geometry::merge"))
     {
-        m_vertices.push_back(v);
+        return;
     }
 
-    for (uint32 i : other.m_indices)
+    PROFILE_SCOPE("Geometry::merge");
+    invalidateBVH();
+    append(other, nullptr);
+
+    // Les sous-ensembles ne decrivent plus la geometrie
+    m_ranges.clear();
+
+    if (m_requiresTangents && !other.m_requiresTangents)
     {
-        m_indices.push_back(nbVertex + i);
+        updateTangents();
     }
 
-    m_triangles.clear();
-    constructTrianglesList();
-    updateTangents();
-
 	updateVertexBuffer();
 	updateIndexBuffer();
 }
@@ -1,6 +1,7 @@
 #ifndef _GEOMETRY_GEOMETRY_H_
 #define _GEOMETRY_GEOMETRY_H_
 
+#include "VertexFormat.h"
 #include "../Utilities/Color.h"
 #include "../Utilities/Point.h"
 #include "../Utilities/Types.h"
@@ -12,6 +13,7 @@
 
 class Material;
 class Transform;
+class TriangleBVH;
 
 struct Vertex
 {
@@ -19,12 +21,14 @@ struct Vertex
     Vector3<Real> Normal;
     Vector3<Real> Tangent;
     Vector2<Real> TexCoord;
+    float Handedness;   // Signe de la bitangente : cross(Normal, Tangent) * Handedness
 
     Vertex(const Point3<Metre>& pos, const Vector3<Real>& normal, const Vector3<Real>& tangent, const Vector2<Real>& uv)
         : Position(pos)
         , Normal(normal)
         , Tangent(tangent)
         , TexCoord(uv)
+        , Handedness(1.0f)
     {
     }
 
@@ -33,16 +37,18 @@ struct Vertex
         , Normal(normal)
         , Tangent()
         , TexCoord(uv)
+        , Handedness(1.0f)
     {
     }
 
     Vertex()
+        : Handedness(1.0f)
     {
     }
 
     bool operator==(const Vertex& v1) const
     {
-        return Position == v1.Position && Normal == v1.Normal && Tangent == v1.Tangent && TexCoord == v1.TexCoord;
+        return Position == v1.Position && Normal == v1.Normal && Tangent == v1.Tangent && TexCoord == v1.TexCoord && Handedness == v1.Handedness;
     }
 
     bool operator!=(const Vertex& v1) const
@@ -51,47 +57,128 @@ struct Vertex
     }
 };
 
-struct Triangle
+// Donnees gardees en memoire centrale une fois les tampons envoyes. On ne peut
+// que descendre dans cette liste : les donnees liberees ne reviennent pas.
+enum class GeometryResidency
 {
-	Vertex& Vertex1;
-	Vertex& Vertex2;
-	Vertex& Vertex3;
-
-    Triangle(Vertex& v1, Vertex& v2, Vertex& v3)
-        : Vertex1(v1)
-        , Vertex2(v2)
-        , Vertex3(v3)
-    {
-    }
+    KeepAll,        // Sommets complets et indices : transform, merge, updateNormals...
+    PickingOnly,    // Positions et indices, pour la selection et les boites englobantes
+    GpuOnly         // Plus rien en memoire centrale
+};
+
+// Geometrie en memoire centrale. Elle peut etre preparee sur un autre thread que
+// celui du contexte GL, puis creee avec Geometry::CreatePrepared.
+struct GeometryData
+{
+    std::vector<Vertex> Vertices;
+    std::vector<uint32> Indices;
+    bool ComputeNormals = false;    // Normales a recalculer a partir des faces
+    bool Optimize = true;           // Faux si les triangles sont deja dans un ordre favorable au cache
+};
+
+// Flux de sommets deja encodes, par exemple projetes depuis un cache .omesh.
+// Les pointeurs ne sont lus que pendant Geometry::CreateFromEncoded.
+struct EncodedGeometry
+{
+    VertexFormat Format;
+    const uint8* Streams[VERTEX_STREAM_COUNT];  // nullptr si le flux n'est pas fourni
+    Vector3<Real> PositionOffset;
+    Vector3<Real> PositionScale;
+    Point3<Metre> BoundsMin;
+    Point3<Metre> BoundsMax;
+};
+
+// Sous-ensemble d'indices d'une geometrie fusionnee (lot statique), avec sa boite
+// englobante dans l'espace de la geometrie, pour eliminer une partie sans separer les tampons
+struct GeometryRange
+{
+    uint32 FirstIndex;
+    uint32 IndexCount;
+    Point3<Metre> BoundsMin;
+    Point3<Metre> BoundsMax;
 };
 
 class Geometry
 {
 private:
 	uint32 m_indexBuffer;
-	uint32 m_vertexBuffer;
+	uint32 m_vertexBuffers[VERTEX_STREAM_COUNT];
 	uint32 m_normalVertexBuffer;
+    uint32 m_indexType;
+    uint32 m_vertexCount;
+    uint32 m_indexCount;
+    GeometryResidency m_residency;
+
+    // Dernier envoi differe des tampons (UploadQueue) ; rien n'est dessine avant sa fin
+    uint64 m_uploadTicket;
+
+    // Les tangentes ne sont calculees qu'a partir du premier materiel qui les lit,
+    // au plus tard avant de quitter KeepAll (voir requireAttributes)
+    bool m_requiresTangents;
+
+    // Plage de sommets modifiee depuis le dernier envoi, vide si begin == end
+    uint32 m_dirtyBegin;
+    uint32 m_dirtyEnd;
 
     Color m_color;
+    VertexLayout m_layout;
+
+    // Decodage des positions quantifiees : position = aPosition * scale + offset
+    Vector3<Real> m_positionOffset;
+    Vector3<Real> m_positionScale;
+
+    // Boite englobante alignee sur les axes, dans l'espace du maillage
+    Point3<Metre> m_boundsMin;
+    Point3<Metre> m_boundsMax;
 
     std::string m_name;
 
-    std::vector<Triangle> m_triangles;
     std::vector<Vertex> m_vertices;
     std::vector<uint32> m_indices;
-	std::vector<Point3<Metre>> m_normalVertices;
+    std::vector<Point3<Metre>> m_positions;     // PickingOnly seulement
+    std::vector<GeometryRange> m_ranges;        // Une entree par partie d'un lot
+
+    // Construite a la premiere requete de rayon, detruite quand les positions changent
+    mutable TriangleBVH* m_bvh;
     
     Geometry(const std::string& name);
-    void setGeometryData(std::vector<Vertex>&& vertices, std::vector<uint32>&& indices);
+    Geometry(const std::string& name, const VertexFormat& format);
+    bool requireVertexData(const char* operation) const;
+    void append(const Geometry& other, const Transform* t);
     void updateTangents();
     void unloadData();
-    void constructTrianglesList();
+    void invalidateBVH();
+	bool updateBounds();
 	void updateVertexBuffer();
-	void updateIndexBuffer() const;
+	void updateNormalVertexBuffer();
+	void updateVertexStream(uint32 stream, const float positionOffset[3], const float positionScale[3]);
+	void updateVertexRange(uint32 first, uint32 count);
+	void markDirty(uint32 first, uint32 count);
+	void updateIndexBuffer();
+	void uploadBuffer(uint32 buffer, size_t size, const void* data);
 
 public:
 	static Geometry* CreateGeometry(const std::string& name, std::vector<Vertex>&& vertices, std::vector<uint32>&& indices);
+
+    // Optimise le maillage et calcule les normales demandees, sans appel GL
+    static void Prepare(const std::string& name, GeometryData& data);
+    // Un chargement asynchrone passe le format lu au moment de sa demande : le defaut
+    // peut changer (nouvelle scene) pendant la preparation.
+    static Geometry* CreatePrepared(const std::string& name, GeometryData&& data, const VertexFormat& format = VertexFormat::Default());
+    // Les sommets et les indices sont deja optimises. Les flux encodes sont televerses
+    // tels quels s'ils sont dans format, sinon ils sont reencodes.
+    // indices est en uint16 si shortIndices, en uint32 sinon.
+    static Geometry* CreateFromEncoded(const std::string& name, const Vertex* vertices, uint32 vertexCount,
+                                       const void* indices, uint32 indexCount, bool shortIndices, const EncodedGeometry& encoded,
+                                       const VertexFormat& format = VertexFormat::Default());
     static Geometry* Combine(const std::string& name, const Geometry& first, const Geometry& second);
+    // Fusionne des geometries (sommets complets) en les placant par leur transformation :
+    // un seul envoi et un seul dessin. Chaque partie garde son GeometryRange.
+    static Geometry* CreateBatch(const std::string& name, const std::vector<const Geometry*>& parts, const std::vector<Transform>& transforms);
+
+    // Boite englobante, et decodage des positions (offset, scale) pour le format donne
+    static void ComputeBounds(const std::vector<Vertex>& vertices, const VertexFormat& format,
+                              float boundsMin[3], float boundsMax[3], float positionOffset[3], float positionScale[3]);
 	
 	~Geometry();
 
@@ -105,9 +192,56 @@ public:
     void setColor(const Color& c);
 
     void merge(const Geometry& other);
+    // Transforme tous les sommets et envoie les tampons
     void transform(const Transform& t);
 
-    void bindBuffersVAO() const;
+    // Modifications par plage, sans envoi : commitVertexChanges envoie ensuite
+    // seulement la plage modifiee, sans reallouer les tampons. Les normales sont
+    // transformees par l'inverse transposee, les tangentes par la matrice.
+    void transformVertices(const Transform& t, uint32 first, uint32 count);
+    void updateVertices(uint32 first, const Vertex* vertices, uint32 count);
+    void commitVertexChanges();
+
+    const Point3<Metre>& getBoundsMin() const;
+    const Point3<Metre>& getBoundsMax() const;
+
+    GeometryResidency getResidency() const;
+    void setResidency(GeometryResidency residency);
+
+    // Vides si la residence ne les garde plus
+    const std::vector<Vertex>& getVertices() const;
+    const std::vector<uint32>& getIndices() const;
+
+    // Parties d'un lot ; vide pour une geometrie simple
+    const std::vector<GeometryRange>& getRanges() const;
+
+    // Selection : disponibles sauf en GpuOnly
+    bool hasPickingData() const;
+    uint32 getVertexCount() const;
+    uint32 getTriangleCount() const;
+    const Point3<Metre>& getPosition(uint32 vertex) const;
+    // Hierarchie des triangles pour les requetes de rayon, construite au premier
+    // appel ; nullptr sans donnees de selection
+    const TriangleBVH* getBVH() const;
+
+    // Memoire centrale gardee, et taille des tampons GL
+    size_t getCpuMemoryBytes() const;
+    size_t getGpuMemoryBytes() const;
+
+    // Faux tant que des tampons attendent dans UploadQueue
+    bool isUploaded() const;
+
+    const VertexLayout& getVertexLayout() const;
+
+    // Prepare les flux lus par un materiel (masque de VertexAttributeFlag). Les tangentes
+    // sont calculees depuis les sommets : apres KeepAll, il faut les avoir demandees
+    // avant setResidency. Retourne faux si un flux demande ne peut plus etre fourni.
+    bool requireAttributes(uint32 attributeMask);
+    bool canProvideAttributes(uint32 attributeMask) const;
+
+    // Lie au VAO courant les flux de sommets utilises par le materiel. Un flux que
+    // requireAttributes refuse reste desactive dans le VAO.
+    void bindBuffersVAO(const Material& mat);
 	void bindBuffersNormalVAO() const;
 
 	void updateNormals();
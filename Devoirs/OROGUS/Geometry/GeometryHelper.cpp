@@ -6,9 +6,67 @@
 #include "Math.h"
 
 #include "../Utilities/Maths.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ThreadPool.h"
 #include "../Utilities/Transforms.h"
 #include "../Utilities/Vectors.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+    // Sommets remplis par tache de generation
+    const uint32 VERTICES_PER_TASK = 64 * 1024;
+
+    // Appelle body(premiere, derniere) sur des blocs de rangees d'environ VERTICES_PER_TASK
+    // sommets, repartis sur le ThreadPool. Chaque rangee ecrit une plage fixe des tableaux.
+    void ForEachRowBlock(uint32 rows, uint32 verticesPerRow, const std::function<void(uint32, uint32)>& body)
+    {
+        uint32 rowsPerTask = std::max(1u, VERTICES_PER_TASK / std::max(1u, verticesPerRow));
+        uint32 tasks = (rows + rowsPerTask - 1) / rowsPerTask;
+        if (tasks <= 1)
+        {
+            body(0, rows);
+            return;
+        }
+
+        ThreadPool::ParallelFor(tasks, [&](uint32 task)
+        {
+            uint32 first = task * rowsPerTask;
+            body(first, std::min(rows, first + rowsPerTask));
+        });
+    }
+
+    // cos et sin de start + i * step pour i dans [0, count[ : un appel par colonne ou
+    // par rangee au lieu d'un par sommet. Calcule en double pour que la couture ferme.
+    void MakeAngleTable(double start, double step, uint32 count, std::vector<float>& cosines, std::vector<float>& sines)
+    {
+        cosines.resize(count);
+        sines.resize(count);
+        for (uint32 i = 0; i < count; ++i)
+        {
+            double angle = start + step * i;
+            cosines[i] = (float)std::cos(angle);
+            sines[i] = (float)std::sin(angle);
+        }
+    }
+
+    // Deux triangles par quad d'une bande : (a, b, c) et (b, d, c) avec a-b sur la
+    // rangee courante et c-d sur la suivante
+    inline uint32* AddQuad(uint32* out, uint32 a, uint32 b, uint32 c, uint32 d)
+    {
+        out[0] = a;
+        out[1] = b;
+        out[2] = c;
+        out[3] = b;
+        out[4] = d;
+        out[5] = c;
+        return out + 6;
+    }
+}
+
 Geometry* GeometryHelper::CreateTriangle()
 {
     std::vector<Vertex> vertices;
@@ -37,42 +95,54 @@ Geometry* GeometryHelper::CreateGrid(Metre width, Metre depth, uint32 m, uint32
     // Un vertex contient sa position, son vecteur normal et ses coordonn�es de texture. Pour ce TP, les coordonn�es de texture seront (0,0).
     // Vous pouvez vous inspirer du cylindre pour faire la grille.
     
-    // Précalculer quelques valeurs utiles
-    Metre subWidth = width / m;
-    Metre subDepth = depth / n;
-    Metre xOffset = width / 2;
-    Metre zOffset = depth / 2;
+    PROFILE_SCOPE("GeometryHelper::CreateGrid");
+
+    // Une rangee par colonne x, de n + 1 sommets le long de z
+    uint32 rowVertices = n + 1;
+    vertices.resize((size_t)(m + 1) * rowVertices);
+    indices.resize((size_t)m * n * 6);
+
+    float subWidth = (float)width / m;
+    float subDepth = (float)depth / n;
+    float xOffset = (float)width / 2;
+    float zOffset = (float)depth / 2;
     Vector3<Real> normale = Vector3<Real>(Real(), Real(1), Real());
 
     // Calculer les vertex
-    for (uint32 x = 0; x <= m; ++x) {
-        for (uint32 z = 0; z <= n; ++z) {
-            Metre px = Metre(x * subWidth) - xOffset;
-            Metre pz = Metre(z * subDepth) - zOffset;
-            Point3<Metre> p = Point3<Metre>(px, Metre(0), pz);
-            vertices.emplace_back(Vertex(p, normale, Vector2<Real>()));
+    ForEachRowBlock(m + 1, rowVertices, [&](uint32 first, uint32 last)
+    {
+        for (uint32 x = first; x < last; ++x)
+        {
+            Metre px = Metre(x * subWidth - xOffset);
+            Vertex* row = &vertices[(size_t)x * rowVertices];
+            for (uint32 z = 0; z <= n; ++z)
+            {
+                row[z] = Vertex(Point3<Metre>(px, Metre(0), Metre(z * subDepth - zOffset)), normale, Vector2<Real>());
+            }
         }
-    }
+    });
 
     // Effectuer le maillage
-    uint32 verticesWidth = m + 1;
-    for (uint32 x = 0; x < m; ++x) {
-        for (uint32 z = 0; z < n; ++z) {
-            uint32 start = (z * verticesWidth) + x;
-            // Ajouter le triangle au coin (0, 0)
-            indices.push_back(start);
-            indices.push_back(start + 1);
-            indices.push_back(start + verticesWidth);
-
-            // Ajouter le triangle au coin (1, 1)
-            indices.push_back(start + 1);
-            indices.push_back(start + verticesWidth + 1);
-            indices.push_back(start + verticesWidth);
+    ForEachRowBlock(m, n, [&](uint32 first, uint32 last)
+    {
+        for (uint32 x = first; x < last; ++x)
+        {
+            uint32* out = &indices[(size_t)x * n * 6];
+            for (uint32 z = 0; z < n; ++z)
+            {
+                uint32 start = x * rowVertices + z;
+                out = AddQuad(out, start, start + 1, start + rowVertices, start + rowVertices + 1);
+            }
         }
-    }
-    
-    Geometry* geom = Geometry::CreateGeometry("Grid", std::move(vertices), std::move(indices));
-    return geom;
+    });
+
+    // Deja dans l'ordre des bandes : l'optimisation ne vaut pas son cout sur une grande grille
+    GeometryData data;
+    data.Vertices = std::move(vertices);
+    data.Indices = std::move(indices);
+    data.Optimize = false;
+    Geometry::Prepare("Grid", data);
+    return Geometry::CreatePrepared("Grid", std::move(data));
 }
 
 Geometry* GeometryHelper::CreateGrid(Metre width, Metre depth, uint32 m, uint32 n, const Color& color)
@@ -176,50 +246,64 @@ Geometry* GeometryHelper::CreateSphere(Metre radius, uint32 slices, uint32 stack
 	// TP3 : � compl�ter
 	// Pour le TP3, vous devez remplacer le code du t�trah�dre suivant par celui d'une sph�re.
 
-	Metre x, y, z, xy;
-	Radian sectorStep = Degree(360) / slices;
-	Radian stackStep = Degree(180) / stacks;
-	Radian sectorAngle, stackAngle;
+	PROFILE_SCOPE("GeometryHelper::CreateSphere");
 
-	for (uint32 i = 0; i <= stacks; ++i) {
-		stackAngle = Degree(90) - i * stackStep;
-		xy = radius * Maths::Cos(stackAngle);
-		z = radius * Maths::Sin(stackAngle);
+	// Rangee i : latitude 90 - i * 180 / stacks ; colonne j : longitude j * 360 / slices
+	std::vector<float> stackCos, stackSin, sectorCos, sectorSin;
+	MakeAngleTable(M_PI / 2, -M_PI / stacks, stacks + 1, stackCos, stackSin);
+	MakeAngleTable(0.0, 2 * M_PI / slices, slices + 1, sectorCos, sectorSin);
 
-		for (uint32 j = 0; j <= slices; ++j)
+	uint32 rowVertices = slices + 1;
+	vertices.resize((size_t)(stacks + 1) * rowVertices);
+	float r = (float)radius;
+	ForEachRowBlock(stacks + 1, rowVertices, [&](uint32 first, uint32 last)
+	{
+		for (uint32 i = first; i < last; ++i)
 		{
-			sectorAngle = j * sectorStep;
-			x = xy * Maths::Cos(sectorAngle);
-			y = xy * Maths::Sin(sectorAngle);
-			Point3<Metre> point = Point3<Metre>(x, y, z);
-
-			vertices.push_back(Vertex(point, point.normalized(), Vector2<Real>()));
+			Vertex* row = &vertices[(size_t)i * rowVertices];
+			for (uint32 j = 0; j <= slices; ++j)
+			{
+				Vector3<Real> normal = Vector3<Real>(stackCos[i] * sectorCos[j], stackCos[i] * sectorSin[j], stackSin[i]);
+				Point3<Metre> point = Point3<Metre>(Metre(r * normal.x()), Metre(r * normal.y()), Metre(r * normal.z()));
+				row[j] = Vertex(point, normal, Vector2<Real>());
+			}
 		}
-	}
+	});
 
-	uint32 k1, k2;
+	// Les rangees des poles n'ont qu'un triangle par colonne
+	std::vector<size_t> rowOffsets(stacks + 1, 0);
 	for (uint32 i = 0; i < stacks; ++i)
 	{
-		k1 = i * (slices + 1);
-		k2 = k1 + slices + 1;
+		uint32 triangles = (i != 0 ? 1 : 0) + (i != stacks - 1 ? 1 : 0);
+		rowOffsets[i + 1] = rowOffsets[i] + (size_t)slices * triangles * 3;
+	}
+	indices.resize(rowOffsets[stacks]);
 
-		for (uint32 j = 0; j < slices; ++j, ++k1, ++k2)
+	ForEachRowBlock(stacks, slices, [&](uint32 first, uint32 last)
+	{
+		for (uint32 i = first; i < last; ++i)
 		{
-			if (i != 0)
-			{
-				indices.push_back(k1);
-				indices.push_back(k2);
-				indices.push_back(k1 + 1);
-			}
-
-			if (i != (stacks - 1))
+			uint32* out = &indices[rowOffsets[i]];
+			uint32 k1 = i * rowVertices;
+			uint32 k2 = k1 + rowVertices;
+			for (uint32 j = 0; j < slices; ++j, ++k1, ++k2)
 			{
-				indices.push_back(k1 + 1);
-				indices.push_back(k2);
-				indices.push_back(k2 + 1);
+				if (i != 0)
+				{
+					*out++ = k1;
+					*out++ = k2;
+					*out++ = k1 + 1;
+				}
+
+				if (i != (stacks - 1))
+				{
+					*out++ = k1 + 1;
+					*out++ = k2;
+					*out++ = k2 + 1;
+				}
 			}
 		}
-	}
+	});
 
 	// Fin du code � compl�ter du TP3
 
@@ -414,51 +498,45 @@ Geometry* GeometryHelper::CreateTorus(Metre radius, Metre ringRadius, uint32 sid
     std::vector<uint32> indices;
 
 	// TP3 : Bonus � compl�ter
-    Degree ringAngle = Degree(360) / sides;
-    std::vector<Point2<Metre>> slicePoint = std::vector<Point2<Metre>>();
-    for (uint32 sideIndex = 0; sideIndex < sides; ++sideIndex) {
-        Metre x = radius + (ringRadius * Maths::Cos(ringAngle * sideIndex));
-        Metre y = ringRadius * Maths::Sin(ringAngle * sideIndex);
-        slicePoint.push_back(Point2<Metre>(x, y));
-    }
+    PROFILE_SCOPE("GeometryHelper::CreateTorus");
 
-    Degree angle = Degree(360) / rings;
-    Vector3<Real> normal;
+    // Rangee : un point du cercle interne (angle a) ; colonne : la rotation autour de y (angle b)
+    std::vector<float> sideCos, sideSin, ringCos, ringSin;
+    MakeAngleTable(0.0, 2 * M_PI / sides, sides, sideCos, sideSin);
+    MakeAngleTable(0.0, 2 * M_PI / rings, rings, ringCos, ringSin);
 
-    for (size_t sliceIndex = 0; sliceIndex < slicePoint.size(); ++sliceIndex) {
-        Metre radius = slicePoint.at(sliceIndex).x();
-        Metre y = slicePoint.at(sliceIndex).y();
+    vertices.resize((size_t)sides * rings);
+    indices.resize((size_t)sides * rings * 6);
+    float majorRadius = (float)radius;
+    float minorRadius = (float)ringRadius;
 
-        for (uint32 i = 0; i < rings; ++i) {
-            Point3<Metre> p = Point3<Metre>(radius * Maths::Sin(angle * i), y, radius * Maths::Cos(angle * i));
-            vertices.push_back(Vertex(p, normal, Vector2<Real>()));
-        }
-    }
-
-    for (uint32 sliceIndex = 0; sliceIndex < sides; ++sliceIndex) {
-        for (uint32 i = 0; i < rings; ++i) {
-            uint32 x = i;
-            uint32 x2 = (i + rings - 1) % rings;
-            uint32 y = sliceIndex;
-            uint32 y2 = (sliceIndex + sides - 1) % sides;
-
-            uint32 p1 = x2 + (y2 * rings);
-            uint32 p2 = x + (y2 * rings);
-            uint32 p3 = x2 + (y * rings);
-            uint32 p4 = x + (y * rings);
-
-            indices.emplace_back(p1);
-            indices.emplace_back(p2);
-            indices.emplace_back(p3);
-
-            indices.emplace_back(p2);
-            indices.emplace_back(p4);
-            indices.emplace_back(p3);
+    ForEachRowBlock(sides, rings, [&](uint32 first, uint32 last)
+    {
+        for (uint32 sideIndex = first; sideIndex < last; ++sideIndex)
+        {
+            // Normale analytique : direction du point depuis le centre du cercle interne
+            float distance = majorRadius + minorRadius * sideCos[sideIndex];
+            float y = minorRadius * sideSin[sideIndex];
+            Vertex* row = &vertices[(size_t)sideIndex * rings];
+            for (uint32 i = 0; i < rings; ++i)
+            {
+                Point3<Metre> p = Point3<Metre>(Metre(distance * ringSin[i]), Metre(y), Metre(distance * ringCos[i]));
+                Vector3<Real> normal = Vector3<Real>(sideCos[sideIndex] * ringSin[i], sideSin[sideIndex], sideCos[sideIndex] * ringCos[i]);
+                row[i] = Vertex(p, normal, Vector2<Real>());
+            }
+
+            // Bande entre la rangee precedente (avec retour a la derniere) et celle-ci
+            uint32 y2 = (sideIndex + sides - 1) % sides;
+            uint32* out = &indices[(size_t)sideIndex * rings * 6];
+            for (uint32 i = 0; i < rings; ++i)
+            {
+                uint32 x2 = (i + rings - 1) % rings;
+                out = AddQuad(out, x2 + y2 * rings, i + y2 * rings, x2 + sideIndex * rings, i + sideIndex * rings);
+            }
         }
-    }
+    });
 
     Geometry* geom = Geometry::CreateGeometry("Torus", std::move(vertices), std::move(indices));
-	geom->updateNormals();
     if (color != nullptr)
     {
         geom->setColor(*color);
@@ -472,44 +550,51 @@ Geometry* GeometryHelper::CreateRevolutionSurface(const std::vector<Point2<Metre
 	std::vector<uint32> indices;
 
 	// TP3 : � compl�ter
-    Degree angle = Degree(360) / precision;
-    Vector3<Real> normal;
+    PROFILE_SCOPE("GeometryHelper::CreateRevolutionSurface");
 
-    for (size_t sliceIndex = 0; sliceIndex < slicePoint.size(); ++sliceIndex) {
-        Metre radius = slicePoint.at(sliceIndex).x();
-        Metre y = slicePoint.at(sliceIndex).y();
+    std::vector<float> angleCos, angleSin;
+    MakeAngleTable(0.0, 2 * M_PI / precision, precision, angleCos, angleSin);
 
-        for (uint32 i = 0; i < precision; ++i) {
-            Point3<Metre> p = Point3<Metre>(radius * Maths::Sin(angle * i), y, radius * Maths::Cos(angle * i));
-            vertices.push_back(Vertex(p, normal, Vector2<Real>()));
-        }
-    }
+    uint32 rows = (uint32)slicePoint.size();
+    vertices.resize((size_t)rows * precision);
+    indices.resize((size_t)(rows > 0 ? rows - 1 : 0) * precision * 6);
 
-    for (uint32 sliceIndex = 1; sliceIndex < slicePoint.size(); ++sliceIndex) {
-        for (uint32 i = 0; i < precision; ++i) {
-            uint32 x = i;
-            uint32 x2 = (i + precision - 1) % precision;
-            uint32 y = sliceIndex;
-            uint32 y2 = (sliceIndex - 1);
-
-            uint32 p1 = x2 + (y2 * precision);
-            uint32 p2 = x + (y2 * precision);
-            uint32 p3 = x2 + (y * precision);
-            uint32 p4 = x + (y * precision);
-
-            indices.emplace_back(p1);
-            indices.emplace_back(p2);
-            indices.emplace_back(p3);
-
-            indices.emplace_back(p2);
-            indices.emplace_back(p4);
-            indices.emplace_back(p3);
+    ForEachRowBlock(rows, precision, [&](uint32 first, uint32 last)
+    {
+        for (uint32 sliceIndex = first; sliceIndex < last; ++sliceIndex)
+        {
+            float radius = (float)slicePoint[sliceIndex].x();
+            Metre y = slicePoint[sliceIndex].y();
+            Vertex* row = &vertices[(size_t)sliceIndex * precision];
+            for (uint32 i = 0; i < precision; ++i)
+            {
+                row[i] = Vertex(Point3<Metre>(Metre(radius * angleSin[i]), y, Metre(radius * angleCos[i])), Vector3<Real>(), Vector2<Real>());
+            }
+
+            if (sliceIndex == 0)
+            {
+                continue;
+            }
+
+            // Bande entre la silhouette precedente et celle-ci
+            uint32 y2 = sliceIndex - 1;
+            uint32* out = &indices[(size_t)y2 * precision * 6];
+            for (uint32 i = 0; i < precision; ++i)
+            {
+                uint32 x2 = (i + precision - 1) % precision;
+                out = AddQuad(out, x2 + y2 * precision, i + y2 * precision, x2 + sliceIndex * precision, i + sliceIndex * precision);
+            }
         }
-    }
-
-	Geometry* geom = Geometry::CreateGeometry("Revolution", std::move(vertices), std::move(indices));
-	geom->updateNormals();
-	return geom;
+    });
+
+    // Les normales sont calculees une seule fois, avant le premier envoi
+    GeometryData data;
+    data.Vertices = std::move(vertices);
+    data.Indices = std::move(indices);
+    data.ComputeNormals = true;
+    Geometry::Prepare("Revolution", data);
+	return Geometry::CreatePrepared("Revolution", std::move(data));
 }
 
+
             
\ No newline at end of file
@@ -1,9 +1,207 @@
 #include "GeometryManager.h"
 
+#include "MeshCache.h"
 #include "OBJImporter.h"
+#include "../Utilities/Hash.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ThreadPool.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
+struct GeometryRequest
+{
+	enum class Status
+	{
+		Pending,
+		Ready,
+		Failed
+	};
+
+	std::string Name;
+	std::string Key;	// Cle dans GeometryManager : Name, ou une copie de residence differente
+	GeometryResidency Residency = GeometryResidency::PickingOnly;
+	uint32 AttributeMask = 0;	// Union des demandes, comme Residency lue seulement sur le thread GL
+
+	// VertexFormat::Default lu a la demande : une scene rechargee peut le changer
+	// pendant que le thread de travail ecrit le cache
+	VertexFormat Format;
+
+	Status State = Status::Pending;
+	Geometry* Result = nullptr;
+
+	// Poignees encore attachees a la demande ; a zero, le resultat est abandonne
+	uint32 References = 1;
+
+	// Ecrits par le thread de travail, lus par le thread GL apres m_completedMutex
+	bool Prepared = false;
+	GeometryData Data;
+	std::unique_ptr<CachedMesh> Cached;
+	uint64 ContentHash = 0;		// Sommets et indices prepares ; 0 si la preparation a echoue
+};
+
+namespace
+{
+	// Les indices sont haches en 32 bits pour que le cache .omesh et le fichier
+	// source donnent la meme valeur
+	uint64 HashContent(const Vertex* vertices, uint32 vertexCount, const void* indices, uint32 indexCount, bool shortIndices)
+	{
+		uint64 hash = Hash::Bytes(vertices, (size_t)vertexCount * sizeof(Vertex));
+		if (shortIndices)
+		{
+			const uint16* source = static_cast<const uint16*>(indices);
+			std::vector<uint32> wideIndices(source, source + indexCount);
+			return Hash::Bytes(wideIndices.data(), wideIndices.size() * sizeof(uint32), hash);
+		}
+		return Hash::Bytes(indices, (size_t)indexCount * sizeof(uint32), hash);
+	}
+
+	// Copie d'un fichier deja charge avec moins de donnees en memoire. Le '#' ne peut
+	// pas apparaitre dans un nom de fichier de la scene.
+	std::string MakeResidencyKey(const std::string& geometryName, GeometryResidency residency)
+	{
+		return geometryName + "#residence:" + std::to_string((int)residency);
+	}
+
+	bool CanServe(const Geometry& geometry, GeometryResidency residency, uint32 attributeMask)
+	{
+		return geometry.getResidency() <= residency && geometry.canProvideAttributes(attributeMask);
+	}
+
+	// Sommets et indices prepares, tels que haches par HashContent
+	struct ContentView
+	{
+		const Vertex* Vertices = nullptr;
+		uint32 VertexCount = 0;
+		const void* Indices = nullptr;
+		uint32 IndexCount = 0;
+		bool ShortIndices = false;
+
+		uint32 index(uint32 i) const
+		{
+			return ShortIndices ? static_cast<const uint16*>(Indices)[i] : static_cast<const uint32*>(Indices)[i];
+		}
+	};
+
+	ContentView MakeView(const CachedMesh& cached)
+	{
+		ContentView view;
+		view.Vertices = cached.Vertices;
+		view.VertexCount = cached.VertexCount;
+		view.Indices = cached.Indices;
+		view.IndexCount = cached.IndexCount;
+		view.ShortIndices = cached.ShortIndices;
+		return view;
+	}
+
+	ContentView MakeView(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices)
+	{
+		ContentView view;
+		view.Vertices = vertices.data();
+		view.VertexCount = (uint32)vertices.size();
+		view.Indices = indices.data();
+		view.IndexCount = (uint32)indices.size();
+		return view;
+	}
+
+	bool SameContent(const ContentView& a, const ContentView& b)
+	{
+		if (a.VertexCount != b.VertexCount || a.IndexCount != b.IndexCount
+			|| std::memcmp(a.Vertices, b.Vertices, (size_t)a.VertexCount * sizeof(Vertex)) != 0)
+		{
+			return false;
+		}
+		if (a.ShortIndices == b.ShortIndices)
+		{
+			size_t indexSize = a.ShortIndices ? sizeof(uint16) : sizeof(uint32);
+			return std::memcmp(a.Indices, b.Indices, (size_t)a.IndexCount * indexSize) == 0;
+		}
+		for (uint32 i = 0; i < a.IndexCount; ++i)
+		{
+			if (a.index(i) != b.index(i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Des empreintes egales ne suffisent pas : le contenu est compare octet par octet a
+	// celui de la geometrie chargee, ses sommets si elle les garde, sinon son cache .omesh
+	bool SameContent(const GeometryRequest& request, const Geometry& geometry)
+	{
+		ContentView requested = request.Cached != nullptr ? MakeView(*request.Cached) : MakeView(request.Data.Vertices, request.Data.Indices);
+		if (!geometry.getVertices().empty())
+		{
+			return SameContent(requested, MakeView(geometry.getVertices(), geometry.getIndices()));
+		}
+
+		std::unique_ptr<CachedMesh> cached = MeshCache::Open(geometry.getName());
+		return cached != nullptr && SameContent(requested, MakeView(*cached));
+	}
+
+	// Partie du chargement sans appel GL : projection du cache .omesh, ou lecture et
+	// preparation du fichier source suivie de l'ecriture du cache
+	void PrepareRequest(GeometryRequest& request)
+	{
+		PROFILE_SCOPE("GeometryManager::PrepareRequest");
+
+		request.Cached = MeshCache::Open(request.Name);
+		if (request.Cached != nullptr)
+		{
+			const CachedMesh& cached = *request.Cached;
+			request.ContentHash = HashContent(cached.Vertices, cached.VertexCount, cached.Indices, cached.IndexCount, cached.ShortIndices);
+			request.Prepared = true;
+		}
+		else if (OBJGeometryImporter::Import(request.Name, request.Data))
+		{
+			Geometry::Prepare(request.Name, request.Data);
+			MeshCache::Write(request.Name, request.Data, request.Format);
+			const GeometryData& data = request.Data;
+			request.ContentHash = HashContent(data.Vertices.data(), (uint32)data.Vertices.size(), data.Indices.data(), (uint32)data.Indices.size(), false);
+			request.Prepared = true;
+		}
+	}
+}
+
+GeometryHandle::GeometryHandle()
+{
+}
+
+bool GeometryHandle::isValid() const
+{
+	return m_request != nullptr;
+}
+
+bool GeometryHandle::isPending() const
+{
+	return m_request != nullptr && m_request->State == GeometryRequest::Status::Pending;
+}
+
+bool GeometryHandle::hasFailed() const
+{
+	return m_request != nullptr && m_request->State == GeometryRequest::Status::Failed;
+}
+
+Geometry* GeometryHandle::getGeometry() const
+{
+	return m_request != nullptr && m_request->State == GeometryRequest::Status::Ready ? m_request->Result : nullptr;
+}
+
+const std::string& GeometryHandle::getName() const
+{
+	static const std::string s_noName;
+	return m_request != nullptr ? m_request->Name : s_noName;
+}
+
+void GeometryHandle::reset()
+{
+	m_request.reset();
+}
+
 GeometryManager* GeometryManager::s_instance = nullptr;
 
 GeometryManager* GeometryManager::GetInstance()
@@ -29,42 +227,362 @@ void GeometryManager::Uninitialize()
 }
 
 GeometryManager::GeometryManager()
+	: m_completedLoads(0)
 {
 }
 
 GeometryManager::~GeometryManager()
 {
+	// Les threads de travail referencent encore m_completed
+	waitForWorkers();
+	m_completed.clear();
+	m_pending.clear();
 	unloadAll();
 }
 
-Geometry* GeometryManager::loadGeometry(const std::string& geometryName)
+Geometry* GeometryManager::loadGeometry(const std::string& geometryName, GeometryResidency residency, uint32 attributeMask)
 {
 	if (geometryName.empty())
 		return nullptr;
 
-	auto it = m_geometries.find(geometryName);
-	if (it != m_geometries.end())
+	if (m_pending.find(geometryName) != m_pending.end() || m_pending.find(MakeResidencyKey(geometryName, residency)) != m_pending.end())
+	{
+		waitForPendingGeometries();
+	}
+
+	InstanceCounter<Geometry>* instance = nullptr;
+	std::string key = findLoaded(geometryName, residency, attributeMask, instance);
+	if (instance != nullptr)
 	{
-		InstanceCounter<Geometry>* instance = m_geometries[geometryName];
 		instance->AddRef();
 		return instance->getObjectPtr();
 	}
 	else
 	{
-		Geometry* geometry = OBJGeometryImporter::Import(geometryName);			
+		GeometryRequest request;
+		request.Name = geometryName;
+		request.Key = key;
+		request.Residency = residency;
+		request.AttributeMask = attributeMask;
+		request.Format = VertexFormat::Default();
+		PrepareRequest(request);
+
+		Geometry* geometry = findDuplicate(request, 1);
+		if (geometry == nullptr)
+		{
+			geometry = createGeometry(request);
+			if (geometry != nullptr)
+			{
+				addGeometry(key, geometry, 1, request.ContentHash);
+			}
+		}
+		return geometry;
+	}
+}
+
+GeometryHandle GeometryManager::loadGeometryAsync(const std::string& geometryName, GeometryResidency residency, uint32 attributeMask)
+{
+	GeometryHandle handle;
+	if (geometryName.empty())
+		return handle;
+
+	InstanceCounter<Geometry>* instance = nullptr;
+	std::string key = findLoaded(geometryName, residency, attributeMask, instance);
+	if (instance != nullptr)
+	{
+		// Deja chargee : la poignee est prete immediatement
+		instance->AddRef();
+		handle.m_request = std::make_shared<GeometryRequest>();
+		handle.m_request->Name = geometryName;
+		handle.m_request->Key = key;
+		handle.m_request->State = GeometryRequest::Status::Ready;
+		handle.m_request->Result = instance->getObjectPtr();
+		return handle;
+	}
+
+	auto pending = m_pending.find(key);
+	if (pending != m_pending.end())
+	{
+		// Rien n'est encore cree : la demande garde ce que demande le moins restrictif
+		GeometryRequest& request = *(*pending).second;
+		request.References++;
+		request.Residency = std::min(request.Residency, residency);
+		request.AttributeMask |= attributeMask;
+		handle.m_request = (*pending).second;
+		return handle;
+	}
+
+	std::shared_ptr<GeometryRequest> request = std::make_shared<GeometryRequest>();
+	request->Name = geometryName;
+	request->Key = key;
+	request->Residency = residency;
+	request->AttributeMask = attributeMask;
+	request->Format = VertexFormat::Default();
+	m_pending.insert(std::make_pair(key, request));
+	handle.m_request = request;
+
+	ThreadPool::Submit([this, request]()
+	{
+		PrepareRequest(*request);
+
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completed.push_back(request);
+		m_completedCondition.notify_all();
+	});
+	return handle;
+}
+
+uint32 GeometryManager::processLoadedGeometries()
+{
+	std::vector<std::shared_ptr<GeometryRequest>> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		completed.swap(m_completed);
+	}
+
+	for (std::shared_ptr<GeometryRequest>& request : completed)
+	{
+		PROFILE_SCOPE("GeometryManager::processLoadedGeometries");
+		m_pending.erase(request->Key);
+
+		Geometry* geometry = nullptr;
+		if (request->References > 0)
+		{
+			geometry = findDuplicate(*request, request->References);
+			if (geometry == nullptr)
+			{
+				geometry = createGeometry(*request);
+				if (geometry != nullptr)
+				{
+					addGeometry(request->Key, geometry, request->References, request->ContentHash);
+				}
+			}
+		}
+		request->Cached.reset();
+		request->Data = GeometryData();
 		if (geometry != nullptr)
 		{
-			m_geometries.insert(std::pair<std::string, InstanceCounter<Geometry>*>(geometryName, new InstanceCounter<Geometry>(geometry)));
-			m_inverseLookup.insert(std::pair<Geometry*, std::string>(geometry, geometryName));
+			request->State = GeometryRequest::Status::Ready;
+			request->Result = geometry;
+		}
+		else
+		{
+			request->State = GeometryRequest::Status::Failed;
 		}
+		++m_completedLoads;
+	}
+	return (uint32)completed.size();
+}
+
+void GeometryManager::waitForPendingGeometries()
+{
+	waitForWorkers();
+	processLoadedGeometries();
+}
+
+bool GeometryManager::hasPendingGeometries() const
+{
+	return !m_pending.empty();
+}
+
+uint32 GeometryManager::getCompletedLoadCount() const
+{
+	return m_completedLoads;
+}
+
+void GeometryManager::getMemoryUsage(size_t& cpuBytes, size_t& gpuBytes) const
+{
+	cpuBytes = 0;
+	gpuBytes = 0;
+	for (const auto& geometry : m_geometries)
+	{
+		cpuBytes += geometry.second->getObjectPtr()->getCpuMemoryBytes();
+		gpuBytes += geometry.second->getObjectPtr()->getGpuMemoryBytes();
+	}
+}
+
+Geometry* GeometryManager::createGeometry(GeometryRequest& request)
+{
+	Geometry* geometry = nullptr;
+	if (request.Cached != nullptr)
+	{
+		geometry = request.Cached->createGeometry(request.Name, request.Format);
+	}
+	else if (request.Prepared)
+	{
+		geometry = Geometry::CreatePrepared(request.Name, std::move(request.Data), request.Format);
+	}
+
+	if (geometry != nullptr)
+	{
+		// Les tampons sont envoyes (ou copies dans UploadQueue) : la copie centrale peut partir.
+		// Les flux calcules depuis les sommets doivent l'etre avant.
+		geometry->requireAttributes(request.AttributeMask);
+		geometry->setResidency(request.Residency);
+	}
+	return geometry;
+}
+
+void GeometryManager::addGeometry(const std::string& geometryName, Geometry* geometry, uint32 references, uint64 contentHash)
+{
+	InstanceCounter<Geometry>* instance = new InstanceCounter<Geometry>(geometry);
+	for (uint32 i = 1; i < references; ++i)
+	{
+		instance->AddRef();
+	}
+	m_geometries.insert(std::pair<std::string, InstanceCounter<Geometry>*>(geometryName, instance));
+	m_inverseLookup.insert(std::pair<Geometry*, std::string>(geometry, geometryName));
+	if (contentHash != 0)
+	{
+		// Toutes les copies d'un contenu restent connues : a la destruction de l'une,
+		// les autres peuvent encore etre partagees
+		m_contents.insert(std::pair<uint64, std::string>(contentHash, geometryName));
+	}
+}
+
+void GeometryManager::removeGeometry(const std::string& geometryName)
+{
+	auto it = m_geometries.find(geometryName);
+	if (it == m_geometries.end())
+	{
+		return;
+	}
 
+	// Copie : geometryName peut designer une valeur des tables nettoyees ci-dessous
+	std::string name = geometryName;
+	InstanceCounter<Geometry>* instance = (*it).second;
+	m_geometries.erase(it);
+	m_inverseLookup.erase(instance->getObjectPtr());
+	delete instance->getObjectPtr();
+	delete instance;
+
+	for (auto content = m_contents.begin(); content != m_contents.end();)
+	{
+		content = (*content).second == name ? m_contents.erase(content) : std::next(content);
+	}
+	for (auto alias = m_aliases.begin(); alias != m_aliases.end();)
+	{
+		alias = (*alias).second == name ? m_aliases.erase(alias) : std::next(alias);
+	}
+}
+
+Geometry* GeometryManager::findDuplicate(const GeometryRequest& request, uint32 references)
+{
+	if (request.ContentHash == 0)
+	{
+		return nullptr;
+	}
+
+	// La residence ne fait que descendre : une geometrie qui a deja libere des donnees
+	// ne peut pas servir une demande qui les garde, ni envoyer des tangentes oubliees
+	auto contents = m_contents.equal_range(request.ContentHash);
+	for (auto content = contents.first; content != contents.second; ++content)
+	{
+		InstanceCounter<Geometry>* instance = m_geometries[(*content).second];
+		Geometry* geometry = instance->getObjectPtr();
+		if (!CanServe(*geometry, request.Residency, request.AttributeMask))
+		{
+			Log() << request.Name << " a la meme empreinte que " << (*content).second << ", qui garde moins de donnees en memoire" << std::endl;
+			continue;
+		}
+		if (!SameContent(request, *geometry))
+		{
+			Log() << request.Name << " a la meme empreinte que " << (*content).second << " mais pas le meme contenu" << std::endl;
+			continue;
+		}
+
+		for (uint32 i = 0; i < references; ++i)
+		{
+			instance->AddRef();
+		}
+		m_aliases[request.Key] = (*content).second;
+		geometry->requireAttributes(request.AttributeMask);
+		Log() << request.Name << " est identique a " << (*content).second << " : geometrie partagee" << std::endl;
 		return geometry;
 	}
+	return nullptr;
+}
+
+std::string GeometryManager::findLoaded(const std::string& geometryName, GeometryResidency residency, uint32 attributeMask, InstanceCounter<Geometry>*& instance)
+{
+	instance = nullptr;
+	auto it = m_geometries.find(resolveName(geometryName));
+	if (it == m_geometries.end())
+	{
+		return geometryName;
+	}
+	if (CanServe(*(*it).second->getObjectPtr(), residency, attributeMask))
+	{
+		instance = (*it).second;
+		instance->getObjectPtr()->requireAttributes(attributeMask);
+		return geometryName;
+	}
+
+	// La residence ne fait que descendre : les donnees manquantes viennent d'une copie
+	std::string key = MakeResidencyKey(geometryName, residency);
+	auto copy = m_geometries.find(resolveName(key));
+	if (copy == m_geometries.end())
+	{
+		Log() << geometryName << " est deja chargee avec moins de donnees en memoire : copie chargee separement" << std::endl;
+		return key;
+	}
+
+	instance = (*copy).second;
+	if (!instance->getObjectPtr()->requireAttributes(attributeMask))
+	{
+		Log() << "--Erreur : la copie de " << geometryName << " ne fournit pas tous les attributs demandes" << std::endl;
+	}
+	return key;
+}
+
+const std::string& GeometryManager::resolveName(const std::string& geometryName) const
+{
+	auto alias = m_aliases.find(geometryName);
+	return alias != m_aliases.end() ? (*alias).second : geometryName;
+}
+
+std::string GeometryManager::MakeShapeKey(const char* type, const std::vector<float>& parameters)
+{
+	// Le '#' ne peut pas commencer un nom de fichier de la scene
+	std::string key = std::string("#forme:") + type;
+	for (float parameter : parameters)
+	{
+		uint32 bits;
+		std::memcpy(&bits, &parameter, sizeof(bits));
+		char text[16];
+		std::snprintf(text, sizeof(text), ":%08x", bits);
+		key += text;
+	}
+	return key;
+}
+
+Geometry* GeometryManager::loadShape(const std::string& key, const std::function<Geometry*()>& create)
+{
+	auto it = m_geometries.find(key);
+	if (it != m_geometries.end())
+	{
+		(*it).second->AddRef();
+		return (*it).second->getObjectPtr();
+	}
+
+	Geometry* geometry = create();
+	if (geometry != nullptr)
+	{
+		addGeometry(key, geometry, 1);
+	}
+	return geometry;
+}
+
+void GeometryManager::waitForWorkers()
+{
+	// m_pending n'est modifie que par le thread GL, qui est celui qui attend ici
+	std::unique_lock<std::mutex> lock(m_completedMutex);
+	m_completedCondition.wait(lock, [this]() { return m_completed.size() == m_pending.size(); });
 }
 
 Geometry* GeometryManager::operator[](const std::string& geometryName) const
 {
-	auto it = m_geometries.find(geometryName);
+	auto it = m_geometries.find(resolveName(geometryName));
 	if (it != m_geometries.end())
 	{
 		return (*it).second->getObjectPtr();
@@ -84,17 +602,14 @@ std::string GeometryManager::getGeometryName(Geometry * const geom) const
 
 bool GeometryManager::unloadGeometry(const std::string& geometryName)
 {
-	auto it = m_geometries.find(geometryName);
+	auto it = m_geometries.find(resolveName(geometryName));
 	if (it != m_geometries.end())
 	{
 		(*it).second->RemoveRef();
 
 		if (!(*it).second->hasRef())
 		{
-			m_inverseLookup.erase((*it).second->getObjectPtr());
-			delete (*it).second->getObjectPtr();
-			delete (*it).second;
-			m_geometries.erase(it);
+			removeGeometry((*it).first);
 		}
 		return true;
 	}
@@ -111,10 +626,7 @@ bool GeometryManager::unloadGeometry(Geometry*& geometry)
 
 		if (!instance->hasRef())
 		{
-            m_inverseLookup.erase(geometry);
-			delete geometry;
-			delete instance;
-			m_geometries.erase(key);			
+			removeGeometry(key);
 		}
 		// On modifie le pointeur original puisqu'on a demand 
 		// de le decharger. Mais la geometrie pourrait encore exister 
@@ -133,6 +645,29 @@ bool GeometryManager::unloadGeometry(Geometry*& geometry)
 	return false;
 }
 
+bool GeometryManager::unloadGeometry(GeometryHandle& handle)
+{
+	std::shared_ptr<GeometryRequest> request = handle.m_request;
+	handle.reset();
+	if (request == nullptr)
+	{
+		return false;
+	}
+
+	if (request->State == GeometryRequest::Status::Ready)
+	{
+		Geometry* geometry = request->Result;
+		return unloadGeometry(geometry);
+	}
+	if (request->State == GeometryRequest::Status::Pending && request->References > 0)
+	{
+		// Le resultat sera abandonne si plus personne ne l'attend
+		request->References--;
+		return true;
+	}
+	return false;
+}
+
 void GeometryManager::unloadAll()
 {
 	if (m_geometries.size() > 0)
@@ -146,4 +681,6 @@ void GeometryManager::unloadAll()
 		m_geometries.clear();
 		m_inverseLookup.clear();
 	}
+	m_contents.clear();
+	m_aliases.clear();
 }
\ No newline at end of file
@@ -4,8 +4,35 @@
 #include "Geometry.h"
 #include "../Utilities/InstanceCounter.h"
 
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+struct GeometryRequest;
+
+// Geometrie chargee en arriere-plan par GeometryManager::loadGeometryAsync.
+// getGeometry() est nul tant que le chargement n'est pas termine et televerse.
+// Les poignees se lisent sur le thread GL seulement.
+class GeometryHandle
+{
+	friend class GeometryManager;
+	std::shared_ptr<GeometryRequest> m_request;
+
+public:
+	GeometryHandle();
+
+	bool isValid() const;
+	bool isPending() const;
+	bool hasFailed() const;
+	Geometry* getGeometry() const;
+	const std::string& getName() const;
+
+	void reset();
+};
 
 class GeometryManager
 {
@@ -20,18 +47,74 @@ private:
 
 	std::map<std::string, InstanceCounter<Geometry>*> m_geometries;
 	std::map<Geometry*, std::string> m_inverseLookup;
-	
+
+	// Maillages importes par contenu : deux fichiers identiques partagent la meme geometrie.
+	// m_contents garde toutes les copies chargees d'un contenu (residences differentes),
+	// m_aliases associe le nom du second fichier a celui de la geometrie chargee.
+	std::multimap<uint64, std::string> m_contents;
+	std::map<std::string, std::string> m_aliases;
+
+	// Chargements soumis et pas encore traites par processLoadedGeometries
+	std::map<std::string, std::shared_ptr<GeometryRequest>> m_pending;
+
+	// Chargements termines par les threads de travail, en attente du thread GL
+	std::vector<std::shared_ptr<GeometryRequest>> m_completed;
+	std::mutex m_completedMutex;
+	std::condition_variable m_completedCondition;
+	uint32 m_completedLoads;
+
+	Geometry* createGeometry(GeometryRequest& request);
+	void addGeometry(const std::string& geometryName, Geometry* geometry, uint32 references, uint64 contentHash = 0);
+	void removeGeometry(const std::string& geometryName);
+	Geometry* findDuplicate(const GeometryRequest& request, uint32 references);
+	std::string findLoaded(const std::string& geometryName, GeometryResidency residency, uint32 attributeMask, InstanceCounter<Geometry>*& instance);
+	const std::string& resolveName(const std::string& geometryName) const;
+	void waitForWorkers();
 
 public:
 	static GeometryManager* GetInstance();
 	static void Initialize();
 	static void Uninitialize();
 
-	Geometry* loadGeometry(const std::string& geometryName);
+	// residency s'applique a la creation de la geometrie. Une demande en cours prend la
+	// residence la moins restrictive de ses demandeurs. Une geometrie deja chargee qui
+	// garde moins de donnees que demande n'est pas partagee : le fichier est charge une
+	// seconde fois, sous une cle propre a la residence.
+	// attributeMask (Material::getAttributeMask) liste les flux que les materiels de
+	// l'objet liront : les tangentes ne sont envoyees que si elles y figurent.
+	Geometry* loadGeometry(const std::string& geometryName, GeometryResidency residency = GeometryResidency::PickingOnly, uint32 attributeMask = 0);
+
+	// Retourne immediatement ; la lecture et la preparation se font sur le ThreadPool
+	GeometryHandle loadGeometryAsync(const std::string& geometryName, GeometryResidency residency = GeometryResidency::PickingOnly, uint32 attributeMask = 0);
+
+	// Cle d'une forme generee : son type suivi des bits exacts de chaque parametre
+	// (dimensions, subdivisions, couleur...)
+	static std::string MakeShapeKey(const char* type, const std::vector<float>& parameters);
+
+	// Forme generee partagee : la geometrie de cette cle si elle existe (une reference
+	// de plus), sinon celle retournee par create. A liberer avec unloadGeometry.
+	// Une forme partagee ne doit pas etre modifiee (transform, merge...).
+	Geometry* loadShape(const std::string& key, const std::function<Geometry*()>& create);
+
+	// Cree les geometries dont la preparation est terminee. Thread GL seulement,
+	// une fois par image. Retourne le nombre de chargements traites.
+	uint32 processLoadedGeometries();
+
+	// Bloque jusqu'a ce que tous les chargements soumis soient traites
+	void waitForPendingGeometries();
+	bool hasPendingGeometries() const;
+
+	// Augmente a chaque chargement asynchrone traite, reussi ou non
+	uint32 getCompletedLoadCount() const;
+
+	// Somme sur les geometries chargees de la memoire centrale gardee et des tampons GL
+	void getMemoryUsage(size_t& cpuBytes, size_t& gpuBytes) const;
+
 	Geometry* operator[](const std::string& geometryName) const;
 	std::string getGeometryName(Geometry * const geom) const;
 	bool unloadGeometry(const std::string& geometryName);
 	bool unloadGeometry(Geometry*& geometry);
+	bool unloadGeometry(GeometryHandle& handle);
 	void unloadAll();
 };
 
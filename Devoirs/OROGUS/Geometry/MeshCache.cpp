@@ -0,0 +1,362 @@
+#include "MeshCache.h"
+
+#include "Geometry.h"
+#include "MeshOptimizer.h"
+#include "../Utilities/Hash.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/MappedFile.h"
+#include "../Utilities/Profiler.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'M', 'S', 'H' };
+
+    // Alignement de chaque bloc dans le fichier, et donc dans la projection
+    const uint64 BLOB_ALIGNMENT = 64;
+
+    const uint32 OPTIMIZE_VERTEX_CACHE = 0x1;
+    const uint32 OPTIMIZE_OVERDRAW = 0x2;
+    const uint32 OPTIMIZE_VERTEX_FETCH = 0x4;
+
+    // Les decalages sont en octets depuis le debut du fichier ; 0 pour un bloc absent
+    struct CacheHeader
+    {
+        char Magic[4];
+        uint32 Version;
+        uint64 FileSize;
+
+        // Validation de la source
+        uint64 SourceSize;
+        int64 SourceTime;
+        uint64 SourceHash;
+
+        // Reglages de MeshOptimizer avec lesquels la geometrie a ete produite
+        uint32 OptimizerFlags;
+        float OverdrawThreshold;
+
+        float BoundsMin[3];
+        float BoundsMax[3];
+        float PositionOffset[3];
+        float PositionScale[3];
+
+        // Format des flux encodes
+        uint8 PositionEncoding;
+        uint8 DirectionEncoding;
+        uint8 TexCoordEncoding;
+        uint8 IndexSize;
+        uint32 VertexSize;
+        uint32 StreamStrides[VERTEX_STREAM_COUNT];
+
+        uint32 VertexCount;
+        uint32 IndexCount;
+        uint32 LodCount;
+        uint32 Reserved;
+
+        uint64 LodOffset;
+        uint64 VertexOffset;
+        uint64 StreamOffsets[VERTEX_STREAM_COUNT];
+        uint64 IndexOffset;
+    };
+
+    // Plage d'indices d'un niveau de detail ; le niveau 0 couvre tout le maillage
+    struct CacheLod
+    {
+        uint32 FirstIndex;
+        uint32 IndexCount;
+    };
+
+    struct SourceInfo
+    {
+        uint64 Size;
+        int64 Time;
+    };
+
+    bool GetSourceInfo(const std::string& fileName, SourceInfo& info)
+    {
+#ifdef _WIN32
+        struct _stat64 status;
+        if (_stat64(fileName.c_str(), &status) != 0)
+#else
+        struct stat status;
+        if (stat(fileName.c_str(), &status) != 0)
+#endif
+        {
+            return false;
+        }
+        info.Size = (uint64)status.st_size;
+        info.Time = (int64)status.st_mtime;
+        return true;
+    }
+
+    uint32 GetOptimizerFlags(const MeshOptimizationSettings& settings)
+    {
+        return (settings.OptimizeVertexCache ? OPTIMIZE_VERTEX_CACHE : 0)
+            | (settings.OptimizeOverdraw ? OPTIMIZE_OVERDRAW : 0)
+            | (settings.OptimizeVertexFetch ? OPTIMIZE_VERTEX_FETCH : 0);
+    }
+
+    uint64 Align(uint64 offset)
+    {
+        return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    }
+
+    bool IsBlobValid(uint64 offset, uint64 size, uint64 fileSize)
+    {
+        return offset != 0 && offset % BLOB_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+    }
+}
+
+bool MeshCache::s_enabled = true;
+
+bool MeshCache::IsEnabled()
+{
+    return s_enabled;
+}
+
+void MeshCache::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourceName)
+{
+    return sourceName + ".omesh";
+}
+
+CachedMesh::CachedMesh(const std::string& fileName)
+    : File(fileName)
+    , Vertices(nullptr)
+    , VertexCount(0)
+    , Indices(nullptr)
+    , IndexCount(0)
+    , ShortIndices(false)
+{
+}
+
+Geometry* CachedMesh::createGeometry(const std::string& name, const VertexFormat& format) const
+{
+    return Geometry::CreateFromEncoded(name, Vertices, VertexCount, Indices, IndexCount, ShortIndices, Encoded, format);
+}
+
+std::unique_ptr<CachedMesh> MeshCache::Open(const std::string& sourceName)
+{
+    if (!s_enabled)
+    {
+        return nullptr;
+    }
+
+    PROFILE_SCOPE("MeshCache::Open");
+
+    SourceInfo source;
+    if (!GetSourceInfo(sourceName, source))
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<CachedMesh> cached(new CachedMesh(GetCachePath(sourceName)));
+    const MappedFile& file = cached->File;
+    if (!file.isOpen() || file.size() < sizeof(CacheHeader))
+    {
+        return nullptr;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const MeshOptimizationSettings& settings = MeshOptimizer::Settings();
+    if (std::memcmp(header.Magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.Version != VERSION
+        || header.FileSize != file.size()
+        || header.VertexSize != sizeof(Vertex)
+        || header.OptimizerFlags != GetOptimizerFlags(settings)
+        || header.OverdrawThreshold != settings.OverdrawThreshold
+        || header.SourceSize != source.Size)
+    {
+        return nullptr;
+    }
+
+    if (header.SourceTime != source.Time)
+    {
+        // Date modifiee sans changer la taille (copie, extraction) : on compare le contenu
+        MappedFile sourceFile(sourceName);
+        if (!sourceFile.isOpen() || Hash::Bytes(sourceFile.data(), sourceFile.size()) != header.SourceHash)
+        {
+            return nullptr;
+        }
+    }
+
+    bool shortIndices = header.VertexCount < 0x10000;
+    uint64 fileSize = file.size();
+    if (header.IndexSize != (shortIndices ? sizeof(uint16) : sizeof(uint32))
+        || header.PositionEncoding > (uint8)PositionEncoding::Unorm16
+        || header.DirectionEncoding > (uint8)DirectionEncoding::Octahedral16
+        || header.TexCoordEncoding > (uint8)TexCoordEncoding::Float16
+        || header.VertexCount == 0
+        || header.IndexCount % 3 != 0
+        || header.LodCount == 0
+        || !IsBlobValid(header.LodOffset, (uint64)header.LodCount * sizeof(CacheLod), fileSize)
+        || !IsBlobValid(header.VertexOffset, (uint64)header.VertexCount * sizeof(Vertex), fileSize)
+        || !IsBlobValid(header.IndexOffset, (uint64)header.IndexCount * header.IndexSize, fileSize))
+    {
+        Log() << "--Erreur : Cache " << GetCachePath(sourceName) << " corrompu" << std::endl;
+        return nullptr;
+    }
+
+    CacheLod lod;
+    std::memcpy(&lod, file.data() + header.LodOffset, sizeof(lod));
+    if (lod.FirstIndex != 0 || lod.IndexCount != header.IndexCount)
+    {
+        Log() << "--Erreur : Cache " << GetCachePath(sourceName) << " corrompu" << std::endl;
+        return nullptr;
+    }
+
+    // Un indice hors limites ferait lire hors des sommets
+    const char* indices = file.data() + header.IndexOffset;
+    uint32 maxIndex = 0;
+    for (uint32 i = 0; i < header.IndexCount; ++i)
+    {
+        maxIndex = std::max(maxIndex, shortIndices ? (uint32)reinterpret_cast<const uint16*>(indices)[i] : reinterpret_cast<const uint32*>(indices)[i]);
+    }
+    if (header.IndexCount > 0 && maxIndex >= header.VertexCount)
+    {
+        Log() << "--Erreur : Cache " << GetCachePath(sourceName) << " corrompu" << std::endl;
+        return nullptr;
+    }
+
+    EncodedGeometry& encoded = cached->Encoded;
+    encoded.Format.Position = (PositionEncoding)header.PositionEncoding;
+    encoded.Format.Directions = (DirectionEncoding)header.DirectionEncoding;
+    encoded.Format.TexCoord = (TexCoordEncoding)header.TexCoordEncoding;
+    encoded.PositionOffset = Vector3<Real>(header.PositionOffset[0], header.PositionOffset[1], header.PositionOffset[2]);
+    encoded.PositionScale = Vector3<Real>(header.PositionScale[0], header.PositionScale[1], header.PositionScale[2]);
+    encoded.BoundsMin = Point3<Metre>(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]);
+    encoded.BoundsMax = Point3<Metre>(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]);
+
+    // Un flux dont le pas ne correspond plus au layout actuel est reencode
+    VertexLayout layout(encoded.Format);
+    for (uint32 stream = 0; stream < VERTEX_STREAM_COUNT; ++stream)
+    {
+        uint64 size = (uint64)header.VertexCount * header.StreamStrides[stream];
+        bool valid = header.StreamStrides[stream] == layout.getStride(stream) && IsBlobValid(header.StreamOffsets[stream], size, fileSize);
+        encoded.Streams[stream] = valid ? reinterpret_cast<const uint8*>(file.data() + header.StreamOffsets[stream]) : nullptr;
+    }
+
+    cached->Vertices = reinterpret_cast<const Vertex*>(file.data() + header.VertexOffset);
+    cached->VertexCount = header.VertexCount;
+    cached->Indices = indices;
+    cached->IndexCount = header.IndexCount;
+    cached->ShortIndices = shortIndices;
+    return cached;
+}
+
+bool MeshCache::Write(const std::string& sourceName, const GeometryData& data, const VertexFormat& format)
+{
+    if (!s_enabled)
+    {
+        return false;
+    }
+
+    PROFILE_SCOPE("MeshCache::Write");
+
+    const std::vector<Vertex>& vertices = data.Vertices;
+    const std::vector<uint32>& indices = data.Indices;
+    SourceInfo source;
+    MappedFile sourceFile(sourceName);
+    if (vertices.empty() || !GetSourceInfo(sourceName, source) || !sourceFile.isOpen())
+    {
+        return false;
+    }
+
+    VertexLayout layout(format);
+    const MeshOptimizationSettings& settings = MeshOptimizer::Settings();
+    bool shortIndices = vertices.size() < 0x10000;
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, MAGIC, sizeof(MAGIC));
+    header.Version = VERSION;
+    header.SourceSize = source.Size;
+    header.SourceTime = source.Time;
+    header.SourceHash = Hash::Bytes(sourceFile.data(), sourceFile.size());
+    header.OptimizerFlags = GetOptimizerFlags(settings);
+    header.OverdrawThreshold = settings.OverdrawThreshold;
+    Geometry::ComputeBounds(vertices, format, header.BoundsMin, header.BoundsMax, header.PositionOffset, header.PositionScale);
+    header.PositionEncoding = (uint8)format.Position;
+    header.DirectionEncoding = (uint8)format.Directions;
+    header.TexCoordEncoding = (uint8)format.TexCoord;
+    header.IndexSize = shortIndices ? sizeof(uint16) : sizeof(uint32);
+    header.VertexSize = sizeof(Vertex);
+    header.VertexCount = (uint32)vertices.size();
+    header.IndexCount = (uint32)indices.size();
+    header.LodCount = 1;
+
+    // Les tangentes ne sont pas conservees : elles restent calculees a la demande
+    uint64 offset = Align(sizeof(CacheHeader));
+    header.LodOffset = offset;
+    offset = Align(offset + header.LodCount * sizeof(CacheLod));
+    header.VertexOffset = offset;
+    offset = Align(offset + vertices.size() * sizeof(Vertex));
+    for (uint32 stream = VERTEX_STREAM_POSITION; stream <= VERTEX_STREAM_SHADING; ++stream)
+    {
+        header.StreamStrides[stream] = layout.getStride(stream);
+        header.StreamOffsets[stream] = offset;
+        offset = Align(offset + vertices.size() * layout.getStride(stream));
+    }
+    header.IndexOffset = offset;
+    header.FileSize = offset + indices.size() * header.IndexSize;
+
+    std::vector<uint8> file((size_t)header.FileSize, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    CacheLod lod = { 0, header.IndexCount };
+    std::memcpy(file.data() + header.LodOffset, &lod, sizeof(lod));
+    std::memcpy(file.data() + header.VertexOffset, vertices.data(), vertices.size() * sizeof(Vertex));
+    for (uint32 stream = VERTEX_STREAM_POSITION; stream <= VERTEX_STREAM_SHADING; ++stream)
+    {
+        layout.encode(vertices, stream, header.PositionOffset, header.PositionScale, file.data() + header.StreamOffsets[stream]);
+    }
+    if (shortIndices)
+    {
+        uint16* out = reinterpret_cast<uint16*>(file.data() + header.IndexOffset);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            out[i] = (uint16)indices[i];
+        }
+    }
+    else
+    {
+        std::memcpy(file.data() + header.IndexOffset, indices.data(), indices.size() * sizeof(uint32));
+    }
+
+    // Ecrit a cote puis renomme, pour ne jamais laisser un cache tronque
+    std::string path = GetCachePath(sourceName);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(file.data()), file.size()))
+        {
+            Log() << "--Erreur : Impossible d'ecrire le cache " << path << std::endl;
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        Log() << "--Erreur : Impossible d'ecrire le cache " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef _GEOMETRY_MESHCACHE_H_
+#define _GEOMETRY_MESHCACHE_H_
+
+#include "Geometry.h"
+#include "../Utilities/MappedFile.h"
+#include "../Utilities/Types.h"
+
+#include <memory>
+#include <string>
+
+// Contenu valide d'un fichier .omesh. Les pointeurs designent la projection du
+// fichier, qui reste ouverte jusqu'a la destruction de l'objet.
+struct CachedMesh
+{
+    MappedFile File;
+    const Vertex* Vertices;
+    uint32 VertexCount;
+    const void* Indices;
+    uint32 IndexCount;
+    bool ShortIndices;
+    EncodedGeometry Encoded;
+
+    explicit CachedMesh(const std::string& fileName);
+
+    // Appel GL : sur le thread du contexte seulement. Les flux du cache sont reencodes
+    // s'ils ne sont pas dans format.
+    Geometry* createGeometry(const std::string& name, const VertexFormat& format) const;
+};
+
+// Cache binaire (.omesh) des maillages importes, ecrit a cote du fichier source.
+// Il contient la geometrie deja optimisee et ses flux encodes, alignes pour etre
+// televerses directement depuis la projection du fichier en memoire.
+class MeshCache
+{
+public:
+    static const uint32 VERSION = 1;
+
+    static bool IsEnabled();
+    static void SetEnabled(bool enabled);
+
+    static std::string GetCachePath(const std::string& sourceName);
+
+    // nullptr si le cache est absent, invalide ou plus vieux que la source.
+    // Sans appel GL, peut s'executer sur un thread de travail.
+    static std::unique_ptr<CachedMesh> Open(const std::string& sourceName);
+
+    // data doit deja etre preparee (Geometry::Prepare). format est celui des flux encodes.
+    static bool Write(const std::string& sourceName, const GeometryData& data, const VertexFormat& format);
+
+private:
+    static bool s_enabled;
+};
+
+#endif
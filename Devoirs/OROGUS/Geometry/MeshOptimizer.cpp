@@ -0,0 +1,485 @@
+#include "MeshOptimizer.h"
+
+#include "Geometry.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+MeshOptimizationSettings MeshOptimizer::s_settings;
+
+namespace
+{
+    // Parametres de l'algorithme de Tom Forsyth (Linear-Speed Vertex Cache Optimisation)
+    const uint32 FORSYTH_CACHE_SIZE = 32;
+    const uint32 FORSYTH_MAX_VALENCE = 32;
+    const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+    const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+    const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+    const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+    // Nombre minimal de triangles dans un groupe lors de l'optimisation de l'overdraw
+    const uint32 OVERDRAW_MIN_CLUSTER_SIZE = 32;
+
+    const uint32 INVALID_INDEX = std::numeric_limits<uint32>::max();
+
+    struct ForsythScoreTable
+    {
+        float Cache[FORSYTH_CACHE_SIZE];
+        float Valence[FORSYTH_MAX_VALENCE];
+
+        ForsythScoreTable()
+        {
+            for (uint32 i = 0; i < FORSYTH_CACHE_SIZE; ++i)
+            {
+                if (i < 3)
+                {
+                    // Les sommets du dernier triangle ont un score fixe pour eviter
+                    // de favoriser les triangles qui viennent d'etre emis
+                    Cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+                }
+                else
+                {
+                    const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    Cache[i] = std::pow(1.0f - (i - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+                }
+            }
+
+            Valence[0] = 0.0f;
+            for (uint32 i = 1; i < FORSYTH_MAX_VALENCE; ++i)
+            {
+                Valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+            }
+        }
+
+        float score(int32 cachePosition, uint32 remainingTriangles) const
+        {
+            if (remainingTriangles == 0)
+            {
+                return -1.0f;
+            }
+
+            float s = Valence[std::min(remainingTriangles, FORSYTH_MAX_VALENCE - 1)];
+            if (cachePosition >= 0)
+            {
+                s += Cache[cachePosition];
+            }
+            return s;
+        }
+    };
+
+    void ComputeTriangleCentroidAndNormal(const std::vector<Vertex>& vertices, const uint32* tri, float centroid[3], float normal[3])
+    {
+        const float* p0 = vertices[tri[0]].Position.constValues();
+        const float* p1 = vertices[tri[1]].Position.constValues();
+        const float* p2 = vertices[tri[2]].Position.constValues();
+
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+        // Normale non normalisee : sa longueur est le double de l'aire du triangle
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            centroid[k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+        }
+    }
+}
+
+MeshOptimizationSettings& MeshOptimizer::Settings()
+{
+    return s_settings;
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32>& indices, const std::string& name)
+{
+    PROFILE_SCOPE("MeshOptimizer::Optimize");
+
+    if (indices.size() < 3 || vertices.empty())
+    {
+        return;
+    }
+
+    if (!s_settings.OptimizeVertexCache && !s_settings.OptimizeOverdraw && !s_settings.OptimizeVertexFetch)
+    {
+        return;
+    }
+
+    VertexCacheStatistics before;
+    if (s_settings.LogStatistics)
+    {
+        before = AnalyzeVertexCache(indices, (uint32)vertices.size());
+    }
+
+    if (s_settings.OptimizeVertexCache)
+    {
+        OptimizeVertexCache(indices, (uint32)vertices.size());
+    }
+
+    if (s_settings.OptimizeOverdraw)
+    {
+        OptimizeOverdraw(indices, vertices, s_settings.OverdrawThreshold);
+    }
+
+    if (s_settings.OptimizeVertexFetch)
+    {
+        OptimizeVertexFetch(vertices, indices);
+    }
+
+    if (s_settings.LogStatistics)
+    {
+        VertexCacheStatistics after = AnalyzeVertexCache(indices, (uint32)vertices.size());
+        Log() << "Optimisation du maillage " << name << " (" << indices.size() / 3 << " triangles) : "
+              << "ACMR " << before.ACMR << " -> " << after.ACMR << ", "
+              << "ATVR " << before.ATVR << " -> " << after.ATVR << std::endl;
+    }
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32>& indices, uint32 vertexCount, uint32 cacheSize)
+{
+    VertexCacheStatistics stats;
+    if (indices.size() < 3 || vertexCount == 0)
+    {
+        return stats;
+    }
+
+    // Simulation d'une cache FIFO : un sommet est dans la cache si moins de
+    // cacheSize sommets ont ete transformes depuis sa derniere transformation
+    std::vector<uint32> timestamps(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32 time = cacheSize + 1;
+    uint32 uniqueVertices = 0;
+
+    for (uint32 index : indices)
+    {
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            ++stats.TransformedVertices;
+        }
+
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.ACMR = (float)stats.TransformedVertices / (float)(indices.size() / 3);
+    stats.ATVR = (float)stats.TransformedVertices / (float)uniqueVertices;
+    return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32>& indices, uint32 vertexCount)
+{
+    static const ForsythScoreTable scoreTable;
+
+    const uint32 triangleCount = (uint32)indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+    {
+        return;
+    }
+
+    // Liste d'adjacence sommet -> triangles (format compresse)
+    std::vector<uint32> remainingTriangles(vertexCount, 0);
+    for (uint32 i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remainingTriangles[indices[i]];
+    }
+
+    std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+
+    std::vector<uint32> adjacency(triangleCount * 3);
+    std::vector<uint32> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32 t = 0; t < triangleCount; ++t)
+    {
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            adjacency[fillOffsets[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<int32> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = scoreTable.score(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    uint32 bestTriangle = INVALID_INDEX;
+    float bestScore = -1.0f;
+    for (uint32 t = 0; t < triangleCount; ++t)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > bestScore)
+        {
+            bestScore = triangleScore[t];
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<uint32> result;
+    result.reserve(triangleCount * 3);
+
+    uint32 cache[FORSYTH_CACHE_SIZE + 3];
+    uint32 cacheCount = 0;
+    uint32 scanCursor = 0;
+
+    for (uint32 emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (bestTriangle == INVALID_INDEX)
+        {
+            // Aucun triangle candidat dans la cache, on prend le prochain non emis
+            while (emitted[scanCursor])
+            {
+                ++scanCursor;
+            }
+            bestTriangle = scanCursor;
+        }
+
+        const uint32 triangle = bestTriangle;
+        const uint32* triangleIndices = &indices[triangle * 3];
+        emitted[triangle] = true;
+
+        uint32 newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32 newCacheCount = 0;
+
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            uint32 v = triangleIndices[k];
+            result.push_back(v);
+
+            // Retire le triangle de la liste d'adjacence du sommet
+            uint32 begin = adjacencyOffsets[v];
+            uint32 end = begin + remainingTriangles[v];
+            for (uint32 i = begin; i < end; ++i)
+            {
+                if (adjacency[i] == triangle)
+                {
+                    adjacency[i] = adjacency[end - 1];
+                    --remainingTriangles[v];
+                    break;
+                }
+            }
+
+            // Un triangle degenere peut referencer deux fois le meme sommet
+            if (std::find(newCache, newCache + newCacheCount, v) == newCache + newCacheCount)
+            {
+                newCache[newCacheCount++] = v;
+            }
+        }
+
+        for (uint32 i = 0; i < cacheCount; ++i)
+        {
+            uint32 v = cache[i];
+            if (v != triangleIndices[0] && v != triangleIndices[1] && v != triangleIndices[2])
+            {
+                newCache[newCacheCount++] = v;
+            }
+        }
+
+        // Mise a jour des scores des sommets touches et des triangles adjacents
+        for (uint32 i = 0; i < newCacheCount; ++i)
+        {
+            uint32 v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int32)i : -1;
+
+            float score = scoreTable.score(cachePosition[v], remainingTriangles[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            uint32 begin = adjacencyOffsets[v];
+            uint32 end = begin + remainingTriangles[v];
+            for (uint32 a = begin; a < end; ++a)
+            {
+                triangleScore[adjacency[a]] += delta;
+            }
+        }
+
+        bestTriangle = INVALID_INDEX;
+        bestScore = -1.0f;
+        cacheCount = std::min(newCacheCount, FORSYTH_CACHE_SIZE);
+        for (uint32 i = 0; i < cacheCount; ++i)
+        {
+            uint32 v = newCache[i];
+            cache[i] = v;
+
+            uint32 begin = adjacencyOffsets[v];
+            uint32 end = begin + remainingTriangles[v];
+            for (uint32 a = begin; a < end; ++a)
+            {
+                uint32 t = adjacency[a];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+    const uint32 triangleCount = (uint32)indices.size() / 3;
+    if (triangleCount < OVERDRAW_MIN_CLUSTER_SIZE * 2)
+    {
+        return;
+    }
+
+    const uint32 vertexCount = (uint32)vertices.size();
+    const uint32 cacheSize = STATISTICS_CACHE_SIZE;
+    const float meshACMR = AnalyzeVertexCache(indices, vertexCount, cacheSize).ACMR;
+
+    // Decoupage en groupes : une frontiere dure lorsqu'un triangle rate la cache
+    // pour ses trois sommets, une frontiere douce lorsque l'ACMR du groupe courant
+    // est assez bas pour qu'un redemarrage ne degrade pas trop la cache.
+    std::vector<uint32> clusterStarts;
+    std::vector<uint32> timestamps(vertexCount, 0);
+    uint32 time = cacheSize + 1;
+    uint32 clusterMisses = 0;
+    uint32 clusterStart = 0;
+
+    for (uint32 t = 0; t < triangleCount; ++t)
+    {
+        uint32 misses = 0;
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            uint32 v = indices[t * 3 + k];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                ++misses;
+            }
+        }
+
+        uint32 clusterSize = t - clusterStart;
+        bool hardBoundary = misses == 3;
+        bool softBoundary = clusterSize >= OVERDRAW_MIN_CLUSTER_SIZE && (float)clusterMisses / (float)clusterSize <= meshACMR * threshold;
+        if (t == 0 || hardBoundary || softBoundary)
+        {
+            clusterStarts.push_back(t);
+            clusterStart = t;
+            clusterMisses = 0;
+        }
+        clusterMisses += misses;
+    }
+
+    const uint32 clusterCount = (uint32)clusterStarts.size();
+    if (clusterCount < 2)
+    {
+        return;
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // Centroide et normale ponderes par l'aire de chaque groupe
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    std::vector<float> clusterData(clusterCount * 6, 0.0f);
+    for (uint32 c = 0; c < clusterCount; ++c)
+    {
+        float* data = &clusterData[c * 6];
+        float clusterArea = 0.0f;
+        for (uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            float centroid[3];
+            float normal[3];
+            ComputeTriangleCentroidAndNormal(vertices, &indices[t * 3], centroid, normal);
+            float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                data[k] += centroid[k] * area;
+                data[3 + k] += normal[k];
+                meshCentroid[k] += centroid[k] * area;
+            }
+            clusterArea += area;
+        }
+
+        if (clusterArea > 0.0f)
+        {
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                data[k] /= clusterArea;
+            }
+        }
+        meshArea += clusterArea;
+    }
+
+    if (meshArea > 0.0f)
+    {
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            meshCentroid[k] /= meshArea;
+        }
+    }
+
+    // Les groupes orientes vers l'exterieur du maillage sont dessines en premier
+    std::vector<float> sortKeys(clusterCount);
+    std::vector<uint32> clusterOrder(clusterCount);
+    for (uint32 c = 0; c < clusterCount; ++c)
+    {
+        const float* data = &clusterData[c * 6];
+        float length = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        float dot = 0.0f;
+        if (length > 0.0f)
+        {
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                dot += (data[k] - meshCentroid[k]) * data[3 + k] / length;
+            }
+        }
+        sortKeys[c] = dot;
+        clusterOrder[c] = c;
+    }
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32 a, uint32 b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32> result;
+    result.reserve(indices.size());
+    for (uint32 c : clusterOrder)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32>& indices)
+{
+    std::vector<uint32> remap(vertices.size(), INVALID_INDEX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32& index : indices)
+    {
+        if (remap[index] == INVALID_INDEX)
+        {
+            remap[index] = (uint32)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    // Les sommets non references sont conserves a la fin pour ne pas changer leur nombre
+    for (uint32 v = 0; v < (uint32)vertices.size(); ++v)
+    {
+        if (remap[v] == INVALID_INDEX)
+        {
+            reordered.push_back(vertices[v]);
+        }
+    }
+
+    vertices.swap(reordered);
+}
@@ -0,0 +1,55 @@
+#ifndef _GEOMETRY_MESHOPTIMIZER_H_
+#define _GEOMETRY_MESHOPTIMIZER_H_
+
+#include "../Utilities/Types.h"
+
+#include <string>
+#include <vector>
+
+struct Vertex;
+
+struct MeshOptimizationSettings
+{
+    bool OptimizeVertexCache = true;
+    bool OptimizeOverdraw = false;
+    bool OptimizeVertexFetch = true;
+    bool LogStatistics = false;     // ACMR/ATVR avant et apres, au prix d'une analyse de plus par maillage
+
+    // Ratio maximal d'ACMR tolere lors du decoupage en groupes pour l'overdraw
+    float OverdrawThreshold = 1.05f;
+};
+
+struct VertexCacheStatistics
+{
+    uint32 TransformedVertices = 0;
+    float ACMR = 0.0f; // Sommets transformes par triangle
+    float ATVR = 0.0f; // Sommets transformes par sommet reference
+};
+
+class MeshOptimizer
+{
+public:
+    // Taille de la cache FIFO simulee pour les statistiques
+    static const uint32 STATISTICS_CACHE_SIZE = 16;
+
+    static MeshOptimizationSettings& Settings();
+
+    static void Optimize(std::vector<Vertex>& vertices, std::vector<uint32>& indices, const std::string& name);
+
+    static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32>& indices, uint32 vertexCount, uint32 cacheSize = STATISTICS_CACHE_SIZE);
+
+    // Reordonne les triangles pour la cache post-transformation (Forsyth)
+    static void OptimizeVertexCache(std::vector<uint32>& indices, uint32 vertexCount);
+
+    // Reordonne des groupes de triangles pour reduire l'overdraw (Tipsify/Sander).
+    // Doit etre appele apres OptimizeVertexCache.
+    static void OptimizeOverdraw(std::vector<uint32>& indices, const std::vector<Vertex>& vertices, float threshold);
+
+    // Reordonne les sommets selon leur premiere utilisation dans les indices
+    static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32>& indices);
+
+private:
+    static MeshOptimizationSettings s_settings;
+};
+
+#endif
@@ -1,119 +1,769 @@
 #include "OBJImporter.h"
 
 #include "Geometry.h"
-#include "GeometryHelper.h"
 #include "../Utilities/Logger.h"
-#include "../Utilities/StringUtilities.h"
+#include "../Utilities/MappedFile.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ThreadPool.h"
 #include "../Utilities/Types.h"
 #include "../Utilities/Units.h"
 
-#include <fstream>
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <vector>
 
+namespace
+{
+    const double POWERS_OF_TEN[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Lecture en place du contenu du fichier, sans allocation ni dependance a la locale
+    class Cursor
+    {
+    private:
+        const char* m_current;
+        const char* m_end;
+
+        bool atDelimiter(const char* p) const
+        {
+            return p == m_end || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == '/' || *p == '#';
+        }
+
+    public:
+        Cursor(const char* begin, const char* end)
+            : m_current(begin)
+            , m_end(end)
+        {
+        }
+
+        bool atEnd() const
+        {
+            return m_current == m_end;
+        }
+
+        bool atEndOfLine() const
+        {
+            return m_current == m_end || *m_current == '\n' || *m_current == '\r' || *m_current == '#';
+        }
+
+        const char* position() const
+        {
+            return m_current;
+        }
+
+        void skipSpaces()
+        {
+            while (m_current != m_end && (*m_current == ' ' || *m_current == '\t'))
+            {
+                ++m_current;
+            }
+        }
+
+        void nextLine()
+        {
+            const void* newLine = std::memchr(m_current, '\n', m_end - m_current);
+            m_current = newLine != nullptr ? static_cast<const char*>(newLine) + 1 : m_end;
+        }
+
+        bool consume(char c)
+        {
+            if (m_current != m_end && *m_current == c)
+            {
+                ++m_current;
+                return true;
+            }
+            return false;
+        }
+
+        bool peek(char c) const
+        {
+            return m_current != m_end && *m_current == c;
+        }
+
+        // Premier mot de la ligne ; faux pour une ligne vide ou un commentaire
+        bool keyword(const char*& begin, size_t& length)
+        {
+            skipSpaces();
+            if (atEndOfLine())
+            {
+                return false;
+            }
+            begin = m_current;
+            while (m_current != m_end && *m_current != ' ' && *m_current != '\t' && *m_current != '\r' && *m_current != '\n')
+            {
+                ++m_current;
+            }
+            length = m_current - begin;
+            return true;
+        }
+
+        bool parseInt(int32& value)
+        {
+            const char* p = m_current;
+            bool negative = p != m_end && *p == '-';
+            if (p != m_end && (*p == '-' || *p == '+'))
+            {
+                ++p;
+            }
+
+            int64 result = 0;
+            const char* digits = p;
+            while (p != m_end && IsDigit(*p) && result <= 0x7FFFFFFF)
+            {
+                result = result * 10 + (*p - '0');
+                ++p;
+            }
+            if (p == digits || result > 0x7FFFFFFF || !atDelimiter(p))
+            {
+                return false;
+            }
+
+            value = (int32)(negative ? -result : result);
+            m_current = p;
+            return true;
+        }
+
+        bool parseFloat(float& value)
+        {
+            skipSpaces();
+            const char* p = m_current;
+            bool negative = p != m_end && *p == '-';
+            if (p != m_end && (*p == '-' || *p == '+'))
+            {
+                ++p;
+            }
+
+            // Jusqu'a 19 chiffres significatifs dans la mantisse, les suivants ne font que decaler l'exposant
+            uint64 mantissa = 0;
+            uint32 significantDigits = 0;
+            int32 exponent = 0;
+            bool hasDigits = false;
+            while (p != m_end && IsDigit(*p))
+            {
+                uint32 digit = *p - '0';
+                if (mantissa != 0 || digit != 0)
+                {
+                    if (significantDigits < 19)
+                    {
+                        mantissa = mantissa * 10 + digit;
+                        ++significantDigits;
+                    }
+                    else
+                    {
+                        ++exponent;
+                    }
+                }
+                hasDigits = true;
+                ++p;
+            }
+            if (p != m_end && *p == '.')
+            {
+                ++p;
+                while (p != m_end && IsDigit(*p))
+                {
+                    uint32 digit = *p - '0';
+                    if (significantDigits < 19)
+                    {
+                        if (mantissa != 0 || digit != 0)
+                        {
+                            mantissa = mantissa * 10 + digit;
+                            ++significantDigits;
+                        }
+                        --exponent;
+                    }
+                    hasDigits = true;
+                    ++p;
+                }
+            }
+            if (hasDigits && p != m_end && (*p == 'e' || *p == 'E'))
+            {
+                const char* e = p + 1;
+                bool negativeExponent = e != m_end && *e == '-';
+                if (e != m_end && (*e == '-' || *e == '+'))
+                {
+                    ++e;
+                }
+                if (e != m_end && IsDigit(*e))
+                {
+                    int32 explicitExponent = 0;
+                    while (e != m_end && IsDigit(*e))
+                    {
+                        explicitExponent = std::min(explicitExponent * 10 + (*e - '0'), 100000);
+                        ++e;
+                    }
+                    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                    p = e;
+                }
+            }
+
+            if (!hasDigits || !atDelimiter(p))
+            {
+                return parseSpecialFloat(value);
+            }
+
+            double result = (double)mantissa;
+            if (exponent >= -22 && exponent <= 22)
+            {
+                result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+            }
+            else if (mantissa != 0)
+            {
+                result *= std::pow(10.0, exponent);
+            }
+            value = (float)(negative ? -result : result);
+            m_current = p;
+            return true;
+        }
+
+        // nan, inf et autres formes rares : on passe par strtod sur une copie du jeton
+        bool parseSpecialFloat(float& value)
+        {
+            char token[64];
+            size_t length = 0;
+            while (m_current + length != m_end && length + 1 < sizeof(token) && !atDelimiter(m_current + length))
+            {
+                token[length] = m_current[length];
+                ++length;
+            }
+            token[length] = '\0';
+
+            char* end = nullptr;
+            double result = std::strtod(token, &end);
+            if (length == 0 || end != token + length)
+            {
+                return false;
+            }
+            value = (float)result;
+            m_current += length;
+            return true;
+        }
+    };
+
+
+    // Indices (commencant a 0) d'un coin de face ; -1 si absent
+    struct VertexKey
+    {
+        int32 Position;
+        int32 TexCoord;
+        int32 Normal;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return Position == other.Position && TexCoord == other.TexCoord && Normal == other.Normal;
+        }
+    };
+
+    uint32 HashKey(const VertexKey& key)
+    {
+        uint64 h = (uint32)key.Position;
+        h = h * 0x9E3779B97F4A7C15ull ^ (uint32)key.TexCoord;
+        h = h * 0x9E3779B97F4A7C15ull ^ (uint32)key.Normal;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return (uint32)h;
+    }
+
+    const uint32 EMPTY_SLOT = 0xFFFFFFFF;
+
+    // Table a adressage ouvert (sondage lineaire) des coins deja emis, pour
+    // souder les sommets en temps constant au lieu de chercher dans tous les precedents
+    class VertexWelder
+    {
+    private:
+        std::vector<VertexKey> m_keys;
+        std::vector<uint32> m_slots;
+        uint32 m_mask;
+
+        uint32 findSlot(const VertexKey& key) const
+        {
+            uint32 slot = HashKey(key) & m_mask;
+            while (m_slots[slot] != EMPTY_SLOT && !(m_keys[m_slots[slot]] == key))
+            {
+                slot = (slot + 1) & m_mask;
+            }
+            return slot;
+        }
+
+        void grow()
+        {
+            m_slots.assign(m_slots.size() * 2, EMPTY_SLOT);
+            m_mask = (uint32)m_slots.size() - 1;
+            for (uint32 i = 0; i < (uint32)m_keys.size(); ++i)
+            {
+                m_slots[findSlot(m_keys[i])] = i;
+            }
+        }
+
+    public:
+        VertexWelder()
+            : m_slots(1024, EMPTY_SLOT)
+            , m_mask(1023)
+        {
+        }
+
+        // Indice du sommet pour ce coin ; inserted est vrai s'il vient d'etre cree
+        uint32 insert(const VertexKey& key, bool& inserted)
+        {
+            // Facteur de charge maximal de 1/2
+            if ((m_keys.size() + 1) * 2 > m_slots.size())
+            {
+                grow();
+            }
+
+            uint32 slot = findSlot(key);
+            inserted = m_slots[slot] == EMPTY_SLOT;
+            if (inserted)
+            {
+                m_slots[slot] = (uint32)m_keys.size();
+                m_keys.push_back(key);
+            }
+            return m_slots[slot];
+        }
+
+        uint32 size() const
+        {
+            return (uint32)m_keys.size();
+        }
+    };
+
+    // Les indices negatifs sont relatifs a la fin de la liste courante
+    bool ResolveIndex(int32 index, size_t count, int32& resolved)
+    {
+        if (index > 0 && (size_t)index <= count)
+        {
+            resolved = index - 1;
+            return true;
+        }
+        if (index < 0 && (size_t)(-(int64)index) <= count)
+        {
+            resolved = (int32)count + index;
+            return true;
+        }
+        return false;
+    }
+
+    std::string LineText(const char* begin, const char* end)
+    {
+        const char* lineEnd = begin;
+        while (lineEnd != end && *lineEnd != '\n' && *lineEnd != '\r')
+        {
+            ++lineEnd;
+        }
+        return std::string(begin, lineEnd);
+    }
+
+    // Les morceaux plus petits ne valent pas le cout d'une tache
+    const size_t MIN_CHUNK_SIZE = 1 << 20;
+    const uint32 CHUNKS_PER_THREAD = 4;
+    const uint32 MAX_PARTITION_BITS = 6;
+
+    // parseInt ne produit jamais cette valeur
+    const int32 MISSING_INDEX = (int32)0x80000000;
+    const uint32 NO_ERROR_LINE = 0xFFFFFFFF;
+
+    // Coin de face tel qu'ecrit dans le fichier, avant la resolution des indices
+    struct RawCorner
+    {
+        int32 Position;
+        int32 TexCoord;
+        int32 Normal;
+    };
+
+    struct RawFace
+    {
+        uint32 FirstCorner;
+        uint32 CornerCount;
+
+        // Nombre d'elements deja lus dans le morceau, pour resoudre les indices
+        // comme si le fichier avait ete lu d'un bloc
+        uint32 PositionCount;
+        uint32 TexCoordCount;
+        uint32 NormalCount;
+
+        uint32 Line;
+        const char* LineStart;
+    };
+
+    // Portion du fichier delimitee par des fins de ligne, analysee independamment
+    struct Chunk
+    {
+        const char* Begin = nullptr;
+        const char* End = nullptr;
+
+        std::vector<Point3<Metre>> Positions;
+        std::vector<Vector2<Real>> TexCoords;
+        std::vector<Vector3<Real>> Normals;
+        std::vector<RawCorner> Corners;
+        std::vector<RawFace> Faces;
+        uint32 LineCount = 0;
+
+        // Premiere ligne invalide du morceau
+        uint32 ErrorLine = NO_ERROR_LINE;
+        const char* ErrorLineStart = nullptr;
+
+        // Decalages dans les tableaux globaux, obtenus par sommes prefixes
+        uint32 LineBase = 0;
+        uint32 PositionBase = 0;
+        uint32 TexCoordBase = 0;
+        uint32 NormalBase = 0;
+        uint32 CornerBase = 0;
+        uint32 TriangleBase = 0;
+        uint32 VertexBase = 0;
+
+        uint32 TriangleCount = 0;
+        uint32 VertexCount = 0;
+        bool MissingNormals = false;
+
+        // Coins (indices globaux) appartenant a chaque partition, dans l'ordre du fichier
+        std::vector<std::vector<uint32>> PartitionCorners;
+    };
+
+    // Sous-ensemble des cles de sommets, soude par un seul thread
+    struct Partition
+    {
+        VertexWelder Welder;
+        std::vector<uint32> VertexIds;
+    };
+
+    void SplitChunks(const char* begin, const char* end, uint32 count, std::vector<Chunk>& chunks)
+    {
+        chunks.resize(count);
+        const char* current = begin;
+        size_t size = end - begin;
+        for (uint32 i = 0; i < count; ++i)
+        {
+            const char* target = i + 1 < count ? begin + size * (i + 1) / count : end;
+            if (target < current)
+            {
+                target = current;
+            }
+            const void* newLine = target != end ? std::memchr(target, '\n', end - target) : nullptr;
+            chunks[i].Begin = current;
+            chunks[i].End = newLine != nullptr ? static_cast<const char*>(newLine) + 1 : end;
+            current = chunks[i].End;
+        }
+    }
+
+    void ParseChunk(Chunk& chunk)
+    {
+        PROFILE_SCOPE("OBJ::ParseChunk");
+
+        Cursor cursor(chunk.Begin, chunk.End);
+        for (; !cursor.atEnd(); cursor.nextLine(), ++chunk.LineCount)
+        {
+            const char* lineStart = cursor.position();
+            const char* keyword = nullptr;
+            size_t length = 0;
+            if (!cursor.keyword(keyword, length))
+            {
+                continue;
+            }
+
+            bool valid = true;
+            if (length == 1 && keyword[0] == 'v')
+            {
+                float x, y, z;
+                valid = cursor.parseFloat(x) && cursor.parseFloat(y) && cursor.parseFloat(z);
+                chunk.Positions.push_back(Point3<Metre>(Metre(x), Metre(y), Metre(z)));
+            }
+            else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't')
+            {
+                float u = 0.0f;
+                float v = 0.0f;
+                valid = cursor.parseFloat(u);
+                cursor.skipSpaces();
+                if (valid && !cursor.atEndOfLine())
+                {
+                    valid = cursor.parseFloat(v);
+                }
+                chunk.TexCoords.push_back(Vector2<Real>(u, v));
+            }
+            else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+            {
+                float x, y, z;
+                valid = cursor.parseFloat(x) && cursor.parseFloat(y) && cursor.parseFloat(z);
+                chunk.Normals.push_back(Vector3<Real>(x, y, z));
+            }
+            else if (length == 1 && keyword[0] == 'f')
+            {
+                RawFace face;
+                face.FirstCorner = (uint32)chunk.Corners.size();
+                face.PositionCount = (uint32)chunk.Positions.size();
+                face.TexCoordCount = (uint32)chunk.TexCoords.size();
+                face.NormalCount = (uint32)chunk.Normals.size();
+                face.Line = chunk.LineCount;
+                face.LineStart = lineStart;
+
+                cursor.skipSpaces();
+                while (valid && !cursor.atEndOfLine())
+                {
+                    RawCorner corner = { 0, MISSING_INDEX, MISSING_INDEX };
+
+                    // v, v/vt, v//vn ou v/vt/vn
+                    valid = cursor.parseInt(corner.Position);
+                    if (valid && cursor.consume('/'))
+                    {
+                        if (!cursor.peek('/'))
+                        {
+                            valid = cursor.parseInt(corner.TexCoord);
+                        }
+                        if (valid && cursor.consume('/'))
+                        {
+                            valid = cursor.parseInt(corner.Normal);
+                        }
+                    }
+                    chunk.Corners.push_back(corner);
+                    cursor.skipSpaces();
+                }
+
+                face.CornerCount = (uint32)chunk.Corners.size() - face.FirstCorner;
+                valid = valid && face.CornerCount >= 3;
+                chunk.Faces.push_back(face);
+            }
+
+            if (!valid)
+            {
+                chunk.ErrorLine = chunk.LineCount;
+                chunk.ErrorLineStart = lineStart;
+                return;
+            }
+        }
+    }
+
+    // Indices globaux des coins, et repartition des coins entre les partitions de soudure
+    void ResolveChunk(Chunk& chunk, uint32 partitionBits, std::vector<VertexKey>& keys)
+    {
+        PROFILE_SCOPE("OBJ::ResolveChunk");
+
+        chunk.PartitionCorners.resize((size_t)1 << partitionBits);
+        for (const RawFace& face : chunk.Faces)
+        {
+            if (face.Line >= chunk.ErrorLine)
+            {
+                break;
+            }
+
+            bool valid = true;
+            for (uint32 i = 0; i < face.CornerCount; ++i)
+            {
+                const RawCorner& raw = chunk.Corners[face.FirstCorner + i];
+                uint32 corner = chunk.CornerBase + face.FirstCorner + i;
+                VertexKey& key = keys[corner];
+                key.TexCoord = -1;
+                key.Normal = -1;
+
+                valid = ResolveIndex(raw.Position, chunk.PositionBase + face.PositionCount, key.Position)
+                    && (raw.TexCoord == MISSING_INDEX || ResolveIndex(raw.TexCoord, chunk.TexCoordBase + face.TexCoordCount, key.TexCoord))
+                    && (raw.Normal == MISSING_INDEX || ResolveIndex(raw.Normal, chunk.NormalBase + face.NormalCount, key.Normal));
+
+                if (!valid)
+                {
+                    break;
+                }
+
+                chunk.MissingNormals |= raw.Normal == MISSING_INDEX;
+                uint32 partition = partitionBits > 0 ? HashKey(key) >> (32 - partitionBits) : 0;
+                chunk.PartitionCorners[partition].push_back(corner);
+            }
+
+            if (!valid)
+            {
+                chunk.ErrorLine = face.Line;
+                chunk.ErrorLineStart = face.LineStart;
+                break;
+            }
+            chunk.TriangleCount += face.CornerCount - 2;
+        }
+    }
+}
+
 Geometry* OBJGeometryImporter::Import(const std::string& fileName)
 {
-	std::ifstream fileReader(fileName);
-
-	if (fileReader.is_open())
-	{
-        std::vector<Vertex> vertices;
-        std::vector<uint32> indexes;
-
-		std::vector<Point3<Metre>> positionList;
-		std::vector<Vector2<Real>> texturedList;
-		std::vector<Vector3<Real>> normalList;
-
-		std::string line;
-		while (!std::getline(fileReader, line))
-		{
-			if (StringUtilities::StartsWith(line, '#') || line.empty())
-			{
-				continue;
-			}
-			else
-			{
-				std::vector<std::string> values = StringUtilities::Split(line, ' ');
-
-				if (values[0] != "g")
-				{
-					if (values[0] == "v")
-					{
-						float v1, v2, v3;
-
-						v1 = std::stof(values[1]);
-						v2 = std::stof(values[2]);
-						v3 = std::stof(values[3]);
-
-						positionList.push_back(Point3<Metre>(Metre(v1), Metre(v2), Metre(v3)));
-					}
-					else if (values[0] == "vt")
-					{
-						float v1, v2;
-
-						v1 = std::stof(values[1]);
-						v2 = std::stof(values[2]);
-						
-						texturedList.push_back(Vector2<Real>(v1, v2));
-					}
-					else if (values[0] == "vn")
-					{
-						float v1, v2, v3;
-						v1 = std::stof(values[1]);
-						v2 = std::stof(values[2]);
-						v3 = std::stof(values[3]);
-
-						normalList.push_back(Vector3<Real>(v1, v2, v3));
-					}
-					else if (values[0] == "f")
-					{
-						for (int i = 1; i < 4; ++i)
-						{
-							std::vector<std::string> tripletValue = StringUtilities::Split(values[i], '/');
-							int position, texture, normal;
-							position = std::stoi(tripletValue[0]);
-							texture = std::stoi(tripletValue[1]);
-							normal = std::stoi(tripletValue[2]);
-
-							if (position > 0 && (uint32)position <= (uint32)positionList.size() && texture > 0 && (uint32)texture <= (uint32)texturedList.size() && normal > 0 && (uint32)normal <= (uint32)normalList.size())
-							{
-								Point3<Metre> vPos = positionList[position - 1];
-								Vector3<Real> vNormal = normalList[normal - 1];
-								Vector2<Real> vUV = texturedList[texture - 1];
-
-                                Vertex v = Vertex(vPos, vNormal, vUV);
-
-                                uint32 index = 0;
-                                auto it = std::find(vertices.begin(), vertices.end(), v);
-                                if (it == vertices.end())
-                                {
-                                    vertices.push_back(v);
-                                    index = (uint32)vertices.size() - 1;
-                                }
-                                else
-                                {
-                                    index = (uint32)std::distance(vertices.begin(), it);
-                                }
-
-                                indexes.push_back(index);
-							}
-							else
-							{
-								Log() << "--Erreur : La face contient des numeros de vertex invalide : " << values[i] << std::endl;
-								return nullptr;
-							}
-						}
-					}
-				}
-			}
-		}
-        return Geometry::CreateGeometry(fileName, std::move(vertices), std::move(indexes));
-	}
-    else
+    GeometryData data;
+    if (!Import(fileName, data))
     {
-        Log() << "-- Erreur : Impossible d'ouvrir le fichier " << fileName << std::endl;
         return nullptr;
     }
+    Geometry::Prepare(fileName, data);
+    return Geometry::CreatePrepared(fileName, std::move(data));
+}
+
+bool OBJGeometryImporter::Import(const std::string& fileName, GeometryData& data)
+{
+    PROFILE_SCOPE("OBJGeometryImporter::Import");
+
+    MappedFile file(fileName);
+    if (!file.isOpen())
+    {
+        Log() << "-- Erreur : Impossible d'ouvrir le fichier " << fileName << std::endl;
+        return false;
+    }
+
+    // Le fichier est coupe en morceaux analyses en parallele. Les etapes suivantes
+    // ne dependent pas du decoupage : le resultat est identique a une lecture sequentielle.
+    const char* end = file.data() + file.size();
+    uint32 threadCount = ThreadPool::GetThreadCount() + 1;
+    uint32 chunkCount = (uint32)std::min<size_t>(file.size() / MIN_CHUNK_SIZE, threadCount * CHUNKS_PER_THREAD);
+    chunkCount = std::max(chunkCount, 1u);
+
+    uint32 partitionBits = 0;
+    while (chunkCount > 1 && partitionBits < MAX_PARTITION_BITS && (1u << partitionBits) < threadCount)
+    {
+        ++partitionBits;
+    }
+    uint32 partitionCount = 1u << partitionBits;
+
+    std::vector<Chunk> chunks;
+    SplitChunks(file.data(), end, chunkCount, chunks);
+    ThreadPool::ParallelFor(chunkCount, [&chunks](uint32 i) { ParseChunk(chunks[i]); });
+
+    // Sommes prefixes : position de chaque morceau dans les listes globales
+    std::vector<Point3<Metre>> positions;
+    std::vector<Vector2<Real>> texCoords;
+    std::vector<Vector3<Real>> normals;
+    uint32 cornerCount = 0;
+    for (uint32 i = 0, lines = 0; i < chunkCount; ++i)
+    {
+        Chunk& chunk = chunks[i];
+        chunk.LineBase = lines;
+        chunk.PositionBase = (uint32)positions.size();
+        chunk.TexCoordBase = (uint32)texCoords.size();
+        chunk.NormalBase = (uint32)normals.size();
+        chunk.CornerBase = cornerCount;
+
+        lines += chunk.LineCount;
+        positions.insert(positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+        texCoords.insert(texCoords.end(), chunk.TexCoords.begin(), chunk.TexCoords.end());
+        normals.insert(normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+        cornerCount += (uint32)chunk.Corners.size();
+    }
+
+    std::vector<VertexKey> keys(cornerCount);
+    ThreadPool::ParallelFor(chunkCount, [&](uint32 i) { ResolveChunk(chunks[i], partitionBits, keys); });
+
+    bool missingNormals = false;
+    uint32 triangleCount = 0;
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.ErrorLine != NO_ERROR_LINE)
+        {
+            Log() << "--Erreur : " << fileName << ", ligne " << chunk.LineBase + chunk.ErrorLine + 1 << " invalide : " << LineText(chunk.ErrorLineStart, end) << std::endl;
+            return false;
+        }
+        chunk.TriangleBase = triangleCount;
+        triangleCount += chunk.TriangleCount;
+        missingNormals |= chunk.MissingNormals;
+    }
+
+    // Soudure : chaque partition parcourt ses coins dans l'ordre du fichier et marque
+    // la premiere occurrence de chaque cle
+    std::vector<Partition> partitions(partitionCount);
+    std::vector<uint32> localIds(cornerCount);
+    std::vector<uint8> firstOccurrences(cornerCount, 0);
+    ThreadPool::ParallelFor(partitionCount, [&](uint32 p)
+    {
+        PROFILE_SCOPE("OBJ::WeldPartition");
+        Partition& partition = partitions[p];
+        for (const Chunk& chunk : chunks)
+        {
+            for (uint32 corner : chunk.PartitionCorners[p])
+            {
+                bool inserted = false;
+                localIds[corner] = partition.Welder.insert(keys[corner], inserted);
+                firstOccurrences[corner] = inserted ? 1 : 0;
+            }
+        }
+        partition.VertexIds.resize(partition.Welder.size());
+    });
+
+    // Les sommets sont numerotes dans l'ordre de leur premiere occurrence
+    ThreadPool::ParallelFor(chunkCount, [&](uint32 i)
+    {
+        Chunk& chunk = chunks[i];
+        uint32 last = chunk.CornerBase + (uint32)chunk.Corners.size();
+        for (uint32 corner = chunk.CornerBase; corner < last; ++corner)
+        {
+            chunk.VertexCount += firstOccurrences[corner];
+        }
+    });
+
+    uint32 vertexCount = 0;
+    for (Chunk& chunk : chunks)
+    {
+        chunk.VertexBase = vertexCount;
+        vertexCount += chunk.VertexCount;
+    }
+
+    std::vector<Vertex> vertices(vertexCount);
+    ThreadPool::ParallelFor(chunkCount, [&](uint32 i)
+    {
+        PROFILE_SCOPE("OBJ::EmitVertices");
+        const Chunk& chunk = chunks[i];
+        uint32 vertex = chunk.VertexBase;
+        uint32 last = chunk.CornerBase + (uint32)chunk.Corners.size();
+        for (uint32 corner = chunk.CornerBase; corner < last; ++corner)
+        {
+            if (firstOccurrences[corner] != 0)
+            {
+                const VertexKey& key = keys[corner];
+                vertices[vertex] = Vertex(positions[key.Position],
+                                          key.Normal >= 0 && !missingNormals ? normals[key.Normal] : Vector3<Real>(),
+                                          key.TexCoord >= 0 ? texCoords[key.TexCoord] : Vector2<Real>());
+
+                // Chaque cle n'a qu'une premiere occurrence : aucun autre thread n'ecrit cette entree
+                uint32 partition = partitionBits > 0 ? HashKey(key) >> (32 - partitionBits) : 0;
+                partitions[partition].VertexIds[localIds[corner]] = vertex;
+                ++vertex;
+            }
+        }
+    });
+
+    // Polygones triangules en eventail autour du premier coin
+    std::vector<uint32> indices((size_t)triangleCount * 3);
+    ThreadPool::ParallelFor(chunkCount, [&](uint32 i)
+    {
+        PROFILE_SCOPE("OBJ::EmitTriangles");
+        const Chunk& chunk = chunks[i];
+        uint32* out = indices.data() + (size_t)chunk.TriangleBase * 3;
+        for (const RawFace& face : chunk.Faces)
+        {
+            uint32 first = 0;
+            uint32 previous = 0;
+            for (uint32 c = 0; c < face.CornerCount; ++c)
+            {
+                uint32 corner = chunk.CornerBase + face.FirstCorner + c;
+                uint32 partition = partitionBits > 0 ? HashKey(keys[corner]) >> (32 - partitionBits) : 0;
+                uint32 index = partitions[partition].VertexIds[localIds[corner]];
+                if (c == 0)
+                {
+                    first = index;
+                }
+                else if (c >= 2)
+                {
+                    *out++ = first;
+                    *out++ = previous;
+                    *out++ = index;
+                }
+                previous = index;
+            }
+        }
+    });
 
-	
-}
\ No newline at end of file
+    // Normales recalculees a partir des faces pour tout le maillage
+    data.Vertices = std::move(vertices);
+    data.Indices = std::move(indices);
+    data.ComputeNormals = missingNormals;
+    return true;
+}
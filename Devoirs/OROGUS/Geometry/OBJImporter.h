@@ -4,11 +4,16 @@
 #include <string>
 
 class Geometry;
+struct GeometryData;
 
 class OBJGeometryImporter
 {
 public:
 	static Geometry* Import(const std::string& fileName);
+
+	// Lecture seule, sans appel GL : peut s'executer sur un thread de travail.
+	// data doit encore passer par Geometry::Prepare.
+	static bool Import(const std::string& fileName, GeometryData& data);
 };
 
 #endif
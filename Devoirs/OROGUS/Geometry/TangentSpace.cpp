@@ -0,0 +1,437 @@
+#include "TangentSpace.h"
+
+#include "Geometry.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ThreadPool.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Nombre minimal de faces par tache d'accumulation
+    const uint32 MIN_TRIANGLES_PER_TASK = 32 * 1024;
+
+    // Sommets par tache pour les passes par sommet (multiple de 4)
+    const uint32 VERTICES_PER_TASK = 64 * 1024;
+
+    // Memoire maximale des tableaux d'accumulation, toutes taches confondues
+    const size_t ACCUMULATION_BUDGET = 256 * 1024 * 1024;
+
+    // En dessous, les coordonnees de texture de la face sont degenerees
+    const float MIN_UV_DETERMINANT = 1e-12f;
+
+    const float PI = 3.14159265f;
+
+    struct Float3Array
+    {
+        std::vector<float> X;
+        std::vector<float> Y;
+        std::vector<float> Z;
+
+        void reset(size_t count)
+        {
+            X.assign(count, 0.0f);
+            Y.assign(count, 0.0f);
+            Z.assign(count, 0.0f);
+        }
+    };
+
+    // Quatre vecteurs 3D, un par voie
+    struct Lanes3
+    {
+        __m128 X;
+        __m128 Y;
+        __m128 Z;
+    };
+
+    inline __m128 Gather(const std::vector<float>& values, const uint32 index[4])
+    {
+        return _mm_setr_ps(values[index[0]], values[index[1]], values[index[2]], values[index[3]]);
+    }
+
+    inline Lanes3 Gather(const Float3Array& values, const uint32 index[4])
+    {
+        return { Gather(values.X, index), Gather(values.Y, index), Gather(values.Z, index) };
+    }
+
+    inline Lanes3 Sub(const Lanes3& a, const Lanes3& b)
+    {
+        return { _mm_sub_ps(a.X, b.X), _mm_sub_ps(a.Y, b.Y), _mm_sub_ps(a.Z, b.Z) };
+    }
+
+    inline Lanes3 Scale(const Lanes3& a, __m128 s)
+    {
+        return { _mm_mul_ps(a.X, s), _mm_mul_ps(a.Y, s), _mm_mul_ps(a.Z, s) };
+    }
+
+    inline __m128 Dot(const Lanes3& a, const Lanes3& b)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.X, b.X), _mm_mul_ps(a.Y, b.Y)), _mm_mul_ps(a.Z, b.Z));
+    }
+
+    inline Lanes3 Cross(const Lanes3& a, const Lanes3& b)
+    {
+        return {
+            _mm_sub_ps(_mm_mul_ps(a.Y, b.Z), _mm_mul_ps(a.Z, b.Y)),
+            _mm_sub_ps(_mm_mul_ps(a.Z, b.X), _mm_mul_ps(a.X, b.Z)),
+            _mm_sub_ps(_mm_mul_ps(a.X, b.Y), _mm_mul_ps(a.Y, b.X))
+        };
+    }
+
+    inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // 1 / x, ou 0 si x est nul
+    inline __m128 SafeInverse(__m128 x)
+    {
+        __m128 valid = _mm_cmpneq_ps(x, _mm_setzero_ps());
+        return _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), x));
+    }
+
+    inline __m128 Abs(__m128 x)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    }
+
+    // Abramowitz et Stegun 4.4.45, erreur < 7e-5 rad : suffisant pour une ponderation
+    inline __m128 Acos(__m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        __m128 a = Abs(x);
+        __m128 poly = _mm_set1_ps(-0.0187293f);
+        poly = _mm_add_ps(_mm_mul_ps(poly, a), _mm_set1_ps(0.0742610f));
+        poly = _mm_sub_ps(_mm_mul_ps(poly, a), _mm_set1_ps(0.2121144f));
+        poly = _mm_add_ps(_mm_mul_ps(poly, a), _mm_set1_ps(1.5707288f));
+        __m128 r = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)), poly);
+        return Select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PI), r), r);
+    }
+
+    // Indices des coins des faces tri[0..count[ ; les voies en trop reprennent la premiere face
+    void LoadCorners(const uint32* tri, uint32 count, uint32 i0[4], uint32 i1[4], uint32 i2[4])
+    {
+        for (uint32 lane = 0; lane < 4; ++lane)
+        {
+            const uint32* face = tri + (lane < count ? lane : 0) * 3;
+            i0[lane] = face[0];
+            i1[lane] = face[1];
+            i2[lane] = face[2];
+        }
+    }
+
+    // Tableaux alignes recevant les quatre voies d'un Lanes3
+    struct LaneStore
+    {
+        alignas(16) float X[4];
+        alignas(16) float Y[4];
+        alignas(16) float Z[4];
+
+        explicit LaneStore(const Lanes3& value)
+        {
+            _mm_store_ps(X, value.X);
+            _mm_store_ps(Y, value.Y);
+            _mm_store_ps(Z, value.Z);
+        }
+
+        Vector3<Real> get(uint32 lane) const
+        {
+            return Vector3<Real>(X[lane], Y[lane], Z[lane]);
+        }
+    };
+
+    void ScatterAdd(Float3Array& acc, const uint32 index[4], uint32 count, const Lanes3& value)
+    {
+        LaneStore lanes(value);
+        for (uint32 lane = 0; lane < count; ++lane)
+        {
+            acc.X[index[lane]] += lanes.X[lane];
+            acc.Y[index[lane]] += lanes.Y[lane];
+            acc.Z[index[lane]] += lanes.Z[lane];
+        }
+    }
+
+    void AccumulateNormals(const Float3Array& positions, const uint32* tri, uint32 count,
+                           NormalWeighting weighting, Float3Array& acc)
+    {
+        uint32 i0[4];
+        uint32 i1[4];
+        uint32 i2[4];
+        LoadCorners(tri, count, i0, i1, i2);
+
+        Lanes3 p0 = Gather(positions, i0);
+        Lanes3 p1 = Gather(positions, i1);
+        Lanes3 p2 = Gather(positions, i2);
+        Lanes3 e1 = Sub(p1, p0);
+        Lanes3 e2 = Sub(p2, p0);
+
+        // Norme egale au double de l'aire
+        Lanes3 n = Cross(e1, e2);
+        if (weighting == NormalWeighting::Area)
+        {
+            ScatterAdd(acc, i0, count, n);
+            ScatterAdd(acc, i1, count, n);
+            ScatterAdd(acc, i2, count, n);
+            return;
+        }
+
+        Lanes3 e3 = Sub(p2, p1);
+        Lanes3 unit = Scale(n, SafeInverse(_mm_sqrt_ps(Dot(n, n))));
+        __m128 inv1 = SafeInverse(_mm_sqrt_ps(Dot(e1, e1)));
+        __m128 inv2 = SafeInverse(_mm_sqrt_ps(Dot(e2, e2)));
+        __m128 inv3 = SafeInverse(_mm_sqrt_ps(Dot(e3, e3)));
+
+        // Angles en p0 (entre e1 et e2) et en p1 (entre -e1 et e3) ; le troisieme complete a pi
+        __m128 a0 = Acos(_mm_mul_ps(Dot(e1, e2), _mm_mul_ps(inv1, inv2)));
+        __m128 a1 = Acos(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), Dot(e1, e3)), _mm_mul_ps(inv1, inv3)));
+        __m128 a2 = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(PI), a0), a1), _mm_setzero_ps());
+
+        ScatterAdd(acc, i0, count, Scale(unit, a0));
+        ScatterAdd(acc, i1, count, Scale(unit, a1));
+        ScatterAdd(acc, i2, count, Scale(unit, a2));
+    }
+
+    void AccumulateTangents(const Float3Array& positions, const std::vector<float>& u, const std::vector<float>& v,
+                            const uint32* tri, uint32 count, Float3Array& tangents, Float3Array& bitangents)
+    {
+        uint32 i0[4];
+        uint32 i1[4];
+        uint32 i2[4];
+        LoadCorners(tri, count, i0, i1, i2);
+
+        Lanes3 p0 = Gather(positions, i0);
+        Lanes3 e1 = Sub(Gather(positions, i1), p0);
+        Lanes3 e2 = Sub(Gather(positions, i2), p0);
+
+        __m128 u0 = Gather(u, i0);
+        __m128 v0 = Gather(v, i0);
+        __m128 s1 = _mm_sub_ps(Gather(u, i1), u0);
+        __m128 t1 = _mm_sub_ps(Gather(v, i1), v0);
+        __m128 s2 = _mm_sub_ps(Gather(u, i2), u0);
+        __m128 t2 = _mm_sub_ps(Gather(v, i2), v0);
+
+        // Une face sans etendue en UV ne contribue pas
+        __m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+        __m128 valid = _mm_cmpgt_ps(Abs(det), _mm_set1_ps(MIN_UV_DETERMINANT));
+        __m128 r = _mm_and_ps(valid, SafeInverse(det));
+
+        Lanes3 sdir = Scale(Sub(Scale(e1, t2), Scale(e2, t1)), r);
+        Lanes3 tdir = Scale(Sub(Scale(e2, s1), Scale(e1, s2)), r);
+
+        ScatterAdd(tangents, i0, count, sdir);
+        ScatterAdd(tangents, i1, count, sdir);
+        ScatterAdd(tangents, i2, count, sdir);
+        ScatterAdd(bitangents, i0, count, tdir);
+        ScatterAdd(bitangents, i1, count, tdir);
+        ScatterAdd(bitangents, i2, count, tdir);
+    }
+
+    uint32 AccumulationTaskCount(uint32 triangleCount, uint32 vertexCount, uint32 arraysPerTask)
+    {
+        uint32 tasks = std::min(ThreadPool::GetThreadCount() + 1, std::max(1u, triangleCount / MIN_TRIANGLES_PER_TASK));
+        size_t bytesPerTask = (size_t)vertexCount * arraysPerTask * 3 * sizeof(float);
+        if (bytesPerTask > 0)
+        {
+            tasks = (uint32)std::min<size_t>(tasks, std::max<size_t>(1, ACCUMULATION_BUDGET / bytesPerTask));
+        }
+        return tasks;
+    }
+
+    void TaskRange(uint32 count, uint32 tasks, uint32 task, uint32& begin, uint32& end)
+    {
+        begin = (uint32)((uint64)count * task / tasks);
+        end = (uint32)((uint64)count * (task + 1) / tasks);
+    }
+
+    // Appelle body(begin, end) sur des blocs de sommets, en parallele
+    template<typename Body>
+    void ForEachVertexBlock(uint32 vertexCount, const Body& body)
+    {
+        uint32 blocks = (vertexCount + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+        ThreadPool::ParallelFor(blocks, [&](uint32 block)
+        {
+            uint32 begin = block * VERTICES_PER_TASK;
+            body(begin, std::min(begin + VERTICES_PER_TASK, vertexCount));
+        });
+    }
+
+    void ExtractPositions(const std::vector<Vertex>& vertices, Float3Array& positions)
+    {
+        PROFILE_SCOPE("TangentSpace::ExtractPositions");
+        positions.X.resize(vertices.size());
+        positions.Y.resize(vertices.size());
+        positions.Z.resize(vertices.size());
+        ForEachVertexBlock((uint32)vertices.size(), [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; ++i)
+            {
+                const float* p = vertices[i].Position.constValues();
+                positions.X[i] = p[0];
+                positions.Y[i] = p[1];
+                positions.Z[i] = p[2];
+            }
+        });
+    }
+
+    // Somme des accumulateurs sur 4 sommets consecutifs ; les voies au-dela de end restent nulles
+    Lanes3 SumLanes(const std::vector<Float3Array>& partials, uint32 first, uint32 end)
+    {
+        Lanes3 sum = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+        for (const Float3Array& partial : partials)
+        {
+            if (first + 4 <= end)
+            {
+                sum.X = _mm_add_ps(sum.X, _mm_loadu_ps(&partial.X[first]));
+                sum.Y = _mm_add_ps(sum.Y, _mm_loadu_ps(&partial.Y[first]));
+                sum.Z = _mm_add_ps(sum.Z, _mm_loadu_ps(&partial.Z[first]));
+            }
+            else
+            {
+                alignas(16) float x[4] = {};
+                alignas(16) float y[4] = {};
+                alignas(16) float z[4] = {};
+                for (uint32 lane = 0; first + lane < end; ++lane)
+                {
+                    x[lane] = partial.X[first + lane];
+                    y[lane] = partial.Y[first + lane];
+                    z[lane] = partial.Z[first + lane];
+                }
+                sum.X = _mm_add_ps(sum.X, _mm_load_ps(x));
+                sum.Y = _mm_add_ps(sum.Y, _mm_load_ps(y));
+                sum.Z = _mm_add_ps(sum.Z, _mm_load_ps(z));
+            }
+        }
+        return sum;
+    }
+
+    Lanes3 Normalize(const Lanes3& a)
+    {
+        return Scale(a, SafeInverse(_mm_sqrt_ps(Dot(a, a))));
+    }
+
+    // Vecteur unitaire quelconque orthogonal a n, pour les sommets sans tangente exploitable
+    Vector3<Real> AnyTangent(const Vector3<Real>& n)
+    {
+        const float* d = n.constValues();
+        Vector3<Real> t = std::abs(d[0]) > std::abs(d[2]) ? Vector3<Real>(-d[1], d[0], 0.0f) : Vector3<Real>(0.0f, -d[2], d[1]);
+        const float* c = t.constValues();
+        float length = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+        return length > 0.0f ? Vector3<Real>(c[0] / length, c[1] / length, c[2] / length) : Vector3<Real>(1.0f, 0.0f, 0.0f);
+    }
+}
+
+void TangentSpace::ComputeNormals(std::vector<Vertex>& vertices, const std::vector<uint32>& indices, NormalWeighting weighting)
+{
+    PROFILE_SCOPE("TangentSpace::ComputeNormals");
+    uint32 vertexCount = (uint32)vertices.size();
+    uint32 triangleCount = (uint32)(indices.size() / 3);
+
+    Float3Array positions;
+    ExtractPositions(vertices, positions);
+
+    uint32 tasks = AccumulationTaskCount(triangleCount, vertexCount, 1);
+    std::vector<Float3Array> partials(tasks);
+    ThreadPool::ParallelFor(tasks, [&](uint32 task)
+    {
+        PROFILE_SCOPE("TangentSpace::AccumulateNormals");
+        Float3Array& acc = partials[task];
+        acc.reset(vertexCount);
+
+        uint32 begin;
+        uint32 end;
+        TaskRange(triangleCount, tasks, task, begin, end);
+        for (uint32 t = begin; t < end; t += 4)
+        {
+            AccumulateNormals(positions, &indices[(size_t)t * 3], std::min(4u, end - t), weighting, acc);
+        }
+    });
+
+    ForEachVertexBlock(vertexCount, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 first = begin; first < end; first += 4)
+        {
+            LaneStore n(Normalize(SumLanes(partials, first, end)));
+            for (uint32 lane = 0; lane < 4 && first + lane < end; ++lane)
+            {
+                vertices[first + lane].Normal = n.get(lane);
+            }
+        }
+    });
+}
+
+void TangentSpace::ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32>& indices)
+{
+    PROFILE_SCOPE("TangentSpace::ComputeTangents");
+    uint32 vertexCount = (uint32)vertices.size();
+    uint32 triangleCount = (uint32)(indices.size() / 3);
+
+    Float3Array positions;
+    ExtractPositions(vertices, positions);
+
+    std::vector<float> u(vertexCount);
+    std::vector<float> v(vertexCount);
+    ForEachVertexBlock(vertexCount, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const float* uv = vertices[i].TexCoord.constValues();
+            u[i] = uv[0];
+            v[i] = uv[1];
+        }
+    });
+
+    uint32 tasks = AccumulationTaskCount(triangleCount, vertexCount, 2);
+    std::vector<Float3Array> tangents(tasks);
+    std::vector<Float3Array> bitangents(tasks);
+    ThreadPool::ParallelFor(tasks, [&](uint32 task)
+    {
+        PROFILE_SCOPE("TangentSpace::AccumulateTangents");
+        tangents[task].reset(vertexCount);
+        bitangents[task].reset(vertexCount);
+
+        uint32 begin;
+        uint32 end;
+        TaskRange(triangleCount, tasks, task, begin, end);
+        for (uint32 t = begin; t < end; t += 4)
+        {
+            AccumulateTangents(positions, u, v, &indices[(size_t)t * 3], std::min(4u, end - t), tangents[task], bitangents[task]);
+        }
+    });
+
+    ForEachVertexBlock(vertexCount, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 first = begin; first < end; first += 4)
+        {
+            Lanes3 t = SumLanes(tangents, first, end);
+            Lanes3 b = SumLanes(bitangents, first, end);
+
+            alignas(16) float nx[4] = {};
+            alignas(16) float ny[4] = {};
+            alignas(16) float nz[4] = {};
+            for (uint32 lane = 0; lane < 4 && first + lane < end; ++lane)
+            {
+                const float* n = vertices[first + lane].Normal.constValues();
+                nx[lane] = n[0];
+                ny[lane] = n[1];
+                nz[lane] = n[2];
+            }
+            Lanes3 n = { _mm_load_ps(nx), _mm_load_ps(ny), _mm_load_ps(nz) };
+
+            // Gram-Schmidt : on retire de t sa composante selon n
+            Lanes3 orthogonal = Normalize(Sub(t, Scale(n, Dot(n, t))));
+            int degenerate = _mm_movemask_ps(_mm_cmpeq_ps(Dot(orthogonal, orthogonal), _mm_setzero_ps()));
+            int handedness = _mm_movemask_ps(_mm_cmplt_ps(Dot(Cross(n, t), b), _mm_setzero_ps()));
+
+            LaneStore tangent(orthogonal);
+            for (uint32 lane = 0; lane < 4 && first + lane < end; ++lane)
+            {
+                Vertex& vertex = vertices[first + lane];
+                vertex.Tangent = (degenerate & (1 << lane)) != 0 ? AnyTangent(vertex.Normal) : tangent.get(lane);
+                vertex.Handedness = (handedness & (1 << lane)) != 0 ? -1.0f : 1.0f;
+            }
+        }
+    });
+}
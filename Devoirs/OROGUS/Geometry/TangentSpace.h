@@ -0,0 +1,37 @@
+#ifndef _GEOMETRY_TANGENTSPACE_H_
+#define _GEOMETRY_TANGENTSPACE_H_
+
+#include "../Utilities/Types.h"
+
+#include <vector>
+
+struct Vertex;
+
+enum class NormalWeighting
+{
+    Area,   // Produit vectoriel brut : les grandes faces comptent plus
+    Angle   // Normale de la face ponderee par l'angle du coin
+};
+
+// Normales et tangentes lissees. Les attributs sont copies en structure de
+// tableaux, puis les faces sont traitees 4 par 4 en SSE. Les faces sont
+// reparties sur le ThreadPool : chaque tache accumule dans ses propres
+// tableaux, additionnes ensuite sommet par sommet.
+class TangentSpace
+{
+public:
+    TangentSpace() = delete;
+
+    // Remplace les normales. Un sommet qui n'appartient a aucune face non
+    // degeneree recoit une normale nulle.
+    static void ComputeNormals(std::vector<Vertex>& vertices, const std::vector<uint32>& indices,
+                               NormalWeighting weighting = NormalWeighting::Area);
+
+    // Tangentes accumulees sur les faces (Lengyel), orthogonalisees par rapport a
+    // la normale (Gram-Schmidt). Handedness est le signe de la bitangente :
+    // bitangente = cross(normale, tangente) * Handedness. Les normales doivent
+    // deja etre calculees.
+    static void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32>& indices);
+};
+
+#endif
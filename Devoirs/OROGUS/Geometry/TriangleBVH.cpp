@@ -0,0 +1,700 @@
+#include "TriangleBVH.h"
+#include "Geometry.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/ThreadPool.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace
+{
+    const uint32 LEAF = 0x80000000u;
+    const uint32 EMPTY = 0xFFFFFFFFu;
+
+    const uint32 BIN_COUNT = 16;
+    const uint32 MAX_LEAF_TRIANGLES = 16;           // Quatre paquets
+    const float TRAVERSAL_COST = 1.0f;              // Par rapport au test d'un paquet
+
+    // Au-dela, les noeuds sont coupes a la mediane : la profondeur reste bornee meme
+    // si la SAH produit une chaine, ce qui borne aussi la pile de parcours
+    const uint32 MAX_SAH_DEPTH = 48;
+    const uint32 STACK_SIZE = 256;
+
+    // Sous-arbres construits en parallele au-dessus de ce nombre de triangles
+    const uint32 PARALLEL_BUILD_TRIANGLES = 16 * 1024;
+    const uint32 TRIANGLES_PER_TASK = 64 * 1024;
+
+    // Quatrieme composante a zero : deux boites s'unissent en deux instructions SSE
+    struct Box
+    {
+        float Min[4];
+        float Max[4];
+    };
+
+    Box EmptyBox()
+    {
+        const float big = std::numeric_limits<float>::max();
+        return Box{ { big, big, big, 0.0f }, { -big, -big, -big, 0.0f } };
+    }
+
+    void Grow(Box& box, const float p[3])
+    {
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            box.Min[i] = std::min(box.Min[i], p[i]);
+            box.Max[i] = std::max(box.Max[i], p[i]);
+        }
+    }
+
+    void Grow(Box& box, const Box& other)
+    {
+        _mm_storeu_ps(box.Min, _mm_min_ps(_mm_loadu_ps(box.Min), _mm_loadu_ps(other.Min)));
+        _mm_storeu_ps(box.Max, _mm_max_ps(_mm_loadu_ps(box.Max), _mm_loadu_ps(other.Max)));
+    }
+
+    // Demi-aire : seul le rapport entre deux aires compte pour la SAH
+    float HalfArea(const Box& box)
+    {
+        float dx = box.Max[0] - box.Min[0];
+        float dy = box.Max[1] - box.Min[1];
+        float dz = box.Max[2] - box.Min[2];
+        return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+    }
+
+    uint32 PacketCount(uint32 triangles)
+    {
+        return (triangles + 3) / 4;
+    }
+
+    // Deplacees elles-memes lors des partages : chaque passage lit la memoire dans l'ordre
+    struct BuildTriangle
+    {
+        Box Bounds;
+        float Centroid[3];
+        uint32 Triangle;
+    };
+
+    // Boite des triangles et boite de leurs centres
+    struct RangeBounds
+    {
+        Box Bounds;
+        Box Centroids;
+    };
+
+    RangeBounds ComputeBounds(const BuildTriangle* triangles, uint32 begin, uint32 end)
+    {
+        RangeBounds range = { EmptyBox(), EmptyBox() };
+        for (uint32 i = begin; i < end; ++i)
+        {
+            Grow(range.Bounds, triangles[i].Bounds);
+            Grow(range.Centroids, triangles[i].Centroid);
+        }
+        return range;
+    }
+
+    // Casiers de la SAH sur les trois axes
+    struct Bins
+    {
+        Box Bounds[3][BIN_COUNT];
+        uint32 Counts[3][BIN_COUNT];
+    };
+
+    uint32 BinIndex(float centroid, float origin, float scale)
+    {
+        return std::min(BIN_COUNT - 1, (uint32)((centroid - origin) * scale));
+    }
+
+    void FillBins(const BuildTriangle* triangles, uint32 begin, uint32 end, const float origin[3], const float scales[3], Bins& bins)
+    {
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            std::fill(bins.Bounds[axis], bins.Bounds[axis] + BIN_COUNT, EmptyBox());
+            std::fill(bins.Counts[axis], bins.Counts[axis] + BIN_COUNT, 0u);
+        }
+
+        // Un seul passage sur les triangles remplit les casiers des trois axes
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const BuildTriangle& triangle = triangles[i];
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                uint32 bin = BinIndex(triangle.Centroid[axis], origin[axis], scales[axis]);
+                bins.Counts[axis][bin]++;
+                Grow(bins.Bounds[axis][bin], triangle.Bounds);
+            }
+        }
+    }
+
+    // Nombre de morceaux d'un passage sur count triangles : un seul sous le seuil parallele
+    uint32 TaskCount(uint32 count)
+    {
+        return count >= PARALLEL_BUILD_TRIANGLES ? (count + TRIANGLES_PER_TASK - 1) / TRIANGLES_PER_TASK : 1;
+    }
+
+    // Appelle body(task, begin, end) sur les morceaux de [first, first + count). Les
+    // passages des noeuds du haut de l'arbre, ou peu de sous-arbres se construisent a
+    // la fois, sont ainsi repartis sur le ThreadPool.
+    template<typename Body>
+    void ForEachTask(uint32 first, uint32 count, const Body& body)
+    {
+        uint32 taskCount = TaskCount(count);
+        if (taskCount == 1)
+        {
+            body(0, first, first + count);
+            return;
+        }
+
+        ThreadPool::ParallelFor(taskCount, [&](uint32 task)
+        {
+            uint32 begin = first + task * TRIANGLES_PER_TASK;
+            body(task, begin, std::min(begin + TRIANGLES_PER_TASK, first + count));
+        });
+    }
+
+    void GetTriangle(const Geometry& geometry, uint32 triangle, float p[3][3])
+    {
+        const std::vector<uint32>& indices = geometry.getIndices();
+        for (uint32 corner = 0; corner < 3; ++corner)
+        {
+            const Point3<Metre>& position = geometry.getPosition(indices[3 * triangle + corner]);
+            p[corner][0] = (float)position.x();
+            p[corner][1] = (float)position.y();
+            p[corner][2] = (float)position.z();
+        }
+    }
+
+    struct NearestVisitor
+    {
+        float MaxDistance;
+        TriangleHit Hit;
+        bool Found;
+
+        void operator()(uint32 triangle, float distance, float u, float v)
+        {
+            if (distance < MaxDistance)
+            {
+                MaxDistance = distance;
+                Hit = TriangleHit{ triangle, distance, u, v };
+                Found = true;
+            }
+        }
+    };
+
+    struct AllVisitor
+    {
+        float MaxDistance;
+        std::vector<TriangleHit>* Hits;
+
+        void operator()(uint32 triangle, float distance, float u, float v)
+        {
+            Hits->push_back(TriangleHit{ triangle, distance, u, v });
+        }
+    };
+}
+
+// Arbre binaire de la construction, aplati ensuite dans m_nodes
+struct TriangleBVH::BuildNode
+{
+    Box Bounds;
+    std::unique_ptr<BuildNode> Children[2];
+    uint32 First;       // Feuilles : plage de BuildState::Triangles
+    uint32 Count;
+
+    bool isLeaf() const
+    {
+        return !Children[0];
+    }
+};
+
+struct TriangleBVH::BuildState
+{
+    const Geometry& Source;
+    std::vector<BuildTriangle> Triangles;
+};
+
+TriangleBVH::TriangleBVH(const Geometry& geometry)
+    : m_triangleCount(0)
+{
+    if (!geometry.hasPickingData() || geometry.getIndices().size() < 3)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("TriangleBVH::TriangleBVH");
+    m_triangleCount = (uint32)(geometry.getIndices().size() / 3);
+
+    BuildState state{ geometry, std::vector<BuildTriangle>(m_triangleCount) };
+    ForEachTask(0, m_triangleCount, [&state](uint32, uint32 begin, uint32 end)
+    {
+        for (uint32 triangle = begin; triangle < end; ++triangle)
+        {
+            float p[3][3];
+            GetTriangle(state.Source, triangle, p);
+            BuildTriangle& build = state.Triangles[triangle];
+            build.Bounds = EmptyBox();
+            for (uint32 corner = 0; corner < 3; ++corner)
+            {
+                Grow(build.Bounds, p[corner]);
+            }
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                build.Centroid[axis] = (build.Bounds.Min[axis] + build.Bounds.Max[axis]) * 0.5f;
+            }
+            build.Triangle = triangle;
+        }
+    });
+
+    BuildNode root;
+    buildNode(state, root, 0, m_triangleCount, 0);
+
+    // La racine doit etre un noeud a quatre enfants, meme pour une seule feuille
+    if (root.isLeaf())
+    {
+        m_nodes.emplace_back();
+        Node& node = m_nodes.back();
+        std::fill(node.Child, node.Child + 4, EMPTY);
+        std::fill(node.PacketCount, node.PacketCount + 4, 0u);
+        node.MinX[0] = root.Bounds.Min[0];
+        node.MinY[0] = root.Bounds.Min[1];
+        node.MinZ[0] = root.Bounds.Min[2];
+        node.MaxX[0] = root.Bounds.Max[0];
+        node.MaxY[0] = root.Bounds.Max[1];
+        node.MaxZ[0] = root.Bounds.Max[2];
+        node.Child[0] = LEAF | packLeaf(state, root);
+        node.PacketCount[0] = PacketCount(root.Count);
+    }
+    else
+    {
+        flatten(state, root);
+    }
+}
+
+void TriangleBVH::buildNode(BuildState& state, BuildNode& node, uint32 first, uint32 count, uint32 depth)
+{
+    node.First = first;
+    node.Count = count;
+
+    BuildTriangle* triangles = state.Triangles.data();
+    uint32 taskCount = TaskCount(count);
+    RangeBounds range;
+    std::vector<RangeBounds> taskRanges(taskCount - 1);
+    ForEachTask(first, count, [&](uint32 task, uint32 begin, uint32 end)
+    {
+        (task == 0 ? range : taskRanges[task - 1]) = ComputeBounds(triangles, begin, end);
+    });
+    for (const RangeBounds& taskRange : taskRanges)
+    {
+        Grow(range.Bounds, taskRange.Bounds);
+        Grow(range.Centroids, taskRange.Centroids);
+    }
+    node.Bounds = range.Bounds;
+    const Box& centroids = range.Centroids;
+
+    if (count <= 4)
+    {
+        return;
+    }
+
+    // SAH par casiers sur les trois axes : cout d'un partage = aire * paquets de chaque cote
+    uint32 bestAxis = 0;
+    uint32 bestSplit = BIN_COUNT;
+    float bestCost = std::numeric_limits<float>::max();
+    if (depth < MAX_SAH_DEPTH)
+    {
+        float scales[3];
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            float extent = centroids.Max[axis] - centroids.Min[axis];
+            scales[axis] = extent > 0.0f ? BIN_COUNT / extent : 0.0f;
+        }
+
+        Bins bins;
+        std::vector<Bins> taskBins(taskCount - 1);
+        ForEachTask(first, count, [&](uint32 task, uint32 begin, uint32 end)
+        {
+            FillBins(triangles, begin, end, centroids.Min, scales, task == 0 ? bins : taskBins[task - 1]);
+        });
+        for (const Bins& taskBin : taskBins)
+        {
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                for (uint32 bin = 0; bin < BIN_COUNT; ++bin)
+                {
+                    Grow(bins.Bounds[axis][bin], taskBin.Bounds[axis][bin]);
+                    bins.Counts[axis][bin] += taskBin.Counts[axis][bin];
+                }
+            }
+        }
+
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            if (scales[axis] == 0.0f)
+            {
+                continue;
+            }
+
+            // Cote gauche cumule, puis balayage de droite a gauche
+            float leftCosts[BIN_COUNT - 1];
+            Box left = EmptyBox();
+            uint32 leftCount = 0;
+            for (uint32 split = 0; split < BIN_COUNT - 1; ++split)
+            {
+                Grow(left, bins.Bounds[axis][split]);
+                leftCount += bins.Counts[axis][split];
+                leftCosts[split] = HalfArea(left) * PacketCount(leftCount);
+            }
+
+            Box right = EmptyBox();
+            uint32 rightCount = 0;
+            for (uint32 split = BIN_COUNT - 1; split > 0; --split)
+            {
+                Grow(right, bins.Bounds[axis][split]);
+                rightCount += bins.Counts[axis][split];
+                if (rightCount == 0 || rightCount == count)
+                {
+                    continue;
+                }
+                float cost = leftCosts[split - 1] + HalfArea(right) * PacketCount(rightCount);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+    }
+
+    uint32 middle = first;
+    if (bestSplit < BIN_COUNT)
+    {
+        float area = HalfArea(node.Bounds);
+        if (count <= MAX_LEAF_TRIANGLES && TRAVERSAL_COST * area + bestCost >= area * PacketCount(count))
+        {
+            return;
+        }
+
+        float extent = centroids.Max[bestAxis] - centroids.Min[bestAxis];
+        float scale = BIN_COUNT / extent;
+        float minimum = centroids.Min[bestAxis];
+        middle = (uint32)(std::partition(triangles + first, triangles + first + count, [=](const BuildTriangle& triangle)
+        {
+            return BinIndex(triangle.Centroid[bestAxis], minimum, scale) < bestSplit;
+        }) - triangles);
+    }
+
+    // Pas de partage utile (centres confondus, ou arbre trop profond) : mediane sur le plus grand axe
+    if (middle == first || middle == first + count)
+    {
+        uint32 axis = 0;
+        for (uint32 i = 1; i < 3; ++i)
+        {
+            if (centroids.Max[i] - centroids.Min[i] > centroids.Max[axis] - centroids.Min[axis])
+            {
+                axis = i;
+            }
+        }
+        middle = first + count / 2;
+        std::nth_element(triangles + first, triangles + middle, triangles + first + count, [=](const BuildTriangle& a, const BuildTriangle& b)
+        {
+            return a.Centroid[axis] < b.Centroid[axis];
+        });
+    }
+
+    node.Children[0].reset(new BuildNode());
+    node.Children[1].reset(new BuildNode());
+    uint32 firsts[2] = { first, middle };
+    uint32 counts[2] = { middle - first, first + count - middle };
+    if (count >= PARALLEL_BUILD_TRIANGLES)
+    {
+        ThreadPool::ParallelFor(2, [&](uint32 child)
+        {
+            buildNode(state, *node.Children[child], firsts[child], counts[child], depth + 1);
+        });
+    }
+    else
+    {
+        buildNode(state, *node.Children[0], firsts[0], counts[0], depth + 1);
+        buildNode(state, *node.Children[1], firsts[1], counts[1], depth + 1);
+    }
+}
+
+uint32 TriangleBVH::flatten(const BuildState& state, const BuildNode& node)
+{
+    // Les quatre enfants : on ouvre l'enfant interne de plus grande aire tant qu'il y a de la place
+    const BuildNode* children[4] = { node.Children[0].get(), node.Children[1].get(), nullptr, nullptr };
+    uint32 childCount = 2;
+    while (childCount < 4)
+    {
+        int32 open = -1;
+        float openArea = -1.0f;
+        for (uint32 i = 0; i < childCount; ++i)
+        {
+            if (!children[i]->isLeaf() && HalfArea(children[i]->Bounds) > openArea)
+            {
+                open = (int32)i;
+                openArea = HalfArea(children[i]->Bounds);
+            }
+        }
+        if (open < 0)
+        {
+            break;
+        }
+        const BuildNode* opened = children[open];
+        children[open] = opened->Children[0].get();
+        children[childCount++] = opened->Children[1].get();
+    }
+
+    // Les enfants sont ajoutes apres leur parent : m_nodes peut etre reallouee, on garde l'indice
+    uint32 index = (uint32)m_nodes.size();
+    m_nodes.emplace_back();
+    for (uint32 i = 0; i < 4; ++i)
+    {
+        uint32 child = EMPTY;
+        uint32 packetCount = 0;
+        Box bounds = Box{ { 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+        if (i < childCount)
+        {
+            bounds = children[i]->Bounds;
+            if (children[i]->isLeaf())
+            {
+                child = LEAF | packLeaf(state, *children[i]);
+                packetCount = PacketCount(children[i]->Count);
+            }
+            else
+            {
+                child = flatten(state, *children[i]);
+            }
+        }
+
+        Node& flat = m_nodes[index];
+        flat.MinX[i] = bounds.Min[0];
+        flat.MinY[i] = bounds.Min[1];
+        flat.MinZ[i] = bounds.Min[2];
+        flat.MaxX[i] = bounds.Max[0];
+        flat.MaxY[i] = bounds.Max[1];
+        flat.MaxZ[i] = bounds.Max[2];
+        flat.Child[i] = child;
+        flat.PacketCount[i] = packetCount;
+    }
+    return index;
+}
+
+uint32 TriangleBVH::packLeaf(const BuildState& state, const BuildNode& leaf)
+{
+    uint32 firstPacket = (uint32)m_packets.size();
+    for (uint32 packed = 0; packed < leaf.Count; packed += 4)
+    {
+        TrianglePacket packet = {};
+        for (uint32 lane = 0; lane < 4; ++lane)
+        {
+            if (packed + lane >= leaf.Count)
+            {
+                packet.Triangle[lane] = EMPTY;
+                continue;
+            }
+
+            uint32 triangle = state.Triangles[leaf.First + packed + lane].Triangle;
+            float p[3][3];
+            GetTriangle(state.Source, triangle, p);
+            packet.V0X[lane] = p[0][0];
+            packet.V0Y[lane] = p[0][1];
+            packet.V0Z[lane] = p[0][2];
+            packet.E1X[lane] = p[1][0] - p[0][0];
+            packet.E1Y[lane] = p[1][1] - p[0][1];
+            packet.E1Z[lane] = p[1][2] - p[0][2];
+            packet.E2X[lane] = p[2][0] - p[0][0];
+            packet.E2Y[lane] = p[2][1] - p[0][1];
+            packet.E2Z[lane] = p[2][2] - p[0][2];
+            packet.Triangle[lane] = triangle;
+        }
+        m_packets.push_back(packet);
+    }
+    return firstPacket;
+}
+
+template<typename Visitor>
+void TriangleBVH::traverse(const Ray& ray, Visitor& visitor) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    // Une composante nulle donne une grande valeur plutot que l'infini : 0 * infini
+    // donnerait NaN pour une origine sur le plan d'une boite
+    float inverse[3];
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        float d = ray.Direction[i];
+        inverse[i] = std::fabs(d) > 1e-30f ? 1.0f / d : std::copysign(1e30f, d);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 originX = _mm_set1_ps(ray.Origin[0]);
+    const __m128 originY = _mm_set1_ps(ray.Origin[1]);
+    const __m128 originZ = _mm_set1_ps(ray.Origin[2]);
+    const __m128 directionX = _mm_set1_ps(ray.Direction[0]);
+    const __m128 directionY = _mm_set1_ps(ray.Direction[1]);
+    const __m128 directionZ = _mm_set1_ps(ray.Direction[2]);
+    const __m128 inverseX = _mm_set1_ps(inverse[0]);
+    const __m128 inverseY = _mm_set1_ps(inverse[1]);
+    const __m128 inverseZ = _mm_set1_ps(inverse[2]);
+
+    struct Entry
+    {
+        uint32 Child;
+        uint32 PacketCount;
+        float Distance;     // Entree dans la boite, pour sauter les noeuds devenus trop loin
+    };
+    Entry stack[STACK_SIZE];
+    uint32 stackSize = 0;
+    stack[stackSize++] = Entry{ 0, 0, 0.0f };
+
+    while (stackSize > 0)
+    {
+        Entry entry = stack[--stackSize];
+        if (entry.Distance > visitor.MaxDistance)
+        {
+            continue;
+        }
+
+        if (entry.Child & LEAF)
+        {
+            const TrianglePacket* packet = &m_packets[entry.Child & ~LEAF];
+            for (uint32 p = 0; p < entry.PacketCount; ++p, ++packet)
+            {
+                __m128 e1x = _mm_loadu_ps(packet->E1X);
+                __m128 e1y = _mm_loadu_ps(packet->E1Y);
+                __m128 e1z = _mm_loadu_ps(packet->E1Z);
+                __m128 e2x = _mm_loadu_ps(packet->E2X);
+                __m128 e2y = _mm_loadu_ps(packet->E2Y);
+                __m128 e2z = _mm_loadu_ps(packet->E2Z);
+
+                // Moller-Trumbore sur quatre triangles ; les places vides ont det == 0
+                __m128 px = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+                __m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+                __m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+                __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                __m128 invDet = _mm_div_ps(one, det);
+
+                __m128 tx = _mm_sub_ps(originX, _mm_loadu_ps(packet->V0X));
+                __m128 ty = _mm_sub_ps(originY, _mm_loadu_ps(packet->V0Y));
+                __m128 tz = _mm_sub_ps(originZ, _mm_loadu_ps(packet->V0Z));
+                __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+                __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+                __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+                __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+                __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), invDet);
+                __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+                // Les comparaisons avec NaN (det nul) sont fausses
+                __m128 valid = _mm_cmpneq_ps(det, zero);
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+                valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+                valid = _mm_and_ps(valid, _mm_cmple_ps(t, _mm_set1_ps(visitor.MaxDistance)));
+
+                int mask = _mm_movemask_ps(valid);
+                if (mask != 0)
+                {
+                    float distances[4];
+                    float us[4];
+                    float vs[4];
+                    _mm_storeu_ps(distances, t);
+                    _mm_storeu_ps(us, u);
+                    _mm_storeu_ps(vs, v);
+                    for (uint32 lane = 0; lane < 4; ++lane)
+                    {
+                        if (mask & (1 << lane))
+                        {
+                            visitor(packet->Triangle[lane], distances[lane], us[lane], vs[lane]);
+                        }
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Les quatre boites en une fois (methode des dalles)
+        const Node& node = m_nodes[entry.Child];
+        __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinX), originX), inverseX);
+        __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxX), originX), inverseX);
+        __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinY), originY), inverseY);
+        __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxY), originY), inverseY);
+        __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinZ), originZ), inverseZ);
+        __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxZ), originZ), inverseZ);
+        __m128 boxEntry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), zero));
+        __m128 boxExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)),
+                                _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(visitor.MaxDistance)));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(boxEntry, boxExit));
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        float distances[4];
+        _mm_storeu_ps(distances, boxEntry);
+
+        // Enfants touches tries du plus loin au plus proche : le plus proche sort de la pile en premier
+        Entry hits[4];
+        uint32 hitCount = 0;
+        for (uint32 i = 0; i < 4; ++i)
+        {
+            if (!(mask & (1 << i)) || node.Child[i] == EMPTY)
+            {
+                continue;
+            }
+            uint32 slot = hitCount++;
+            while (slot > 0 && hits[slot - 1].Distance < distances[i])
+            {
+                hits[slot] = hits[slot - 1];
+                --slot;
+            }
+            hits[slot] = Entry{ node.Child[i], node.PacketCount[i], distances[i] };
+        }
+        for (uint32 i = 0; i < hitCount; ++i)
+        {
+            stack[stackSize++] = hits[i];
+        }
+    }
+}
+
+bool TriangleBVH::raycast(const Ray& ray, TriangleHit& hit) const
+{
+    NearestVisitor visitor{ ray.MaxDistance, TriangleHit{ 0, 0.0f, 0.0f, 0.0f }, false };
+    traverse(ray, visitor);
+    if (visitor.Found)
+    {
+        hit = visitor.Hit;
+    }
+    return visitor.Found;
+}
+
+void TriangleBVH::raycastAll(const Ray& ray, std::vector<TriangleHit>& hits) const
+{
+    AllVisitor visitor{ ray.MaxDistance, &hits };
+    traverse(ray, visitor);
+}
+
+uint32 TriangleBVH::getTriangleCount() const
+{
+    return m_triangleCount;
+}
+
+uint32 TriangleBVH::getNodeCount() const
+{
+    return (uint32)m_nodes.size();
+}
+
+size_t TriangleBVH::getMemoryBytes() const
+{
+    return m_nodes.capacity() * sizeof(Node) + m_packets.capacity() * sizeof(TrianglePacket);
+}
@@ -0,0 +1,93 @@
+#ifndef _GEOMETRY_TRIANGLEBVH_H_
+#define _GEOMETRY_TRIANGLEBVH_H_
+
+#include "../Utilities/Types.h"
+
+#include <cstddef>
+#include <vector>
+
+class Geometry;
+
+// Rayon dans l'espace d'un maillage. La direction n'a pas a etre normalisee : les
+// distances sont en multiples de sa longueur. Un rayon normalise dans l'espace du
+// monde puis transforme garde donc ses distances en metres du monde.
+struct Ray
+{
+    float Origin[3];
+    float Direction[3];
+    float MaxDistance;
+};
+
+struct TriangleHit
+{
+    uint32 Triangle;    // Indice du triangle dans Geometry::getIndices
+    float Distance;
+    float U;            // Point = (1 - U - V) * p0 + U * p1 + V * p2
+    float V;
+};
+
+// Hierarchie de boites englobantes sur les triangles d'une geometrie (positions de
+// selection). Construite par SAH avec casiers, les passages des gros noeuds et les
+// sous-arbres en parallele sur le ThreadPool, puis aplatie en noeuds a quatre
+// enfants : un noeud teste ses quatre boites en une fois en SSE, et les feuilles
+// rangent leurs triangles par paquets de quatre, testes ensemble (Moller-Trumbore).
+class TriangleBVH
+{
+private:
+    // Quatre enfants, boites en colonnes pour les charger directement en SSE
+    struct Node
+    {
+        float MinX[4];
+        float MinY[4];
+        float MinZ[4];
+        float MaxX[4];
+        float MaxY[4];
+        float MaxZ[4];
+        uint32 Child[4];        // Noeud, ou LEAF | premier paquet ; EMPTY si absent
+        uint32 PacketCount[4];  // Feuilles seulement
+    };
+
+    // Sommet et aretes de quatre triangles ; les places libres ont des aretes nulles
+    struct TrianglePacket
+    {
+        float V0X[4];
+        float V0Y[4];
+        float V0Z[4];
+        float E1X[4];
+        float E1Y[4];
+        float E1Z[4];
+        float E2X[4];
+        float E2Y[4];
+        float E2Z[4];
+        uint32 Triangle[4];
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<TrianglePacket> m_packets;
+    uint32 m_triangleCount;
+
+    // Construction : arbre binaire temporaire, aplati ensuite dans m_nodes
+    struct BuildNode;
+    struct BuildState;
+    static void buildNode(BuildState& state, BuildNode& node, uint32 first, uint32 count, uint32 depth);
+    uint32 flatten(const BuildState& state, const BuildNode& node);
+    uint32 packLeaf(const BuildState& state, const BuildNode& leaf);
+
+    template<typename Visitor>
+    void traverse(const Ray& ray, Visitor& visitor) const;
+
+public:
+    // La geometrie doit avoir ses donnees de selection (Geometry::hasPickingData)
+    explicit TriangleBVH(const Geometry& geometry);
+
+    // Intersection la plus proche avant ray.MaxDistance, faces avant et arriere
+    bool raycast(const Ray& ray, TriangleHit& hit) const;
+    // Ajoute a hits toutes les intersections avant ray.MaxDistance, sans ordre
+    void raycastAll(const Ray& ray, std::vector<TriangleHit>& hits) const;
+
+    uint32 getTriangleCount() const;
+    uint32 getNodeCount() const;
+    size_t getMemoryBytes() const;
+};
+
+#endif
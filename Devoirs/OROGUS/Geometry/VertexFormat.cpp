@@ -0,0 +1,401 @@
+#include <glew/glew.h>
+
+#include "VertexFormat.h"
+
+#include "Geometry.h"
+#include "../Material/Material.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    uint16 FloatToHalf(float value)
+    {
+        uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint32 sign = (bits >> 16) & 0x8000;
+        int32 exponent = (int32)((bits >> 23) & 0xFF) - 127 + 15;
+        uint32 mantissa = bits & 0x7FFFFF;
+
+        // Infini et NaN
+        if ((bits & 0x7FFFFFFF) >= 0x7F800000)
+        {
+            return (uint16)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+        }
+        if (exponent >= 31)
+        {
+            return (uint16)(sign | 0x7C00);
+        }
+
+        // Sous-normaux, arrondi au plus pres pair
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+            {
+                return (uint16)sign;
+            }
+            mantissa |= 0x800000;
+            uint32 shift = (uint32)(14 - exponent);
+            uint32 half = mantissa >> shift;
+            uint32 remainder = mantissa & ((1u << shift) - 1);
+            uint32 midpoint = 1u << (shift - 1);
+            if (remainder > midpoint || (remainder == midpoint && (half & 1) != 0))
+            {
+                ++half;
+            }
+            return (uint16)(sign | half);
+        }
+
+        // La retenue de l'arrondi se propage naturellement dans l'exposant
+        uint32 half = ((uint32)exponent << 10) | (mantissa >> 13);
+        uint32 remainder = mantissa & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+        {
+            ++half;
+        }
+        return (uint16)(sign | half);
+    }
+
+    int32 ToSnorm(float value, float maxValue)
+    {
+        float clamped = std::min(std::max(value, -1.0f), 1.0f);
+        return (int32)std::lround(clamped * maxValue);
+    }
+
+    uint32 PackInt2_10_10_10(const float* v)
+    {
+        uint32 x = (uint32)ToSnorm(v[0], 511.0f) & 0x3FF;
+        uint32 y = (uint32)ToSnorm(v[1], 511.0f) & 0x3FF;
+        uint32 z = (uint32)ToSnorm(v[2], 511.0f) & 0x3FF;
+        return x | (y << 10) | (z << 20);
+    }
+
+    void EncodeOctahedral(const float* v, int16 out[2])
+    {
+        float l1 = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+        if (l1 == 0.0f)
+        {
+            out[0] = 0;
+            out[1] = 0;
+            return;
+        }
+
+        float x = v[0] / l1;
+        float y = v[1] / l1;
+        if (v[2] < 0.0f)
+        {
+            float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+        out[0] = (int16)ToSnorm(x, 32767.0f);
+        out[1] = (int16)ToSnorm(y, 32767.0f);
+    }
+
+    void EncodeDirection(DirectionEncoding encoding, const float* v, uint8* dst)
+    {
+        if (encoding == DirectionEncoding::Float32)
+        {
+            std::memcpy(dst, v, 3 * sizeof(float));
+        }
+        else if (encoding == DirectionEncoding::Int2_10_10_10)
+        {
+            uint32 packed = PackInt2_10_10_10(v);
+            std::memcpy(dst, &packed, sizeof(packed));
+        }
+        else
+        {
+            int16 oct[2];
+            EncodeOctahedral(v, oct);
+            std::memcpy(dst, oct, sizeof(oct));
+        }
+    }
+
+    void EncodeTangent(DirectionEncoding encoding, const float* t, float handedness, uint8* dst)
+    {
+        if (encoding == DirectionEncoding::Float32)
+        {
+            float tangent[4] = { t[0], t[1], t[2], handedness < 0.0f ? -1.0f : 1.0f };
+            std::memcpy(dst, tangent, sizeof(tangent));
+        }
+        else if (encoding == DirectionEncoding::Int2_10_10_10)
+        {
+            // w sur 2 bits signes : 1 (01) ou -1 (11)
+            uint32 packed = PackInt2_10_10_10(t) | ((handedness < 0.0f ? 3u : 1u) << 30);
+            std::memcpy(dst, &packed, sizeof(packed));
+        }
+        else
+        {
+            int16 oct[2];
+            EncodeOctahedral(t, oct);
+            int16 tangent[4] = { oct[0], oct[1], 0, (int16)(handedness < 0.0f ? -32767 : 32767) };
+            std::memcpy(dst, tangent, sizeof(tangent));
+        }
+    }
+}
+
+VertexFormat VertexFormat::s_default;
+
+VertexFormat& VertexFormat::Default()
+{
+    return s_default;
+}
+
+VertexFormat VertexFormat::Full()
+{
+    VertexFormat format;
+    format.Position = PositionEncoding::Float32;
+    format.Directions = DirectionEncoding::Float32;
+    format.TexCoord = TexCoordEncoding::Float32;
+    return format;
+}
+
+VertexFormat VertexFormat::Packed()
+{
+    VertexFormat format;
+    format.Position = PositionEncoding::Float32;
+    format.Directions = DirectionEncoding::Int2_10_10_10;
+    format.TexCoord = TexCoordEncoding::Float16;
+    return format;
+}
+
+VertexFormat VertexFormat::Compact()
+{
+    VertexFormat format;
+    format.Position = PositionEncoding::Unorm16;
+    format.Directions = DirectionEncoding::Int2_10_10_10;
+    format.TexCoord = TexCoordEncoding::Float16;
+    return format;
+}
+
+VertexFormat VertexFormat::Octahedral()
+{
+    VertexFormat format;
+    format.Position = PositionEncoding::Unorm16;
+    format.Directions = DirectionEncoding::Octahedral16;
+    format.TexCoord = TexCoordEncoding::Float16;
+    return format;
+}
+
+bool VertexFormat::FromName(const char* name, VertexFormat& format)
+{
+    if (name == nullptr)
+    {
+        return false;
+    }
+    if (std::strcmp(name, "full") == 0)
+    {
+        format = Full();
+    }
+    else if (std::strcmp(name, "packed") == 0)
+    {
+        format = Packed();
+    }
+    else if (std::strcmp(name, "compact") == 0)
+    {
+        format = Compact();
+    }
+    else if (std::strcmp(name, "octahedral") == 0)
+    {
+        format = Octahedral();
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool VertexFormat::operator==(const VertexFormat& other) const
+{
+    return Position == other.Position && Directions == other.Directions && TexCoord == other.TexCoord;
+}
+
+bool VertexFormat::operator!=(const VertexFormat& other) const
+{
+    return !((*this) == other);
+}
+
+VertexLayout::VertexLayout(const VertexFormat& format)
+    : m_format(format)
+    , m_strides{ 0, 0, 0 }
+{
+    if (format.Position == PositionEncoding::Float32)
+    {
+        addAttribute("aPosition", VERTEX_POSITION, VERTEX_STREAM_POSITION, 3, GL_FLOAT, false, 3 * sizeof(float));
+    }
+    else
+    {
+        addAttribute("aPosition", VERTEX_POSITION, VERTEX_STREAM_POSITION, 3, GL_UNSIGNED_SHORT, true, 3 * sizeof(uint16));
+    }
+
+    struct DirectionAttribute
+    {
+        const char* Name;
+        uint32 Flag;
+        uint32 Stream;
+    };
+    const DirectionAttribute directions[] = {
+        { "aNormal", VERTEX_NORMAL, VERTEX_STREAM_SHADING },
+        { "aTangent", VERTEX_TANGENT, VERTEX_STREAM_TANGENT }
+    };
+    for (const DirectionAttribute& direction : directions)
+    {
+        // La tangente ajoute le signe de la bitangente en w
+        bool tangent = direction.Flag == VERTEX_TANGENT;
+        if (format.Directions == DirectionEncoding::Float32)
+        {
+            int32 components = tangent ? 4 : 3;
+            addAttribute(direction.Name, direction.Flag, direction.Stream, components, GL_FLOAT, false, components * sizeof(float));
+        }
+        else if (format.Directions == DirectionEncoding::Int2_10_10_10)
+        {
+            addAttribute(direction.Name, direction.Flag, direction.Stream, 4, GL_INT_2_10_10_10_REV, true, sizeof(uint32));
+        }
+        else
+        {
+            int32 components = tangent ? 4 : 2;
+            addAttribute(direction.Name, direction.Flag, direction.Stream, components, GL_SHORT, true, components * sizeof(int16));
+        }
+    }
+
+    if (format.TexCoord == TexCoordEncoding::Float32)
+    {
+        addAttribute("aTexCoord", VERTEX_TEXCOORD, VERTEX_STREAM_SHADING, 2, GL_FLOAT, false, 2 * sizeof(float));
+    }
+    else
+    {
+        addAttribute("aTexCoord", VERTEX_TEXCOORD, VERTEX_STREAM_SHADING, 2, GL_HALF_FLOAT, false, 2 * sizeof(uint16));
+    }
+}
+
+void VertexLayout::addAttribute(const char* name, uint32 flag, uint32 stream, int32 components, uint32 type, bool normalized, uint32 size)
+{
+    VertexAttribute attribute = { name, flag, stream, components, type, normalized, m_strides[stream] };
+    m_attributes.push_back(attribute);
+
+    // Chaque attribut reste aligne sur 4 octets
+    m_strides[stream] += (size + 3) & ~3u;
+}
+
+uint32 VertexLayout::QueryAttributeMask(const Material& mat)
+{
+    uint32 mask = 0;
+    const char* names[] = { "aPosition", "aNormal", "aTangent", "aTexCoord" };
+    const uint32 flags[] = { VERTEX_POSITION, VERTEX_NORMAL, VERTEX_TANGENT, VERTEX_TEXCOORD };
+    for (uint32 i = 0; i < 4; ++i)
+    {
+        if ((int32)mat.attribute(names[i]) >= 0)
+        {
+            mask |= flags[i];
+        }
+    }
+    return mask;
+}
+
+const VertexFormat& VertexLayout::getFormat() const
+{
+    return m_format;
+}
+
+const std::vector<VertexAttribute>& VertexLayout::getAttributes() const
+{
+    return m_attributes;
+}
+
+uint32 VertexLayout::getStride(uint32 stream) const
+{
+    return m_strides[stream];
+}
+
+void VertexLayout::setupAttributes(uint32 attributeMask, const Material& mat, const uint32 buffers[VERTEX_STREAM_COUNT]) const
+{
+    attributeMask &= mat.getAttributeMask();
+    for (const VertexAttribute& attribute : m_attributes)
+    {
+        if ((attributeMask & attribute.Flag) == 0)
+        {
+            continue;
+        }
+
+        int32 location = (int32)mat.attribute(attribute.Name);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[attribute.Stream]);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, attribute.Components, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE, m_strides[attribute.Stream], (const GLvoid*)(size_t)attribute.Offset);
+    }
+}
+
+void VertexLayout::encode(const std::vector<Vertex>& vertices, uint32 stream, const float positionOffset[3], const float positionScale[3], uint8* out) const
+{
+    encode(vertices.data(), (uint32)vertices.size(), stream, positionOffset, positionScale, out);
+}
+
+void VertexLayout::encode(const Vertex* vertices, uint32 count, uint32 stream, const float positionOffset[3], const float positionScale[3], uint8* out) const
+{
+    uint32 stride = m_strides[stream];
+
+    float inverseScale[3];
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        inverseScale[i] = positionScale[i] > 0.0f ? 1.0f / positionScale[i] : 0.0f;
+    }
+
+    for (const VertexAttribute& attribute : m_attributes)
+    {
+        if (attribute.Stream != stream)
+        {
+            continue;
+        }
+
+        uint8* dst = out + attribute.Offset;
+        for (uint32 index = 0; index < count; ++index)
+        {
+            const Vertex& v = vertices[index];
+            if (attribute.Flag == VERTEX_POSITION)
+            {
+                const float* position = v.Position.constValues();
+                if (m_format.Position == PositionEncoding::Float32)
+                {
+                    std::memcpy(dst, position, 3 * sizeof(float));
+                }
+                else
+                {
+                    uint16 quantized[3];
+                    for (uint32 i = 0; i < 3; ++i)
+                    {
+                        float t = (position[i] - positionOffset[i]) * inverseScale[i];
+                        t = std::min(std::max(t, 0.0f), 1.0f);
+                        quantized[i] = (uint16)std::lround(t * 65535.0f);
+                    }
+                    std::memcpy(dst, quantized, sizeof(quantized));
+                }
+            }
+            else if (attribute.Flag == VERTEX_NORMAL)
+            {
+                EncodeDirection(m_format.Directions, v.Normal.constValues(), dst);
+            }
+            else if (attribute.Flag == VERTEX_TANGENT)
+            {
+                EncodeTangent(m_format.Directions, v.Tangent.constValues(), v.Handedness, dst);
+            }
+            else
+            {
+                const float* uv = v.TexCoord.constValues();
+                if (m_format.TexCoord == TexCoordEncoding::Float32)
+                {
+                    std::memcpy(dst, uv, 2 * sizeof(float));
+                }
+                else
+                {
+                    uint16 half[2] = { FloatToHalf(uv[0]), FloatToHalf(uv[1]) };
+                    std::memcpy(dst, half, sizeof(half));
+                }
+            }
+            dst += stride;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef _GEOMETRY_VERTEXFORMAT_H_
+#define _GEOMETRY_VERTEXFORMAT_H_
+
+#include "../Utilities/Types.h"
+
+#include <vector>
+
+class Material;
+struct Vertex;
+
+enum class PositionEncoding
+{
+    Float32,    // 3 x float
+    Unorm16     // 3 x uint16 normalise dans la boite englobante du maillage
+};
+
+enum class DirectionEncoding
+{
+    Float32,        // 3 x float
+    Int2_10_10_10,  // GL_INT_2_10_10_10_REV, lisible tel quel par un vec3
+    Octahedral16    // 2 x int16, decode dans le vertex shader (gOctahedralDirections)
+};
+
+enum class TexCoordEncoding
+{
+    Float32,    // 2 x float
+    Float16     // 2 x half
+};
+
+// Choix d'encodage des attributs d'un sommet dans le vertex buffer.
+// L'encodage des directions s'applique a la normale et a la tangente. La tangente
+// est un vec4 dont w porte le signe de la bitangente (Vertex::Handedness).
+//
+// Les encodages compacts perdent de la precision : environ 1/511 par composante
+// pour Int2_10_10_10, 1/65535 de la boite englobante pour Unorm16, et pour Float16
+// un pas de 1/1024 entre 1 et 2, qui double a chaque puissance de deux (1/32 vers
+// 32, plus de valeur au-dela de 65504). Des UV repetees ou grandes doivent rester
+// en Float32. Octahedral16 est bien plus precis que Int2_10_10_10 pour la normale,
+// au prix d'un decodage dans le vertex shader. Ces encodages sont donc choisis
+// explicitement, par exemple pour une scene avec <vertexFormat value="packed"/>
+// dans ses proprietes.
+struct VertexFormat
+{
+    PositionEncoding Position = PositionEncoding::Float32;
+    DirectionEncoding Directions = DirectionEncoding::Float32;
+    TexCoordEncoding TexCoord = TexCoordEncoding::Float32;
+
+    // Format utilise par les nouvelles geometries, Full sauf demande de la scene
+    static VertexFormat& Default();
+
+    // Equivalent exact de la structure Vertex (48 octets)
+    static VertexFormat Full();
+
+    // Positions exactes, directions en 10 bits et UV en half (24 octets)
+    static VertexFormat Packed();
+
+    // Format le plus compact (20 octets), demande le decodage dans le shader
+    static VertexFormat Compact();
+
+    // Comme Compact, avec des directions octaedriques en 16 bits (24 octets)
+    static VertexFormat Octahedral();
+
+    // "full", "packed", "compact" ou "octahedral" ; faux si le nom est inconnu
+    static bool FromName(const char* name, VertexFormat& format);
+
+    bool operator==(const VertexFormat& other) const;
+    bool operator!=(const VertexFormat& other) const;
+
+private:
+    static VertexFormat s_default;
+};
+
+// Attributs de sommet connus du moteur, sous forme de masque
+enum VertexAttributeFlags : uint32
+{
+    VERTEX_POSITION = 0x1,
+    VERTEX_NORMAL   = 0x2,
+    VERTEX_TANGENT  = 0x4,
+    VERTEX_TEXCOORD = 0x8,
+    VERTEX_ALL      = 0xF
+};
+
+// Chaque flux a son propre vertex buffer. Une passe qui ne lit que les positions
+// (profondeur, ombres, selection) ne touche que le premier.
+enum VertexStream : uint32
+{
+    VERTEX_STREAM_POSITION = 0,
+    VERTEX_STREAM_SHADING,      // Normale et coordonnees de texture
+    VERTEX_STREAM_TANGENT,      // Genere seulement si un materiel le demande
+    VERTEX_STREAM_COUNT
+};
+
+struct VertexAttribute
+{
+    const char* Name;
+    uint32 Flag;
+    uint32 Stream;
+    int32 Components;
+    uint32 Type;
+    bool Normalized;
+    uint32 Offset;
+};
+
+// Disposition concrete des attributs dans les flux de sommets pour un VertexFormat.
+// C'est la seule source des appels glVertexAttribPointer pour les geometries.
+class VertexLayout
+{
+private:
+    VertexFormat m_format;
+    std::vector<VertexAttribute> m_attributes;
+    uint32 m_strides[VERTEX_STREAM_COUNT];
+
+    void addAttribute(const char* name, uint32 flag, uint32 stream, int32 components, uint32 type, bool normalized, uint32 size);
+
+public:
+    explicit VertexLayout(const VertexFormat& format);
+
+    // Masque des attributs actifs dans le programme du materiel
+    static uint32 QueryAttributeMask(const Material& mat);
+
+    const VertexFormat& getFormat() const;
+    const std::vector<VertexAttribute>& getAttributes() const;
+    uint32 getStride(uint32 stream) const;
+
+    // Active et decrit, pour le VAO actuellement lie, les attributs de attributeMask
+    // lus par le materiel. buffers contient un vertex buffer par flux.
+    void setupAttributes(uint32 attributeMask, const Material& mat, const uint32 buffers[VERTEX_STREAM_COUNT]) const;
+
+    // Encode un flux de sommets dans le format du layout. positionOffset/positionScale
+    // sont la boite englobante utilisee par PositionEncoding::Unorm16. out doit
+    // contenir vertices.size() * getStride(stream) octets.
+    void encode(const std::vector<Vertex>& vertices, uint32 stream, const float positionOffset[3], const float positionScale[3], uint8* out) const;
+    // Meme chose pour count sommets consecutifs, par exemple une plage modifiee
+    void encode(const Vertex* vertices, uint32 count, uint32 stream, const float positionOffset[3], const float positionScale[3], uint8* out) const;
+};
+
+#endif
@@ -4,8 +4,10 @@
 
 #include "../Geometry/Geometry.h"
 #include "../Geometry/GeometryHelper.h"
+#include "../Geometry/GeometryManager.h"
 #include "../Material/ShaderHelper.h"
 #include "../Scene/Scene.h"
+#include "../Utilities/RenderStats.h"
 
 LightObject::LightObject()
     : m_enabled(true)
@@ -17,31 +19,16 @@ LightObject::LightObject()
 
 LightObject::~LightObject()
 {
-    delete m_geometry;
+    GeometryManager::GetInstance()->unloadGeometry(m_geometry);
     glDeleteVertexArrays(1, &m_vao);
 }
 
 void LightObject::updateVAO() const
 {
     glBindVertexArray(m_vao);
-    if (m_material.isInitialized())
+    if (m_material.isInitialized() && m_geometry != nullptr)
     {
-        uint32 posAttribute = m_material.attribute("aPosition");
-        uint32 normalAttribute = m_material.attribute("aNormal");
-        uint32 uvAttribute = m_material.attribute("aTexCoord");
-        glEnableVertexAttribArray(posAttribute);
-        glEnableVertexAttribArray(normalAttribute);
-        glEnableVertexAttribArray(uvAttribute);
-
-        if (m_geometry != nullptr)
-        {
-            m_geometry->bindBuffersVAO();
-        }
-
-        uint32 vertexSize = sizeof(Vertex);
-        glVertexAttribPointer(posAttribute, 3, GL_FLOAT, GL_FALSE, vertexSize, 0);
-        glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, vertexSize, (const GLvoid*)12);
-        glVertexAttribPointer(uvAttribute, 2, GL_FLOAT, GL_FALSE, vertexSize, (const GLvoid*)24);
+        m_geometry->bindBuffersVAO(m_material);
     }
     glBindVertexArray(0);
 }
@@ -50,8 +37,7 @@ void LightObject::updateGeometry(const ColorRGB& color)
 {
 	if (m_geometry != nullptr)
 	{
-		delete m_geometry;
-		m_geometry = nullptr;
+		GeometryManager::GetInstance()->unloadGeometry(m_geometry);
 	}
     m_geometry = createRenderGeometry(color);
     updateVAO();
@@ -65,6 +51,7 @@ void LightObject::setScene(const Scene* scene)
 void LightObject::render()
 {
     glBindVertexArray(m_vao);
+    RenderCounters::Current().VertexArrayBinds++;
     if (m_material.isInitialized() && m_geometry != nullptr)
     {
         m_material.bind();
@@ -97,13 +84,18 @@ DirectionalLight::~DirectionalLight()
 Geometry* DirectionalLight::createRenderGeometry(const ColorRGB& color) const
 {
     // On cre une flche compose d'un cone et d'un cylindre
-    Geometry* cone = GeometryHelper::CreateCylinder(Metre(0), Metre(0.2f), Metre(0.5f), 10, 4, color);
-    Geometry* cylinder = GeometryHelper::CreateCylinder(Metre(0.1f), Metre(0.1f), Metre(0.6f), 10, 2, color);
-    cone->transform(Transform::MakeTranslation(Vector3<Metre>(Metre(0), Metre(0.55f), Metre(0))));
-    Geometry* arrow = Geometry::Combine("Fleche", *cone, *cylinder);
-    delete cylinder;
-    delete cone;
-    return arrow;
+    // Toutes les lumieres de meme couleur partagent la meme fleche
+    std::string key = GeometryManager::MakeShapeKey("fleche", { color.r(), color.g(), color.b() });
+    return GeometryManager::GetInstance()->loadShape(key, [&color]()
+    {
+        Geometry* cone = GeometryHelper::CreateCylinder(Metre(0), Metre(0.2f), Metre(0.5f), 10, 4, color);
+        Geometry* cylinder = GeometryHelper::CreateCylinder(Metre(0.1f), Metre(0.1f), Metre(0.6f), 10, 2, color);
+        cone->transform(Transform::MakeTranslation(Vector3<Metre>(Metre(0), Metre(0.55f), Metre(0))));
+        Geometry* arrow = Geometry::Combine("Fleche", *cone, *cylinder);
+        delete cylinder;
+        delete cone;
+        return arrow;
+    });
 }
 
 Transform DirectionalLight::getModelTransform() const
@@ -164,7 +156,8 @@ PointLight::~PointLight()
 Geometry* PointLight::createRenderGeometry(const ColorRGB& color) const
 {
     // On cre une sphre pour ce PointLight
-    return GeometryHelper::CreateSphere(Metre(0.1f), 10, 10, color);
+    std::string key = GeometryManager::MakeShapeKey("lumiere/sphere", { color.r(), color.g(), color.b() });
+    return GeometryManager::GetInstance()->loadShape(key, [&color]() { return GeometryHelper::CreateSphere(Metre(0.1f), 10, 10, color); });
 }
 
 Transform PointLight::getModelTransform() const
@@ -237,7 +230,8 @@ Geometry* SpotLight::createRenderGeometry(const ColorRGB& color) const
     Metre adjacent = Metre(1);
     Metre hypo = adjacent / m_attribute.CosAngle;
     Metre overture = Maths::Sqrt((hypo * hypo) - (adjacent * adjacent));
-    return GeometryHelper::CreateCylinder(overture, Metre(), adjacent, 10, 10, color);
+    std::string key = GeometryManager::MakeShapeKey("lumiere/cone", { (float)overture, color.r(), color.g(), color.b() });
+    return GeometryManager::GetInstance()->loadShape(key, [&]() { return GeometryHelper::CreateCylinder(overture, Metre(), adjacent, 10, 10, color); });
 }
 
 Transform SpotLight::getModelTransform() const
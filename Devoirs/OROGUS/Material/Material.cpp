@@ -2,23 +2,31 @@
 
 #include "Shaders.h"
 #include "ShaderManager.h"
+#include "../Geometry/VertexFormat.h"
 #include "../Light/Lights.h"
 #include "../Scene/Scene.h"
 #include "../Texture/Texture.h"
 #include "../Texture/TextureManager.h"
 #include "../Utilities/Color.h"
 #include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/StringUtilities.h"
 
 #include <iostream>
 #include <string>
 
 Material::Material(VertexShader* vShader, FragmentShader* fShader)
-	: m_vertexShader(vShader)
-	, m_fragmentShader(fShader)
-	, m_programId(0)
+	: m_programId(0)
 	, m_isInitialized(false)
     , m_isUsingLighting(false)
+    , m_attributeMask(0)
+	, m_vertexShader(vShader)
+	, m_fragmentShader(fShader)
+    , m_colorLocation(-1)
+    , m_positionOffsetLocation(-1)
+    , m_positionScaleLocation(-1)
+    , m_octahedralDirectionsLocation(-1)
+    , m_identityDecoding(true)
 {
 	if (m_vertexShader != nullptr && m_vertexShader->isValid() && m_fragmentShader != nullptr && m_fragmentShader->isValid())
 	{
@@ -30,6 +38,11 @@ Material::Material(VertexShader* vShader, FragmentShader* fShader)
 			glLinkProgram(m_programId);
 			m_isInitialized = validateProgram();
             m_isUsingLighting = glGetUniformLocation(id(), "currentPointLights") != -1;
+            m_attributeMask = VertexLayout::QueryAttributeMask(*this);
+            m_colorLocation = glGetUniformLocation(id(), "uColor");
+            m_positionOffsetLocation = glGetUniformLocation(id(), "gPositionOffset");
+            m_positionScaleLocation = glGetUniformLocation(id(), "gPositionScale");
+            m_octahedralDirectionsLocation = glGetUniformLocation(id(), "gOctahedralDirections");
 		}
 	}
 	else
@@ -73,6 +86,11 @@ uint32 Material::attribute(const char* attName) const
     return glGetAttribLocation(m_programId, attName);
 }
 
+uint32 Material::getAttributeMask() const
+{
+    return m_attributeMask;
+}
+
 bool Material::isInitialized() const
 {
     return m_isInitialized;
@@ -86,9 +104,11 @@ bool Material::isUsingLighting() const
 // Bind the shader
 void Material::bind() const
 {
+    PROFILE_SCOPE("Material::bind");
     if (isInitialized())
     {
         glUseProgram(m_programId);        
+        RenderCounters::Current().ProgramBinds++;
 
         uint32 bindingUnit = 0;
         for (const BindingInfo<Texture2D*>& info : m_textures)
@@ -184,15 +204,38 @@ void Material::addColorBinding(const char* bindingName, const Color& c)
 void Material::setColor(const char* uniformName, const Color& c) const
 {
     uint32 uniformIndex = glGetUniformLocation(id(), uniformName);
+    RenderCounters::Current().UniformUploads++;
     glUniform4fv(uniformIndex, 1, c.constData());
 }
 
 void Material::setColor(const char* uniformName, const ColorRGB& c) const
 {
     uint32 uniformIndex = glGetUniformLocation(id(), uniformName);
+    RenderCounters::Current().UniformUploads++;
     glUniform3fv(uniformIndex, 1, c.constData());
 }
 
+void Material::setDrawColor(const Color& c) const
+{
+    RenderCounters::Current().UniformUploads++;
+    glUniform4fv(m_colorLocation, 1, c.constData());
+}
+
+void Material::setVertexDecoding(const VertexFormat& format, const Vector3<Real>& positionOffset, const Vector3<Real>& positionScale) const
+{
+    // Les shaders declarent l'identite comme valeur initiale (decalage nul, echelle 1)
+    bool quantized = format.Position != PositionEncoding::Float32 || format.Directions == DirectionEncoding::Octahedral16;
+    if (!quantized && m_identityDecoding)
+    {
+        return;
+    }
+
+    setVec3(m_positionOffsetLocation, positionOffset);
+    setVec3(m_positionScaleLocation, positionScale);
+    setInt(m_octahedralDirectionsLocation, format.Directions == DirectionEncoding::Octahedral16 ? 1 : 0);
+    m_identityDecoding = !quantized;
+}
+
 void Material::setInt(const std::string& name, int value) const
 {
     setInt(name.c_str(), value);
@@ -205,6 +248,7 @@ void Material::setInt(const char* uniformName, int val) const
 
 void Material::setInt(uint32 uniformLocation, int val) const
 {
+    RenderCounters::Current().UniformUploads++;
     glUniform1i(uniformLocation, val);
 }
 
@@ -220,6 +264,7 @@ void Material::setBool(const char* name, bool value) const
 
 void Material::setBool(uint32 uniformLocation, bool value) const
 {
+    RenderCounters::Current().UniformUploads++;
     glUniform1i(uniformLocation, (int)value);
 }
 
@@ -236,6 +281,7 @@ void Material::setFloat(const char* name, float value) const
 void Material::setFloat(uint32 uniformLocation, float value) const
 {
 	// TP2 :  complter
+	RenderCounters::Current().UniformUploads++;
 	glUniform1f(uniformLocation, value);
 }
 
@@ -251,6 +297,7 @@ void Material::setVec2(const char* name, float x, float y) const
 
 void Material::setVec2(uint32 uniformLocation, float x, float y) const
 {
+	RenderCounters::Current().UniformUploads++;
 	glUniform2f(uniformLocation, x, y);
 }
 
@@ -268,6 +315,7 @@ void Material::setVec3(const char* name, float x, float y, float z) const
 void Material::setVec3(uint32 uniformLocation, float x, float y, float z) const
 {
 	// TP2 :  complter
+	RenderCounters::Current().UniformUploads++;
 	glUniform3f(uniformLocation, x, y, z);
 }
 
@@ -283,6 +331,7 @@ void Material::setVec4(const char* name, float x, float y, float z, float w) con
 
 void Material::setVec4(uint32 uniformLocation, float x, float y, float z, float w) const
 {
+	RenderCounters::Current().UniformUploads++;
 	glUniform4f(uniformLocation, x, y, z, w);
 }
 
@@ -5,6 +5,7 @@
 
 #include "../Utilities/Matrices.h"
 #include "../Utilities/Point.h"
+#include "../Utilities/RenderStats.h"
 #include "../Utilities/Types.h"
 #include "../Utilities/Vectors.h"
 
@@ -17,6 +18,7 @@ class FragmentShader;
 class Scene;
 class Texture2D;
 class VertexShader;
+struct VertexFormat;
 
 class Material {
 private:
@@ -31,6 +33,7 @@ private:
     uint32 m_programId;
     bool m_isInitialized;
     bool m_isUsingLighting;
+    uint32 m_attributeMask;
     VertexShader* m_vertexShader;
     FragmentShader* m_fragmentShader;
 
@@ -40,6 +43,14 @@ private:
     std::vector<BindingInfo<Real> > m_uniformFloat;
     std::vector<BindingInfo<int> > m_uniformInt;
 
+    // Uniformes de Geometry::render, cherches une fois a l'edition des liens
+    uint32 m_colorLocation;
+    uint32 m_positionOffsetLocation;
+    uint32 m_positionScaleLocation;
+    uint32 m_octahedralDirectionsLocation;
+    // Vrai tant que le programme garde le decodage par defaut (formats non quantifies)
+    mutable bool m_identityDecoding;
+
     void setBool(uint32 uniformLocation, bool value) const;
     void setInt(uint32 uniformLocation, int value) const;
     void setFloat(uint32 uniformLocation, float value) const;
@@ -50,30 +61,35 @@ private:
     template<typename U>
     void setVec2(uint32 uniformLocation, const Vector2<U>& value) const
     {
+        RenderCounters::Current().UniformUploads++;
         glUniform2fv(uniformLocation, 1, value.constValues());
     }
 
     template<typename U>
     void setVec3(uint32 uniformLocation, const Vector3<U>& value) const
     {
+        RenderCounters::Current().UniformUploads++;
         glUniform3fv(uniformLocation, 1, value.constValues());
     }
 
     template<typename U>
     void setVec3(uint32 uniformLocation, const Point3<U>& value) const
     {
+        RenderCounters::Current().UniformUploads++;
         glUniform3fv(uniformLocation, 1, value.constValues());
     }
 
     template<typename U>
     void setVec4(uint32 uniformLocation, const Vector4<U>& value) const
     {
+        RenderCounters::Current().UniformUploads++;
         glUniform4fv(uniformLocation, 1, value.constValues());
     }
 
     template<typename U>
     void setMat3(uint32 uniformLocation, const Matrix3x3<U>& value) const
     {
+        RenderCounters::Current().UniformUploads++;
         glUniformMatrix3fv(uniformLocation, 1, GL_FALSE, value.constValues());
     }
 
@@ -81,6 +97,7 @@ private:
     void setMat4(uint32 uniformLocation, const Matrix4x4<U>& value) const
     {
 		// TP2 :  complter
+		RenderCounters::Current().UniformUploads++;
 		glUniformMatrix4fv(uniformLocation, 1, GL_FALSE, value.constValues());
     }
 
@@ -93,6 +110,9 @@ public:
 	uint32 id() const;
     uint32 attribute(const char* attName) const;
 
+    // Masque VertexAttributeFlags des attributs lus par le vertex shader
+    uint32 getAttributeMask() const;
+
     bool isInitialized() const;
 	bool isUsingLighting() const;
     
@@ -111,6 +131,12 @@ public:
     
     void setColor(const char* uniformName, const Color& c) const;
     void setColor(const char* uniformName, const ColorRGB& c) const;
+
+    // Uniformes fixes a chaque dessin par Geometry::render. Le decodage des sommets
+    // n'est envoye que pour un format quantifie, puis remis une fois a l'identite
+    // pour la geometrie non quantifiee suivante.
+    void setDrawColor(const Color& c) const;
+    void setVertexDecoding(const VertexFormat& format, const Vector3<Real>& positionOffset, const Vector3<Real>& positionScale) const;
     
     void setBool(const std::string &name, bool value) const;
     void setBool(const char* name, bool value) const;
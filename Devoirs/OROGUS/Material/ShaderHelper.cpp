@@ -37,6 +37,31 @@ FragmentShader* ShaderHelper::LoadEngineNormalFragmentShader()
 	return ShaderManager::GetInstance()->LoadFragmentShader("", "EngineNormalFragmentShader");
 }
 
+VertexShader* ShaderHelper::LoadEngineDebugDrawVertexShader()
+{
+	return ShaderManager::GetInstance()->LoadVertexShader("", "EngineDebugDrawVertexShader");
+}
+
+FragmentShader* ShaderHelper::LoadEngineDebugDrawFragmentShader()
+{
+	return ShaderManager::GetInstance()->LoadFragmentShader("", "EngineDebugDrawFragmentShader");
+}
+
+VertexShader* ShaderHelper::LoadEngineFullscreenVertexShader()
+{
+	return ShaderManager::GetInstance()->LoadVertexShader("", "EngineFullscreenVertexShader");
+}
+
+FragmentShader* ShaderHelper::LoadEngineUpscaleFragmentShader()
+{
+	return ShaderManager::GetInstance()->LoadFragmentShader("", "EngineUpscaleFragmentShader");
+}
+
+VertexShader* ShaderHelper::LoadEngineTerrainVertexShader()
+{
+	return ShaderManager::GetInstance()->LoadVertexShader("", "EngineTerrainVertexShader");
+}
+
 VertexShader* ShaderHelper::LoadVertexShader(const std::string& shaderName)
 {
     if (StringUtilities::EndsWith(shaderName, "BaseVertexShader.vs"))
@@ -46,17 +71,29 @@ VertexShader* ShaderHelper::LoadVertexShader(const std::string& shaderName)
         uniform mat4 gViewMatrix; \
         uniform mat4 gModelMatrix; \
         uniform vec4 uColor; \
+        uniform vec3 gPositionOffset = vec3(0.0); \
+        uniform vec3 gPositionScale = vec3(1.0); \
+        uniform int gOctahedralDirections = 0; \
         in vec3 aPosition; \
         in vec3 aNormal; \
         in vec2 aTexCoord; \
         struct FS_In { vec3 Color; vec2 TexCoord; vec3 Normal; vec3 WorldPosition; };\
         out FS_In fsIn; \
+        vec3 DecodeDirection(vec3 d) { \
+            if (gOctahedralDirections == 0) { return d; } \
+            vec3 n = vec3(d.xy, 1.0 - abs(d.x) - abs(d.y)); \
+            float t = max(-n.z, 0.0); \
+            n.x += n.x >= 0.0 ? -t : t; \
+            n.y += n.y >= 0.0 ? -t : t; \
+            return normalize(n); \
+        } \
         void main() { \
-            fsIn.WorldPosition = (gModelMatrix * vec4(aPosition, 1.0f)).xyz; \
+            vec3 position = aPosition * gPositionScale + gPositionOffset; \
+            fsIn.WorldPosition = (gModelMatrix * vec4(position, 1.0f)).xyz; \
             gl_Position = gProjectionMatrix * gViewMatrix * vec4(fsIn.WorldPosition, 1.0f); \
             fsIn.TexCoord = aTexCoord; \
             fsIn.Color = uColor.rgb; \
-            fsIn.Normal = mat3(transpose(inverse(gModelMatrix))) * aNormal; \
+            fsIn.Normal = mat3(transpose(inverse(gModelMatrix))) * DecodeDirection(aNormal); \
         }";
         return new VertexShader("BaseVertexShader.vs", code);
     }
@@ -88,6 +125,72 @@ VertexShader* ShaderHelper::LoadVertexShader(const std::string& shaderName)
             }";
 		return new VertexShader("EngineNormalVertexShader", code);
 	}
+	else if (StringUtilities::Equals(shaderName, "EngineDebugDrawVertexShader"))
+	{
+		std::string code = "#version 410 \n \
+            uniform mat4 gProjectionMatrix; \
+            uniform mat4 gViewMatrix; \
+            in vec3 aPosition; \
+            in vec4 aColor; \
+            out vec3 color; \
+            void main() { \
+                gl_Position = gProjectionMatrix * gViewMatrix * vec4(aPosition, 1.0f); \
+                color = aColor.rgb; \
+            }";
+		return new VertexShader("EngineDebugDrawVertexShader", code);
+	}
+	else if (StringUtilities::Equals(shaderName, "EngineFullscreenVertexShader"))
+	{
+		// Triangle couvrant l'ecran, genere sans buffer a partir de gl_VertexID
+		std::string code = "#version 410 \n \
+            out vec2 texCoord; \
+            void main() { \
+                texCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2); \
+                gl_Position = vec4(texCoord * 2.0 - 1.0, 0.0, 1.0); \
+            }";
+		return new VertexShader("EngineFullscreenVertexShader", code);
+	}
+	else if (StringUtilities::Equals(shaderName, "EngineTerrainVertexShader"))
+	{
+		// aNode : origine x et z, cote et niveau du noeud, dans l'espace du terrain.
+		// Les sommets impairs glissent vers leur voisin pair (grille du niveau suivant)
+		// entre le debut et la fin du morphing du niveau : pas de saut entre niveaux.
+		std::string code = "#version 410 \n \
+            uniform mat4 gProjectionMatrix; \
+            uniform mat4 gViewMatrix; \
+            uniform mat4 gModelMatrix; \
+            uniform vec4 uColor; \
+            uniform sampler2D gTerrainHeights; \
+            uniform vec4 gTerrainTile; \
+            uniform vec3 gTerrainCamera; \
+            uniform float gTerrainPatchSize; \
+            uniform float gTerrainSize; \
+            uniform vec2 gTerrainMorph[16]; \
+            in vec2 aPatchPosition; \
+            in vec4 aNode; \
+            struct FS_In { vec3 Color; vec2 TexCoord; vec3 Normal; vec3 WorldPosition; };\
+            out FS_In fsIn; \
+            float Height(vec2 p) { \
+                vec2 uv = (p - gTerrainTile.xy) / gTerrainTile.z; \
+                uv = (uv * (gTerrainTile.w - 1.0) + 0.5) / gTerrainTile.w; \
+                return textureLod(gTerrainHeights, uv, 0.0).r; \
+            } \
+            void main() { \
+                vec2 p = aNode.xy + aPatchPosition * aNode.z; \
+                vec2 morph = gTerrainMorph[int(aNode.w)]; \
+                float k = clamp((distance(vec3(p.x, Height(p), p.y), gTerrainCamera) - morph.x) / (morph.y - morph.x), 0.0, 1.0); \
+                p -= fract(aPatchPosition * gTerrainPatchSize * 0.5) * 2.0 / gTerrainPatchSize * aNode.z * k; \
+                float texel = gTerrainTile.z / (gTerrainTile.w - 1.0); \
+                vec3 normal = vec3(Height(p - vec2(texel, 0.0)) - Height(p + vec2(texel, 0.0)), 2.0 * texel, \
+                                   Height(p - vec2(0.0, texel)) - Height(p + vec2(0.0, texel))); \
+                fsIn.WorldPosition = (gModelMatrix * vec4(p.x, Height(p), p.y, 1.0f)).xyz; \
+                gl_Position = gProjectionMatrix * gViewMatrix * vec4(fsIn.WorldPosition, 1.0f); \
+                fsIn.TexCoord = p / gTerrainSize; \
+                fsIn.Color = uColor.rgb; \
+                fsIn.Normal = mat3(transpose(inverse(gModelMatrix))) * normalize(normal); \
+            }";
+		return new VertexShader("EngineTerrainVertexShader", code);
+	}
     return nullptr;
 }
 
@@ -218,5 +321,60 @@ FragmentShader* ShaderHelper::LoadFragmentShader(const std::string& shaderName)
         void main() { outColor = color; }";
 		return new FragmentShader("EngineNormalFragmentShader", code);
 	}
+	else if (StringUtilities::Equals(shaderName, "EngineDebugDrawFragmentShader"))
+	{
+		std::string code = "#version 410 \n \
+        in vec3 color; \
+        out vec3 outColor; \
+        void main() { outColor = color; }";
+		return new FragmentShader("EngineDebugDrawFragmentShader", code);
+	}
+	else if (StringUtilities::Equals(shaderName, "EngineUpscaleFragmentShader"))
+	{
+		// Filtre bilineaire, puis soit FXAA, soit un rehaussement optionnel borne par le voisinage pour eviter les halos
+		std::string code = "#version 410 \n \
+        uniform sampler2D gSource; \
+        uniform float gSharpness; \
+        uniform int gFxaa; \
+        in vec2 texCoord; \
+        out vec4 outColor; \
+        const float FXAA_REDUCE_MIN = 1.0 / 128.0; \
+        const float FXAA_REDUCE_MUL = 1.0 / 8.0; \
+        const float FXAA_SPAN_MAX = 8.0; \
+        void main() { \
+            vec2 texel = 1.0 / vec2(textureSize(gSource, 0)); \
+            vec3 c = texture(gSource, texCoord).rgb; \
+            if (gFxaa != 0) { \
+                vec3 luma = vec3(0.299, 0.587, 0.114); \
+                float lumaNW = dot(texture(gSource, texCoord + vec2(-1.0, -1.0) * texel).rgb, luma); \
+                float lumaNE = dot(texture(gSource, texCoord + vec2(1.0, -1.0) * texel).rgb, luma); \
+                float lumaSW = dot(texture(gSource, texCoord + vec2(-1.0, 1.0) * texel).rgb, luma); \
+                float lumaSE = dot(texture(gSource, texCoord + vec2(1.0, 1.0) * texel).rgb, luma); \
+                float lumaM = dot(c, luma); \
+                float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE))); \
+                float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE))); \
+                vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE)); \
+                float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * FXAA_REDUCE_MUL, FXAA_REDUCE_MIN); \
+                float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce); \
+                dir = clamp(dir * rcpDirMin, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texel; \
+                vec3 rgbA = 0.5 * (texture(gSource, texCoord + dir * (1.0 / 3.0 - 0.5)).rgb \
+                                 + texture(gSource, texCoord + dir * (2.0 / 3.0 - 0.5)).rgb); \
+                vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(gSource, texCoord - dir * 0.5).rgb \
+                                               + texture(gSource, texCoord + dir * 0.5).rgb); \
+                float lumaB = dot(rgbB, luma); \
+                c = (lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB; \
+            } \
+            else if (gSharpness > 0.0) { \
+                vec3 n = texture(gSource, texCoord + vec2(0.0, texel.y)).rgb; \
+                vec3 s = texture(gSource, texCoord - vec2(0.0, texel.y)).rgb; \
+                vec3 e = texture(gSource, texCoord + vec2(texel.x, 0.0)).rgb; \
+                vec3 w = texture(gSource, texCoord - vec2(texel.x, 0.0)).rgb; \
+                vec3 sharpened = c + gSharpness * (4.0 * c - n - s - e - w); \
+                c = clamp(sharpened, min(c, min(min(n, s), min(e, w))), max(c, max(max(n, s), max(e, w)))); \
+            } \
+            outColor = vec4(c, 1.0); \
+        }";
+		return new FragmentShader("EngineUpscaleFragmentShader", code);
+	}
     return nullptr;
 }
\ No newline at end of file
@@ -18,6 +18,16 @@ public:
 	static VertexShader* LoadEngineNormalVertexShader();
 	static FragmentShader* LoadEngineNormalFragmentShader();
 
+	static VertexShader* LoadEngineDebugDrawVertexShader();
+	static FragmentShader* LoadEngineDebugDrawFragmentShader();
+
+	static VertexShader* LoadEngineFullscreenVertexShader();
+	static FragmentShader* LoadEngineUpscaleFragmentShader();
+
+	// Grille partagee d'un Terrain, deplacee par la carte de hauteur de la tuile.
+	// Produit les memes sorties que BaseVertexShader.vs pour les fragment shaders de la scene.
+	static VertexShader* LoadEngineTerrainVertexShader();
+
     static VertexShader* LoadVertexShader(const std::string& shaderName);
     static FragmentShader* LoadFragmentShader(const std::string& shaderName);
 };
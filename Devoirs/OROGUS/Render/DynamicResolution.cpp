@@ -0,0 +1,137 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Variation maximale de l'echelle par ajustement
+    const float MAX_SCALE_CHANGE = 0.125f;
+
+    // Retard maximal des mesures du Profiler (ses quatre jeux de requetes GPU)
+    const uint32 GPU_LATENCY_FRAMES = 4;
+}
+
+const float DynamicResolution::SCALE_STEP = 1.0f / 16.0f;
+const float DynamicResolution::LOWER_TOLERANCE = 0.90f;
+const float DynamicResolution::UPPER_TOLERANCE = 1.10f;
+const float DynamicResolution::SMOOTHING = 0.1f;
+const uint32 DynamicResolution::SETTLE_FRAMES = 15;
+
+DynamicResolution::DynamicResolution(uint32 outputWidth, uint32 outputHeight, float targetFrameTime)
+    : m_outputWidth(outputWidth)
+    , m_outputHeight(outputHeight)
+    , m_enabled(true)
+    , m_targetFrameTime(targetFrameTime)
+    , m_minScale(0.5f)
+    , m_maxScale(1.0f)
+    , m_scale(1.0f)
+    , m_smoothedFrameTime(0.0f)
+    , m_framesSinceChange(0)
+{
+}
+
+bool DynamicResolution::isEnabled() const
+{
+    return m_enabled;
+}
+
+void DynamicResolution::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    m_smoothedFrameTime = 0.0f;
+    m_framesSinceChange = 0;
+}
+
+float DynamicResolution::getTargetFrameTime() const
+{
+    return m_targetFrameTime;
+}
+
+void DynamicResolution::setTargetFrameTime(float milliseconds)
+{
+    m_targetFrameTime = milliseconds;
+    m_framesSinceChange = 0;
+}
+
+void DynamicResolution::setScaleRange(float minScale, float maxScale)
+{
+    m_minScale = std::max(minScale, SCALE_STEP);
+    m_maxScale = std::max(maxScale, m_minScale);
+    m_scale = std::min(std::max(m_scale, m_minScale), m_maxScale);
+}
+
+float DynamicResolution::getScale() const
+{
+    return m_enabled ? m_scale : 1.0f;
+}
+
+uint32 DynamicResolution::getRenderWidth() const
+{
+    return std::max((uint32)(m_outputWidth * getScale() + 0.5f), 1u);
+}
+
+uint32 DynamicResolution::getRenderHeight() const
+{
+    return std::max((uint32)(m_outputHeight * getScale() + 0.5f), 1u);
+}
+
+uint32 DynamicResolution::getOutputWidth() const
+{
+    return m_outputWidth;
+}
+
+uint32 DynamicResolution::getOutputHeight() const
+{
+    return m_outputHeight;
+}
+
+void DynamicResolution::setOutputSize(uint32 width, uint32 height)
+{
+    m_outputWidth = width;
+    m_outputHeight = height;
+}
+
+void DynamicResolution::update(double frameTime)
+{
+    if (!m_enabled || frameTime <= 0.0)
+    {
+        return;
+    }
+
+    // Les mesures GPU ont jusqu'a GPU_LATENCY_FRAMES images de retard : celles de l'ancienne echelle sont ignorees
+    if (++m_framesSinceChange <= GPU_LATENCY_FRAMES)
+    {
+        return;
+    }
+
+    // Moyenne exponentielle pour ne pas reagir au bruit d'une seule image
+    m_smoothedFrameTime = m_smoothedFrameTime > 0.0f
+        ? m_smoothedFrameTime + SMOOTHING * ((float)frameTime - m_smoothedFrameTime)
+        : (float)frameTime;
+
+    if (m_framesSinceChange < SETTLE_FRAMES)
+    {
+        return;
+    }
+
+    float ratio = m_targetFrameTime / m_smoothedFrameTime;
+    if (ratio >= LOWER_TOLERANCE && ratio <= UPPER_TOLERANCE)
+    {
+        return;
+    }
+
+    // Le cout du remplissage suit le nombre de pixels, soit le carre de l'echelle
+    float desired = m_scale * std::sqrt(ratio);
+    desired = std::min(std::max(desired, m_scale - MAX_SCALE_CHANGE), m_scale + MAX_SCALE_CHANGE);
+    desired = std::round(desired / SCALE_STEP) * SCALE_STEP;
+    desired = std::min(std::max(desired, m_minScale), m_maxScale);
+
+    if (desired != m_scale)
+    {
+        m_scale = desired;
+        m_framesSinceChange = 0;
+        // Les mesures a l'ancienne echelle ne predisent plus le temps a la nouvelle
+        m_smoothedFrameTime = 0.0f;
+    }
+}
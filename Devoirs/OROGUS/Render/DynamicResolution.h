@@ -0,0 +1,62 @@
+#ifndef _RENDER_DYNAMICRESOLUTION_H_
+#define _RENDER_DYNAMICRESOLUTION_H_
+
+#include "../Utilities/Types.h"
+
+// Echelle de la resolution de rendu, ajustee pour suivre un budget de temps
+// par image. Le rendu dans la cible reduite et l'agrandissement sont faits par
+// FramePipeline.
+//
+// L'echelle est quantifiee par pas de SCALE_STEP : les quelques tailles
+// possibles restent peu nombreuses et peuvent etre gardees dans un pool.
+class DynamicResolution
+{
+private:
+    uint32 m_outputWidth;
+    uint32 m_outputHeight;
+
+    bool m_enabled;
+    float m_targetFrameTime;
+    float m_minScale;
+    float m_maxScale;
+    float m_scale;
+    float m_smoothedFrameTime;
+    uint32 m_framesSinceChange;
+
+public:
+    static const float SCALE_STEP;
+
+    // Ecart relatif toleree autour de la cible avant de changer d'echelle
+    static const float LOWER_TOLERANCE;
+    static const float UPPER_TOLERANCE;
+
+    // Poids de la derniere mesure dans la moyenne exponentielle
+    static const float SMOOTHING;
+
+    // Images a attendre apres un changement, le temps que les mesures GPU le refletent
+    static const uint32 SETTLE_FRAMES;
+
+    DynamicResolution(uint32 outputWidth, uint32 outputHeight, float targetFrameTime);
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    // Budget en millisecondes
+    float getTargetFrameTime() const;
+    void setTargetFrameTime(float milliseconds);
+
+    void setScaleRange(float minScale, float maxScale);
+    float getScale() const;
+
+    uint32 getRenderWidth() const;
+    uint32 getRenderHeight() const;
+
+    uint32 getOutputWidth() const;
+    uint32 getOutputHeight() const;
+    void setOutputSize(uint32 width, uint32 height);
+
+    // Ajuste l'echelle a partir du temps d'une image, en millisecondes
+    void update(double frameTime);
+};
+
+#endif
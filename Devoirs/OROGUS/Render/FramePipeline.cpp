@@ -0,0 +1,227 @@
+#include <glew/glew.h>
+
+#include "FramePipeline.h"
+
+#include "RenderTarget.h"
+
+#include "../Material/Material.h"
+#include "../Material/ShaderHelper.h"
+#include "../Utilities/RenderStats.h"
+#include "../Utilities/StringUtilities.h"
+
+#include <algorithm>
+
+namespace
+{
+    const float SHARPNESS = 0.2f;
+
+    // Chaque mode MSAA utilise une cible multiechantillonnee et sa cible de resolution
+    const uint32 POOL_CAPACITY = 8;
+
+    const struct
+    {
+        AntiAliasing Mode;
+        const char* Name;
+        uint32 Samples;
+    } ANTI_ALIASING_MODES[] =
+    {
+        { AntiAliasing::Off, "off", 1 },
+        { AntiAliasing::Msaa2, "msaa2", 2 },
+        { AntiAliasing::Msaa4, "msaa4", 4 },
+        { AntiAliasing::Msaa8, "msaa8", 8 },
+        { AntiAliasing::Fxaa, "fxaa", 1 },
+    };
+}
+
+FramePipeline::FramePipeline(uint32 outputWidth, uint32 outputHeight, float targetFrameTime)
+    : m_dynamicResolution(outputWidth, outputHeight, targetFrameTime)
+    , m_pool(POOL_CAPACITY)
+    , m_maxSamples(RenderTarget::GetMaxSamples())
+    , m_antiAliasing(AntiAliasing::Msaa4)
+    , m_filter(UpscaleFilter::Sharpen)
+    , m_destination(nullptr)
+    , m_sceneTarget(nullptr)
+    , m_resolveTarget(nullptr)
+{
+    m_presentMaterial = new Material(ShaderHelper::LoadEngineFullscreenVertexShader(), ShaderHelper::LoadEngineUpscaleFragmentShader());
+
+    // Le profil core exige un VAO lie meme sans attribut
+    glGenVertexArrays(1, &m_emptyVao);
+}
+
+FramePipeline::~FramePipeline()
+{
+    delete m_presentMaterial;
+    glDeleteVertexArrays(1, &m_emptyVao);
+}
+
+DynamicResolution& FramePipeline::getDynamicResolution()
+{
+    return m_dynamicResolution;
+}
+
+const DynamicResolution& FramePipeline::getDynamicResolution() const
+{
+    return m_dynamicResolution;
+}
+
+AntiAliasing FramePipeline::getAntiAliasing() const
+{
+    return m_antiAliasing;
+}
+
+void FramePipeline::setAntiAliasing(AntiAliasing antiAliasing)
+{
+    m_antiAliasing = antiAliasing;
+}
+
+uint32 FramePipeline::getSampleCount() const
+{
+    for (const auto& mode : ANTI_ALIASING_MODES)
+    {
+        if (mode.Mode == m_antiAliasing)
+        {
+            return std::max(std::min(mode.Samples, m_maxSamples), 1u);
+        }
+    }
+    return 1;
+}
+
+UpscaleFilter FramePipeline::getFilter() const
+{
+    return m_filter;
+}
+
+void FramePipeline::setFilter(UpscaleFilter filter)
+{
+    m_filter = filter;
+}
+
+void FramePipeline::setOutputSize(uint32 width, uint32 height)
+{
+    if (width != m_dynamicResolution.getOutputWidth() || height != m_dynamicResolution.getOutputHeight())
+    {
+        // Les anciennes tailles ne resserviront plus
+        m_pool.clear();
+        m_sceneTarget = nullptr;
+        m_resolveTarget = nullptr;
+        m_dynamicResolution.setOutputSize(width, height);
+    }
+}
+
+void FramePipeline::bindDestination() const
+{
+    if (m_destination != nullptr)
+    {
+        m_destination->bind();
+    }
+    else
+    {
+        RenderTarget::BindDefault();
+        glViewport(0, 0, m_dynamicResolution.getOutputWidth(), m_dynamicResolution.getOutputHeight());
+    }
+}
+
+void FramePipeline::beginFrame(const RenderTarget* destination)
+{
+    m_destination = destination;
+    m_sceneTarget = nullptr;
+    m_resolveTarget = nullptr;
+
+    uint32 width = m_dynamicResolution.getRenderWidth();
+    uint32 height = m_dynamicResolution.getRenderHeight();
+    uint32 samples = getSampleCount();
+
+    // Rien a resoudre ni a filtrer : la passe plein ecran serait une copie inutile
+    bool direct = samples == 1 && m_antiAliasing != AntiAliasing::Fxaa
+        && width == m_dynamicResolution.getOutputWidth() && height == m_dynamicResolution.getOutputHeight();
+
+    if (!direct && m_presentMaterial->isInitialized() && width > 0 && height > 0)
+    {
+        RenderTarget* target = m_pool.acquire(width, height, samples);
+        RenderTarget* resolveTarget = samples > 1 ? m_pool.acquire(width, height) : nullptr;
+        if (target->isComplete() && (resolveTarget == nullptr || resolveTarget->isComplete()))
+        {
+            m_sceneTarget = target;
+            m_resolveTarget = resolveTarget;
+            m_sceneTarget->bind();
+            return;
+        }
+    }
+
+    bindDestination();
+}
+
+void FramePipeline::endFrame()
+{
+    if (m_sceneTarget == nullptr)
+    {
+        return;
+    }
+
+    const RenderTarget* source = m_sceneTarget;
+    if (m_resolveTarget != nullptr)
+    {
+        m_sceneTarget->resolve(*m_resolveTarget);
+        source = m_resolveTarget;
+    }
+
+    bindDestination();
+
+    // Le mode fil de fer ne doit pas s'appliquer au triangle plein ecran
+    GLint polygonMode[2] = { GL_FILL, GL_FILL };
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source->getColorTexture());
+    glBindVertexArray(m_emptyVao);
+
+    // Le rehaussement compense l'agrandissement ; a pleine resolution il defairait l'anticrenelage
+    bool upscaled = source->getWidth() != m_dynamicResolution.getOutputWidth()
+        || source->getHeight() != m_dynamicResolution.getOutputHeight();
+
+    m_presentMaterial->bind();
+    m_presentMaterial->setInt("gSource", 0);
+    m_presentMaterial->setInt("gFxaa", m_antiAliasing == AntiAliasing::Fxaa ? 1 : 0);
+    m_presentMaterial->setFloat("gSharpness", m_filter == UpscaleFilter::Sharpen && upscaled ? SHARPNESS : 0.0f);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_presentMaterial->unbind();
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.TextureBinds++;
+    stats.VertexArrayBinds++;
+    stats.DrawCalls++;
+    stats.Triangles++;
+    stats.Vertices += 3;
+}
+
+const char* FramePipeline::GetAntiAliasingName(AntiAliasing antiAliasing)
+{
+    for (const auto& mode : ANTI_ALIASING_MODES)
+    {
+        if (mode.Mode == antiAliasing)
+        {
+            return mode.Name;
+        }
+    }
+    return "";
+}
+
+bool FramePipeline::ParseAntiAliasing(const std::string& name, AntiAliasing& antiAliasing)
+{
+    for (const auto& mode : ANTI_ALIASING_MODES)
+    {
+        if (StringUtilities::Equals(name, mode.Name))
+        {
+            antiAliasing = mode.Mode;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,88 @@
+#ifndef _RENDER_FRAMEPIPELINE_H_
+#define _RENDER_FRAMEPIPELINE_H_
+
+#include "DynamicResolution.h"
+#include "RenderTargetPool.h"
+
+#include "../Utilities/Types.h"
+
+#include <string>
+
+class Material;
+class RenderTarget;
+
+enum class AntiAliasing
+{
+    Off,
+    Msaa2,
+    Msaa4,
+    Msaa8,
+    Fxaa
+};
+
+enum class UpscaleFilter
+{
+    Bilinear,
+    Sharpen
+};
+
+// Chemin d'une image entre la scene et la fenetre (ou une cible de destination).
+//
+// La scene est rendue dans une cible hors ecran dont la taille suit la
+// resolution dynamique et le nombre d'echantillons le mode d'anticrenelage.
+// En fin d'image, une cible MSAA est resolue dans une cible simple, puis une
+// passe plein ecran agrandit le resultat en appliquant FXAA ou le rehaussement.
+// Sans anticrenelage ni reduction, la scene est rendue directement dans la
+// destination. Changer de mode ne demande que d'autres cibles du pool, pas de
+// recreer la fenetre.
+class FramePipeline
+{
+private:
+    DynamicResolution m_dynamicResolution;
+    RenderTargetPool m_pool;
+    Material* m_presentMaterial;
+    uint32 m_emptyVao;
+    uint32 m_maxSamples;
+
+    AntiAliasing m_antiAliasing;
+    UpscaleFilter m_filter;
+
+    const RenderTarget* m_destination;
+    RenderTarget* m_sceneTarget;
+    RenderTarget* m_resolveTarget;
+
+    void bindDestination() const;
+
+public:
+    FramePipeline(uint32 outputWidth, uint32 outputHeight, float targetFrameTime);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    DynamicResolution& getDynamicResolution();
+    const DynamicResolution& getDynamicResolution() const;
+
+    AntiAliasing getAntiAliasing() const;
+    void setAntiAliasing(AntiAliasing antiAliasing);
+
+    // Echantillons par pixel de la cible de scene, bornes par le pilote
+    uint32 getSampleCount() const;
+
+    UpscaleFilter getFilter() const;
+    void setFilter(UpscaleFilter filter);
+
+    void setOutputSize(uint32 width, uint32 height);
+
+    // Lie la cible de rendu de la scene. Sans destination, l'image finit dans
+    // le framebuffer de la fenetre.
+    void beginFrame(const RenderTarget* destination = nullptr);
+
+    // Resout et agrandit la cible de la scene dans la destination
+    void endFrame();
+
+    static const char* GetAntiAliasingName(AntiAliasing antiAliasing);
+    static bool ParseAntiAliasing(const std::string& name, AntiAliasing& antiAliasing);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <glew/glew.h>
+
+#include "RenderTarget.h"
+
+#include "../Utilities/Logger.h"
+
+RenderTarget::RenderTarget(uint32 width, uint32 height, uint32 samples)
+    : m_colorTexture(0)
+    , m_colorBuffer(0)
+    , m_width(width)
+    , m_height(height)
+    , m_samples(samples > 1 ? samples : 1)
+    , m_isComplete(false)
+{
+    glGenFramebuffers(1, &m_framebuffer);
+    if (m_samples > 1)
+    {
+        glGenRenderbuffers(1, &m_colorBuffer);
+    }
+    else
+    {
+        glGenTextures(1, &m_colorTexture);
+    }
+    glGenRenderbuffers(1, &m_depthBuffer);
+    allocate();
+}
+
+RenderTarget::~RenderTarget()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_samples > 1)
+    {
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+    }
+    else
+    {
+        glDeleteTextures(1, &m_colorTexture);
+    }
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+}
+
+void RenderTarget::allocate()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    if (m_samples > 1)
+    {
+        glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, GL_RGBA8, m_width, m_height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, GL_DEPTH_COMPONENT24, m_width, m_height);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+    m_isComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!m_isComplete)
+    {
+        Log() << "--Erreur : Framebuffer " << m_width << "x" << m_height << " (" << m_samples << " echantillons) incomplet" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool RenderTarget::isComplete() const
+{
+    return m_isComplete;
+}
+
+uint32 RenderTarget::getWidth() const
+{
+    return m_width;
+}
+
+uint32 RenderTarget::getHeight() const
+{
+    return m_height;
+}
+
+uint32 RenderTarget::getSamples() const
+{
+    return m_samples;
+}
+
+uint32 RenderTarget::getColorTexture() const
+{
+    return m_colorTexture;
+}
+
+void RenderTarget::resize(uint32 width, uint32 height)
+{
+    if (width != m_width || height != m_height)
+    {
+        m_width = width;
+        m_height = height;
+        allocate();
+    }
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::BindDefault()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::resolve(const RenderTarget& destination) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.m_framebuffer);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, destination.m_width, destination.m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+uint32 RenderTarget::GetMaxSamples()
+{
+    GLint maxSamples = 1;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    return (uint32)maxSamples;
+}
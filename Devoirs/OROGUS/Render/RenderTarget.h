@@ -0,0 +1,54 @@
+#ifndef _RENDER_RENDERTARGET_H_
+#define _RENDER_RENDERTARGET_H_
+
+#include "../Utilities/Types.h"
+
+// Framebuffer hors ecran avec profondeur dans un renderbuffer.
+// Sans multiechantillonnage, la couleur RGBA8 est une texture (pour pouvoir la
+// relire ou l'echantillonner) ; avec, c'est un renderbuffer a resoudre dans une
+// autre cible par resolve.
+class RenderTarget
+{
+private:
+    uint32 m_framebuffer;
+    uint32 m_colorTexture;
+    uint32 m_colorBuffer;
+    uint32 m_depthBuffer;
+    uint32 m_width;
+    uint32 m_height;
+    uint32 m_samples;
+    bool m_isComplete;
+
+    void allocate();
+
+public:
+    RenderTarget(uint32 width, uint32 height, uint32 samples = 1);
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    bool isComplete() const;
+
+    uint32 getWidth() const;
+    uint32 getHeight() const;
+    uint32 getSamples() const;
+
+    // Nulle pour une cible multiechantillonnee
+    uint32 getColorTexture() const;
+
+    // Realloue les attachements si la taille change
+    void resize(uint32 width, uint32 height);
+
+    // Lie le framebuffer et ajuste le viewport a sa taille
+    void bind() const;
+    static void BindDefault();
+
+    // Copie la couleur dans destination (de meme taille), en moyennant les echantillons
+    void resolve(const RenderTarget& destination) const;
+
+    // Nombre d'echantillons maximal supporte par le pilote
+    static uint32 GetMaxSamples();
+};
+
+#endif
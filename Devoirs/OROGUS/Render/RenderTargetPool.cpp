@@ -0,0 +1,50 @@
+#include "RenderTargetPool.h"
+
+#include "RenderTarget.h"
+
+#include <algorithm>
+
+RenderTargetPool::RenderTargetPool(uint32 capacity)
+    : m_capacity(std::max(capacity, 1u))
+    , m_useCount(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    clear();
+}
+
+RenderTarget* RenderTargetPool::acquire(uint32 width, uint32 height, uint32 samples)
+{
+    ++m_useCount;
+    for (Entry& entry : m_entries)
+    {
+        if (entry.Target->getWidth() == width && entry.Target->getHeight() == height
+            && entry.Target->getSamples() == samples)
+        {
+            entry.LastUsed = m_useCount;
+            return entry.Target;
+        }
+    }
+
+    if (m_entries.size() >= m_capacity)
+    {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                                       [](const Entry& a, const Entry& b) { return a.LastUsed < b.LastUsed; });
+        delete oldest->Target;
+        m_entries.erase(oldest);
+    }
+
+    m_entries.push_back({ new RenderTarget(width, height, samples), m_useCount });
+    return m_entries.back().Target;
+}
+
+void RenderTargetPool::clear()
+{
+    for (Entry& entry : m_entries)
+    {
+        delete entry.Target;
+    }
+    m_entries.clear();
+}
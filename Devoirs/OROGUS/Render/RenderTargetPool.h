@@ -0,0 +1,38 @@
+#ifndef _RENDER_RENDERTARGETPOOL_H_
+#define _RENDER_RENDERTARGETPOOL_H_
+
+#include "../Utilities/Types.h"
+
+#include <vector>
+
+class RenderTarget;
+
+// Cibles de rendu conservees par taille et nombre d'echantillons. Les tailles deja vues sont reutilisees
+// telles quelles ; au-dela de la capacite, la moins recemment utilisee est detruite.
+class RenderTargetPool
+{
+private:
+    struct Entry
+    {
+        RenderTarget* Target;
+        uint64 LastUsed;
+    };
+
+    std::vector<Entry> m_entries;
+    uint32 m_capacity;
+    uint64 m_useCount;
+
+public:
+    explicit RenderTargetPool(uint32 capacity);
+    ~RenderTargetPool();
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    // La cible reste valide jusqu'a ce que capacity autres formats aient ete demandes
+    RenderTarget* acquire(uint32 width, uint32 height, uint32 samples = 1);
+
+    void clear();
+};
+
+#endif
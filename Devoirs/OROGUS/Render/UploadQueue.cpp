@@ -0,0 +1,295 @@
+#include <glew/glew.h>
+
+#include "UploadQueue.h"
+
+#include "../Utilities/Profiler.h"
+#include "../Utilities/RenderStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Upload
+    {
+        uint64 Ticket;
+        bool Texture;
+        uint32 Object;
+        const uint8* Data;
+        std::unique_ptr<uint8[]> Storage;   // Copie possedee par la file (tampons seulement)
+        size_t Size;
+        size_t Offset;
+
+        // Textures : envoi par lignes entieres
+        uint32 Width;
+        uint32 Height;
+        uint32 Format;
+        uint32 Type;
+        size_t RowSize;
+    };
+
+    std::deque<Upload> s_uploads;
+    bool s_initialized = false;
+    uint64 s_nextTicket = 1;
+    uint64 s_pendingBytes = 0;
+    uint64 s_bytesPerFrame = 0;
+    double s_microsecondsPerFrame = 0.0;
+
+    // Retourne le nombre d'octets envoyes, au plus maxBytes sauf pour une ligne de texture plus grande
+    size_t UploadChunk(Upload& upload, size_t maxBytes)
+    {
+        size_t size;
+        if (upload.Texture)
+        {
+            uint32 firstRow = (uint32)(upload.Offset / upload.RowSize);
+            uint32 rows = (uint32)std::max<size_t>(1, maxBytes / upload.RowSize);
+            rows = std::min(rows, upload.Height - firstRow);
+            size = rows * upload.RowSize;
+
+            glBindTexture(GL_TEXTURE_2D, upload.Object);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, upload.Width, rows, upload.Format, upload.Type, upload.Data + upload.Offset);
+        }
+        else
+        {
+            size = std::min(maxBytes, upload.Size - upload.Offset);
+
+            // GL_COPY_WRITE_BUFFER ne modifie pas l'etat du VAO lie
+            glBindBuffer(GL_COPY_WRITE_BUFFER, upload.Object);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, upload.Offset, size, upload.Data + upload.Offset);
+        }
+
+        upload.Offset += size;
+        s_pendingBytes -= size;
+        return size;
+    }
+
+    void Cancel(bool texture, uint32 object)
+    {
+        for (auto it = s_uploads.begin(); it != s_uploads.end();)
+        {
+            if (it->Texture == texture && it->Object == object)
+            {
+                s_pendingBytes -= it->Size - it->Offset;
+                it = s_uploads.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void UpdateQueueStats()
+    {
+        RenderStats& stats = RenderCounters::Current();
+        stats.UploadQueueDepth = (uint32)s_uploads.size();
+        stats.UploadQueueBytes = s_pendingBytes;
+    }
+}
+
+const uint64 UploadQueue::DEFAULT_BYTES_PER_FRAME = 16 * 1024 * 1024;
+const double UploadQueue::DEFAULT_MICROSECONDS_PER_FRAME = 2000.0;
+const size_t UploadQueue::CHUNK_SIZE = 1024 * 1024;
+
+void UploadQueue::Initialize(uint64 bytesPerFrame, double microsecondsPerFrame)
+{
+    Uninitialize();
+    SetBudget(bytesPerFrame, microsecondsPerFrame);
+    s_initialized = true;
+}
+
+void UploadQueue::Uninitialize()
+{
+    s_uploads.clear();
+    s_pendingBytes = 0;
+    s_initialized = false;
+}
+
+void UploadQueue::SetBudget(uint64 bytesPerFrame, double microsecondsPerFrame)
+{
+    s_bytesPerFrame = bytesPerFrame;
+    s_microsecondsPerFrame = microsecondsPerFrame;
+}
+
+uint64 UploadQueue::BufferData(uint32 buffer, size_t size, const void* data)
+{
+    // Les morceaux en attente ne correspondent plus au nouveau contenu
+    CancelBuffer(buffer);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (!s_initialized || size <= CHUNK_SIZE || data == nullptr)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+        RenderCounters::Current().BufferBytesUploaded += data != nullptr ? size : 0;
+        return 0;
+    }
+
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+
+    Upload upload;
+    upload.Ticket = s_nextTicket++;
+    upload.Texture = false;
+    upload.Object = buffer;
+    upload.Storage.reset(new uint8[size]);
+    std::memcpy(upload.Storage.get(), data, size);
+    upload.Data = upload.Storage.get();
+    upload.Size = size;
+    upload.Offset = 0;
+    upload.Width = 0;
+    upload.Height = 0;
+    upload.Format = 0;
+    upload.Type = 0;
+    upload.RowSize = 0;
+    s_pendingBytes += size;
+    s_uploads.push_back(std::move(upload));
+    return s_uploads.back().Ticket;
+}
+
+void UploadQueue::BufferSubData(uint32 buffer, size_t offset, size_t size, const void* data)
+{
+    for (Upload& upload : s_uploads)
+    {
+        if (!upload.Texture && upload.Object == buffer && offset < upload.Size)
+        {
+            size_t patched = std::min(size, upload.Size - offset);
+            std::memcpy(upload.Storage.get() + offset, data, patched);
+        }
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    RenderCounters::Current().BufferBytesUploaded += size;
+}
+
+uint64 UploadQueue::TextureData(uint32 texture, int32 internalFormat, uint32 width, uint32 height,
+                                uint32 format, uint32 type, uint32 bytesPerPixel, const void* data)
+{
+    CancelTexture(texture);
+
+    size_t rowSize = (size_t)width * bytesPerPixel;
+    size_t size = rowSize * height;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (!s_initialized || size <= CHUNK_SIZE || data == nullptr)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
+        RenderCounters::Current().BufferBytesUploaded += data != nullptr ? size : 0;
+        return 0;
+    }
+
+    // Le contenu reste indefini tant que toutes les lignes ne sont pas envoyees
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+
+    Upload upload;
+    upload.Ticket = s_nextTicket++;
+    upload.Texture = true;
+    upload.Object = texture;
+    upload.Data = static_cast<const uint8*>(data);
+    upload.Size = size;
+    upload.Offset = 0;
+    upload.Width = width;
+    upload.Height = height;
+    upload.Format = format;
+    upload.Type = type;
+    upload.RowSize = rowSize;
+    s_pendingBytes += size;
+    s_uploads.push_back(std::move(upload));
+    return s_uploads.back().Ticket;
+}
+
+void UploadQueue::CancelBuffer(uint32 buffer)
+{
+    Cancel(false, buffer);
+}
+
+void UploadQueue::CancelTexture(uint32 texture)
+{
+    Cancel(true, texture);
+}
+
+bool UploadQueue::IsComplete(uint64 ticket)
+{
+    return s_uploads.empty() || s_uploads.front().Ticket > ticket;
+}
+
+void UploadQueue::Process()
+{
+    if (s_uploads.empty())
+    {
+        UpdateQueueStats();
+        return;
+    }
+
+    PROFILE_SCOPE("UploadQueue::Process");
+    Clock::time_point start = Clock::now();
+    uint64 sent = 0;
+    while (!s_uploads.empty())
+    {
+        if (s_bytesPerFrame > 0 && sent >= s_bytesPerFrame)
+        {
+            break;
+        }
+        if (s_microsecondsPerFrame > 0.0 && sent > 0 &&
+            std::chrono::duration<double, std::micro>(Clock::now() - start).count() >= s_microsecondsPerFrame)
+        {
+            break;
+        }
+
+        size_t chunk = CHUNK_SIZE;
+        if (s_bytesPerFrame > 0)
+        {
+            chunk = (size_t)std::min<uint64>(chunk, s_bytesPerFrame - sent);
+        }
+
+        Upload& upload = s_uploads.front();
+        sent += UploadChunk(upload, chunk);
+        if (upload.Offset >= upload.Size)
+        {
+            s_uploads.pop_front();
+        }
+    }
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.BufferBytesUploaded += sent;
+    stats.StreamedBytes += sent;
+    stats.UploadTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    UpdateQueueStats();
+}
+
+void UploadQueue::Flush()
+{
+    if (s_uploads.empty())
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("UploadQueue::Flush");
+    Clock::time_point start = Clock::now();
+    uint64 sent = 0;
+    while (!s_uploads.empty())
+    {
+        Upload& upload = s_uploads.front();
+        sent += UploadChunk(upload, upload.Size - upload.Offset);
+        s_uploads.pop_front();
+    }
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.BufferBytesUploaded += sent;
+    stats.StreamedBytes += sent;
+    stats.UploadTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    UpdateQueueStats();
+}
+
+uint32 UploadQueue::GetPendingCount()
+{
+    return (uint32)s_uploads.size();
+}
+
+uint64 UploadQueue::GetPendingBytes()
+{
+    return s_pendingBytes;
+}
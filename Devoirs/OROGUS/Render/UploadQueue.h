@@ -0,0 +1,65 @@
+#ifndef _RENDER_UPLOADQUEUE_H_
+#define _RENDER_UPLOADQUEUE_H_
+
+#include "../Utilities/Types.h"
+
+#include <cstddef>
+
+// Televersements GPU etales sur plusieurs images. Un gros tampon ou une grosse
+// texture est alloue tout de suite, puis rempli par morceaux (glBufferSubData,
+// glTexSubImage2D) sans depasser un budget d'octets et de temps par image.
+// Les petits envois passent directement. Utilisable seulement depuis le thread GL.
+//
+// Les envois sont traites dans l'ordre : un ticket est termine quand plus aucun
+// envoi de numero inferieur ou egal n'est en attente.
+class UploadQueue
+{
+public:
+    static const uint64 DEFAULT_BYTES_PER_FRAME;
+    static const double DEFAULT_MICROSECONDS_PER_FRAME;
+
+    // Taille d'un morceau, et seuil au-dessous duquel l'envoi est immediat
+    static const size_t CHUNK_SIZE;
+
+    UploadQueue() = delete;
+
+    // Sans Initialize, tous les envois sont immediats
+    static void Initialize(uint64 bytesPerFrame = DEFAULT_BYTES_PER_FRAME,
+                           double microsecondsPerFrame = DEFAULT_MICROSECONDS_PER_FRAME);
+    // Abandonne les envois restants
+    static void Uninitialize();
+
+    // 0 : pas de limite. Au moins un morceau est envoye par image.
+    static void SetBudget(uint64 bytesPerFrame, double microsecondsPerFrame);
+
+    // Remplace glBufferData pour un tampon statique. Les donnees sont copiees si
+    // l'envoi est differe. Retourne 0 si l'envoi a ete fait immediatement.
+    static uint64 BufferData(uint32 buffer, size_t size, const void* data);
+
+    // Remplace glBufferSubData : ecrit tout de suite dans le tampon et corrige aussi
+    // la copie d'un envoi encore en attente, pour que ses morceaux restants
+    // n'ecrasent pas la plage avec l'ancien contenu.
+    static void BufferSubData(uint32 buffer, size_t offset, size_t size, const void* data);
+
+    // Remplace glTexImage2D pour le niveau 0. data n'est pas copie et doit rester
+    // valide jusqu'a la fin de l'envoi ou jusqu'a CancelTexture. Laisse la texture liee.
+    static uint64 TextureData(uint32 texture, int32 internalFormat, uint32 width, uint32 height,
+                              uint32 format, uint32 type, uint32 bytesPerPixel, const void* data);
+
+    // A appeler avant de detruire ou de redefinir l'objet GL
+    static void CancelBuffer(uint32 buffer);
+    static void CancelTexture(uint32 texture);
+
+    static bool IsComplete(uint64 ticket);
+
+    // Une fois par image, avant le rendu
+    static void Process();
+
+    // Envoie tout ce qui est en attente, sans budget
+    static void Flush();
+
+    static uint32 GetPendingCount();
+    static uint64 GetPendingBytes();
+};
+
+#endif
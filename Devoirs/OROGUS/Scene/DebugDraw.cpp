@@ -0,0 +1,256 @@
+#include <glew/glew.h>
+
+#include "DebugDraw.h"
+
+#include "Scene.h"
+#include "../Material/Material.h"
+#include "../Material/ShaderHelper.h"
+#include "../Utilities/RenderStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    uint32 PackColor(const Color& color)
+    {
+        auto toByte = [](float c) { return (uint32)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f); };
+        return toByte(color.r()) | (toByte(color.g()) << 8) | (toByte(color.b()) << 16) | (toByte(color.a()) << 24);
+    }
+}
+
+DebugDraw* DebugDraw::s_instance = nullptr;
+
+void DebugDraw::Initialize()
+{
+    if (s_instance == nullptr)
+    {
+        s_instance = new DebugDraw();
+    }
+}
+
+void DebugDraw::Uninitialize()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+DebugDraw::DebugDraw()
+    : m_bufferCapacity(0)
+{
+    m_material = new Material(ShaderHelper::LoadEngineDebugDrawVertexShader(), ShaderHelper::LoadEngineDebugDrawFragmentShader());
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vertexBuffer);
+
+    if (m_material->isInitialized())
+    {
+        glBindVertexArray(m_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        uint32 posAttribute = m_material->attribute("aPosition");
+        uint32 colorAttribute = m_material->attribute("aColor");
+        glEnableVertexAttribArray(posAttribute);
+        glEnableVertexAttribArray(colorAttribute);
+        glVertexAttribPointer(posAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), 0);
+        glVertexAttribPointer(colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (const GLvoid*)(3 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+}
+
+DebugDraw::~DebugDraw()
+{
+    delete m_material;
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+void DebugDraw::addLine(const float from[3], const float to[3], uint32 color, bool depthTest)
+{
+    std::vector<DebugVertex>& lines = depthTest ? m_depthTestedLines : m_overlayLines;
+    lines.push_back({ { from[0], from[1], from[2] }, color });
+    lines.push_back({ { to[0], to[1], to[2] }, color });
+}
+
+void DebugDraw::addAxis(const Transform& t, Metre length, bool depthTest)
+{
+    Point3<Metre> origin = t * Point3<Metre>();
+    Point3<Metre> axisX = t * Point3<Metre>(length, Metre(), Metre());
+    Point3<Metre> axisY = t * Point3<Metre>(Metre(), length, Metre());
+    Point3<Metre> axisZ = t * Point3<Metre>(Metre(), Metre(), length);
+    addLine(origin.constValues(), axisX.constValues(), PackColor(Color::Red()), depthTest);
+    addLine(origin.constValues(), axisY.constValues(), PackColor(Color::Green()), depthTest);
+    addLine(origin.constValues(), axisZ.constValues(), PackColor(Color::Blue()), depthTest);
+}
+
+void DebugDraw::GizmoAxis(const Transform& t, Metre length)
+{
+    // Teste en profondeur, comme les cylindres qu'il remplace
+    if (s_instance != nullptr)
+    {
+        s_instance->addAxis(t, length, true);
+    }
+}
+
+#ifdef OROGUS_DEBUG_DRAW
+
+void DebugDraw::Line(const Point3<Metre>& from, const Point3<Metre>& to, const Color& color, bool depthTest)
+{
+    if (s_instance != nullptr)
+    {
+        s_instance->addLine(from.constValues(), to.constValues(), PackColor(color), depthTest);
+    }
+}
+
+void DebugDraw::Box(const Point3<Metre>& min, const Point3<Metre>& max, const Transform& t, const Color& color, bool depthTest)
+{
+    if (s_instance == nullptr)
+    {
+        return;
+    }
+
+    // Coin i : bit 0 -> x max, bit 1 -> y max, bit 2 -> z max
+    Point3<Metre> corners[8];
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        Point3<Metre> corner((i & 1) ? max.x() : min.x(), (i & 2) ? max.y() : min.y(), (i & 4) ? max.z() : min.z());
+        corners[i] = t * corner;
+    }
+
+    const uint32 edges[12][2] = {
+        { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+    };
+    uint32 packed = PackColor(color);
+    for (const uint32* edge : edges)
+    {
+        s_instance->addLine(corners[edge[0]].constValues(), corners[edge[1]].constValues(), packed, depthTest);
+    }
+}
+
+void DebugDraw::Sphere(const Point3<Metre>& center, Metre radius, const Color& color, uint32 segments, bool depthTest)
+{
+    if (s_instance == nullptr || segments < 3)
+    {
+        return;
+    }
+
+    const float* c = center.constValues();
+    float r = radius.Value();
+    uint32 packed = PackColor(color);
+    const float step = 2.0f * 3.14159265f / segments;
+
+    // Un cercle par plan XY, XZ et YZ
+    for (uint32 axis = 0; axis < 3; ++axis)
+    {
+        uint32 u = axis == 2 ? 1 : 0;
+        uint32 v = axis == 0 ? 1 : 2;
+
+        float previous[3] = { c[0], c[1], c[2] };
+        previous[u] += r;
+        for (uint32 i = 1; i <= segments; ++i)
+        {
+            float current[3] = { c[0], c[1], c[2] };
+            current[u] += r * std::cos(step * i);
+            current[v] += r * std::sin(step * i);
+            s_instance->addLine(previous, current, packed, depthTest);
+            std::copy(current, current + 3, previous);
+        }
+    }
+}
+
+void DebugDraw::Axis(const Transform& t, Metre length, bool depthTest)
+{
+    if (s_instance != nullptr)
+    {
+        s_instance->addAxis(t, length, depthTest);
+    }
+}
+
+void DebugDraw::Frustum(const Matrix4x4<Real>& viewProjection, const Color& color, bool depthTest)
+{
+    if (s_instance == nullptr)
+    {
+        return;
+    }
+
+    // Les coins du cube NDC ramenes dans l'espace du monde
+    auto inverse = viewProjection.inverse();
+    Point3<Real> corners[8];
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        Point3<Real> ndc(Real((i & 1) ? 1.0f : -1.0f), Real((i & 2) ? 1.0f : -1.0f), Real((i & 4) ? 1.0f : -1.0f));
+        corners[i] = Point3<Real>(inverse * ndc);
+    }
+
+    const uint32 edges[12][2] = {
+        { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+    };
+    uint32 packed = PackColor(color);
+    for (const uint32* edge : edges)
+    {
+        s_instance->addLine(corners[edge[0]].constValues(), corners[edge[1]].constValues(), packed, depthTest);
+    }
+}
+
+#endif
+
+void DebugDraw::Flush(const Scene& scene)
+{
+    if (s_instance == nullptr)
+    {
+        return;
+    }
+
+    DebugDraw& self = *s_instance;
+    uint32 depthTestedCount = (uint32)self.m_depthTestedLines.size();
+    uint32 overlayCount = (uint32)self.m_overlayLines.size();
+    uint32 vertexCount = depthTestedCount + overlayCount;
+    if (vertexCount == 0 || !self.m_material->isInitialized())
+    {
+        self.m_depthTestedLines.clear();
+        self.m_overlayLines.clear();
+        return;
+    }
+
+    // Le buffer ne fait que grandir. Il est reinitialise a chaque image pour ne
+    // pas attendre que le GPU ait fini de lire celui de l'image precedente.
+    glBindBuffer(GL_ARRAY_BUFFER, self.m_vertexBuffer);
+    if (vertexCount > self.m_bufferCapacity)
+    {
+        self.m_bufferCapacity = std::max(vertexCount, self.m_bufferCapacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, self.m_bufferCapacity * sizeof(DebugVertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, depthTestedCount * sizeof(DebugVertex), self.m_depthTestedLines.data());
+    glBufferSubData(GL_ARRAY_BUFFER, depthTestedCount * sizeof(DebugVertex), overlayCount * sizeof(DebugVertex), self.m_overlayLines.data());
+
+    RenderStats& stats = RenderCounters::Current();
+    stats.BufferBytesUploaded += vertexCount * sizeof(DebugVertex);
+    stats.Vertices += vertexCount;
+
+    glBindVertexArray(self.m_vao);
+    stats.VertexArrayBinds++;
+    self.m_material->bind();
+    scene.bindNormals(*self.m_material);
+
+    if (depthTestedCount > 0)
+    {
+        glDrawArrays(GL_LINES, 0, depthTestedCount);
+        stats.DrawCalls++;
+    }
+    if (overlayCount > 0)
+    {
+        glDisable(GL_DEPTH_TEST);
+        glDrawArrays(GL_LINES, depthTestedCount, overlayCount);
+        stats.DrawCalls++;
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    self.m_material->unbind();
+    glBindVertexArray(0);
+
+    self.m_depthTestedLines.clear();
+    self.m_overlayLines.clear();
+}
@@ -0,0 +1,79 @@
+#ifndef _SCENE_DEBUGDRAW_H_
+#define _SCENE_DEBUGDRAW_H_
+
+#include "../Utilities/Color.h"
+#include "../Utilities/Matrices.h"
+#include "../Utilities/Point.h"
+#include "../Utilities/Transforms.h"
+#include "../Utilities/Types.h"
+#include "../Utilities/Units.h"
+
+#include <vector>
+
+class Material;
+class Scene;
+
+// Sans OROGUS_DEBUG_DRAW (defini seulement en Debug), les primitives de
+// deverminage sont vides et disparaissent a la compilation. Le tampon de lignes
+// reste compile : le repere de la scene (GizmoAxis) l'utilise dans tous les cas.
+#ifdef OROGUS_DEBUG_DRAW
+#define DEBUG_DRAW_BODY ;
+#else
+#define DEBUG_DRAW_BODY {}
+#endif
+
+// Primitives en lignes, accumulees pendant l'image puis dessinees par Flush
+// en au plus deux appels (avec et sans test de profondeur).
+class DebugDraw
+{
+private:
+    struct DebugVertex
+    {
+        float Position[3];
+        uint32 Color;   // RGBA8
+    };
+
+    static DebugDraw* s_instance;
+
+    Material* m_material;
+    uint32 m_vao;
+    uint32 m_vertexBuffer;
+    uint32 m_bufferCapacity;
+
+    std::vector<DebugVertex> m_depthTestedLines;
+    std::vector<DebugVertex> m_overlayLines;
+
+    DebugDraw();
+    ~DebugDraw();
+
+    void addLine(const float from[3], const float to[3], uint32 color, bool depthTest);
+    void addAxis(const Transform& t, Metre length, bool depthTest);
+
+public:
+    static void Initialize();
+    static void Uninitialize();
+
+    // Repere de la scene : present aussi hors OROGUS_DEBUG_DRAW
+    static void GizmoAxis(const Transform& t, Metre length);
+
+    static void Line(const Point3<Metre>& from, const Point3<Metre>& to, const Color& color, bool depthTest = true) DEBUG_DRAW_BODY
+
+    // Boite alignee sur les axes de l'espace defini par t
+    static void Box(const Point3<Metre>& min, const Point3<Metre>& max, const Transform& t, const Color& color, bool depthTest = true) DEBUG_DRAW_BODY
+
+    // Trois grands cercles orthogonaux
+    static void Sphere(const Point3<Metre>& center, Metre radius, const Color& color, uint32 segments = 24, bool depthTest = true) DEBUG_DRAW_BODY
+
+    // Axes X, Y et Z (rouge, vert, bleu) du repere t
+    static void Axis(const Transform& t, Metre length, bool depthTest = false) DEBUG_DRAW_BODY
+
+    // Aretes du volume de vue d'une matrice projection * vue
+    static void Frustum(const Matrix4x4<Real>& viewProjection, const Color& color, bool depthTest = true) DEBUG_DRAW_BODY
+
+    // Dessine et vide les lignes accumulees depuis le dernier appel
+    static void Flush(const Scene& scene);
+};
+
+#undef DEBUG_DRAW_BODY
+
+#endif
@@ -4,30 +4,18 @@
 #include "../Utilities/Transforms.h"
 #include "../Utilities/Types.h"
 
-class Geometry;
-class Material;
-class Scene;
-
+// Repere X, Y, Z (rouge, vert, bleu) dessine en lignes par DebugDraw::GizmoAxis,
+// visible dans toutes les compilations.
 class Gizmo
 {
-	Geometry* m_axeX;
-	Geometry* m_axeY;
-	Geometry* m_axeZ;
-	Material* m_material;
 	Transform m_gizmoTransform;
-	uint32 m_vao[3];
 
 public:
-	Gizmo();
-	~Gizmo();
-
-	Gizmo(const Gizmo&) = delete;
-	Gizmo& operator=(const Gizmo&) = delete;
-
 	void setTransform(const Transform& t);
 	const Transform& getTransform() const;
 
-	void render(const Scene& scene);
+	// A appeler avant DebugDraw::Flush
+	void render() const;
 };
 
 #endif
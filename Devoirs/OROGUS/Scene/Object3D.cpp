@@ -1,10 +1,44 @@
 #include "Object3D.h"
 
+#include "DebugDraw.h"
 #include "Scene.h"
 #include "../Geometry/Geometry.h"
 #include "../Geometry/GeometryManager.h"
+#include "../Geometry/TriangleBVH.h"
 #include "../Material/Material.h"
 #include "../Material/ShaderHelper.h"
+#include "../Utilities/RenderStats.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Test des dalles contre la boite de la geometrie, avant de construire sa hierarchie
+    bool HitsBounds(const Ray& ray, const Point3<Metre>& boundsMin, const Point3<Metre>& boundsMax)
+    {
+        float entry = 0.0f;
+        float exit = ray.MaxDistance;
+        const float minimum[3] = { (float)boundsMin.x(), (float)boundsMin.y(), (float)boundsMin.z() };
+        const float maximum[3] = { (float)boundsMax.x(), (float)boundsMax.y(), (float)boundsMax.z() };
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            if (ray.Direction[axis] == 0.0f)
+            {
+                if (ray.Origin[axis] < minimum[axis] || ray.Origin[axis] > maximum[axis])
+                {
+                    return false;
+                }
+                continue;
+            }
+            float inverse = 1.0f / ray.Direction[axis];
+            float t0 = (minimum[axis] - ray.Origin[axis]) * inverse;
+            float t1 = (maximum[axis] - ray.Origin[axis]) * inverse;
+            entry = std::max(entry, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+        }
+        return entry <= exit;
+    }
+}
 
 Object3D::Object3D(const std::string& name, Material* material, Geometry* geometry)
     : m_material(material)
@@ -34,6 +68,10 @@ Object3D::~Object3D()
     {
         GeometryManager::GetInstance()->unloadGeometry(m_geometry);
     }
+    if (m_pendingGeometry.isValid())
+    {
+        GeometryManager::GetInstance()->unloadGeometry(m_pendingGeometry);
+    }
 
     if (m_material != nullptr)
     {
@@ -70,25 +108,10 @@ void Object3D::updateVAO() const
     if (mat != nullptr)
     {
         glBindVertexArray(m_vao);
-        uint32 posAttribute = mat->attribute("aPosition");
-        uint32 normalAttribute = mat->attribute("aNormal");
-        uint32 tangentAttribute = mat->attribute("aTangent");
-        uint32 uvAttribute = mat->attribute("aTexCoord");
-        glEnableVertexAttribArray(posAttribute);
-        glEnableVertexAttribArray(normalAttribute);
-        glEnableVertexAttribArray(tangentAttribute);
-        glEnableVertexAttribArray(uvAttribute);
-
         if (m_geometry != nullptr)
         {
-            m_geometry->bindBuffersVAO();
+            m_geometry->bindBuffersVAO(*mat);
         }
-
-		uint32 vertexSize = sizeof(Vertex);
-		glVertexAttribPointer(posAttribute, 3, GL_FLOAT, GL_FALSE, vertexSize, 0);
-		glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, vertexSize, (const GLvoid*)12);
-		glVertexAttribPointer(tangentAttribute, 3, GL_FLOAT, GL_FALSE, vertexSize, (const GLvoid*)24);
-		glVertexAttribPointer(uvAttribute, 2, GL_FLOAT, GL_FALSE, vertexSize, (const GLvoid*)36);
         glBindVertexArray(0);
     }
 
@@ -119,9 +142,18 @@ const Material* Object3D::getMaterial() const
     return m_scene->getSceneMaterial();
 }
 
+const Object3D* Object3D::getParent() const
+{
+    return m_parent;
+}
+
 void Object3D::setTransform(const Transform& t)
 {
     m_transformation = t;
+    if (m_scene != nullptr)
+    {
+        m_scene->invalidateRaycastBVH(true);
+    }
 }
 
 void Object3D::addChildren(Object3D* child)
@@ -130,12 +162,136 @@ void Object3D::addChildren(Object3D* child)
     {
         m_children.push_back(child);
         child->setParent(this);
+        if (m_scene != nullptr)
+        {
+            child->setScene(m_scene);
+            m_scene->invalidateRaycastBVH(false);
+        }
+    }
+}
+
+const std::vector<Object3D*>& Object3D::getChildren() const
+{
+    return m_children;
+}
+
+void Object3D::setPendingGeometry(GeometryHandle handle)
+{
+    m_pendingGeometry = std::move(handle);
+}
+
+void Object3D::updateGeometry()
+{
+    if (m_pendingGeometry.isValid() && !m_pendingGeometry.isPending())
+    {
+        // Nul si le chargement a echoue ; la reference passe de la poignee a m_geometry
+        m_geometry = m_pendingGeometry.getGeometry();
+        m_pendingGeometry.reset();
+        updateVAO();
+        if (m_scene != nullptr)
+        {
+            m_scene->invalidateRaycastBVH(false);
+        }
+    }
+
+    for (Object3D* child : m_children)
+    {
+        child->updateGeometry();
     }
 }
 
 void Object3D::transformObject(const Transform& t)
 {
     m_transformation = t * m_transformation;
+    if (m_scene != nullptr)
+    {
+        m_scene->invalidateRaycastBVH(true);
+    }
+}
+
+bool Object3D::getWorldBounds(Point3<Metre>& boundsMin, Point3<Metre>& boundsMax) const
+{
+    if (m_geometry == nullptr || !m_geometry->hasPickingData())
+    {
+        return false;
+    }
+
+    // Boite alignee sur les axes du monde qui contient les huit coins transformes
+    Transform transform = getTransform();
+    const Point3<Metre>& localMin = m_geometry->getBoundsMin();
+    const Point3<Metre>& localMax = m_geometry->getBoundsMax();
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        Point3<Metre> corner = transform * Point3<Metre>((i & 1) ? localMax.x() : localMin.x(),
+                                                         (i & 2) ? localMax.y() : localMin.y(),
+                                                         (i & 4) ? localMax.z() : localMin.z());
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = i == 0 ? corner[axis] : std::min(boundsMin[axis], corner[axis]);
+            boundsMax[axis] = i == 0 ? corner[axis] : std::max(boundsMax[axis], corner[axis]);
+        }
+    }
+    return true;
+}
+
+void Object3D::raycast(const Matrix4x4<Real>& worldToLocal, Ray& ray, bool nearestOnly,
+                       std::vector<RaycastHit>& hits, std::vector<TriangleHit>& triangleHits) const
+{
+    if (m_geometry != nullptr && m_geometry->hasPickingData())
+    {
+        // Rayon ramene dans l'espace de la geometrie. La direction n'est pas renormalisee :
+        // les distances le long du rayon restent celles de l'espace du monde.
+        const Matrix4x4<Real>& inverse = worldToLocal;
+        Point3<Real> origin = Point3<Real>(inverse * Point3<Real>(Real(ray.Origin[0]), Real(ray.Origin[1]), Real(ray.Origin[2])));
+        Point3<Real> target = Point3<Real>(inverse * Point3<Real>(Real(ray.Origin[0] + ray.Direction[0]),
+                                                                  Real(ray.Origin[1] + ray.Direction[1]),
+                                                                  Real(ray.Origin[2] + ray.Direction[2])));
+        Ray local;
+        std::copy(origin.constValues(), origin.constValues() + 3, local.Origin);
+        std::copy(target.constValues(), target.constValues() + 3, local.Direction);
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            local.Direction[i] -= local.Origin[i];
+        }
+        local.MaxDistance = ray.MaxDistance;
+
+        if (HitsBounds(local, m_geometry->getBoundsMin(), m_geometry->getBoundsMax()))
+        {
+            const TriangleBVH* bvh = m_geometry->getBVH();
+            auto makeHit = [this, &ray](const TriangleHit& triangleHit)
+            {
+                RaycastHit hit;
+                hit.Object = this;
+                hit.Triangle = triangleHit.Triangle;
+                hit.Distance = Metre(triangleHit.Distance);
+                hit.U = triangleHit.U;
+                hit.V = triangleHit.V;
+                hit.Position = Point3<Metre>(Metre(ray.Origin[0] + ray.Direction[0] * triangleHit.Distance),
+                                             Metre(ray.Origin[1] + ray.Direction[1] * triangleHit.Distance),
+                                             Metre(ray.Origin[2] + ray.Direction[2] * triangleHit.Distance));
+                return hit;
+            };
+
+            if (nearestOnly)
+            {
+                TriangleHit triangleHit;
+                if (bvh->raycast(local, triangleHit))
+                {
+                    ray.MaxDistance = triangleHit.Distance;
+                    hits.assign(1, makeHit(triangleHit));
+                }
+            }
+            else
+            {
+                triangleHits.clear();
+                bvh->raycastAll(local, triangleHits);
+                for (const TriangleHit& triangleHit : triangleHits)
+                {
+                    hits.push_back(makeHit(triangleHit));
+                }
+            }
+        }
+    }
 }
 
 Transform Object3D::getObjectTransform() const
@@ -158,6 +314,7 @@ Transform Object3D::getTransform() const
 void Object3D::render() const
 {
     glBindVertexArray(m_vao);
+    RenderCounters::Current().VertexArrayBinds++;
     const Material* material = getMaterial();
     if (material != nullptr)
     {
@@ -183,6 +340,7 @@ void Object3D::render() const
 void Object3D::renderNormals() const
 {
 	glBindVertexArray(m_vaoNormals);
+	RenderCounters::Current().VertexArrayBinds++;
 	m_normalMaterial->bind();
 	m_normalMaterial->setMat4("gModelMatrix", getTransform());
 	m_scene->bindNormals(*m_normalMaterial);
@@ -198,4 +356,24 @@ void Object3D::renderNormals() const
 
 	m_normalMaterial->unbind();
 	glBindVertexArray(0);
+}
+
+void Object3D::renderBounds() const
+{
+	if (m_geometry != nullptr)
+	{
+		Transform transform = getTransform();
+		DebugDraw::Box(m_geometry->getBoundsMin(), m_geometry->getBoundsMax(), transform, Color(1.0f, 1.0f, 0.0f));
+
+		// Parties d'un lot statique
+		for (const GeometryRange& range : m_geometry->getRanges())
+		{
+			DebugDraw::Box(range.BoundsMin, range.BoundsMax, transform, Color(1.0f, 0.5f, 0.0f));
+		}
+	}
+
+	for (Object3D* child : m_children)
+	{
+		child->renderBounds();
+	}
 }
\ No newline at end of file
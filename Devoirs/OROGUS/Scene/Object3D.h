@@ -1,6 +1,7 @@
 #ifndef _SCENE_OBJECT3D_H_
 #define _SCENE_OBJECT3D_H_
 
+#include "../Geometry/GeometryManager.h"
 #include "../Utilities/Transforms.h"
 #include "../Utilities/Types.h"
 
@@ -10,11 +11,15 @@
 class Geometry;
 class Material;
 class Scene;
+struct Ray;
+struct RaycastHit;
+struct TriangleHit;
 
 class Object3D
 {
     Object3D* m_parent;
     Geometry* m_geometry;
+    GeometryHandle m_pendingGeometry;
     Material* m_material;
 	Material* m_normalMaterial;
     Transform m_transformation;
@@ -44,13 +49,32 @@ public:
 
     void setScene(const Scene* scene);
     void setParent(Object3D* parent);
+    const Object3D* getParent() const;
     void setTransform(const Transform& t);
 
     void addChildren(Object3D* child);
+    const std::vector<Object3D*>& getChildren() const;
+
+    // Geometrie en cours de chargement ; l'objet prend la reference de la poignee
+    // et ne dessine rien tant qu'elle n'est pas prete
+    void setPendingGeometry(GeometryHandle handle);
+    void updateGeometry();
+
     void transformObject(const Transform& t);
+
+    // Boite de la geometrie dans l'espace du monde ; faux sans donnees de selection
+    bool getWorldBounds(Point3<Metre>& boundsMin, Point3<Metre>& boundsMax) const;
+
+    // Intersections du rayon (espace du monde) avec la geometrie de l'objet seul, sans ses
+    // enfants, ajoutees a hits. worldToLocal est l'inverse de getTransform. Avec
+    // nearestOnly, hits ne garde que la plus proche et ray.MaxDistance descend a sa
+    // distance pour ecarter les objets plus loin. triangleHits sert de tampon de travail.
+    void raycast(const Matrix4x4<Real>& worldToLocal, Ray& ray, bool nearestOnly,
+                 std::vector<RaycastHit>& hits, std::vector<TriangleHit>& triangleHits) const;
     
     void render() const;
 	void renderNormals() const;
+	void renderBounds() const;
 };
 
 #endif
@@ -1,10 +1,113 @@
 #include "Scene.h"
 
 #include "Object3D.h"
+#include "Terrain.h"
 #include "../Camera/Camera.h"
 #include "../Curves/Curve.h"
+#include "../Geometry/TriangleBVH.h"
+#include "../Geometry/GeometryManager.h"
 #include "../Light/Lights.h"
 #include "../Material/Material.h"
+#include "../Utilities/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+    // Noms des uniformes de chaque lumiere, construits une seule fois par indice :
+    // Scene::bind est appele a chaque dessin et ne doit pas allouer de chaines.
+    struct PointLightUniforms
+    {
+        std::string Position;
+        std::string AmbientColor;
+        std::string DiffuseColor;
+        std::string SpecularColor;
+        std::string Constant;
+        std::string Linear;
+        std::string Quadratic;
+    };
+
+    struct DirectionalLightUniforms
+    {
+        std::string Direction;
+        std::string AmbientColor;
+        std::string DiffuseColor;
+        std::string SpecularColor;
+    };
+
+    struct SpotLightUniforms
+    {
+        std::string Position;
+        std::string Direction;
+        std::string AmbientColor;
+        std::string DiffuseColor;
+        std::string SpecularColor;
+        std::string CosAngle;
+    };
+
+    std::string LightPrefix(const char* array, size_t index)
+    {
+        return std::string(array) + "[" + std::to_string(index) + "].";
+    }
+
+    const PointLightUniforms& GetPointLightUniforms(uint32 index)
+    {
+        static std::vector<PointLightUniforms> s_uniforms;
+        while (s_uniforms.size() <= index)
+        {
+            std::string prefix = LightPrefix("pointLights", s_uniforms.size());
+            s_uniforms.push_back({ prefix + "position", prefix + "ambientColor", prefix + "diffuseColor", prefix + "specularColor",
+                                   prefix + "constant", prefix + "linear", prefix + "quadratic" });
+        }
+        return s_uniforms[index];
+    }
+
+    const DirectionalLightUniforms& GetDirectionalLightUniforms(uint32 index)
+    {
+        static std::vector<DirectionalLightUniforms> s_uniforms;
+        while (s_uniforms.size() <= index)
+        {
+            std::string prefix = LightPrefix("directionalLights", s_uniforms.size());
+            s_uniforms.push_back({ prefix + "direction", prefix + "ambientColor", prefix + "diffuseColor", prefix + "specularColor" });
+        }
+        return s_uniforms[index];
+    }
+
+    const SpotLightUniforms& GetSpotLightUniforms(uint32 index)
+    {
+        static std::vector<SpotLightUniforms> s_uniforms;
+        while (s_uniforms.size() <= index)
+        {
+            std::string prefix = LightPrefix("spotLights", s_uniforms.size());
+            s_uniforms.push_back({ prefix + "position", prefix + "direction", prefix + "ambientColor", prefix + "diffuseColor",
+                                   prefix + "specularColor", prefix + "cosAngle" });
+        }
+        return s_uniforms[index];
+    }
+
+    // Rayon de l'espace du monde a direction normalisee ; faux si la direction est nulle
+    bool MakeWorldRay(const Point3<Metre>& origin, const Vector3<Real>& direction, Metre maxDistance, Ray& ray)
+    {
+        float d[3] = { (float)direction.x(), (float)direction.y(), (float)direction.z() };
+        float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        if (length <= 0.0f)
+        {
+            return false;
+        }
+
+        ray.Origin[0] = (float)origin.x();
+        ray.Origin[1] = (float)origin.y();
+        ray.Origin[2] = (float)origin.z();
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            ray.Direction[i] = d[i] / length;
+        }
+        ray.MaxDistance = (float)maxDistance;
+        return true;
+    }
+}
 
 Scene::Scene()
     : m_ambientColor(ColorRGB::Black())
@@ -12,6 +115,7 @@ Scene::Scene()
 	, m_currentSelectedObject(0)
 	, m_showLights(true)
 	, m_sceneMaterial(nullptr)
+	, m_completedGeometryLoads(0)
 {
     m_camera.reset();
 }
@@ -33,9 +137,15 @@ Scene::~Scene()
 		delete obj;
 	}
 
+	for (Terrain* terrain : m_terrains)
+	{
+		delete terrain;
+	}
+
 	m_objects.clear();
 	m_lights.clear();
 	m_curves.clear();
+	m_terrains.clear();
 
 	if (m_sceneMaterial != nullptr)
 	{
@@ -59,6 +169,7 @@ void Scene::addObject(Object3D* obj)
     {
         m_objects.push_back(obj);
         obj->setScene(this);
+        m_raycastBVH.invalidate(false);
     }
 }
 
@@ -71,6 +182,15 @@ void Scene::addLight(LightObject* light)
     }
 }
 
+void Scene::addTerrain(Terrain* terrain)
+{
+    if (terrain != nullptr)
+    {
+        m_terrains.push_back(terrain);
+        terrain->setScene(this);
+    }
+}
+
 uint32 Scene::getNbObjects() const
 {
 	return (uint32)m_objects.size();
@@ -97,6 +217,88 @@ void Scene::changeSelectedObject(int delta)
 	m_currentSelectedObject = nextSelected % getNbObjects();
 }
 
+bool Scene::selectObject(const Object3D* object)
+{
+	if (object == nullptr)
+	{
+		return false;
+	}
+
+	while (object->getParent() != nullptr)
+	{
+		object = object->getParent();
+	}
+
+	auto it = std::find(m_objects.begin(), m_objects.end(), object);
+	if (it == m_objects.end())
+	{
+		return false;
+	}
+	m_currentSelectedObject = (uint32)(it - m_objects.begin());
+	return true;
+}
+
+bool Scene::raycast(const Point3<Metre>& origin, const Vector3<Real>& direction, RaycastHit& hit, Metre maxDistance) const
+{
+    Ray ray;
+    if (!MakeWorldRay(origin, direction, maxDistance, ray))
+    {
+        return false;
+    }
+
+    PROFILE_SCOPE("Scene::raycast");
+    m_raycastBVH.update(m_objects);
+    m_raycastHits.clear();
+    m_raycastBVH.raycast(ray, true, m_raycastHits);
+    if (m_raycastHits.empty())
+    {
+        return false;
+    }
+    hit = m_raycastHits.front();
+    return true;
+}
+
+void Scene::raycastAll(const Point3<Metre>& origin, const Vector3<Real>& direction, std::vector<RaycastHit>& hits, Metre maxDistance) const
+{
+    hits.clear();
+    Ray ray;
+    if (!MakeWorldRay(origin, direction, maxDistance, ray))
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("Scene::raycastAll");
+    m_raycastBVH.update(m_objects);
+    m_raycastBVH.raycast(ray, false, hits);
+    std::sort(hits.begin(), hits.end(), [](const RaycastHit& a, const RaycastHit& b)
+    {
+        return a.Distance < b.Distance;
+    });
+}
+
+void Scene::invalidateRaycastBVH(bool transformsOnly) const
+{
+    m_raycastBVH.invalidate(transformsOnly);
+}
+
+void Scene::getViewRay(float x, float y, Point3<Metre>& origin, Vector3<Real>& direction) const
+{
+    // Points du plan proche et du plan lointain sous le pixel, ramenes dans l'espace du monde
+    float ndcX = x * 2.0f - 1.0f;
+    float ndcY = 1.0f - y * 2.0f;
+    auto inverseProjection = m_camera.getPerspective().inverse();
+    auto inverseView = m_camera.getView().inverse();
+    Point3<Real> nearView = Point3<Real>(inverseProjection * Point3<Real>(Real(ndcX), Real(ndcY), Real(-1.0f)));
+    Point3<Real> farView = Point3<Real>(inverseProjection * Point3<Real>(Real(ndcX), Real(ndcY), Real(1.0f)));
+    Point3<Real> nearWorld = Point3<Real>(inverseView * nearView);
+    Point3<Real> farWorld = Point3<Real>(inverseView * farView);
+
+    origin = Point3<Metre>(Metre((float)nearWorld.x()), Metre((float)nearWorld.y()), Metre((float)nearWorld.z()));
+    direction = Vector3<Real>(Real((float)farWorld.x() - (float)nearWorld.x()),
+                              Real((float)farWorld.y() - (float)nearWorld.y()),
+                              Real((float)farWorld.z() - (float)nearWorld.z()));
+}
+
 bool Scene::lightsVisible() const
 {
 	return m_showLights;
@@ -125,6 +327,7 @@ void Scene::setAmbientPower(const Vector3<Real>& p)
 void Scene::setSceneTransform(const Transform& t)
 {
 	m_sceneTransform = t;
+	m_raycastBVH.invalidate(true);
 }
 
 const Transform& Scene::getSceneTransform() const
@@ -147,6 +350,11 @@ Camera& Scene::getCamera()
     return m_camera;
 }
 
+const Camera& Scene::getCamera() const
+{
+    return m_camera;
+}
+
 const ColorRGB& Scene::getAmbientColor() const
 {
     return m_ambientColor;
@@ -164,6 +372,7 @@ const std::vector<LightObject*>& Scene::getLights() const
 
 void Scene::bind(const Material& m) const
 {
+    PROFILE_SCOPE("Scene::bind");
     if (m.isInitialized())
     {
         m.setMat4("gProjectionMatrix", m_camera.getPerspective());
@@ -175,45 +384,46 @@ void Scene::bind(const Material& m) const
             m.setColor("ambientColor", getAmbientColor());
             m.setVec3("ambientPower", getAmbientPower());
 
-            const std::vector<LightObject*> lights = getLights();
+            const std::vector<LightObject*>& lights = getLights();
             uint32 dirCount = 0;
             uint32 pointCount = 0;
             uint32 spotCount = 0;
+            RenderCounters::Current().LightsEvaluated += (uint32)lights.size();
             for (const LightObject* l : lights)
             {
                 if (l->getType() == LightType::Point)
                 {
-                    std::string noLight = std::to_string(pointCount);
+                    const PointLightUniforms& names = GetPointLightUniforms(pointCount);
                     const PointLight* pLight = static_cast<const PointLight*>(l);
-                    m.setVec3(("pointLights[" + noLight + "].position").c_str(), getSceneTransform() * pLight->getPosition());
-                    m.setColor(("pointLights[" + noLight + "].ambientColor").c_str(), pLight->getAmbientColor());
-                    m.setColor(("pointLights[" + noLight + "].diffuseColor").c_str(), pLight->getDiffuseColor());
-                    m.setColor(("pointLights[" + noLight + "].specularColor").c_str(), pLight->getSpecularColor());
-                    m.setFloat(("pointLights[" + noLight + "].constant").c_str(), pLight->getConstantAttenuationCoefficient());
-                    m.setFloat(("pointLights[" + noLight + "].linear").c_str(), pLight->getLinearAttenuationCoefficient());
-                    m.setFloat(("pointLights[" + noLight + "].quadratic").c_str(), pLight->getQuadraticAttenuationCoefficient());
+                    m.setVec3(names.Position.c_str(), getSceneTransform() * pLight->getPosition());
+                    m.setColor(names.AmbientColor.c_str(), pLight->getAmbientColor());
+                    m.setColor(names.DiffuseColor.c_str(), pLight->getDiffuseColor());
+                    m.setColor(names.SpecularColor.c_str(), pLight->getSpecularColor());
+                    m.setFloat(names.Constant.c_str(), pLight->getConstantAttenuationCoefficient());
+                    m.setFloat(names.Linear.c_str(), pLight->getLinearAttenuationCoefficient());
+                    m.setFloat(names.Quadratic.c_str(), pLight->getQuadraticAttenuationCoefficient());
                     ++pointCount;
                 }
                 else if (l->getType() == LightType::Directional)
                 {
-                    std::string noLight = std::to_string(dirCount);
+                    const DirectionalLightUniforms& names = GetDirectionalLightUniforms(dirCount);
                     const DirectionalLight* dLight = static_cast<const DirectionalLight*>(l);
-                    m.setVec3(("directionalLights[" + noLight + "].direction").c_str(), getSceneTransform() * dLight->getDirection());
-                    m.setColor(("directionalLights[" + noLight + "].ambientColor").c_str(), dLight->getAmbientColor());
-                    m.setColor(("directionalLights[" + noLight + "].diffuseColor").c_str(), dLight->getDiffuseColor());
-                    m.setColor(("directionalLights[" + noLight + "].specularColor").c_str(), dLight->getSpecularColor());
+                    m.setVec3(names.Direction.c_str(), getSceneTransform() * dLight->getDirection());
+                    m.setColor(names.AmbientColor.c_str(), dLight->getAmbientColor());
+                    m.setColor(names.DiffuseColor.c_str(), dLight->getDiffuseColor());
+                    m.setColor(names.SpecularColor.c_str(), dLight->getSpecularColor());
                     ++dirCount;
                 }
                 else if (l->getType() == LightType::Spot)
                 {
-                    std::string noLight = std::to_string(spotCount);
+                    const SpotLightUniforms& names = GetSpotLightUniforms(spotCount);
                     const SpotLight* sLight = static_cast<const SpotLight*>(l);
-                    m.setVec3(("spotLights[" + noLight + "].position").c_str(), getSceneTransform() * sLight->getPosition());
-                    m.setVec3(("spotLights[" + noLight + "].direction").c_str(), getSceneTransform() * sLight->getDirection());
-                    m.setColor(("spotLights[" + noLight + "].ambientColor").c_str(), sLight->getAmbientColor());
-                    m.setColor(("spotLights[" + noLight + "].diffuseColor").c_str(), sLight->getDiffuseColor());
-                    m.setColor(("spotLights[" + noLight + "].specularColor").c_str(), sLight->getSpecularColor());
-                    m.setFloat(("spotLights[" + noLight + "].cosAngle").c_str(), sLight->getCosAngle());
+                    m.setVec3(names.Position.c_str(), getSceneTransform() * sLight->getPosition());
+                    m.setVec3(names.Direction.c_str(), getSceneTransform() * sLight->getDirection());
+                    m.setColor(names.AmbientColor.c_str(), sLight->getAmbientColor());
+                    m.setColor(names.DiffuseColor.c_str(), sLight->getDiffuseColor());
+                    m.setColor(names.SpecularColor.c_str(), sLight->getSpecularColor());
+                    m.setFloat(names.CosAngle.c_str(), sLight->getCosAngle());
                     ++spotCount;
                 }
             }
@@ -234,8 +444,31 @@ void Scene::bindNormals(const Material& m) const
 	}
 }
 
+void Scene::update()
+{
+	// Les objets ne sont parcourus que si un chargement s'est termine entre-temps
+	GeometryManager* geometries = GeometryManager::GetInstance();
+	uint32 completedLoads = geometries != nullptr ? geometries->getCompletedLoadCount() : 0;
+	if (completedLoads != m_completedGeometryLoads)
+	{
+		m_completedGeometryLoads = completedLoads;
+		for (Object3D* obj : m_objects)
+		{
+			obj->updateGeometry();
+		}
+	}
+
+	for (Terrain* terrain : m_terrains)
+	{
+		terrain->update();
+	}
+}
+
 void Scene::render() const
 {
+	PROFILE_SCOPE("Scene::render");
+	PROFILE_GPU_SCOPE("Scene::render");
+
 	if (m_showLights)
 	{
 		for (LightObject* obj : m_lights)
@@ -244,6 +477,11 @@ void Scene::render() const
 		}
 	}
 
+    for (Terrain* terrain : m_terrains)
+    {
+        terrain->render();
+    }
+
     for (Object3D* obj : m_objects)
     {
         obj->render();
@@ -261,4 +499,17 @@ void Scene::renderNormals() const
 	{
 		obj->renderNormals();
 	}
+}
+
+void Scene::renderBounds() const
+{
+	for (Object3D* obj : m_objects)
+	{
+		obj->renderBounds();
+	}
+
+	for (Terrain* terrain : m_terrains)
+	{
+		terrain->renderBounds();
+	}
 }
\ No newline at end of file
@@ -1,18 +1,34 @@
 #ifndef _SCENE_SCENE_H_
 #define _SCENE_SCENE_H_
 
+#include "SceneBVH.h"
 #include "../Camera/Camera.h"
 #include "../Utilities/Color.h"
+#include "../Utilities/Point.h"
 #include "../Utilities/Transforms.h"
 #include "../Utilities/Types.h"
+#include "../Utilities/Units.h"
 #include "../Utilities/Vectors.h"
 
+#include <limits>
 #include <vector>
 
 class BaseCurve;
 class LightObject;
 class Material;
 class Object3D;
+class Terrain;
+
+// Intersection d'un rayon avec la geometrie d'un objet de la scene
+struct RaycastHit
+{
+    const Object3D* Object;     // Objet touche, eventuellement un enfant
+    uint32 Triangle;            // Indice du triangle dans Geometry::getIndices de l'objet
+    Metre Distance;             // Depuis l'origine du rayon
+    float U;                    // Coordonnees barycentriques du point : (1 - U - V, U, V)
+    float V;
+    Point3<Metre> Position;     // Espace du monde
+};
 
 class Scene
 {
@@ -20,6 +36,7 @@ private:
     std::vector<BaseCurve*> m_curves;
     std::vector<Object3D*> m_objects;
     std::vector<LightObject*> m_lights;
+    std::vector<Terrain*> m_terrains;
 
     Camera m_camera;
     ColorRGB m_ambientColor;
@@ -30,6 +47,14 @@ private:
 	uint32 m_currentSelectedObject = 0;
 	bool m_showLights;
 
+	// Valeur de GeometryManager::getCompletedLoadCount lors du dernier update
+	uint32 m_completedGeometryLoads;
+
+	// Premier niveau des requetes de rayon, mis a jour a la requete suivante une fois
+	// invalide, et resultats de raycast gardes d'un appel a l'autre
+	mutable SceneBVH m_raycastBVH;
+	mutable std::vector<RaycastHit> m_raycastHits;
+
 public:
     Scene();
     ~Scene();
@@ -40,11 +65,34 @@ public:
     void addCurve(BaseCurve* curve);
     void addObject(Object3D* obj);
     void addLight(LightObject* light);
+    void addTerrain(Terrain* terrain);
 
 	uint32 getNbObjects() const;
 
 	Object3D* getCurrentSelectedObject() const;
 	void changeSelectedObject(int delta);
+	// Selectionne l'objet de premier niveau qui contient object ; faux s'il n'est pas dans la scene
+	bool selectObject(const Object3D* object);
+
+    // Requetes de rayon dans l'espace du monde. Deux niveaux : une hierarchie sur les
+    // boites du monde des objets (SceneBVH), puis, pour chaque objet atteint, le rayon
+    // ramene dans son espace et la hierarchie des triangles de sa geometrie (TriangleBVH,
+    // construite a la premiere requete qui atteint sa boite). La direction est
+    // normalisee : les distances sont en metres. Les geometries sans donnees de
+    // selection (GpuOnly) et les terrains sont ignores. Thread GL seulement.
+    bool raycast(const Point3<Metre>& origin, const Vector3<Real>& direction, RaycastHit& hit,
+                 Metre maxDistance = Metre(std::numeric_limits<float>::max())) const;
+    // Remplace le contenu de hits par toutes les intersections, de la plus proche a la plus loin
+    void raycastAll(const Point3<Metre>& origin, const Vector3<Real>& direction, std::vector<RaycastHit>& hits,
+                    Metre maxDistance = Metre(std::numeric_limits<float>::max())) const;
+
+    // Appele par les objets quand leur transformation (transformsOnly) ou leur contenu
+    // change. A appeler aussi apres avoir modifie les sommets d'une geometrie de la scene.
+    void invalidateRaycastBVH(bool transformsOnly) const;
+
+    // Rayon de la camera passant par un point de l'image, x et y dans [0, 1] depuis
+    // le coin superieur gauche
+    void getViewRay(float x, float y, Point3<Metre>& origin, Vector3<Real>& direction) const;
 
 	bool lightsVisible() const;
 	void showLights(bool show);
@@ -59,14 +107,21 @@ public:
 	const Material* getSceneMaterial() const;
 
     Camera& getCamera();
+    const Camera& getCamera() const;
     const ColorRGB& getAmbientColor() const;
     const Vector3<Real>& getAmbientPower() const;
     const std::vector<LightObject*>& getLights() const;
 
+    // Attache aux objets les geometries chargees en arriere-plan et met a jour les
+    // tuiles des terrains. A appeler a chaque image, apres
+    // GeometryManager::processLoadedGeometries et avant UploadQueue::Process.
+    void update();
+
     void bind(const Material& m) const;
 	void bindNormals(const Material& m) const;
     void render() const;
 	void renderNormals() const;
+	void renderBounds() const;
 };
 
 #endif
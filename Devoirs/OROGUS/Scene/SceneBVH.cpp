@@ -0,0 +1,272 @@
+#include "SceneBVH.h"
+
+#include "Object3D.h"
+#include "Scene.h"
+#include "../Utilities/Profiler.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const uint32 MAX_LEAF_OBJECTS = 2;
+
+    // Coupe a la mediane : profondeur au plus log2(objets) + 1
+    const uint32 STACK_SIZE = 64;
+
+    // Entree dans la boite le long du rayon ; faux si le rayon la manque avant MaxDistance
+    bool IntersectBox(const Ray& ray, const float inverseDirection[3], const float minimum[3], const float maximum[3], float& entry)
+    {
+        entry = 0.0f;
+        float exit = ray.MaxDistance;
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            if (ray.Direction[axis] == 0.0f)
+            {
+                if (ray.Origin[axis] < minimum[axis] || ray.Origin[axis] > maximum[axis])
+                {
+                    return false;
+                }
+                continue;
+            }
+            float t0 = (minimum[axis] - ray.Origin[axis]) * inverseDirection[axis];
+            float t1 = (maximum[axis] - ray.Origin[axis]) * inverseDirection[axis];
+            entry = std::max(entry, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+        }
+        return entry <= exit;
+    }
+}
+
+SceneBVH::SceneBVH()
+    : m_rebuild(true)
+    , m_refit(true)
+{
+}
+
+void SceneBVH::invalidate(bool transformsOnly)
+{
+    m_rebuild = m_rebuild || !transformsOnly;
+    m_refit = true;
+}
+
+void SceneBVH::update(const std::vector<Object3D*>& objects)
+{
+    if (m_rebuild)
+    {
+        PROFILE_SCOPE("SceneBVH::build");
+        m_entries.clear();
+        m_nodes.clear();
+        for (const Object3D* object : objects)
+        {
+            collect(*object);
+        }
+
+        // Les boites des entrees servent a choisir les coupes
+        refit();
+        if (!m_entries.empty())
+        {
+            m_nodes.reserve(m_entries.size() * 2);
+            buildNode(0, (uint32)m_entries.size());
+        }
+        m_rebuild = false;
+        m_refit = true;
+    }
+
+    if (m_refit)
+    {
+        PROFILE_SCOPE("SceneBVH::refit");
+        refit();
+        m_refit = false;
+    }
+}
+
+void SceneBVH::collect(const Object3D& object)
+{
+    Point3<Metre> boundsMin;
+    Point3<Metre> boundsMax;
+    if (object.getWorldBounds(boundsMin, boundsMax))
+    {
+        m_entries.push_back({ &object });
+    }
+
+    for (const Object3D* child : object.getChildren())
+    {
+        collect(*child);
+    }
+}
+
+uint32 SceneBVH::buildNode(uint32 first, uint32 count)
+{
+    uint32 index = (uint32)m_nodes.size();
+    m_nodes.push_back(Node());
+    if (count <= MAX_LEAF_OBJECTS)
+    {
+        m_nodes[index].First = first;
+        m_nodes[index].Count = count;
+        return index;
+    }
+
+    // Axe le plus etendu des centres, coupe a la mediane
+    float centerMin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float centerMax[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for (uint32 i = first; i < first + count; ++i)
+    {
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            float center = m_entries[i].Min[axis] + m_entries[i].Max[axis];
+            centerMin[axis] = std::min(centerMin[axis], center);
+            centerMax[axis] = std::max(centerMax[axis], center);
+        }
+    }
+    uint32 axis = 0;
+    for (uint32 a = 1; a < 3; ++a)
+    {
+        if (centerMax[a] - centerMin[a] > centerMax[axis] - centerMin[axis])
+        {
+            axis = a;
+        }
+    }
+
+    uint32 middle = first + count / 2;
+    std::nth_element(m_entries.begin() + first, m_entries.begin() + middle, m_entries.begin() + first + count,
+                     [axis](const Entry& a, const Entry& b) { return a.Min[axis] + a.Max[axis] < b.Min[axis] + b.Max[axis]; });
+
+    buildNode(first, middle - first);
+    uint32 right = buildNode(middle, first + count - middle);
+    m_nodes[index].First = right;
+    m_nodes[index].Count = 0;
+    return index;
+}
+
+void SceneBVH::refit()
+{
+    for (Entry& entry : m_entries)
+    {
+        Point3<Metre> boundsMin;
+        Point3<Metre> boundsMax;
+        if (entry.Object->getWorldBounds(boundsMin, boundsMax))
+        {
+            entry.WorldToLocal = entry.Object->getTransform().inverse();
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                entry.Min[axis] = (float)boundsMin[axis];
+                entry.Max[axis] = (float)boundsMax[axis];
+            }
+        }
+        else
+        {
+            // Donnees de selection liberees depuis la construction : boite vide
+            std::fill(entry.Min, entry.Min + 3, std::numeric_limits<float>::max());
+            std::fill(entry.Max, entry.Max + 3, -std::numeric_limits<float>::max());
+        }
+    }
+
+    // Les enfants suivent toujours leur parent dans m_nodes
+    for (uint32 i = (uint32)m_nodes.size(); i-- > 0;)
+    {
+        Node& node = m_nodes[i];
+        std::fill(node.Min, node.Min + 3, std::numeric_limits<float>::max());
+        std::fill(node.Max, node.Max + 3, -std::numeric_limits<float>::max());
+
+        auto grow = [&node](const float minimum[3], const float maximum[3])
+        {
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                node.Min[axis] = std::min(node.Min[axis], minimum[axis]);
+                node.Max[axis] = std::max(node.Max[axis], maximum[axis]);
+            }
+        };
+
+        if (node.Count > 0)
+        {
+            for (uint32 e = node.First; e < node.First + node.Count; ++e)
+            {
+                grow(m_entries[e].Min, m_entries[e].Max);
+            }
+        }
+        else
+        {
+            grow(m_nodes[i + 1].Min, m_nodes[i + 1].Max);
+            grow(m_nodes[node.First].Min, m_nodes[node.First].Max);
+        }
+    }
+}
+
+void SceneBVH::raycast(Ray& ray, bool nearestOnly, std::vector<RaycastHit>& hits)
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    float inverseDirection[3];
+    for (uint32 axis = 0; axis < 3; ++axis)
+    {
+        inverseDirection[axis] = ray.Direction[axis] != 0.0f ? 1.0f / ray.Direction[axis] : 0.0f;
+    }
+
+    uint32 stack[STACK_SIZE];
+    uint32 stackSize = 0;
+    uint32 current = 0;
+    float entry = 0.0f;
+    if (!IntersectBox(ray, inverseDirection, m_nodes[0].Min, m_nodes[0].Max, entry))
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        const Node& node = m_nodes[current];
+        if (node.Count > 0)
+        {
+            for (uint32 e = node.First; e < node.First + node.Count; ++e)
+            {
+                float objectEntry;
+                if (IntersectBox(ray, inverseDirection, m_entries[e].Min, m_entries[e].Max, objectEntry))
+                {
+                    m_entries[e].Object->raycast(m_entries[e].WorldToLocal, ray, nearestOnly, hits, m_triangleHits);
+                }
+            }
+        }
+        else
+        {
+            // Le plus proche d'abord : avec nearestOnly, ray.MaxDistance peut ecarter l'autre
+            uint32 left = current + 1;
+            uint32 right = node.First;
+            float leftEntry;
+            float rightEntry;
+            bool hitLeft = IntersectBox(ray, inverseDirection, m_nodes[left].Min, m_nodes[left].Max, leftEntry);
+            bool hitRight = IntersectBox(ray, inverseDirection, m_nodes[right].Min, m_nodes[right].Max, rightEntry);
+            if (hitLeft && hitRight)
+            {
+                bool leftFirst = leftEntry <= rightEntry;
+                stack[stackSize++] = leftFirst ? right : left;
+                current = leftFirst ? left : right;
+                continue;
+            }
+            if (hitLeft || hitRight)
+            {
+                current = hitLeft ? left : right;
+                continue;
+            }
+        }
+
+        // Noeud suivant sur la pile, s'il reste atteignable apres les intersections trouvees
+        bool found = false;
+        while (stackSize > 0 && !found)
+        {
+            current = stack[--stackSize];
+            found = IntersectBox(ray, inverseDirection, m_nodes[current].Min, m_nodes[current].Max, entry);
+        }
+        if (!found)
+        {
+            return;
+        }
+    }
+}
+
+uint32 SceneBVH::getObjectCount() const
+{
+    return (uint32)m_entries.size();
+}
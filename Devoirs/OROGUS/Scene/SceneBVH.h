@@ -0,0 +1,63 @@
+#ifndef _SCENE_SCENEBVH_H_
+#define _SCENE_SCENEBVH_H_
+
+#include "../Geometry/TriangleBVH.h"
+#include "../Utilities/Matrices.h"
+#include "../Utilities/Types.h"
+
+#include <vector>
+
+class Object3D;
+struct RaycastHit;
+
+// Premier niveau des requetes de rayon de la scene : hierarchie binaire sur les boites,
+// dans l'espace du monde, des objets (enfants compris) qui ont des donnees de selection.
+// L'arbre est reconstruit quand des objets ou des geometries s'ajoutent, et seulement
+// reajuste (boites recalculees, meme arbre) quand des transformations changent.
+class SceneBVH
+{
+private:
+    struct Entry
+    {
+        const Object3D* Object;
+        Matrix4x4<Real> WorldToLocal;   // Inverse de Object3D::getTransform
+        float Min[3];
+        float Max[3];
+    };
+
+    // Feuille si Count > 0 : entrees [First, First + Count). Sinon l'enfant gauche
+    // suit le noeud et First est l'indice de l'enfant droit.
+    struct Node
+    {
+        float Min[3];
+        float Max[3];
+        uint32 First;
+        uint32 Count;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<Node> m_nodes;
+    std::vector<TriangleHit> m_triangleHits;    // Tampon des requetes, garde entre les appels
+    bool m_rebuild;
+    bool m_refit;
+
+    void collect(const Object3D& object);
+    uint32 buildNode(uint32 first, uint32 count);
+    void refit();
+
+public:
+    SceneBVH();
+
+    // transformsOnly : les memes objets ont bouge, l'arbre est seulement reajuste
+    void invalidate(bool transformsOnly);
+
+    // Reconstruit ou reajuste l'arbre s'il a ete invalide. Avant chaque requete.
+    void update(const std::vector<Object3D*>& objects);
+
+    // Meme contrat que Object3D::raycast, pour tous les objets de la hierarchie
+    void raycast(Ray& ray, bool nearestOnly, std::vector<RaycastHit>& hits);
+
+    uint32 getObjectCount() const;
+};
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "Object3D.h"
 #include "Scene.h"
+#include "Terrain.h"
 
 #include "../Curves/Curve.h"
 #include "../Geometry/Geometry.h"
@@ -16,15 +17,40 @@
 #include "../Texture/Texture.h"
 #include "../Texture/TextureManager.h"
 #include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
 #include "../Utilities/StringUtilities.h"
 #include "../Utilities/Transforms.h"
 #include "../Utilities/Types.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
+namespace
+{
+    // Parametres d'une forme suivis de sa couleur, pour GeometryManager::MakeShapeKey
+    std::vector<float> ShapeParameters(const std::vector<float>& values, const Color* color)
+    {
+        std::vector<float> parameters = values;
+        parameters.insert(parameters.end(), { color->r(), color->g(), color->b(), color->a() });
+        return parameters;
+    }
+}
+
+struct SceneLoader::StaticBatch
+{
+    std::string MaterialKey;    // Texte XML du materiel, vide pour le materiel de la scene
+    const tinyxml2::XMLElement* MaterialElement;
+    VertexFormat Format;
+    Color GeometryColor;
+    std::vector<Geometry*> Parts;
+    std::vector<Transform> Transforms;
+};
+
 Scene* SceneLoader::LoadScene(const std::string& path, const std::string& sceneFile)
 {
+    PROFILE_SCOPE("SceneLoader::LoadScene");
+
     Scene* loadedScene = nullptr;
 
     tinyxml2::XMLDocument document;
@@ -45,9 +71,18 @@ Scene* SceneLoader::LoadScene(const std::string& path, const std::string& sceneF
     {
         loadedScene = new Scene();
 
+        // Les formats compacts perdent de la precision : seulement sur demande de la scene
+        VertexFormat::Default() = VertexFormat::Full();
+
         const tinyxml2::XMLElement* propertiesElement = sceneElement->FirstChildElement("properties");
         if (propertiesElement != nullptr)
         {
+            const tinyxml2::XMLElement* vertexFormatElement = propertiesElement->FirstChildElement("vertexFormat");
+            if (vertexFormatElement != nullptr && !VertexFormat::FromName(vertexFormatElement->Attribute("value"), VertexFormat::Default()))
+            {
+                Log() << "--Erreur : Format de sommets inconnu, full est utilise" << std::endl;
+            }
+
             const tinyxml2::XMLElement* cameraElement = propertiesElement->FirstChildElement("camera");
             if (cameraElement != nullptr)
             {
@@ -86,13 +121,33 @@ Scene* SceneLoader::LoadScene(const std::string& path, const std::string& sceneF
         const tinyxml2::XMLElement* objectsElement = sceneElement->FirstChildElement("objects");
         if (objectsElement != nullptr)
         {
+            std::vector<StaticBatch> staticBatches;
             const tinyxml2::XMLElement* objElement = objectsElement->FirstChildElement("object");
             while (objElement != nullptr)
             {
-                loadedScene->addObject(LoadObject(path, objElement));
+                if (!objElement->BoolAttribute("statique", false) || !AddStaticObject(path, objElement, staticBatches))
+                {
+                    loadedScene->addObject(LoadObject(path, objElement));
+                }
                 objElement = objElement->NextSiblingElement("object");
             }
+
+            for (uint32 i = 0; i < staticBatches.size(); ++i)
+            {
+                loadedScene->addObject(CreateStaticBatch(path, staticBatches[i], i));
+            }
         }
+        const tinyxml2::XMLElement* terrainsElement = sceneElement->FirstChildElement("terrains");
+        if (terrainsElement != nullptr)
+        {
+            const tinyxml2::XMLElement* terrainElement = terrainsElement->FirstChildElement("terrain");
+            while (terrainElement != nullptr)
+            {
+                loadedScene->addTerrain(LoadTerrain(path, terrainElement));
+                terrainElement = terrainElement->NextSiblingElement("terrain");
+            }
+        }
+
         const tinyxml2::XMLElement* curvesElement = sceneElement->FirstChildElement("curves");
         if (curvesElement != nullptr)
         {
@@ -295,6 +350,7 @@ Object3D* SceneLoader::LoadObject(const std::string& path, const tinyxml2::XMLEl
 
     Material* objMaterial = nullptr;
     Geometry* objGeom = nullptr;
+    GeometryHandle pendingGeometry;
     Transform objTransform;
 
     if (materialElement != nullptr)
@@ -304,13 +360,18 @@ Object3D* SceneLoader::LoadObject(const std::string& path, const tinyxml2::XMLEl
 
     if (geometryElement != nullptr)
     {
-        objGeom = LoadGeometry(path, geometryElement);
+        // Le materiel est charge d'abord : la geometrie sait ainsi quels flux envoyer
+        objGeom = LoadGeometry(path, geometryElement, pendingGeometry, objMaterial != nullptr ? objMaterial->getAttributeMask() : 0);
     }
 
 	objTransform = LoadTransform(transformElement);
     
     Object3D* obj = new Object3D(objName, objMaterial, objGeom);
     obj->setTransform(objTransform);
+    if (pendingGeometry.isValid())
+    {
+        obj->setPendingGeometry(std::move(pendingGeometry));
+    }
 
     if (childrenElement != nullptr)
     {
@@ -472,11 +533,138 @@ BaseCurve* SceneLoader::LoadCurve(const std::string& path, const tinyxml2::XMLEl
     return curve;
 }
 
-Material* SceneLoader::LoadMaterial(const std::string& path, const tinyxml2::XMLElement* element)
+// <terrain name="..." heightmap="carte.png" size="1024" height="100" patchSize="32"
+//          levels="5" tiles="4" viewDistance="1000">
+//   <material> : seul le fragment shader est lu, le vertex shader est celui du terrain
+//   <transform>
+// </terrain>
+Terrain* SceneLoader::LoadTerrain(const std::string& path, const tinyxml2::XMLElement* element)
 {
+    const char* terrainName = element->Attribute("name");
+    if (terrainName == nullptr)
+        terrainName = "Unknown";
+
+    Log() << "Chargement du terrain " << terrainName << "..." << std::endl;
+
+    Logger::IncIndent();
+
+    const char* heightmap = element->Attribute("heightmap");
+    if (heightmap == nullptr)
+    {
+        Log() << "--Erreur : Le terrain doit specifier une carte de hauteur (heightmap)." << std::endl;
+        Logger::DecIndent();
+        return nullptr;
+    }
+
+    TerrainSettings settings;
+    settings.Size = Metre(element->FloatAttribute("size", (float)settings.Size));
+    settings.Height = Metre(element->FloatAttribute("height", (float)settings.Height));
+    settings.PatchSize = element->UnsignedAttribute("patchSize", settings.PatchSize);
+    settings.LodLevels = element->UnsignedAttribute("levels", settings.LodLevels);
+    settings.Tiles = element->UnsignedAttribute("tiles", settings.Tiles);
+    settings.ViewDistance = Metre(element->FloatAttribute("viewDistance", (float)settings.ViewDistance));
+
+    Material* material = nullptr;
+    const tinyxml2::XMLElement* materialElement = element->FirstChildElement("material");
+    if (materialElement != nullptr)
+    {
+        material = LoadMaterial(path, materialElement, ShaderHelper::LoadEngineTerrainVertexShader());
+    }
+    else
+    {
+        material = new Material(ShaderHelper::LoadEngineTerrainVertexShader(), ShaderHelper::LoadBaseNoLitFragmentShader());
+        material->addColorBinding("uColor", Color::White());
+    }
+
+    Terrain* terrain = new Terrain(terrainName, material, path + heightmap, settings);
+    if (terrain->isValid())
+    {
+        terrain->setTransform(LoadTransform(element->FirstChildElement("transform")));
+    }
+    else
+    {
+        delete terrain;
+        terrain = nullptr;
+    }
+
+    Logger::DecIndent();
+    return terrain;
+}
+
+bool SceneLoader::AddStaticObject(const std::string& path, const tinyxml2::XMLElement* element, std::vector<StaticBatch>& batches)
+{
+    const tinyxml2::XMLElement* geometryElement = element->FirstChildElement("geometry");
+    const char* geometryType = geometryElement != nullptr ? geometryElement->Attribute("type") : nullptr;
+    if (element->FirstChildElement("children") != nullptr || geometryType == nullptr || !StringUtilities::Equals(geometryType, "forme"))
+    {
+        return false;
+    }
+
+    const char* objName = element->Attribute("name");
+    Log() << "Chargement de l'objet statique " << (objName != nullptr ? objName : "Unknown") << "..." << std::endl;
+    Logger::IncIndent();
+
+    GeometryHandle pendingGeometry;
+    // Formes generees seulement : elles gardent leurs sommets, les tangentes restent a la demande
+    Geometry* geometry = LoadGeometry(path, geometryElement, pendingGeometry, 0);
+    if (geometry != nullptr)
+    {
+        // Deux materiels decrits par le meme XML sont identiques
+        std::string materialKey;
+        const tinyxml2::XMLElement* materialElement = element->FirstChildElement("material");
+        if (materialElement != nullptr)
+        {
+            tinyxml2::XMLPrinter printer(nullptr, true);
+            materialElement->Accept(&printer);
+            materialKey = printer.CStr();
+        }
+
+        const VertexFormat& format = geometry->getVertexLayout().getFormat();
+        Color color = geometry->getColor();
+        auto batch = std::find_if(batches.begin(), batches.end(), [&](const StaticBatch& b)
+        {
+            return b.MaterialKey == materialKey && b.Format == format && b.GeometryColor == color;
+        });
+        if (batch == batches.end())
+        {
+            batches.push_back({ materialKey, materialElement, format, color });
+            batch = batches.end() - 1;
+        }
+
+        batch->Parts.push_back(geometry);
+        batch->Transforms.push_back(LoadTransform(element->FirstChildElement("transform")));
+    }
+
+    Logger::DecIndent();
+    return true;
+}
+
+Object3D* SceneLoader::CreateStaticBatch(const std::string& path, StaticBatch& batch, uint32 batchIndex)
+{
+    PROFILE_SCOPE("SceneLoader::CreateStaticBatch");
+
+    std::string name = "Lot statique " + std::to_string(batchIndex);
+    Log() << name << " : " << batch.Parts.size() << " objets fusionnes" << std::endl;
+
+    // Les sommets sont places dans l'espace de la scene : l'objet garde la transformation identite
+    std::vector<const Geometry*> parts(batch.Parts.begin(), batch.Parts.end());
+    Geometry* geometry = Geometry::CreateBatch(name, parts, batch.Transforms);
+    for (Geometry*& part : batch.Parts)
+    {
+        GeometryManager::GetInstance()->unloadGeometry(part);
+    }
+    batch.Parts.clear();
+
+    Material* material = batch.MaterialElement != nullptr ? LoadMaterial(path, batch.MaterialElement) : nullptr;
+    return new Object3D(name, material, geometry);
+}
+
+Material* SceneLoader::LoadMaterial(const std::string& path, const tinyxml2::XMLElement* element, VertexShader* vertexShader)
+{
+    // Avec vertexShader impose, les uniforms de l'element vertexShader sont tout de meme charges
     const tinyxml2::XMLElement* vShaderElement = element->FirstChildElement("vertexShader");
-    VertexShader* vShader = nullptr;
-    if (vShaderElement != nullptr)
+    VertexShader* vShader = vertexShader;
+    if (vShader == nullptr && vShaderElement != nullptr)
     {
         vShader = ShaderManager::GetInstance()->LoadVertexShader(path, vShaderElement->Attribute("name"));
         if (vShader == nullptr)
@@ -486,7 +674,7 @@ Material* SceneLoader::LoadMaterial(const std::string& path, const tinyxml2::XML
             vShader = ShaderHelper::LoadBaseVertexShader();
         }
     }
-    else
+    else if (vShader == nullptr)
     {
         vShader = ShaderHelper::LoadBaseVertexShader();
     }
@@ -589,7 +777,7 @@ void SceneLoader::LoadUniformsForMaterial(const std::string& path, const tinyxml
     }
 }
 
-Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XMLElement* element)
+Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XMLElement* element, GeometryHandle& pendingGeometry, uint32 attributeMask)
 {
     Geometry* objGeom = nullptr;
     if (StringUtilities::Equals(element->Attribute("type"), "forme"))
@@ -602,9 +790,12 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
             const tinyxml2::XMLElement* geomInfo = formeElement->FirstChildElement("color");
             bool colorSpecified = geomInfo != nullptr;
 
+            // Les formes identiques (type, parametres, couleur) partagent une seule geometrie
+            GeometryManager* geometries = GeometryManager::GetInstance();
+
             if (StringUtilities::Equals(formeElement->Attribute("type"), "triangle"))
             {
-                objGeom = GeometryHelper::CreateTriangle();
+                objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("triangle", {}), []() { return GeometryHelper::CreateTriangle(); });
             }
             else if (StringUtilities::Equals(formeElement->Attribute("type"), "cube"))
             {
@@ -625,11 +816,14 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
 
                 if (colorSpecified)
                 {
-                    objGeom = GeometryHelper::CreateBox(width, height, depth, LoadColor(geomInfo));
+                    Color color = LoadColor(geomInfo);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("cube/couleur", ShapeParameters({ (float)width, (float)height, (float)depth }, &color)),
+                                                    [&]() { return GeometryHelper::CreateBox(width, height, depth, color); });
                 }
                 else
                 {
-                    objGeom = GeometryHelper::CreateBox(width, height, depth, repeatX, repeatY);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("cube", { (float)width, (float)height, (float)depth, repeatX, repeatY }),
+                                                    [&]() { return GeometryHelper::CreateBox(width, height, depth, repeatX, repeatY); });
                 }
             }
             else if (StringUtilities::Equals(formeElement->Attribute("type"), "sphere"))
@@ -640,11 +834,14 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
 
                 if (colorSpecified)
                 {
-                    objGeom = GeometryHelper::CreateSphere(radius, slices, stacks, LoadColor(geomInfo));
+                    Color color = LoadColor(geomInfo);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("sphere/couleur", ShapeParameters({ (float)radius, (float)slices, (float)stacks }, &color)),
+                                                    [&]() { return GeometryHelper::CreateSphere(radius, slices, stacks, color); });
                 }
                 else
                 {
-                    objGeom = GeometryHelper::CreateSphere(radius, slices, stacks);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("sphere", { (float)radius, (float)slices, (float)stacks }),
+                                                    [&]() { return GeometryHelper::CreateSphere(radius, slices, stacks); });
                 }
             }
             else if (StringUtilities::Equals(formeElement->Attribute("type"), "cylinder"))
@@ -655,13 +852,17 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
                 uint32 slices = formeElement->UnsignedAttribute("slices", 10);
                 uint32 stacks = formeElement->UnsignedAttribute("stacks", 10);
 
+                std::vector<float> parameters = { (float)topRadius, (float)bottomRadius, (float)height, (float)slices, (float)stacks };
                 if (colorSpecified)
                 {
-                    objGeom = GeometryHelper::CreateCylinder(topRadius, bottomRadius, height, slices, stacks, LoadColor(geomInfo));
+                    Color color = LoadColor(geomInfo);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("cylinder/couleur", ShapeParameters(parameters, &color)),
+                                                    [&]() { return GeometryHelper::CreateCylinder(topRadius, bottomRadius, height, slices, stacks, color); });
                 }
                 else
                 {
-                    objGeom = GeometryHelper::CreateCylinder(topRadius, bottomRadius, height, slices, stacks);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("cylinder", parameters),
+                                                    [&]() { return GeometryHelper::CreateCylinder(topRadius, bottomRadius, height, slices, stacks); });
                 }
             }
             else if (StringUtilities::Equals(formeElement->Attribute("type"), "torus"))
@@ -671,7 +872,9 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
                 uint32 sides = formeElement->UnsignedAttribute("sides", 10);
                 uint32 rings = formeElement->UnsignedAttribute("rings", 10);
 
-                objGeom = GeometryHelper::CreateTorus(radius, ringRadius, sides, rings, &LoadColor(geomInfo));
+                Color color = LoadColor(geomInfo);
+                objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("torus", ShapeParameters({ (float)radius, (float)ringRadius, (float)sides, (float)rings }, &color)),
+                                                [&]() { return GeometryHelper::CreateTorus(radius, ringRadius, sides, rings, &color); });
             }
             else if (StringUtilities::Equals(formeElement->Attribute("type"), "grid"))
             {
@@ -686,11 +889,14 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
 
                 if (colorSpecified)
                 {
-                    objGeom = GeometryHelper::CreateGrid(width, depth, m, n, LoadColor(geomInfo));
+                    Color color = LoadColor(geomInfo);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("grid/couleur", ShapeParameters({ (float)width, (float)depth, (float)m, (float)n }, &color)),
+                                                    [&]() { return GeometryHelper::CreateGrid(width, depth, m, n, color); });
                 }
                 else
                 {
-                    objGeom = GeometryHelper::CreateGrid(width, depth, m, n, repeatX, repeatY);
+                    objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("grid", { (float)width, (float)depth, (float)m, (float)n, repeatX, repeatY }),
+                                                    [&]() { return GeometryHelper::CreateGrid(width, depth, m, n, repeatX, repeatY); });
                 }
             }
 			else if (StringUtilities::Equals(formeElement->Attribute("type"), "revolution"))
@@ -709,7 +915,14 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
 					}
 					if (vertices.size() > 0)
 					{
-						objGeom = GeometryHelper::CreateRevolutionSurface(vertices, precision);
+						std::vector<float> parameters = { (float)precision };
+						for (const Point2<Metre>& p : vertices)
+						{
+							parameters.push_back((float)p.x());
+							parameters.push_back((float)p.y());
+						}
+						objGeom = geometries->loadShape(GeometryManager::MakeShapeKey("revolution", parameters),
+														[&]() { return GeometryHelper::CreateRevolutionSurface(vertices, precision); });
 					}
 					else
 					{
@@ -736,7 +949,26 @@ Geometry* SceneLoader::LoadGeometry(const std::string& path, const tinyxml2::XML
         const tinyxml2::XMLElement* formeElement = element->FirstChildElement("fichier");
         if (formeElement != nullptr)
         {
-            objGeom = GeometryManager::GetInstance()->loadGeometry(formeElement->Attribute("name"));
+            // Memoire centrale gardee apres l'envoi : "complete", "selection" (defaut) ou "gpu"
+            GeometryResidency residency = GeometryResidency::PickingOnly;
+            const char* residence = formeElement->Attribute("residence");
+            if (residence != nullptr && StringUtilities::Equals(residence, "complete"))
+            {
+                residency = GeometryResidency::KeepAll;
+            }
+            else if (residence != nullptr && StringUtilities::Equals(residence, "gpu"))
+            {
+                residency = GeometryResidency::GpuOnly;
+            }
+
+            pendingGeometry = GeometryManager::GetInstance()->loadGeometryAsync(formeElement->Attribute("name"), residency, attributeMask);
+
+            // Deja chargee (partagee avec un autre objet) : inutile d'attendre
+            if (!pendingGeometry.isPending())
+            {
+                objGeom = pendingGeometry.getGeometry();
+                pendingGeometry.reset();
+            }
         }
         else
         {
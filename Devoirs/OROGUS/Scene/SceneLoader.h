@@ -8,24 +8,41 @@
 #include <TinyXML/tinyxml2.h>
 
 #include <string>
+#include <vector>
 
 class BaseCurve;
 class Camera;
 class Geometry;
+class GeometryHandle;
 class LightObject;
 class Material;
 class Object3D;
 class Scene;
+class Terrain;
 class Transform;
+class VertexShader;
 
 class SceneLoader
 {
 private:
+    // Objets statiques regroupes pendant le chargement (voir AddStaticObject)
+    struct StaticBatch;
+
     static void LoadUniformsForMaterial(const std::string& path, const tinyxml2::XMLElement* element, Material& material);
-    static Material* LoadMaterial(const std::string& path, const tinyxml2::XMLElement* element);
-    static Geometry* LoadGeometry(const std::string& path, const tinyxml2::XMLElement* element);
+    // vertexShader remplace celui de l'element (terrains) ; le materiel en prend la reference
+    static Material* LoadMaterial(const std::string& path, const tinyxml2::XMLElement* element, VertexShader* vertexShader = nullptr);
+    // Les fichiers sont charges en arriere-plan : pendingGeometry recoit alors la poignee
+    // et la fonction retourne nullptr tant que la geometrie n'est pas prete
+    // attributeMask : flux lus par le materiel de l'objet (voir GeometryManager::loadGeometryAsync)
+    static Geometry* LoadGeometry(const std::string& path, const tinyxml2::XMLElement* element, GeometryHandle& pendingGeometry, uint32 attributeMask);
     static Object3D* LoadObject(const std::string& path, const tinyxml2::XMLElement* element);
+    // Objet marque statique="true" : sa forme est ajoutee au lot de meme materiel,
+    // couleur et format de sommets. Retourne faux si l'objet ne peut pas etre fusionne
+    // (enfants, fichier charge en arriere-plan) et doit etre charge normalement.
+    static bool AddStaticObject(const std::string& path, const tinyxml2::XMLElement* element, std::vector<StaticBatch>& batches);
+    static Object3D* CreateStaticBatch(const std::string& path, StaticBatch& batch, uint32 batchIndex);
     static BaseCurve* LoadCurve(const std::string& path, const tinyxml2::XMLElement* element);
+    static Terrain* LoadTerrain(const std::string& path, const tinyxml2::XMLElement* element);
     static LightObject* LoadLight(const std::string& path, const tinyxml2::XMLElement* element);
     static Color LoadColor(const tinyxml2::XMLElement* element, const Color& defaultColor);
     static ColorRGB LoadColorRGB(const tinyxml2::XMLElement* element, const ColorRGB& defaultColor);
@@ -0,0 +1,675 @@
+#include <glew/glew.h>
+
+#include "Terrain.h"
+
+#include "DebugDraw.h"
+#include "Scene.h"
+#include "../Camera/Camera.h"
+#include "../Material/Material.h"
+#include "../Render/UploadQueue.h"
+#include "../Texture/Texture.h"
+#include "../Texture/TextureManager.h"
+#include "../Utilities/Color.h"
+#include "../Utilities/Logger.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/RenderStats.h"
+#include "../Utilities/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+    const uint32 INVALID_ATTRIBUTE = (uint32)-1;
+
+    // Doit correspondre a la taille de gTerrainMorph dans EngineTerrainVertexShader
+    const uint32 MAX_LOD_LEVELS = 16;
+    const uint32 MAX_PATCH_SIZE = 128;
+    const uint32 MAX_TILE_TEXELS = 2049;
+
+    // Unite de texture de la carte de hauteur, au-dessus de celles du materiel
+    const uint32 HEIGHTMAP_UNIT = 15;
+
+    // Fraction de l'intervalle d'un niveau ou commence le morphing vers le suivant
+    const float MORPH_START_RATIO = 0.66f;
+
+    // Une tuile residente n'est liberee qu'au-dela de ViewDistance * STREAM_OUT_MARGIN,
+    // pour ne pas la recharger a chaque aller-retour de la camera pres de la limite
+    const float STREAM_OUT_MARGIN = 1.25f;
+
+    const uint32 ROWS_PER_TASK = 64;
+
+    // Tuiles reechantillonnees en meme temps : borne la memoire des hauteurs en attente
+    const uint32 MAX_RESAMPLING_TILES = 2;
+
+    const uint32 NO_TILE = (uint32)-1;
+}
+
+Terrain::Terrain(const std::string& name, Material* material, const std::string& heightmap, const TerrainSettings& settings)
+    : m_name(name)
+    , m_material(material)
+    , m_scene(nullptr)
+    , m_settings(settings)
+    , m_heightmapWidth(0)
+    , m_heightmapHeight(0)
+    , m_tileSize(0.0f)
+    , m_tileTexels(0)
+    , m_vao(0)
+    , m_patchBuffer(0)
+    , m_indexBuffer(0)
+    , m_instanceBuffer(0)
+    , m_patchIndexCount(0)
+    , m_instanceAttribute(INVALID_ATTRIBUTE)
+    , m_resamplingTiles(0)
+    , m_camera{ 0.0f, 0.0f, 0.0f }
+{
+    PROFILE_SCOPE("Terrain::Terrain");
+
+    // La grille doit etre paire pour le morphing et les quarts de grille
+    m_settings.PatchSize = std::min(MAX_PATCH_SIZE, std::max(2u, settings.PatchSize & ~1u));
+    m_settings.LodLevels = std::min(MAX_LOD_LEVELS, std::max(1u, settings.LodLevels));
+    m_settings.Tiles = std::max(1u, settings.Tiles);
+    while (m_settings.LodLevels > 1 && (m_settings.PatchSize << (m_settings.LodLevels - 1)) + 1 > MAX_TILE_TEXELS)
+    {
+        --m_settings.LodLevels;
+    }
+    if (m_settings.LodLevels != settings.LodLevels)
+    {
+        Log() << "--Attention : Terrain " << name << " limite a " << m_settings.LodLevels << " niveaux." << std::endl;
+    }
+
+    Texture2D* image = TextureManager::GetInstance()->loadTexture(heightmap, false);
+    if (image == nullptr)
+    {
+        Log() << "--Erreur : Carte de hauteur " << heightmap << " introuvable." << std::endl;
+        return;
+    }
+
+    // Seul le canal rouge est garde ; les couleurs de l'image sont liberees tout de suite
+    m_heightmapWidth = image->getWidth();
+    m_heightmapHeight = image->getHeight();
+    m_heights.resize((size_t)m_heightmapWidth * m_heightmapHeight);
+    const Color* pixels = image->getData();
+    float height = (float)m_settings.Height;
+    for (size_t i = 0; i < m_heights.size(); ++i)
+    {
+        m_heights[i] = pixels[i].r() * height;
+    }
+    TextureManager::GetInstance()->unloadTexture(image);
+
+    uint32 levels = m_settings.LodLevels;
+    m_tileSize = (float)m_settings.Size / m_settings.Tiles;
+    m_tileTexels = (m_settings.PatchSize << (levels - 1)) + 1;
+
+    uint32 nodeCount = 0;
+    for (uint32 depth = 0; depth < levels; ++depth)
+    {
+        m_levelOffsets.push_back(nodeCount);
+        nodeCount += 1u << (2 * depth);
+    }
+
+    // Le niveau le plus grossier couvre toute la distance de vue, chaque niveau
+    // plus fin la moitie du precedent
+    float previousRange = 0.0f;
+    for (uint32 level = 0; level < levels; ++level)
+    {
+        float range = (float)m_settings.ViewDistance / (float)(1u << (levels - 1 - level));
+        m_lodRanges.push_back(range);
+        m_morphStart.push_back(previousRange + (range - previousRange) * MORPH_START_RATIO);
+        m_morphUniforms.push_back("gTerrainMorph[" + std::to_string(level) + "]");
+        previousRange = range;
+    }
+
+    float halfSize = (float)m_settings.Size / 2;
+    m_tiles.resize(m_settings.Tiles * m_settings.Tiles);
+    for (uint32 z = 0; z < m_settings.Tiles; ++z)
+    {
+        for (uint32 x = 0; x < m_settings.Tiles; ++x)
+        {
+            Tile& tile = m_tiles[z * m_settings.Tiles + x];
+            tile.OriginX = x * m_tileSize - halfSize;
+            tile.OriginZ = z * m_tileSize - halfSize;
+            tile.Bounds.resize(nodeCount);
+            tile.Texture = 0;
+            tile.UploadTicket = 0;
+            tile.Resampling = false;
+        }
+    }
+
+    ThreadPool::ParallelFor((uint32)m_tiles.size(), [this](uint32 i)
+    {
+        computeBounds(m_tiles[i]);
+    });
+
+    buildPatch();
+
+    Log() << "Terrain " << name << " : " << m_tiles.size() << " tuiles de " << m_tileTexels << "x" << m_tileTexels
+          << " texels, " << levels << " niveaux." << std::endl;
+}
+
+Terrain::~Terrain()
+{
+    // Les travaux encore en cours lisent m_heights et ecrivent dans m_resampled
+    {
+        std::unique_lock<std::mutex> lock(m_resampleMutex);
+        m_resampleCondition.wait(lock, [this]() { return m_resampled.size() == m_resamplingTiles; });
+    }
+
+    for (Tile& tile : m_tiles)
+    {
+        streamOut(tile);
+    }
+
+    if (m_vao != 0)
+    {
+        glDeleteBuffers(1, &m_patchBuffer);
+        glDeleteBuffers(1, &m_indexBuffer);
+        glDeleteBuffers(1, &m_instanceBuffer);
+        glDeleteVertexArrays(1, &m_vao);
+    }
+
+    if (m_material != nullptr)
+    {
+        delete m_material;
+        m_material = nullptr;
+    }
+}
+
+const std::string& Terrain::getName() const
+{
+    return m_name;
+}
+
+bool Terrain::isValid() const
+{
+    return !m_heights.empty();
+}
+
+void Terrain::setScene(const Scene* scene)
+{
+    m_scene = scene;
+}
+
+void Terrain::setTransform(const Transform& t)
+{
+    m_transformation = t;
+}
+
+Transform Terrain::getTransform() const
+{
+    return m_scene->getSceneTransform() * m_transformation;
+}
+
+uint32 Terrain::getResidentTileCount() const
+{
+    uint32 count = 0;
+    for (const Tile& tile : m_tiles)
+    {
+        count += tile.Texture != 0 ? 1 : 0;
+    }
+    return count;
+}
+
+void Terrain::buildPatch()
+{
+    uint32 n = m_settings.PatchSize;
+    uint32 row = n + 1;
+
+    // Sommets x-major comme GeometryHelper::CreateGrid, dans [0, 1]
+    std::vector<float> positions((size_t)row * row * 2);
+    for (uint32 x = 0; x <= n; ++x)
+    {
+        for (uint32 z = 0; z <= n; ++z)
+        {
+            positions[(x * row + z) * 2] = (float)x / n;
+            positions[(x * row + z) * 2 + 1] = (float)z / n;
+        }
+    }
+
+    // Triangles regroupes par quart de grille : un noeud peut ne dessiner qu'un quart
+    // quand l'enfant correspondant est hors de portee de son propre niveau
+    std::vector<uint16> indices;
+    indices.reserve((size_t)n * n * 6);
+    uint32 half = n / 2;
+    for (uint32 quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        uint32 firstX = (quadrant & 1) * half;
+        uint32 firstZ = (quadrant >> 1) * half;
+        for (uint32 x = firstX; x < firstX + half; ++x)
+        {
+            for (uint32 z = firstZ; z < firstZ + half; ++z)
+            {
+                uint16 start = (uint16)(x * row + z);
+                indices.insert(indices.end(), { start, (uint16)(start + 1), (uint16)(start + row),
+                                                (uint16)(start + 1), (uint16)(start + row + 1), (uint16)(start + row) });
+            }
+        }
+    }
+    m_patchIndexCount = (uint32)indices.size();
+
+    glCreateVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_patchBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+    glGenBuffers(1, &m_instanceBuffer);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_patchBuffer);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16), indices.data(), GL_STATIC_DRAW);
+    RenderCounters::Current().BufferBytesUploaded += positions.size() * sizeof(float) + indices.size() * sizeof(uint16);
+
+    if (m_material != nullptr && m_material->isInitialized())
+    {
+        uint32 patchAttribute = m_material->attribute("aPatchPosition");
+        if (patchAttribute != INVALID_ATTRIBUTE)
+        {
+            glEnableVertexAttribArray(patchAttribute);
+            glVertexAttribPointer(patchAttribute, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        }
+
+        m_instanceAttribute = m_material->attribute("aNode");
+        if (m_instanceAttribute != INVALID_ATTRIBUTE)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+            glEnableVertexAttribArray(m_instanceAttribute);
+            glVertexAttribPointer(m_instanceAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), 0);
+            glVertexAttribDivisor(m_instanceAttribute, 1);
+        }
+        else
+        {
+            Log() << "--Erreur : Le materiel du terrain " << m_name << " n'utilise pas EngineTerrainVertexShader." << std::endl;
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void Terrain::computeBounds(Tile& tile)
+{
+    uint32 depth = m_settings.LodLevels - 1;
+    uint32 leaves = 1u << depth;
+    float leafSize = m_tileSize / leaves;
+    float size = (float)m_settings.Size;
+    float maxX = (float)(m_heightmapWidth - 1);
+    float maxY = (float)(m_heightmapHeight - 1);
+
+    // Feuilles : pixels qui entrent dans l'interpolation bilineaire sur leur surface
+    for (uint32 j = 0; j < leaves; ++j)
+    {
+        float v0 = (tile.OriginZ + j * leafSize) / size + 0.5f;
+        uint32 y0 = (uint32)std::max(0.0f, std::floor(v0 * maxY));
+        uint32 y1 = (uint32)std::min(maxY, std::ceil((v0 + leafSize / size) * maxY));
+        for (uint32 i = 0; i < leaves; ++i)
+        {
+            float u0 = (tile.OriginX + i * leafSize) / size + 0.5f;
+            uint32 x0 = (uint32)std::max(0.0f, std::floor(u0 * maxX));
+            uint32 x1 = (uint32)std::min(maxX, std::ceil((u0 + leafSize / size) * maxX));
+
+            NodeBounds bounds = { m_heights[(size_t)y0 * m_heightmapWidth + x0], m_heights[(size_t)y0 * m_heightmapWidth + x0] };
+            for (uint32 y = y0; y <= y1; ++y)
+            {
+                const float* heights = &m_heights[(size_t)y * m_heightmapWidth];
+                for (uint32 x = x0; x <= x1; ++x)
+                {
+                    bounds.MinHeight = std::min(bounds.MinHeight, heights[x]);
+                    bounds.MaxHeight = std::max(bounds.MaxHeight, heights[x]);
+                }
+            }
+            tile.Bounds[m_levelOffsets[depth] + j * leaves + i] = bounds;
+        }
+    }
+
+    // Les parents englobent leurs quatre enfants
+    for (uint32 level = depth; level-- > 0;)
+    {
+        uint32 count = 1u << level;
+        for (uint32 j = 0; j < count; ++j)
+        {
+            for (uint32 i = 0; i < count; ++i)
+            {
+                NodeBounds bounds = tile.Bounds[m_levelOffsets[level + 1] + (2 * j) * (2 * count) + 2 * i];
+                for (uint32 child = 1; child < 4; ++child)
+                {
+                    const NodeBounds& c = tile.Bounds[m_levelOffsets[level + 1] + (2 * j + (child >> 1)) * (2 * count) + 2 * i + (child & 1)];
+                    bounds.MinHeight = std::min(bounds.MinHeight, c.MinHeight);
+                    bounds.MaxHeight = std::max(bounds.MaxHeight, c.MaxHeight);
+                }
+                tile.Bounds[m_levelOffsets[level] + j * count + i] = bounds;
+            }
+        }
+    }
+}
+
+float Terrain::sampleHeight(float u, float v) const
+{
+    float x = std::min(std::max(u, 0.0f), 1.0f) * (m_heightmapWidth - 1);
+    float y = std::min(std::max(v, 0.0f), 1.0f) * (m_heightmapHeight - 1);
+    uint32 x0 = (uint32)x;
+    uint32 y0 = (uint32)y;
+    uint32 x1 = std::min(x0 + 1, m_heightmapWidth - 1);
+    uint32 y1 = std::min(y0 + 1, m_heightmapHeight - 1);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    const float* row0 = &m_heights[(size_t)y0 * m_heightmapWidth];
+    const float* row1 = &m_heights[(size_t)y1 * m_heightmapWidth];
+    float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+    float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+float Terrain::distanceSquared(float minX, float minZ, float size, const NodeBounds& bounds) const
+{
+    float dx = std::max(std::max(minX - m_camera[0], m_camera[0] - (minX + size)), 0.0f);
+    float dy = std::max(std::max(bounds.MinHeight - m_camera[1], m_camera[1] - bounds.MaxHeight), 0.0f);
+    float dz = std::max(std::max(minZ - m_camera[2], m_camera[2] - (minZ + size)), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+bool Terrain::selectNode(const Tile& tile, uint32 depth, uint32 x, uint32 z)
+{
+    uint32 level = m_settings.LodLevels - 1 - depth;
+    float size = m_tileSize / (float)(1u << depth);
+    float minX = tile.OriginX + x * size;
+    float minZ = tile.OriginZ + z * size;
+    float distance = distanceSquared(minX, minZ, size, tile.Bounds[m_levelOffsets[depth] + z * (1u << depth) + x]);
+
+    // Hors de portee : le parent couvre cette surface avec sa propre grille
+    if (distance > m_lodRanges[level] * m_lodRanges[level])
+    {
+        return false;
+    }
+
+    Instance node = { minX, minZ, size, (float)level };
+    if (level == 0 || distance > m_lodRanges[level - 1] * m_lodRanges[level - 1])
+    {
+        m_selection[4].push_back(node);
+        return true;
+    }
+
+    for (uint32 child = 0; child < 4; ++child)
+    {
+        if (!selectNode(tile, depth + 1, 2 * x + (child & 1), 2 * z + (child >> 1)))
+        {
+            m_selection[child].push_back(node);
+        }
+    }
+    return true;
+}
+
+std::vector<float> Terrain::resample(float originX, float originZ) const
+{
+    PROFILE_SCOPE("Terrain::resample");
+
+    // Un texel par sommet du niveau le plus fin : les positions de la grille, morphing
+    // compris, tombent toujours au centre d'un texel
+    uint32 texels = m_tileTexels;
+    float size = (float)m_settings.Size;
+    float step = m_tileSize / (texels - 1) / size;
+    float u0 = originX / size + 0.5f;
+    float v0 = originZ / size + 0.5f;
+    std::vector<float> heights((size_t)texels * texels);
+
+    ThreadPool::ParallelFor((texels + ROWS_PER_TASK - 1) / ROWS_PER_TASK, [&](uint32 task)
+    {
+        uint32 lastRow = std::min(texels, (task + 1) * ROWS_PER_TASK);
+        for (uint32 j = task * ROWS_PER_TASK; j < lastRow; ++j)
+        {
+            float* row = &heights[(size_t)j * texels];
+            for (uint32 i = 0; i < texels; ++i)
+            {
+                row[i] = sampleHeight(u0 + i * step, v0 + j * step);
+            }
+        }
+    });
+    return heights;
+}
+
+void Terrain::streamIn(uint32 index)
+{
+    // La tuile reste non residente jusqu'a ce que update recupere ses hauteurs
+    Tile& tile = m_tiles[index];
+    tile.Resampling = true;
+    ++m_resamplingTiles;
+
+    float originX = tile.OriginX;
+    float originZ = tile.OriginZ;
+    ThreadPool::Submit([this, index, originX, originZ]()
+    {
+        ResampledTile result = { index, resample(originX, originZ) };
+
+        std::lock_guard<std::mutex> lock(m_resampleMutex);
+        m_resampled.push_back(std::move(result));
+        m_resampleCondition.notify_all();
+    });
+}
+
+void Terrain::collectResampledTiles()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_resampleMutex);
+        m_resampledScratch.swap(m_resampled);
+    }
+
+    float streamOutDistance = (float)m_settings.ViewDistance * STREAM_OUT_MARGIN;
+    for (ResampledTile& resampled : m_resampledScratch)
+    {
+        --m_resamplingTiles;
+        Tile& tile = m_tiles[resampled.Tile];
+        tile.Resampling = false;
+
+        // La camera a pu s'eloigner pendant le calcul
+        if (distanceSquared(tile.OriginX, tile.OriginZ, m_tileSize, tile.Bounds[0]) <= streamOutDistance * streamOutDistance)
+        {
+            upload(tile, std::move(resampled.Heights));
+        }
+    }
+    m_resampledScratch.clear();
+}
+
+void Terrain::upload(Tile& tile, std::vector<float>&& heights)
+{
+    PROFILE_SCOPE("Terrain::upload");
+
+    uint32 texels = m_tileTexels;
+    tile.UploadData = std::move(heights);
+    glGenTextures(1, &tile.Texture);
+    tile.UploadTicket = UploadQueue::TextureData(tile.Texture, GL_R32F, texels, texels, GL_RED, GL_FLOAT, sizeof(float), tile.UploadData.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Envoi immediat : les donnees ne sont plus utiles
+    if (tile.UploadTicket == 0)
+    {
+        std::vector<float>().swap(tile.UploadData);
+    }
+}
+
+void Terrain::streamOut(Tile& tile)
+{
+    if (tile.Texture != 0)
+    {
+        UploadQueue::CancelTexture(tile.Texture);
+        glDeleteTextures(1, &tile.Texture);
+        tile.Texture = 0;
+    }
+    tile.UploadTicket = 0;
+    std::vector<float>().swap(tile.UploadData);
+}
+
+void Terrain::update()
+{
+    if (!isValid() || m_scene == nullptr)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("Terrain::update");
+
+    // Camera ramenee dans l'espace du terrain, ou sont exprimees les distances des niveaux
+    const Point3<Metre>& position = m_scene->getCamera().position();
+    auto inverse = getTransform().inverse();
+    Point3<Real> camera = Point3<Real>(inverse * Point3<Real>(Real((float)position.x()), Real((float)position.y()), Real((float)position.z())));
+    std::copy(camera.constValues(), camera.constValues() + 3, m_camera);
+
+    float viewDistance = (float)m_settings.ViewDistance;
+    float streamOutDistance = viewDistance * STREAM_OUT_MARGIN;
+    uint32 nearest = NO_TILE;
+    float nearestDistance = 0.0f;
+    for (uint32 t = 0; t < m_tiles.size(); ++t)
+    {
+        Tile& tile = m_tiles[t];
+        float distance = distanceSquared(tile.OriginX, tile.OriginZ, m_tileSize, tile.Bounds[0]);
+        if (tile.Texture != 0)
+        {
+            if (distance > streamOutDistance * streamOutDistance)
+            {
+                streamOut(tile);
+            }
+            else if (!tile.UploadData.empty() && UploadQueue::IsComplete(tile.UploadTicket))
+            {
+                std::vector<float>().swap(tile.UploadData);
+            }
+        }
+        else if (!tile.Resampling && distance <= viewDistance * viewDistance && (nearest == NO_TILE || distance < nearestDistance))
+        {
+            nearest = t;
+            nearestDistance = distance;
+        }
+    }
+
+    // Une tuile soumise par image, la plus proche, et peu de tuiles en calcul a la fois
+    if (nearest != NO_TILE && m_resamplingTiles < MAX_RESAMPLING_TILES)
+    {
+        streamIn(nearest);
+    }
+
+    // Sans thread de travail, la tuile soumise ci-dessus est deja prete
+    collectResampledTiles();
+
+    // Une tuile n'est dessinee qu'une fois sa texture completement envoyee
+    m_instances.clear();
+    m_draws.clear();
+    for (uint32 t = 0; t < m_tiles.size(); ++t)
+    {
+        const Tile& tile = m_tiles[t];
+        if (tile.Texture == 0 || !tile.UploadData.empty())
+        {
+            continue;
+        }
+
+        for (std::vector<Instance>& selection : m_selection)
+        {
+            selection.clear();
+        }
+        selectNode(tile, 0, 0, 0);
+
+        for (uint32 quadrant = 0; quadrant < 5; ++quadrant)
+        {
+            const std::vector<Instance>& selection = m_selection[quadrant];
+            if (!selection.empty())
+            {
+                m_draws.push_back({ t, quadrant, (uint32)m_instances.size(), (uint32)selection.size() });
+                m_instances.insert(m_instances.end(), selection.begin(), selection.end());
+            }
+        }
+    }
+
+    if (!m_instances.empty())
+    {
+        size_t bytes = m_instances.size() * sizeof(Instance);
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, m_instances.data(), GL_STREAM_DRAW);
+        RenderCounters::Current().BufferBytesUploaded += bytes;
+    }
+}
+
+void Terrain::render() const
+{
+    if (m_draws.empty() || m_material == nullptr || !m_material->isInitialized() || m_instanceAttribute == INVALID_ATTRIBUTE)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("Terrain::render");
+
+    glBindVertexArray(m_vao);
+    RenderCounters::Current().VertexArrayBinds++;
+    m_material->bind();
+    m_material->setMat4("gModelMatrix", getTransform());
+    m_scene->bind(*m_material);
+
+    m_material->setVec3("gTerrainCamera", m_camera[0], m_camera[1], m_camera[2]);
+    m_material->setFloat("gTerrainPatchSize", (float)m_settings.PatchSize);
+    m_material->setFloat("gTerrainSize", (float)m_settings.Size);
+    m_material->setInt("gTerrainHeights", HEIGHTMAP_UNIT);
+    for (uint32 level = 0; level < m_lodRanges.size(); ++level)
+    {
+        m_material->setVec2(m_morphUniforms[level].c_str(), m_morphStart[level], m_lodRanges[level]);
+    }
+
+    uint32 quarterCount = m_patchIndexCount / 4;
+    uint32 boundTile = (uint32)-1;
+    RenderStats& stats = RenderCounters::Current();
+    for (const Draw& draw : m_draws)
+    {
+        if (draw.Tile != boundTile)
+        {
+            const Tile& tile = m_tiles[draw.Tile];
+            glActiveTexture(GL_TEXTURE0 + HEIGHTMAP_UNIT);
+            glBindTexture(GL_TEXTURE_2D, tile.Texture);
+            stats.TextureBinds++;
+            m_material->setVec4("gTerrainTile", tile.OriginX, tile.OriginZ, m_tileSize, (float)m_tileTexels);
+            boundTile = draw.Tile;
+        }
+
+        // Sans glDrawElementsInstancedBaseInstance (GL 4.2), l'attribut est repointe
+        // sur la premiere instance du groupe
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        glVertexAttribPointer(m_instanceAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*)(draw.FirstInstance * sizeof(Instance)));
+
+        uint32 indexCount = draw.Quadrant < 4 ? quarterCount : m_patchIndexCount;
+        size_t indexOffset = draw.Quadrant < 4 ? draw.Quadrant * quarterCount * sizeof(uint16) : 0;
+        glDrawElementsInstanced(GL_TRIANGLES, (int)indexCount, GL_UNSIGNED_SHORT, (const void*)indexOffset, (int)draw.InstanceCount);
+
+        stats.DrawCalls++;
+        stats.Triangles += (uint64)indexCount / 3 * draw.InstanceCount;
+        stats.Vertices += (uint64)indexCount * draw.InstanceCount;
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    m_material->unbind();
+    glBindVertexArray(0);
+}
+
+void Terrain::renderBounds() const
+{
+    Transform transform = getTransform();
+    float levels = (float)std::max(1u, m_settings.LodLevels - 1);
+    for (const Draw& draw : m_draws)
+    {
+        const Tile& tile = m_tiles[draw.Tile];
+        for (uint32 i = 0; i < draw.InstanceCount; ++i)
+        {
+            const Instance& node = m_instances[draw.FirstInstance + i];
+            uint32 depth = m_settings.LodLevels - 1 - (uint32)node.Level;
+            uint32 x = (uint32)((node.X - tile.OriginX) / node.Size + 0.5f);
+            uint32 z = (uint32)((node.Z - tile.OriginZ) / node.Size + 0.5f);
+            const NodeBounds& bounds = tile.Bounds[m_levelOffsets[depth] + z * (1u << depth) + x];
+
+            // Un quart de grille est encadre seul, avec les hauteurs de son noeud
+            float size = draw.Quadrant < 4 ? node.Size / 2 : node.Size;
+            float minX = node.X + (draw.Quadrant < 4 ? (draw.Quadrant & 1) * size : 0.0f);
+            float minZ = node.Z + (draw.Quadrant < 4 ? (draw.Quadrant >> 1) * size : 0.0f);
+
+            // Vert pour le niveau le plus fin, rouge pour le plus grossier
+            float t = node.Level / levels;
+            DebugDraw::Box(Point3<Metre>(Metre(minX), Metre(bounds.MinHeight), Metre(minZ)),
+                           Point3<Metre>(Metre(minX + size), Metre(bounds.MaxHeight), Metre(minZ + size)),
+                           transform, Color(t, 1.0f - t, 0.0f));
+        }
+    }
+}
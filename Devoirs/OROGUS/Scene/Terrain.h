@@ -0,0 +1,161 @@
+#ifndef _SCENE_TERRAIN_H_
+#define _SCENE_TERRAIN_H_
+
+#include "../Utilities/Transforms.h"
+#include "../Utilities/Types.h"
+#include "../Utilities/Units.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Material;
+class Scene;
+
+// Parametres d'un Terrain, dans son espace local
+struct TerrainSettings
+{
+    Metre Size = Metre(1024.0f);            // Cote du terrain, centre sur l'origine
+    Metre Height = Metre(100.0f);           // Hauteur d'un pixel blanc de la carte
+    uint32 PatchSize = 32;                  // Quads par cote de la grille partagee (pair, au plus 128)
+    uint32 LodLevels = 5;                   // Niveaux de l'arbre de chaque tuile
+    uint32 Tiles = 4;                       // Tuiles par cote : unite de chargement sur le GPU
+    Metre ViewDistance = Metre(1000.0f);    // Au-dela, rien n'est dessine ni garde sur le GPU
+};
+
+// Terrain a partir d'une carte de hauteur, decoupe en tuiles carrees. Chaque tuile est
+// la racine d'un arbre quaternaire ; les noeuds retenus a chaque image selon la distance
+// (CDLOD) sont dessines par instanciation d'une seule grille, deplacee dans le vertex
+// shader par la texture de hauteurs de la tuile. Les sommets se deplacent (morphing)
+// vers la grille du niveau suivant avant le changement de niveau.
+//
+// Seules les tuiles a moins de ViewDistance de la camera ont leur texture sur le GPU :
+// la memoire video et le cout de rendu dependent de la distance de vue, pas de la
+// taille du terrain. Une tuile entrante est reechantillonnee sur le ThreadPool sans
+// bloquer l'image, puis sa texture est envoyee avec UploadQueue ; elle n'est dessinee
+// qu'une fois l'envoi termine.
+class Terrain
+{
+private:
+    struct NodeBounds
+    {
+        float MinHeight;
+        float MaxHeight;
+    };
+
+    struct Tile
+    {
+        float OriginX;                      // Coin minimal, espace local
+        float OriginZ;
+        std::vector<NodeBounds> Bounds;     // Par niveau depuis la racine, puis ligne par ligne
+        uint32 Texture;                     // 0 si la tuile n'est pas residente
+        uint64 UploadTicket;
+        std::vector<float> UploadData;      // Gardees jusqu'a la fin de l'envoi
+        bool Resampling;                    // Hauteurs en calcul sur le ThreadPool
+    };
+
+    // Hauteurs d'une tuile calculees par un thread de travail
+    struct ResampledTile
+    {
+        uint32 Tile;
+        std::vector<float> Heights;
+    };
+
+    // Attribut aNode d'une instance de la grille
+    struct Instance
+    {
+        float X;
+        float Z;
+        float Size;
+        float Level;
+    };
+
+    // Instances consecutives d'une tuile dessinees avec la grille entiere
+    // (Quadrant == 4) ou seulement un de ses quarts
+    struct Draw
+    {
+        uint32 Tile;
+        uint32 Quadrant;
+        uint32 FirstInstance;
+        uint32 InstanceCount;
+    };
+
+    std::string m_name;
+    Material* m_material;
+    const Scene* m_scene;
+    Transform m_transformation;
+    TerrainSettings m_settings;
+
+    uint32 m_heightmapWidth;
+    uint32 m_heightmapHeight;
+    std::vector<float> m_heights;           // Carte de hauteur en metres
+
+    float m_tileSize;
+    uint32 m_tileTexels;                    // Texels par cote : un par sommet du niveau le plus fin
+    std::vector<Tile> m_tiles;
+    std::vector<uint32> m_levelOffsets;     // Premier noeud de chaque profondeur dans Tile::Bounds
+    std::vector<float> m_lodRanges;         // Distance couverte par chaque niveau, 0 le plus fin
+    std::vector<float> m_morphStart;
+    std::vector<std::string> m_morphUniforms;
+
+    uint32 m_vao;
+    uint32 m_patchBuffer;
+    uint32 m_indexBuffer;
+    uint32 m_instanceBuffer;
+    uint32 m_patchIndexCount;
+    uint32 m_instanceAttribute;
+
+    // Reechantillonnages soumis et pas encore recuperes par update (thread GL), et
+    // resultats deposes par les threads de travail sous m_resampleMutex
+    uint32 m_resamplingTiles;
+    std::vector<ResampledTile> m_resampled;
+    std::vector<ResampledTile> m_resampledScratch;
+    std::mutex m_resampleMutex;
+    std::condition_variable m_resampleCondition;
+
+    float m_camera[3];                      // Camera dans l'espace du terrain, au dernier update
+    std::vector<Instance> m_instances;
+    std::vector<Draw> m_draws;
+    std::vector<Instance> m_selection[5];   // Par quart de grille, puis grille entiere
+
+    void buildPatch();
+    void computeBounds(Tile& tile);
+    float sampleHeight(float u, float v) const;
+    float distanceSquared(float minX, float minZ, float size, const NodeBounds& bounds) const;
+    bool selectNode(const Tile& tile, uint32 depth, uint32 x, uint32 z);
+    std::vector<float> resample(float originX, float originZ) const;
+    void streamIn(uint32 tile);
+    void collectResampledTiles();
+    void upload(Tile& tile, std::vector<float>&& heights);
+    void streamOut(Tile& tile);
+
+public:
+    // La carte de hauteur (canal rouge) est lue avec TextureManager sans etre envoyee
+    // au GPU. Le materiel devient la propriete du terrain ; son vertex shader doit etre
+    // ShaderHelper::LoadEngineTerrainVertexShader.
+    Terrain(const std::string& name, Material* material, const std::string& heightmap, const TerrainSettings& settings);
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    const std::string& getName() const;
+
+    // Faux si la carte de hauteur n'a pas pu etre chargee
+    bool isValid() const;
+
+    void setScene(const Scene* scene);
+    void setTransform(const Transform& t);
+    Transform getTransform() const;
+
+    uint32 getResidentTileCount() const;
+
+    // Charge ou libere les tuiles et choisit les noeuds a dessiner pour la camera
+    // de la scene. Une fois par image, avant UploadQueue::Process et render.
+    void update();
+    void render() const;
+    void renderBounds() const;
+};
+
+#endif
@@ -6,6 +6,12 @@ uniform mat4 gModelMatrix;
 
 uniform vec4 uColor;
 
+// Decodage des formats de sommets compacts (voir Geometry/VertexFormat.h). Les valeurs
+// initiales ne decodent rien : le moteur ne les envoie que pour un format quantifie.
+uniform vec3 gPositionOffset = vec3(0.0);
+uniform vec3 gPositionScale = vec3(1.0);
+uniform int gOctahedralDirections = 0;
+
 in vec3 aPosition;
 in vec3 aNormal;
 in vec2 aTexCoord;
@@ -19,11 +25,25 @@ struct FS_In {
 
 out FS_In fsIn;
 
+vec3 DecodeDirection(vec3 d)
+{
+	if (gOctahedralDirections == 0)
+	{
+		return d;
+	}
+	vec3 n = vec3(d.xy, 1.0 - abs(d.x) - abs(d.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
-	fsIn.WorldPosition = (gModelMatrix * vec4(aPosition, 1.0f)).xyz;
+	vec3 position = aPosition * gPositionScale + gPositionOffset;
+	fsIn.WorldPosition = (gModelMatrix * vec4(position, 1.0f)).xyz;
 	gl_Position = gProjectionMatrix * gViewMatrix * vec4(fsIn.WorldPosition, 1.0f);
 	fsIn.TexCoord = aTexCoord;
 	fsIn.Color = uColor.rgb;
-	fsIn.Normal = mat3(transpose(inverse(gModelMatrix))) * aNormal;
+	fsIn.Normal = mat3(transpose(inverse(gModelMatrix))) * DecodeDirection(aNormal);
 }
@@ -1,13 +1,36 @@
 #include "Texture.h"
 
+#include "../Render/UploadQueue.h"
+#include "../Utilities/Profiler.h"
+#include "../Utilities/RenderStats.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
 const uint32 NO_TEXTURE_ID = -1;
 
-Texture2D* Texture2D::CreateTexture(const std::string& fileName)
+namespace
+{
+    uint32 s_fallbackTextureID = NO_TEXTURE_ID;
+
+    uint32 GetFallbackTexture()
+    {
+        if (s_fallbackTextureID == NO_TEXTURE_ID)
+        {
+            const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glGenTextures(1, &s_fallbackTextureID);
+            glBindTexture(GL_TEXTURE_2D, s_fallbackTextureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_FLOAT, white);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        return s_fallbackTextureID;
+    }
+}
+
+Texture2D* Texture2D::CreateTexture(const std::string& fileName, bool upload)
 {
-    return new Texture2D(fileName);
+    return new Texture2D(fileName, upload);
 }
 
 // ************************************************
@@ -17,9 +40,11 @@ Texture2D* Texture2D::CreateTexture(const std::string& fileName)
 // Inputs
 //   - filename : Name of the file that
 //                contains the texture data.
+//   - upload   : Send the texture to the GPU now
 // ************************************************
-Texture2D::Texture2D(const std::string& fileName)
+Texture2D::Texture2D(const std::string& fileName, bool upload)
 	: m_textureID(NO_TEXTURE_ID)
+	, m_uploadTicket(0)
 	, m_textureData(nullptr)
 	, m_width(0)
 	, m_height(0)
@@ -28,24 +53,45 @@ Texture2D::Texture2D(const std::string& fileName)
     int w;
     int h;
     int comp;
-    unsigned char* image = stbi_load(fileName.c_str(), &w, &h, &comp, STBI_rgb_alpha);
-        
-    if (image == nullptr)
-        throw(std::string("Failed to load texture"));
-
-    m_width = w;
-    m_height = h;
 
-    m_textureData = new Color[m_width * m_height];
-    for (uint32 i = 0; i < m_width * m_height; ++i)
+    // Les images 16 bits (cartes de hauteur) gardent leur precision
+    if (stbi_is_16_bit(fileName.c_str()))
     {
-        m_textureData[i] = Color(image[i * 4], image[(i * 4) + 1], image[(i * 4) + 2], image[(i * 4) + 3] / 255.f);
+        stbi_us* image = stbi_load_16(fileName.c_str(), &w, &h, &comp, STBI_rgb_alpha);
+        if (image == nullptr)
+            throw(std::string("Failed to load texture"));
+
+        m_width = w;
+        m_height = h;
+
+        m_textureData = new Color[m_width * m_height];
+        for (uint32 i = 0; i < m_width * m_height; ++i)
+        {
+            m_textureData[i] = Color(image[i * 4] / 65535.f, image[(i * 4) + 1] / 65535.f, image[(i * 4) + 2] / 65535.f, image[(i * 4) + 3] / 65535.f);
+        }
+        stbi_image_free(image);
+    }
+    else
+    {
+        unsigned char* image = stbi_load(fileName.c_str(), &w, &h, &comp, STBI_rgb_alpha);
+        if (image == nullptr)
+            throw(std::string("Failed to load texture"));
+
+        m_width = w;
+        m_height = h;
+
+        m_textureData = new Color[m_width * m_height];
+        for (uint32 i = 0; i < m_width * m_height; ++i)
+        {
+            m_textureData[i] = Color(image[i * 4], image[(i * 4) + 1], image[(i * 4) + 2], image[(i * 4) + 3] / 255.f);
+        }
+        stbi_image_free(image);
     }
 
-    load();
-
-    stbi_image_free(image);
-
+    if (upload)
+    {
+        load();
+    }
 }
 
 // ************************************************
@@ -58,6 +104,7 @@ Texture2D::Texture2D(const std::string& fileName)
 // ************************************************
 Texture2D::Texture2D(uint32 width, uint32 height, const Color * const data)
 	: m_textureID(NO_TEXTURE_ID)
+	, m_uploadTicket(0)
 	, m_textureData(nullptr)
 	, m_width(width)
 	, m_height(height)
@@ -83,6 +130,7 @@ Texture2D::~Texture2D()
 
 	if (m_textureID != NO_TEXTURE_ID)
 	{
+		UploadQueue::CancelTexture(m_textureID);
 		glDeleteTextures(1, &m_textureID);
 		m_textureID = NO_TEXTURE_ID;
 	}	
@@ -93,19 +141,62 @@ const std::string& Texture2D::getName() const
     return m_name;
 }
 
+uint32 Texture2D::getWidth() const
+{
+    return m_width;
+}
+
+uint32 Texture2D::getHeight() const
+{
+    return m_height;
+}
+
+const Color* Texture2D::getData() const
+{
+    return m_textureData;
+}
+
+bool Texture2D::isUploaded() const
+{
+    return m_textureID != NO_TEXTURE_ID;
+}
+
+void Texture2D::upload()
+{
+    if (!isUploaded())
+    {
+        load();
+    }
+}
+
 bool Texture2D::bind(uint32 bindingUnit) const
 {
+	// Les lignes pas encore envoyees ont un contenu indefini
+	bool complete = UploadQueue::IsComplete(m_uploadTicket);
 	glActiveTexture(GL_TEXTURE0 + bindingUnit);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
-	return true;
+	glBindTexture(GL_TEXTURE_2D, complete ? m_textureID : GetFallbackTexture());
+	RenderCounters::Current().TextureBinds++;
+	return complete;
+}
+
+void Texture2D::ReleaseFallback()
+{
+	if (s_fallbackTextureID != NO_TEXTURE_ID)
+	{
+		glDeleteTextures(1, &s_fallbackTextureID);
+		s_fallbackTextureID = NO_TEXTURE_ID;
+	}
 }
 
 
 bool Texture2D::load()
 {
+	PROFILE_SCOPE("Texture2D::load");
 	glGenTextures(1, &m_textureID);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_FLOAT, m_textureData);
+
+	// Une grande texture est envoyee par bandes de lignes sur les images suivantes ;
+	// m_textureData reste valide jusqu'a la destruction de la texture
+	m_uploadTicket = UploadQueue::TextureData(m_textureID, GL_RGBA, m_width, m_height, GL_RGBA, GL_FLOAT, 4 * sizeof(float), m_textureData);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
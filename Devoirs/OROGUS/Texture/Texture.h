@@ -11,7 +11,8 @@
 class Texture2D
 {
 public:
-    static Texture2D* CreateTexture(const std::string& fileName);
+    // Sans upload, l'image reste seulement en memoire centrale jusqu'a upload()
+    static Texture2D* CreateTexture(const std::string& fileName, bool upload = true);
     //static Texture2D* CreateTexture(uint32 width, uint32 height, const Color * const data);
 
     Texture2D(const Texture2D& other) = delete;
@@ -20,10 +21,23 @@ public:
 	
     const std::string& getName() const;
 
+    uint32 getWidth() const;
+    uint32 getHeight() const;
+    // Pixels en lignes, composantes entre 0 et 1
+    const Color* getData() const;
+
+    bool isUploaded() const;
+    void upload();
+
+    // Tant que UploadQueue n'a pas envoye toutes les lignes, lie une texture blanche
+    // de 1x1 a la place et retourne faux
 	bool bind(uint32 bindingUnit) const;
 
+    // Detruit la texture de remplacement ; a la fermeture, avec le contexte GL encore actif
+    static void ReleaseFallback();
+
 private:
-    Texture2D(const std::string& fileName);
+    Texture2D(const std::string& fileName, bool upload);
     Texture2D(uint32 width, uint32 height, const Color * const data);
 
     bool load();
@@ -31,6 +45,7 @@ private:
     std::string m_name;
 
     uint32 m_textureID;
+    uint64 m_uploadTicket;     // Envoi differe par UploadQueue, 0 si immediat
     uint32 m_width;
     uint32 m_height;
     Color* m_textureData;
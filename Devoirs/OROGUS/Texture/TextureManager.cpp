@@ -33,9 +33,10 @@ TextureManager::TextureManager()
 TextureManager::~TextureManager()
 {
 	unloadAll();
+	Texture2D::ReleaseFallback();
 }
 
-Texture2D* TextureManager::loadTexture(const std::string& textureName)
+Texture2D* TextureManager::loadTexture(const std::string& textureName, bool upload)
 {
 	if (textureName.empty())
 		return nullptr;
@@ -45,13 +46,17 @@ Texture2D* TextureManager::loadTexture(const std::string& textureName)
 	{
 		InstanceCounter<Texture2D>* instance = m_textures[textureName];
 		instance->AddRef();
+		if (upload)
+		{
+			instance->getObjectPtr()->upload();
+		}
 		return instance->getObjectPtr();
 	}
 	else
 	{
         try
         {
-            Texture2D* texture = Texture2D::CreateTexture(textureName);
+            Texture2D* texture = Texture2D::CreateTexture(textureName, upload);
             if (texture != nullptr)
             {
                 m_textures.insert(std::pair<std::string, InstanceCounter<Texture2D>*>(textureName, new InstanceCounter<Texture2D>(texture)));
@@ -27,7 +27,8 @@ public:
 	static void Initialize();
 	static void Uninitialize();
 
-	Texture2D* loadTexture(const std::string& textureName);
+	// Sans upload, la texture n'est envoyee au GPU qu'au premier chargement qui le demande
+	Texture2D* loadTexture(const std::string& textureName, bool upload = true);
 	Texture2D* operator[](const std::string& textureName) const;
 	std::string getTextureName(Texture2D * const texture) const;
 	bool unloadTexture(const std::string& textureName);
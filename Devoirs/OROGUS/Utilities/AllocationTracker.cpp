@@ -0,0 +1,120 @@
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Initialisation constante : utilisable par operator new des le demarrage de chaque thread
+    thread_local uint64 t_allocationCount = 0;
+    thread_local uint64 t_allocatedBytes = 0;
+}
+
+#ifdef OROGUS_TRACK_ALLOCATIONS
+
+namespace
+{
+    void* TrackedAllocate(size_t size)
+    {
+        ++t_allocationCount;
+        t_allocatedBytes += size;
+        return std::malloc(size > 0 ? size : 1);
+    }
+}
+
+void* operator new(size_t size)
+{
+    void* p = TrackedAllocate(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = TrackedAllocate(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+#endif
+
+bool AllocationTracker::IsEnabled()
+{
+#ifdef OROGUS_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64 AllocationTracker::GetThreadAllocationCount()
+{
+    return t_allocationCount;
+}
+
+uint64 AllocationTracker::GetThreadAllocatedBytes()
+{
+    return t_allocatedBytes;
+}
+
+AllocationScope::AllocationScope()
+    : m_startCount(AllocationTracker::GetThreadAllocationCount())
+    , m_startBytes(AllocationTracker::GetThreadAllocatedBytes())
+{
+}
+
+uint64 AllocationScope::getAllocationCount() const
+{
+    return AllocationTracker::GetThreadAllocationCount() - m_startCount;
+}
+
+uint64 AllocationScope::getAllocatedBytes() const
+{
+    return AllocationTracker::GetThreadAllocatedBytes() - m_startBytes;
+}
@@ -0,0 +1,38 @@
+#ifndef _UTILITIES_ALLOCATIONTRACKER_H_
+#define _UTILITIES_ALLOCATIONTRACKER_H_
+
+#include "Types.h"
+
+// Compte les allocations faites par operator new, separement pour chaque thread :
+// celles du thread de rendu ne se melangent pas a celles des chargements en
+// arriere-plan. Le remplacement d'operator new n'est compile qu'avec
+// OROGUS_TRACK_ALLOCATIONS (defini dans toutes les configurations, il ne coute que
+// deux increments locaux au thread) ; sinon les compteurs restent a zero.
+class AllocationTracker
+{
+public:
+    AllocationTracker() = delete;
+
+    static bool IsEnabled();
+
+    // Totaux du thread appelant depuis son demarrage
+    static uint64 GetThreadAllocationCount();
+    static uint64 GetThreadAllocatedBytes();
+};
+
+// Allocations faites par le thread appelant depuis la construction de l'objet.
+// L'objet ne doit pas changer de thread.
+class AllocationScope
+{
+private:
+    uint64 m_startCount;
+    uint64 m_startBytes;
+
+public:
+    AllocationScope();
+
+    uint64 getAllocationCount() const;
+    uint64 getAllocatedBytes() const;
+};
+
+#endif
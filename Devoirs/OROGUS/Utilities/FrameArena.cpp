@@ -0,0 +1,145 @@
+#include "FrameArena.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    struct Block
+    {
+        uint8* Data;
+        size_t Capacity;
+        size_t Offset;
+    };
+
+    // Taille minimale d'un bloc de debordement
+    const size_t MIN_OVERFLOW_BLOCK = 64 * 1024;
+
+    // Le premier bloc est le bloc principal (s'il y a une capacite), les suivants sont des debordements
+    std::vector<Block> s_blocks;
+    size_t s_capacity = 0;
+    size_t s_peak = 0;
+    size_t s_largestOverflow = 0;
+
+    Block MakeBlock(size_t capacity)
+    {
+        return { static_cast<uint8*>(std::malloc(capacity)), capacity, 0 };
+    }
+
+    // Position alignee dans le bloc, ou Capacity + 1 si la demande ne tient pas
+    size_t AlignedOffset(const Block& block, size_t size, size_t alignment)
+    {
+        uintptr_t base = (uintptr_t)block.Data;
+        uintptr_t aligned = (base + block.Offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t offset = (size_t)(aligned - base);
+        return block.Data != nullptr && offset + size <= block.Capacity ? offset : block.Capacity + 1;
+    }
+}
+
+const size_t FrameArena::DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+void FrameArena::Initialize(size_t capacity)
+{
+    Uninitialize();
+    s_capacity = capacity;
+    if (capacity > 0)
+    {
+        s_blocks.push_back(MakeBlock(capacity));
+    }
+    s_peak = 0;
+    s_largestOverflow = 0;
+}
+
+void FrameArena::Uninitialize()
+{
+    for (Block& block : s_blocks)
+    {
+        std::free(block.Data);
+    }
+    s_blocks.clear();
+    s_capacity = 0;
+}
+
+void FrameArena::Reset()
+{
+    size_t primaryBlocks = s_capacity > 0 ? 1 : 0;
+    if (s_blocks.size() > primaryBlocks)
+    {
+        size_t overflow = 0;
+        for (size_t i = primaryBlocks; i < s_blocks.size(); ++i)
+        {
+            overflow += s_blocks[i].Offset;
+            std::free(s_blocks[i].Data);
+        }
+        s_blocks.resize(primaryBlocks);
+
+        // Un seul message par nouveau maximum pour ne pas inonder le journal a chaque image
+        if (overflow > s_largestOverflow)
+        {
+            s_largestOverflow = overflow;
+            Log() << "--Erreur : Arene d'image trop petite (" << s_capacity << " octets), "
+                  << overflow << " octets alloues sur le tas" << std::endl;
+        }
+    }
+
+    if (!s_blocks.empty())
+    {
+        s_blocks[0].Offset = 0;
+    }
+    s_peak = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    size_t offset = s_blocks.empty() ? 1 : AlignedOffset(s_blocks.back(), size, alignment);
+    if (s_blocks.empty() || offset > s_blocks.back().Capacity)
+    {
+        s_blocks.push_back(MakeBlock(std::max(size + alignment, MIN_OVERFLOW_BLOCK)));
+        offset = AlignedOffset(s_blocks.back(), size, alignment);
+        if (offset > s_blocks.back().Capacity)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    Block& block = s_blocks.back();
+    block.Offset = offset + size;
+    s_peak = std::max(s_peak, GetUsedBytes());
+    return block.Data + offset;
+}
+
+void FrameArena::Deallocate(void* p, size_t size)
+{
+    if (!s_blocks.empty())
+    {
+        Block& block = s_blocks.back();
+        if (static_cast<uint8*>(p) + size == block.Data + block.Offset)
+        {
+            block.Offset = static_cast<uint8*>(p) - block.Data;
+        }
+    }
+}
+
+size_t FrameArena::GetCapacity()
+{
+    return s_capacity;
+}
+
+size_t FrameArena::GetUsedBytes()
+{
+    size_t used = 0;
+    for (const Block& block : s_blocks)
+    {
+        used += block.Offset;
+    }
+    return used;
+}
+
+size_t FrameArena::GetPeakBytes()
+{
+    return s_peak;
+}
@@ -0,0 +1,89 @@
+#ifndef _UTILITIES_FRAMEARENA_H_
+#define _UTILITIES_FRAMEARENA_H_
+
+#include "Types.h"
+
+#include <cstddef>
+#include <vector>
+
+// Allocateur lineaire pour les donnees temporaires d'une image (listes de
+// dessin, tampons de televersement...). Reset, appele en debut d'image,
+// invalide tout ce qui a ete alloue depuis le Reset precedent.
+//
+// La capacite est fixe : une demande qui ne tient plus dans le bloc principal
+// est servie par un bloc de debordement alloue sur le tas, libere au Reset et
+// signale dans le journal. Utilisable seulement depuis le thread GL.
+class FrameArena
+{
+public:
+    static const size_t DEFAULT_CAPACITY;
+
+    FrameArena() = delete;
+
+    static void Initialize(size_t capacity = DEFAULT_CAPACITY);
+    static void Uninitialize();
+
+    static void Reset();
+
+    static void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Rend la memoire si c'est la derniere allocation, sinon ne fait rien
+    static void Deallocate(void* p, size_t size);
+
+    template<typename T>
+    static T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    static size_t GetCapacity();
+
+    // Octets utilises depuis le dernier Reset, debordement compris
+    static size_t GetUsedBytes();
+
+    // Plus haut niveau atteint depuis le dernier Reset
+    static size_t GetPeakBytes();
+};
+
+// Adaptateur pour les conteneurs de la STL
+template<typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator() noexcept = default;
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return FrameArena::AllocateArray<T>(count);
+    }
+
+    void deallocate(T* p, size_t count) noexcept
+    {
+        FrameArena::Deallocate(p, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const FrameAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+// Ne doit pas survivre a l'image ou il a ete cree
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _UTILITIES_HASH_H_
+#define _UTILITIES_HASH_H_
+
+#include "Types.h"
+
+#include <cstddef>
+#include <cstring>
+
+// Hachage rapide non cryptographique, par mots de 64 bits. Sert a reconnaitre un
+// contenu deja vu (source d'un cache, maillages identiques), pas a le proteger.
+class Hash
+{
+    Hash() = delete;
+    Hash(const Hash&) = delete;
+    Hash& operator=(const Hash&) = delete;
+    ~Hash() = delete;
+public:
+    static const uint64 SEED = 0xCBF29CE484222325ull;
+
+    // seed permet d'enchainer plusieurs blocs : Bytes(b, n, Bytes(a, m))
+    static uint64 Bytes(const void* data, size_t size, uint64 seed = SEED)
+    {
+        const uint64 MULTIPLIER = 0x9E3779B97F4A7C15ull;
+        const char* bytes = static_cast<const char*>(data);
+        uint64 h = seed ^ (size * MULTIPLIER);
+        size_t i = 0;
+        for (; i + sizeof(uint64) <= size; i += sizeof(uint64))
+        {
+            uint64 word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            h = (h ^ word) * MULTIPLIER;
+            h ^= h >> 32;
+        }
+        for (; i < size; ++i)
+        {
+            h = (h ^ (uint8)bytes[i]) * MULTIPLIER;
+        }
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+#endif
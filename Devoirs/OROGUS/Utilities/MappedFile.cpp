@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+
+MappedFile::MappedFile(const std::string& fileName)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_isMapped(false)
+    , m_isOpen(false)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+#endif
+{
+#ifdef _WIN32
+    m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(m_file, &size))
+        {
+            m_size = (size_t)size.QuadPart;
+            m_isOpen = true;
+            if (m_size > 0)
+            {
+                m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (m_mapping != nullptr)
+                {
+                    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                    m_isMapped = m_data != nullptr;
+                }
+            }
+        }
+    }
+#else
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat info;
+        if (fstat(fd, &info) == 0)
+        {
+            m_size = (size_t)info.st_size;
+            m_isOpen = true;
+            if (m_size > 0)
+            {
+                void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    madvise(data, m_size, MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(data);
+                    m_isMapped = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (m_isOpen && m_size > 0 && !m_isMapped)
+    {
+        // Projection impossible (ex. systeme de fichiers reseau) : lecture classique
+        std::ifstream file(fileName, std::ios::binary);
+        char* buffer = new char[m_size];
+        if (file.read(buffer, m_size))
+        {
+            m_data = buffer;
+        }
+        else
+        {
+            delete[] buffer;
+            m_isOpen = false;
+            m_size = 0;
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::close()
+{
+    if (m_isMapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    else
+    {
+        delete[] m_data;
+    }
+
+#ifdef _WIN32
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+    }
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isMapped = false;
+    m_isOpen = false;
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_isOpen;
+}
+
+const char* MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
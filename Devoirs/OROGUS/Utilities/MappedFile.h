@@ -0,0 +1,39 @@
+#ifndef _UTILITIES_MAPPEDFILE_H_
+#define _UTILITIES_MAPPEDFILE_H_
+
+#include "Types.h"
+
+#include <string>
+
+// Fichier projete en memoire en lecture seule. Si la projection echoue, le
+// contenu est lu en entier dans un tampon a la place.
+class MappedFile
+{
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_isMapped;
+    bool m_isOpen;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+
+    void close();
+
+public:
+    explicit MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+
+    // Le contenu n'est pas termine par un zero
+    const char* data() const;
+    size_t size() const;
+};
+
+#endif
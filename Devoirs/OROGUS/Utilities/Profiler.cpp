@@ -0,0 +1,438 @@
+#include <glew/glew.h>
+
+#include "Profiler.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Jeux de requetes GPU en rotation : le pilote peut avoir plusieurs images d'avance
+    const uint32 GPU_FRAME_COUNT = 4;
+
+    // Images entre deux recalages de l'horloge GPU (glGetInteger64v est synchrone)
+    const uint64 GPU_CLOCK_SYNC_INTERVAL = 256;
+
+    struct ProfileEvent
+    {
+        const char* Name;
+        uint64 Start;
+        uint64 End;
+    };
+
+    // Champs atomiques relaxes : l'export peut lire une case pendant que le
+    // proprietaire la reecrit, sans course de donnees.
+    struct EventSlot
+    {
+        std::atomic<const char*> Name;
+        std::atomic<uint64> Start;
+        std::atomic<uint64> End;
+    };
+
+    // Tampon circulaire a un seul ecrivain (le thread proprietaire), lu par
+    // l'export comme un seqlock : Head est publie avant la reecriture d'une case,
+    // et l'export relit Head apres sa copie pour ecarter les cases reecrites.
+    struct ThreadBuffer
+    {
+        uint32 ThreadIndex;
+        std::string Name;
+        std::atomic<uint64> Head;
+        std::vector<EventSlot> Events;
+
+        explicit ThreadBuffer(uint32 index)
+            : ThreadIndex(index)
+            , Name("Thread " + std::to_string(index))
+            , Head(0)
+            , Events(Profiler::THREAD_EVENT_CAPACITY)
+        {
+        }
+
+        void push(const char* name, uint64 start, uint64 end)
+        {
+            uint64 head = Head.load(std::memory_order_relaxed);
+            EventSlot& e = Events[head % Events.size()];
+            // Un export qui lit cette ecriture verra aussi Head >= head
+            std::atomic_thread_fence(std::memory_order_release);
+            e.Name.store(name, std::memory_order_relaxed);
+            e.Start.store(start, std::memory_order_relaxed);
+            e.End.store(end, std::memory_order_relaxed);
+            Head.store(head + 1, std::memory_order_release);
+        }
+
+        // Copie les evenements publies qui n'ont pas ete ecrases pendant la copie
+        void snapshot(std::vector<ProfileEvent>& events) const
+        {
+            uint64 capacity = Events.size();
+            uint64 head = Head.load(std::memory_order_acquire);
+            uint64 first = head - std::min<uint64>(head, capacity);
+
+            events.clear();
+            events.reserve((size_t)(head - first));
+            for (uint64 i = first; i < head; ++i)
+            {
+                const EventSlot& e = Events[i % capacity];
+                events.push_back({ e.Name.load(std::memory_order_relaxed), e.Start.load(std::memory_order_relaxed), e.End.load(std::memory_order_relaxed) });
+            }
+
+            // L'evenement i n'est reecrit qu'une fois Head passe a i + capacity
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64 after = Head.load(std::memory_order_relaxed);
+            if (after >= capacity && after - capacity + 1 > first)
+            {
+                uint64 overwritten = std::min<uint64>(after - capacity + 1 - first, events.size());
+                events.erase(events.begin(), events.begin() + (size_t)overwritten);
+            }
+        }
+    };
+
+    // Copie d'un tampon, ecrite dans le fichier hors de tout verrou
+    struct ThreadSnapshot
+    {
+        uint32 ThreadIndex;
+        std::string Name;
+        std::vector<ProfileEvent> Events;
+    };
+
+    struct GpuZone
+    {
+        const char* Name;
+        uint32 BeginQuery;
+        uint32 EndQuery;
+    };
+
+    struct GpuFrame
+    {
+        std::vector<uint32> Queries;
+        uint32 UsedQueries = 0;
+        std::vector<GpuZone> Zones;
+        uint32 FrameQuery = 0;
+        bool Pending = false;
+    };
+
+    struct ProfilerState
+    {
+        std::chrono::steady_clock::time_point Epoch;
+        std::atomic<bool> Enabled;
+        uint32 Generation;
+
+        std::mutex ThreadsMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> Threads;
+
+        // Zones GPU, ecrites seulement par le thread GL
+        GpuFrame Frames[GPU_FRAME_COUNT];
+        uint64 FrameIndex;
+        uint64 NextClockSync;
+        bool FrameOpen;
+        int64 GpuToCpuOffset;
+        ThreadBuffer GpuEvents;
+        double LastGpuFrameTime;
+
+        explicit ProfilerState(uint32 generation)
+            : Epoch(std::chrono::steady_clock::now())
+            , Enabled(true)
+            , Generation(generation)
+            , FrameIndex(0)
+            , NextClockSync(0)
+            , FrameOpen(false)
+            , GpuToCpuOffset(0)
+            , GpuEvents(0)
+            , LastGpuFrameTime(0.0)
+        {
+            GpuEvents.Name = "GPU";
+        }
+    };
+
+    ProfilerState* s_state = nullptr;
+    uint32 s_generation = 0;
+
+    struct ThreadSlot
+    {
+        ThreadBuffer* Buffer = nullptr;
+        uint32 Generation = 0;
+    };
+    thread_local ThreadSlot t_slot;
+
+    ThreadBuffer* GetThreadBuffer()
+    {
+        if (t_slot.Buffer == nullptr || t_slot.Generation != s_state->Generation)
+        {
+            std::lock_guard<std::mutex> lock(s_state->ThreadsMutex);
+            uint32 index = (uint32)s_state->Threads.size() + 1;
+            s_state->Threads.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(index)));
+            t_slot.Buffer = s_state->Threads.back().get();
+            t_slot.Generation = s_state->Generation;
+        }
+        return t_slot.Buffer;
+    }
+
+    // Lit les requetes d'une image si le GPU les a terminees ; faux sinon, sans attendre
+    bool ResolveGpuFrame(ProfilerState& state, GpuFrame& frame)
+    {
+        // Les requetes se terminent dans l'ordre : celle de l'image entiere est la derniere
+        GLint available = 0;
+        glGetQueryObjectiv(frame.FrameQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            return false;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frame.FrameQuery, GL_QUERY_RESULT, &elapsed);
+        state.LastGpuFrameTime = elapsed / 1000000.0;
+
+        for (const GpuZone& zone : frame.Zones)
+        {
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(zone.BeginQuery, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(zone.EndQuery, GL_QUERY_RESULT, &end);
+            state.GpuEvents.push(zone.Name, (uint64)((int64)begin + state.GpuToCpuOffset), (uint64)((int64)end + state.GpuToCpuOffset));
+        }
+        frame.Pending = false;
+        return true;
+    }
+
+    void WriteEscaped(std::ostream& out, const std::string& text)
+    {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\';
+            }
+            out << c;
+        }
+    }
+
+    ThreadSnapshot Snapshot(const ThreadBuffer& buffer)
+    {
+        ThreadSnapshot snapshot;
+        snapshot.ThreadIndex = buffer.ThreadIndex;
+        snapshot.Name = buffer.Name;
+        buffer.snapshot(snapshot.Events);
+        return snapshot;
+    }
+
+    void WriteEvents(std::ostream& out, const ThreadSnapshot& buffer, bool& first)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.ThreadIndex << ",\"args\":{\"name\":\"";
+        WriteEscaped(out, buffer.Name);
+        out << "\"}}";
+        first = false;
+
+        for (const ProfileEvent& e : buffer.Events)
+        {
+            out << ",\n{\"name\":\"";
+            WriteEscaped(out, e.Name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.ThreadIndex
+                << ",\"ts\":" << e.Start / 1000.0
+                << ",\"dur\":" << (e.End >= e.Start ? e.End - e.Start : 0) / 1000.0 << "}";
+        }
+    }
+}
+
+void Profiler::Initialize()
+{
+    if (s_state == nullptr)
+    {
+        s_state = new ProfilerState(++s_generation);
+        for (GpuFrame& frame : s_state->Frames)
+        {
+            glGenQueries(1, &frame.FrameQuery);
+        }
+    }
+}
+
+void Profiler::Uninitialize()
+{
+    if (s_state != nullptr)
+    {
+        for (GpuFrame& frame : s_state->Frames)
+        {
+            glDeleteQueries(1, &frame.FrameQuery);
+            if (!frame.Queries.empty())
+            {
+                glDeleteQueries((GLsizei)frame.Queries.size(), frame.Queries.data());
+            }
+        }
+        delete s_state;
+        s_state = nullptr;
+    }
+}
+
+bool Profiler::IsEnabled()
+{
+    return s_state != nullptr && s_state->Enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    if (s_state != nullptr)
+    {
+        s_state->Enabled.store(enabled, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    if (s_state != nullptr)
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(s_state->ThreadsMutex);
+        buffer->Name = name;
+    }
+}
+
+uint64 Profiler::Now()
+{
+    if (s_state == nullptr)
+    {
+        return 0;
+    }
+    return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_state->Epoch).count();
+}
+
+void Profiler::RecordCpuZone(const char* name, uint64 start, uint64 end)
+{
+    if (s_state != nullptr)
+    {
+        GetThreadBuffer()->push(name, start, end);
+    }
+}
+
+void Profiler::BeginFrame()
+{
+    if (s_state == nullptr)
+    {
+        return;
+    }
+
+    ProfilerState& state = *s_state;
+
+    // Recalage de l'horloge GPU sur celle du profileur, rarement : c'est un aller-retour
+    // synchrone avec le pilote, et la derive entre les deux horloges est lente
+    if (state.FrameIndex >= state.NextClockSync)
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        state.GpuToCpuOffset = (int64)Now() - (int64)gpuNow;
+        state.NextClockSync = state.FrameIndex + GPU_CLOCK_SYNC_INTERVAL;
+    }
+
+    // Images precedentes, de la plus ancienne a la plus recente, jusqu'a la premiere
+    // que le GPU n'a pas terminee
+    for (uint32 i = 0; i < GPU_FRAME_COUNT; ++i)
+    {
+        GpuFrame& previous = state.Frames[(state.FrameIndex + i) % GPU_FRAME_COUNT];
+        if (previous.Pending && !ResolveGpuFrame(state, previous))
+        {
+            break;
+        }
+    }
+
+    // Un jeu encore en attente apres GPU_FRAME_COUNT images est abandonne plutot
+    // que d'attendre le GPU : cette image manque dans la trace
+    GpuFrame& frame = state.Frames[state.FrameIndex % GPU_FRAME_COUNT];
+    frame.UsedQueries = 0;
+    frame.Zones.clear();
+    frame.Pending = true;
+    glBeginQuery(GL_TIME_ELAPSED, frame.FrameQuery);
+    state.FrameOpen = true;
+}
+
+void Profiler::EndFrame()
+{
+    if (s_state != nullptr && s_state->FrameOpen)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        s_state->FrameOpen = false;
+        ++s_state->FrameIndex;
+    }
+}
+
+double Profiler::GetLastGpuFrameTime()
+{
+    return s_state != nullptr ? s_state->LastGpuFrameTime : 0.0;
+}
+
+int32 Profiler::BeginGpuZone(const char* name)
+{
+    if (!IsEnabled() || !s_state->FrameOpen)
+    {
+        return -1;
+    }
+
+    GpuFrame& frame = s_state->Frames[s_state->FrameIndex % GPU_FRAME_COUNT];
+    if (frame.UsedQueries + 2 > frame.Queries.size())
+    {
+        size_t previous = frame.Queries.size();
+        frame.Queries.resize(previous + 32);
+        glGenQueries(32, frame.Queries.data() + previous);
+    }
+
+    GpuZone zone = { name, frame.Queries[frame.UsedQueries], frame.Queries[frame.UsedQueries + 1] };
+    frame.UsedQueries += 2;
+    frame.Zones.push_back(zone);
+
+    glQueryCounter(zone.BeginQuery, GL_TIMESTAMP);
+    return (int32)frame.Zones.size() - 1;
+}
+
+void Profiler::EndGpuZone(int32 zone)
+{
+    if (zone < 0 || s_state == nullptr)
+    {
+        return;
+    }
+
+    GpuFrame& frame = s_state->Frames[s_state->FrameIndex % GPU_FRAME_COUNT];
+    glQueryCounter(frame.Zones[zone].EndQuery, GL_TIMESTAMP);
+}
+
+bool Profiler::DumpChromeTrace(const std::string& fileName)
+{
+    if (s_state == nullptr)
+    {
+        return false;
+    }
+
+    std::ofstream out(fileName);
+    if (!out.is_open())
+    {
+        Log() << "--Erreur : Impossible d'ecrire la trace " << fileName << std::endl;
+        return false;
+    }
+
+    // Copie d'abord tous les tampons : les threads continuent d'ecrire pendant
+    // l'export, et l'ecriture du fichier est trop lente pour tenir le verrou.
+    std::vector<ThreadSnapshot> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(s_state->ThreadsMutex);
+        snapshots.reserve(s_state->Threads.size() + 1);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : s_state->Threads)
+        {
+            snapshots.push_back(Snapshot(*buffer));
+        }
+    }
+    snapshots.push_back(Snapshot(s_state->GpuEvents));
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const ThreadSnapshot& snapshot : snapshots)
+    {
+        WriteEvents(out, snapshot, first);
+    }
+    out << "\n]}\n";
+
+    Log() << "Trace du profileur ecrite dans " << fileName << std::endl;
+    return true;
+}
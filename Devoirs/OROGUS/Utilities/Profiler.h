@@ -0,0 +1,100 @@
+#ifndef _UTILITIES_PROFILER_H_
+#define _UTILITIES_PROFILER_H_
+
+#include "Types.h"
+
+#include <string>
+
+// Zones de temps CPU et GPU, exportables au format Chrome trace (chrome://tracing, Perfetto).
+//
+// Les zones CPU sont ecrites dans un tampon circulaire propre a chaque thread, sans verrou.
+// DumpChromeTrace les copie pendant que les threads ecrivent et ecarte celles ecrasees entre-temps.
+// Les zones GPU utilisent des paires de requetes GL_TIMESTAMP, lues des qu'elles sont
+// disponibles sans jamais bloquer sur le GPU ; elles ne doivent etre ouvertes que sur le
+// thread GL.
+class Profiler
+{
+public:
+    // Nombre de zones CPU conservees par thread avant d'ecraser les plus anciennes
+    static const uint32 THREAD_EVENT_CAPACITY = 1 << 16;
+
+    static void Initialize();
+    static void Uninitialize();
+
+    static bool IsEnabled();
+    static void SetEnabled(bool enabled);
+
+    // Nomme le thread appelant dans la trace
+    static void SetThreadName(const char* name);
+
+    // Delimitent une image : resout les requetes GPU des images precedentes terminees
+    static void BeginFrame();
+    static void EndFrame();
+
+    // Temps GPU total de la derniere image resolue, en millisecondes
+    static double GetLastGpuFrameTime();
+
+    static bool DumpChromeTrace(const std::string& fileName);
+
+    // Horloge du profileur, en nanosecondes depuis Initialize
+    static uint64 Now();
+
+    // Usage interne des zones
+    static void RecordCpuZone(const char* name, uint64 start, uint64 end);
+    static int32 BeginGpuZone(const char* name);
+    static void EndGpuZone(int32 zone);
+};
+
+class ProfileScope
+{
+    const char* m_name;
+    bool m_active;
+    uint64 m_start;
+
+public:
+    explicit ProfileScope(const char* name)
+        : m_name(name)
+        , m_active(Profiler::IsEnabled())
+        , m_start(m_active ? Profiler::Now() : 0)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_active)
+        {
+            Profiler::RecordCpuZone(m_name, m_start, Profiler::Now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+class GpuProfileScope
+{
+    int32 m_zone;
+
+public:
+    explicit GpuProfileScope(const char* name)
+        : m_zone(Profiler::BeginGpuZone(name))
+    {
+    }
+
+    ~GpuProfileScope()
+    {
+        Profiler::EndGpuZone(m_zone);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+// Le nom doit etre une chaine litterale : seul le pointeur est conserve
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif
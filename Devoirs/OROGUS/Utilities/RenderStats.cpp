@@ -0,0 +1,211 @@
+#include "RenderStats.h"
+
+#include "AllocationTracker.h"
+#include "FrameArena.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    RenderStats s_lastFrame;
+    Clock::time_point s_frameStart;
+    uint64 s_frameStartAllocations = 0;
+
+    std::ofstream s_csv;
+    Clock::time_point s_csvStart;
+    Clock::time_point s_csvWindowStart;
+    RenderStats s_csvWindow;
+    uint32 s_csvFrames = 0;
+
+    // Mo/s pendant le temps passe a envoyer, pas sur toute l'image
+    double UploadBandwidth(const RenderStats& stats)
+    {
+        return stats.UploadTime > 0.0 ? stats.StreamedBytes / (stats.UploadTime * 1000.0) : 0.0;
+    }
+
+    void WriteCsvLine(Clock::time_point now)
+    {
+        double seconds = std::chrono::duration<double>(now - s_csvStart).count();
+        double window = std::chrono::duration<double>(now - s_csvWindowStart).count();
+        double n = (double)s_csvFrames;
+
+        s_csv << std::fixed << std::setprecision(3)
+              << seconds << ','
+              << s_csvFrames / window << ','
+              << s_csvWindow.CpuFrameTime / n << ','
+              << s_csvWindow.GpuFrameTime / n << ','
+              << s_csvWindow.DrawCalls / n << ','
+              << s_csvWindow.Triangles / n << ','
+              << s_csvWindow.Vertices / n << ','
+              << s_csvWindow.ProgramBinds / n << ','
+              << s_csvWindow.VertexArrayBinds / n << ','
+              << s_csvWindow.TextureBinds / n << ','
+              << s_csvWindow.UniformUploads / n << ','
+              << s_csvWindow.BufferBytesUploaded / n << ','
+              << s_csvWindow.CulledObjects / n << ','
+              << s_csvWindow.LightsEvaluated / n << ','
+              << s_csvWindow.Allocations / n << ','
+              << s_csvWindow.FrameArenaBytes / n << ','
+              << s_csvWindow.StreamedBytes / n << ','
+              << s_csvWindow.UploadQueueDepth / n << ','
+              << s_csvWindow.UploadQueueBytes / n << ','
+              << UploadBandwidth(s_csvWindow) << '\n';
+    }
+}
+
+RenderStats RenderCounters::s_current;
+
+RenderStats::RenderStats()
+{
+    reset();
+}
+
+void RenderStats::reset()
+{
+    DrawCalls = 0;
+    Triangles = 0;
+    Vertices = 0;
+    ProgramBinds = 0;
+    VertexArrayBinds = 0;
+    TextureBinds = 0;
+    UniformUploads = 0;
+    BufferBytesUploaded = 0;
+    CulledObjects = 0;
+    LightsEvaluated = 0;
+    Allocations = 0;
+    FrameArenaBytes = 0;
+    StreamedBytes = 0;
+    UploadQueueDepth = 0;
+    UploadQueueBytes = 0;
+    UploadTime = 0.0;
+    CpuFrameTime = 0.0;
+    GpuFrameTime = 0.0;
+}
+
+void RenderStats::accumulate(const RenderStats& frame)
+{
+    DrawCalls += frame.DrawCalls;
+    Triangles += frame.Triangles;
+    Vertices += frame.Vertices;
+    ProgramBinds += frame.ProgramBinds;
+    VertexArrayBinds += frame.VertexArrayBinds;
+    TextureBinds += frame.TextureBinds;
+    UniformUploads += frame.UniformUploads;
+    BufferBytesUploaded += frame.BufferBytesUploaded;
+    CulledObjects += frame.CulledObjects;
+    LightsEvaluated += frame.LightsEvaluated;
+    Allocations += frame.Allocations;
+    FrameArenaBytes += frame.FrameArenaBytes;
+    StreamedBytes += frame.StreamedBytes;
+    UploadQueueDepth += frame.UploadQueueDepth;
+    UploadQueueBytes += frame.UploadQueueBytes;
+    UploadTime += frame.UploadTime;
+    CpuFrameTime += frame.CpuFrameTime;
+    GpuFrameTime += frame.GpuFrameTime;
+}
+
+const RenderStats& RenderCounters::LastFrame()
+{
+    return s_lastFrame;
+}
+
+void RenderCounters::BeginFrame()
+{
+    // Les chargements faits entre deux images (textures, buffers) sont attribues a l'image suivante
+    s_frameStart = Clock::now();
+    s_frameStartAllocations = AllocationTracker::GetThreadAllocationCount();
+}
+
+void RenderCounters::EndFrame(double gpuFrameTime)
+{
+    Clock::time_point now = Clock::now();
+    s_current.CpuFrameTime = std::chrono::duration<double, std::milli>(now - s_frameStart).count();
+    s_current.GpuFrameTime = gpuFrameTime;
+    s_current.Allocations = AllocationTracker::GetThreadAllocationCount() - s_frameStartAllocations;
+    s_current.FrameArenaBytes = FrameArena::GetPeakBytes();
+    s_lastFrame = s_current;
+    s_current.reset();
+
+    if (s_csv.is_open())
+    {
+        s_csvWindow.accumulate(s_lastFrame);
+        ++s_csvFrames;
+        if (now - s_csvWindowStart >= std::chrono::seconds(1))
+        {
+            WriteCsvLine(now);
+            s_csvWindow.reset();
+            s_csvFrames = 0;
+            s_csvWindowStart = now;
+        }
+    }
+}
+
+void RenderCounters::LogLastFrame()
+{
+    const RenderStats& s = s_lastFrame;
+    std::ostream& out = Log();
+    out << "Statistiques de rendu :" << std::endl
+        << "  Temps CPU / GPU      : " << s.CpuFrameTime << " ms / " << s.GpuFrameTime << " ms" << std::endl
+        << "  Appels de dessin     : " << s.DrawCalls << std::endl
+        << "  Triangles / sommets  : " << s.Triangles << " / " << s.Vertices << std::endl
+        << "  Programmes lies      : " << s.ProgramBinds << std::endl
+        << "  VAO lies             : " << s.VertexArrayBinds << std::endl
+        << "  Textures liees       : " << s.TextureBinds << std::endl
+        << "  Uniformes envoyes    : " << s.UniformUploads << std::endl
+        << "  Octets televerses    : " << s.BufferBytesUploaded << std::endl
+        << "  Objets elimines      : " << s.CulledObjects << std::endl
+        << "  Lumieres evaluees    : " << s.LightsEvaluated << std::endl
+        << "  File d'envoi GPU     : " << s.UploadQueueDepth << " en attente (" << s.UploadQueueBytes << " octets), "
+        << s.StreamedBytes << " octets envoyes a " << UploadBandwidth(s) << " Mo/s" << std::endl
+        << "  Arene d'image        : " << s.FrameArenaBytes << " / " << FrameArena::GetCapacity() << " octets" << std::endl
+        << "  Allocations          : ";
+    if (AllocationTracker::IsEnabled())
+    {
+        out << s.Allocations << std::endl;
+    }
+    else
+    {
+        out << "non suivies (OROGUS_TRACK_ALLOCATIONS absent)" << std::endl;
+    }
+}
+
+bool RenderCounters::StartCsv(const std::string& fileName)
+{
+    StopCsv();
+    s_csv.open(fileName);
+    if (!s_csv.is_open())
+    {
+        Log() << "--Erreur : Impossible d'ecrire les statistiques " << fileName << std::endl;
+        return false;
+    }
+
+    s_csv << "time_s,fps,cpu_ms,gpu_ms,draw_calls,triangles,vertices,program_binds,vao_binds,"
+             "texture_binds,uniform_uploads,buffer_bytes,culled_objects,lights_evaluated,allocations,frame_arena_bytes,"
+             "streamed_bytes,upload_queue_depth,upload_queue_bytes,upload_mb_s\n";
+    s_csvStart = Clock::now();
+    s_csvWindowStart = s_csvStart;
+    s_csvWindow.reset();
+    s_csvFrames = 0;
+
+    Log() << "Statistiques de rendu ecrites dans " << fileName << std::endl;
+    return true;
+}
+
+void RenderCounters::StopCsv()
+{
+    if (s_csv.is_open())
+    {
+        s_csv.close();
+        Log() << "Fin de l'ecriture des statistiques de rendu" << std::endl;
+    }
+}
+
+bool RenderCounters::IsWritingCsv()
+{
+    return s_csv.is_open();
+}
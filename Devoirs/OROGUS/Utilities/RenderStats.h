@@ -0,0 +1,68 @@
+#ifndef _UTILITIES_RENDERSTATS_H_
+#define _UTILITIES_RENDERSTATS_H_
+
+#include "Types.h"
+
+#include <string>
+
+// Compteurs d'une image, incrementes aux points d'appel GL du moteur
+struct RenderStats
+{
+    uint32 DrawCalls;
+    uint64 Triangles;
+    uint64 Vertices;        // Sommets soumis : nombre d'indices pour les dessins indexes
+    uint32 ProgramBinds;
+    uint32 VertexArrayBinds;
+    uint32 TextureBinds;
+    uint32 UniformUploads;
+    uint64 BufferBytesUploaded;
+    uint32 CulledObjects;   // Reste a zero tant que la scene n'elimine rien
+    uint32 LightsEvaluated;
+    uint64 Allocations;     // Appels a operator new du thread GL pendant l'image (zero sans OROGUS_TRACK_ALLOCATIONS)
+    uint64 FrameArenaBytes; // Plus haut niveau de l'arene d'image
+    uint64 StreamedBytes;   // Envoyes par UploadQueue, compris dans BufferBytesUploaded
+    uint32 UploadQueueDepth; // Envois encore en attente apres UploadQueue::Process
+    uint64 UploadQueueBytes;
+    double UploadTime;      // Millisecondes passees a envoyer les morceaux de UploadQueue
+
+    // Temps de l'image en millisecondes : CPU jusqu'a l'echange des tampons
+    // (attente de vsync exclue) et GPU mesure par le profileur
+    double CpuFrameTime;
+    double GpuFrameTime;
+
+    RenderStats();
+
+    void reset();
+
+    // Additionne les compteurs et les temps d'une autre image
+    void accumulate(const RenderStats& frame);
+};
+
+// Les compteurs ne sont incrementes que sur le thread GL, sans synchronisation.
+class RenderCounters
+{
+private:
+    static RenderStats s_current;
+
+public:
+    // Image en cours
+    static RenderStats& Current()
+    {
+        return s_current;
+    }
+
+    // Derniere image terminee par EndFrame
+    static const RenderStats& LastFrame();
+
+    static void BeginFrame();
+    static void EndFrame(double gpuFrameTime);
+
+    static void LogLastFrame();
+
+    // Ecrit chaque seconde une ligne CSV de moyennes par image
+    static bool StartCsv(const std::string& fileName);
+    static void StopCsv();
+    static bool IsWritingCsv();
+};
+
+#endif
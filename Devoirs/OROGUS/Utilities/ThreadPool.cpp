@@ -0,0 +1,179 @@
+#include "ThreadPool.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Un ParallelFor en cours : les threads se partagent les indices par un compteur atomique
+    struct Batch
+    {
+        const std::function<void(uint32)>* Body;
+        uint32 Count;
+        std::atomic<uint32> Next;
+        std::atomic<uint32> Done;
+        std::mutex Mutex;
+        std::condition_variable Finished;
+
+        Batch(const std::function<void(uint32)>& body, uint32 count)
+            : Body(&body)
+            , Count(count)
+            , Next(0)
+            , Done(0)
+        {
+        }
+
+        void run()
+        {
+            uint32 completed = 0;
+            for (uint32 i = Next.fetch_add(1); i < Count; i = Next.fetch_add(1))
+            {
+                (*Body)(i);
+                ++completed;
+            }
+
+            if (completed > 0 && Done.fetch_add(completed) + completed == Count)
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                Finished.notify_all();
+            }
+        }
+    };
+
+    struct PoolState
+    {
+        std::vector<std::thread> Threads;
+        std::deque<std::function<void()>> Queue;
+        std::mutex Mutex;
+        std::condition_variable WorkAvailable;
+        bool Stopping = false;
+    };
+
+    PoolState* s_pool = nullptr;
+
+    void WorkerMain(PoolState* pool, uint32 index)
+    {
+        std::string name = "Worker " + std::to_string(index);
+        Profiler::SetThreadName(name.c_str());
+
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(pool->Mutex);
+                pool->WorkAvailable.wait(lock, [pool]() { return pool->Stopping || !pool->Queue.empty(); });
+                if (pool->Queue.empty())
+                {
+                    return;
+                }
+                job = std::move(pool->Queue.front());
+                pool->Queue.pop_front();
+            }
+            job();
+        }
+    }
+}
+
+void ThreadPool::Initialize(uint32 threadCount)
+{
+    Uninitialize();
+
+    if (threadCount == 0)
+    {
+        uint32 cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    s_pool = new PoolState();
+    for (uint32 i = 0; i < threadCount; ++i)
+    {
+        s_pool->Threads.emplace_back(WorkerMain, s_pool, i + 1);
+    }
+}
+
+void ThreadPool::Uninitialize()
+{
+    if (s_pool != nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_pool->Mutex);
+            s_pool->Stopping = true;
+        }
+        s_pool->WorkAvailable.notify_all();
+        for (std::thread& thread : s_pool->Threads)
+        {
+            thread.join();
+        }
+        delete s_pool;
+        s_pool = nullptr;
+    }
+}
+
+uint32 ThreadPool::GetThreadCount()
+{
+    return s_pool != nullptr ? (uint32)s_pool->Threads.size() : 0;
+}
+
+void ThreadPool::ParallelFor(uint32 count, const std::function<void(uint32)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    uint32 helpers = std::min(GetThreadCount(), count - 1);
+    if (helpers == 0)
+    {
+        for (uint32 i = 0; i < count; ++i)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>(body, count);
+    {
+        std::lock_guard<std::mutex> lock(s_pool->Mutex);
+        for (uint32 i = 0; i < helpers; ++i)
+        {
+            s_pool->Queue.push_back([batch]() { batch->run(); });
+        }
+    }
+    if (helpers == 1)
+    {
+        s_pool->WorkAvailable.notify_one();
+    }
+    else
+    {
+        s_pool->WorkAvailable.notify_all();
+    }
+
+    batch->run();
+
+    std::unique_lock<std::mutex> lock(batch->Mutex);
+    batch->Finished.wait(lock, [&batch]() { return batch->Done.load() == batch->Count; });
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    if (GetThreadCount() == 0)
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_pool->Mutex);
+        s_pool->Queue.push_back(std::move(job));
+    }
+    s_pool->WorkAvailable.notify_one();
+}
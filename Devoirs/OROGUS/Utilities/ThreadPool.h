@@ -0,0 +1,30 @@
+#ifndef _UTILITIES_THREADPOOL_H_
+#define _UTILITIES_THREADPOOL_H_
+
+#include "Types.h"
+
+#include <functional>
+
+// Threads de travail partages par le moteur. Sans Initialize (ou avec zero
+// thread), tout s'execute sur le thread appelant.
+class ThreadPool
+{
+public:
+    ThreadPool() = delete;
+
+    // threadCount a zero : un thread par coeur, moins le thread principal
+    static void Initialize(uint32 threadCount = 0);
+    static void Uninitialize();
+
+    static uint32 GetThreadCount();
+
+    // Appelle body(i) pour i dans [0, count) et retourne quand tous les appels sont
+    // termines. Le thread appelant participe, ce qui permet les appels imbriques.
+    static void ParallelFor(uint32 count, const std::function<void(uint32)>& body);
+
+    // Execute job sur un thread de travail sans attendre la fin. Sans thread de
+    // travail, job s'execute immediatement sur le thread appelant.
+    static void Submit(std::function<void()> job);
+};
+
+#endif
@@ -1,17 +1,28 @@
 #include <glew/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "Benchmark/SceneBenchmark.h"
 #include "Camera/Camera.h"
+#include "Controller/InputRecorder.h"
 #include "Controller/Mouse.h"
+#include "Geometry/GeometryManager.h"
+#include "Render/FramePipeline.h"
+#include "Render/UploadQueue.h"
 #include "ResourcesManager/ResourcesManager.h"
+#include "Scene/DebugDraw.h"
 #include "Scene/Gizmo.h"
 #include "Scene/Object3D.h"
 #include "Scene/Scene.h"
 #include "Scene/SceneLoader.h"
+#include "Utilities/FrameArena.h"
+#include "Utilities/Profiler.h"
+#include "Utilities/RenderStats.h"
+#include "Utilities/ThreadPool.h"
 #include "Utilities/Transforms.h"
 #include "Utilities/Units.h"
 #include "Utilities/Vectors.h"
 
+#include <algorithm>
 #include <iostream>
 
 enum class Mode
@@ -40,6 +51,10 @@ MouseController mouse;
 
 Scene* scene = nullptr;
 Gizmo* sceneGizmo = nullptr;
+FramePipeline* framePipeline = nullptr;
+
+// Budget de temps GPU par image vise par la resolution dynamique, en millisecondes
+const float TARGET_FRAME_TIME = 16.6f;
 
 Speed cameraSpeed = Speed(2.5);
 auto cameraRotationSpeed = Degree(50) / Second(1);
@@ -50,11 +65,12 @@ auto shearSpeed = Real(0.5f) / Second(1);
 
 bool normalVisible = false;
 bool gizmoVisible = true;
+bool boundsVisible = false;
 
 Mode engineMode = Mode::Camera;
 TransformationType transformationType = TransformationType::Translation;
 
-int main()
+int main(int argc, char** argv)
 {
     // Prototypes des fonctions
     void error_callback(int error, const char* description);
@@ -69,6 +85,14 @@ int main()
     // Initialise le callback pour la gestion des erreurs de GLFW
 	glfwSetErrorCallback(error_callback);
 
+    // Mode benchmark : rendu sans fenetre visible, resultats ecrits en JSON
+    BenchmarkSettings benchmarkSettings;
+    bool validArguments = true;
+    if (SceneBenchmark::ParseArguments(argc, argv, benchmarkSettings, validArguments))
+    {
+        return validArguments ? SceneBenchmark::Run(benchmarkSettings) : -1;
+    }
+
     // Initialise GLFW
 	if (!glfwInit())
 	{
@@ -88,8 +112,8 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // MSAA x4
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    // Pas de MSAA sur le framebuffer de la fenetre : l'anticrenelage est fait par FramePipeline
+    glfwWindowHint(GLFW_SAMPLES, 0);
 
     // On cree la fenetre pour l'affichage avec GLFW
 	window = glfwCreateWindow(800, 600, "IMN401 - Infographie et jeu video", nullptr, nullptr);
@@ -111,6 +135,11 @@ int main()
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    // La relecture des entrees renvoie les evenements enregistres aux memes callbacks
+    InputRecorder::Handlers inputHandlers = { key_callback, mouse_button_callback, mouse_position_callback, scroll_callback,
+                                              []() -> Camera& { return scene->getCamera(); } };
+    InputRecorder::SetHandlers(inputHandlers);
+
     // Initialise GLEW pour pouvoir accder aux fonctions OpenGL
 	glfwMakeContextCurrent(window);	
     glewExperimental = true;
@@ -126,8 +155,16 @@ int main()
 		return -1;
 	}
 
+    // Initialise le profileur avant tout chargement pour en mesurer le temps
+    Profiler::Initialize();
+    Profiler::SetThreadName("Main");
+    ThreadPool::Initialize();
+
     // Initialise les gestionnaires de ressources
     ResourcesManager::Initialize();
+    DebugDraw::Initialize();
+    FrameArena::Initialize();
+    UploadQueue::Initialize();
     
     // Chargement de la scene. Pour changer la scene a charger, 
     // il faut modifier le deuxieme parametre de la methode LoadScene
@@ -155,6 +192,7 @@ int main()
     glfwGetFramebufferSize(window, &width, &height);
     scene->getCamera().ratio() = width / (float)height;
     glViewport(0, 0, width, height);
+    framePipeline = new FramePipeline(width, height, TARGET_FRAME_TIME);
 
     scene->getCamera().setCameraMode(false);
 
@@ -177,31 +215,66 @@ int main()
         elapsedTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window, elapsedTime);
+        // Les donnees temporaires de l'image precedente ne sont plus utilisees
+        FrameArena::Reset();
+        Profiler::BeginFrame();
+        RenderCounters::BeginFrame();
+        {
+            PROFILE_SCOPE("Frame");
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            elapsedTime = InputRecorder::Update(window, elapsedTime);
+            processInput(window, elapsedTime);
 
-        scene->render();
+            // Televerse les geometries chargees en arriere-plan puis les attache aux objets
+            GeometryManager::GetInstance()->processLoadedGeometries();
+            scene->update();
+            UploadQueue::Process();
 
-		if (normalVisible)
-		{
-			scene->renderNormals();
-		}
+            framePipeline->beginFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		if (gizmoVisible)
-		{
-			sceneGizmo->render(*scene);
-		}
+            scene->render();
+
+            if (normalVisible)
+            {
+                scene->renderNormals();
+            }
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+            if (gizmoVisible)
+            {
+                sceneGizmo->render();
+            }
+
+            if (boundsVisible)
+            {
+                scene->renderBounds();
+            }
+
+            DebugDraw::Flush(*scene);
+            framePipeline->endFrame();
+            Profiler::EndFrame();
+            RenderCounters::EndFrame(Profiler::GetLastGpuFrameTime());
+            framePipeline->getDynamicResolution().update(Profiler::GetLastGpuFrameTime());
+
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
 	}
 	
     // Libere les ressources utilisees
+    InputRecorder::StopRecording();
 	delete sceneGizmo;
     delete scene;
+    delete framePipeline;
 
+    DebugDraw::Uninitialize();
+    FrameArena::Uninitialize();
     ResourcesManager::Uninitialize();
+    UploadQueue::Uninitialize();
+    RenderCounters::StopCsv();
+    ThreadPool::Uninitialize();
+    Profiler::Uninitialize();
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -222,6 +295,15 @@ void showMenuOptions()
 	std::cout << "      N : Affiche/Cache les normales des objets" << std::endl;
 	std::cout << "      G : Affiche/Cache le repere de la scene" << std::endl;
 	std::cout << "      L : Affiche/Cache les lumieres" << std::endl;
+	std::cout << "      B : Affiche/Cache les boites englobantes (Debug seulement)" << std::endl;
+	std::cout << "      P : Ecrit la trace du profileur (Trace.json, chrome://tracing)" << std::endl;
+	std::cout << "      I : Affiche les statistiques de rendu de la derniere image" << std::endl;
+	std::cout << "      O : Demarre/Arrete l'ecriture des statistiques de rendu (RenderStats.csv)" << std::endl;
+	std::cout << "      U : Active/Desactive la resolution dynamique" << std::endl;
+	std::cout << "      F : Change le filtre d'agrandissement (bilineaire ou rehausse)" << std::endl;
+	std::cout << "      M : Change l'anticrenelage (aucun, MSAA x2, x4, x8 ou FXAA)" << std::endl;
+	std::cout << "      F9 : Demarre/Arrete l'enregistrement des entrees (Input.rec)" << std::endl;
+	std::cout << "      F10 : Demarre/Arrete la relecture des entrees (Input.rec)" << std::endl;
 	std::cout << "      H : Affiche ce menu" << std::endl << std::endl;
 	std::cout << "      Les touches suivantes dependent du mode courant (3, 4 ou 5)" << std::endl;
 	std::cout << "        Mode 3 et 4" << std::endl;
@@ -238,6 +320,7 @@ void showMenuOptions()
 	std::cout << "          ESC : Sortir du mode transformation" << std::endl;
 	std::cout << "          + : Selectionne le prochain objet dans la scene" << std::endl;
 	std::cout << "          - : Selectionne l'objet precedent dans la scene" << std::endl;
+	std::cout << "          Clic du milieu : Selectionne l'objet sous le curseur" << std::endl;
 	std::cout << "          1 : Effectue des translations" << std::endl;
 	std::cout << "             W : Applique une translation sur l'axe des Y+" << std::endl;
 	std::cout << "             A : Applique une translation sur l'axe des X-" << std::endl;
@@ -295,49 +378,49 @@ void processInput(GLFWwindow *window, Second elapsedTime)
 void processInputCamera(GLFWwindow* window, Second elapsedTime)
 {
 	// Avancer la camera en appuyant sur la touche W
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_W))
 	{
 		scene->getCamera().forward(cameraSpeed * elapsedTime);
 	}
 
 	// Reculer la camera en appuyant sur la touche S
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_S))
 	{
 		scene->getCamera().forward(-cameraSpeed * elapsedTime);
 	}
 
 	// Bouger la camera a gauche en appuyant sur la touche A
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_A))
 	{
 		scene->getCamera().strafe(Metre(-cameraSpeed * elapsedTime));
 	}
 
 	// Bouger la camera a droite en appuyant sur la touche D
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_D))
 	{
 		scene->getCamera().strafe(Metre(cameraSpeed * elapsedTime));
 	}
 
 	// Tourner la camera a gauche en appuyant sur la touche Fleche gauche
-	if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_LEFT))
 	{
 		scene->getCamera().yaw(cameraRotationSpeed * elapsedTime);
 	}
 
 	// Tourner la camera a droite en appuyant sur la touche Fleche droite
-	if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_RIGHT))
 	{
 		scene->getCamera().yaw(-cameraRotationSpeed * elapsedTime);
 	}
 
 	// Tourner la camera a gauche en appuyant sur la touche Fleche gauche
-	if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_UP))
 	{
 		scene->getCamera().pitch(cameraRotationSpeed * elapsedTime);
 	}
 
 	// Tourner la camera a droite en appuyant sur la touche Fleche droite
-	if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_DOWN))
 	{
 		scene->getCamera().pitch(-cameraRotationSpeed * elapsedTime);
 	}
@@ -357,7 +440,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 	Real deltaScale = Real(1) + scaleSpeed * elapsedTime;
 	Real deltaShear = shearSpeed * elapsedTime;
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+	if (InputRecorder::IsKeyDown(window, GLFW_KEY_W))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Rotation)
@@ -369,7 +452,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 			axe = Axe::Y;
 		}
 	}
-	else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_A))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Rotation)
@@ -386,7 +469,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 		deltaShear = -deltaShear;
 
 	}
-	else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_D))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Rotation)
@@ -398,7 +481,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 			axe = Axe::X;
 		}
 	}
-	else if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_X))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Rotation)
@@ -414,7 +497,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 		deltaScale = Real(1) - scaleSpeed * elapsedTime;
 		deltaShear = -deltaShear;
 	}
-	else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_S))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Scale)
@@ -426,7 +509,7 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 			keyPressed = false;
 		}
 	}
-	else if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_C))
 	{
 		keyPressed = true;
 		if (transformationType == TransformationType::Scale)
@@ -439,12 +522,12 @@ void processInputTransformation(GLFWwindow* window, Second elapsedTime)
 			keyPressed = false;
 		}
 	}
-	else if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_E))
 	{
 		keyPressed = true;
 		axe = Axe::Z;
 	}
-	else if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
+	else if (InputRecorder::IsKeyDown(window, GLFW_KEY_Z))
 	{
 		keyPressed = true;
 		axe = Axe::Z;
@@ -491,11 +574,85 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     scene->getCamera().ratio() = width / (float)height;
     glViewport(0, 0, width, height);
+    framePipeline->setOutputSize(width, height);
+}
+
+// Recharge la scene depuis le disque, en gardant l'ancienne en cas d'erreur
+bool reloadScene(GLFWwindow* window)
+{
+	void showMenuOptions();
+
+	Scene* newScene = SceneLoader::LoadScene("Scenes/", "Scene.scn");
+	if (newScene == nullptr)
+	{
+		// Si la scene est invalide ou introuvable, on garde l'ancienne scene
+		std::cout << "Impossible de charger la scene..." << std::endl;
+		return false;
+	}
+	delete scene;
+	scene = newScene;
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	scene->getCamera().ratio() = width / (float)height;
+	scene->getCamera().setCameraMode(false);
+	std::cout << "Chargement termine." << std::endl;
+	showMenuOptions();
+	return true;
+}
+
+// Enregistrement et relecture partent de la scene telle que chargee, en mode camera
+bool resetForInputRecording(GLFWwindow* window)
+{
+	bool reloadScene(GLFWwindow* window);
+
+	if (!reloadScene(window))
+	{
+		return false;
+	}
+	engineMode = Mode::Camera;
+	transformationType = TransformationType::Translation;
+	return true;
 }
 
 // Callback pour les appuie de touche ponctuelle
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	bool reloadScene(GLFWwindow* window);
+	bool resetForInputRecording(GLFWwindow* window);
+
+	// Demarre/Arrete l'enregistrement des entrees
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+	{
+		if (InputRecorder::IsRecording())
+		{
+			InputRecorder::StopRecording();
+		}
+		else if (!InputRecorder::IsReplaying() && resetForInputRecording(window))
+		{
+			InputRecorder::StartRecording("Input.rec", window);
+		}
+		return;
+	}
+
+	// Demarre/Arrete la relecture des entrees
+	if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+	{
+		if (InputRecorder::IsReplaying())
+		{
+			InputRecorder::StopReplay();
+		}
+		else if (!InputRecorder::IsRecording() && resetForInputRecording(window))
+		{
+			InputRecorder::StartReplay("Input.rec");
+		}
+		return;
+	}
+
+	if (!InputRecorder::OnKey(key, scancode, action, mods))
+	{
+		return;
+	}
+
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
 		if (engineMode == Mode::Camera)
@@ -596,21 +753,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	// Activer le mode Wireframe en appuyant sur la touche 2
 	if (key == GLFW_KEY_R && action == GLFW_PRESS)
 	{
-		Scene* newScene = SceneLoader::LoadScene("Scenes/", "Scene.scn");
-		if (newScene == nullptr)
-		{
-			// Si la scene est invalide ou introuvable, on garde l'ancienne scene
-			std::cout << "Impossible de charger la scene..." << std::endl;
-			return;
-		}
-		delete scene;
-		scene = newScene;
-		int width, height;
-		glfwGetFramebufferSize(window, &width, &height);
-		scene->getCamera().ratio() = width / (float)height;
-		scene->getCamera().setCameraMode(false);
-		std::cout << "Chargement termine." << std::endl;
-		showMenuOptions();
+		reloadScene(window);
 	}
 
 	// Affiche/Cache les normales
@@ -631,6 +774,69 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		scene->showLights(!scene->lightsVisible());
 	}
 
+	// Affiche/Cache les boites englobantes
+	if (key == GLFW_KEY_B && action == GLFW_PRESS)
+	{
+		boundsVisible = !boundsVisible;
+	}
+
+	// Ecrit la trace du profileur
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		Profiler::DumpChromeTrace("Trace.json");
+	}
+
+	// Affiche les statistiques de rendu
+	if (key == GLFW_KEY_I && action == GLFW_PRESS)
+	{
+		RenderCounters::LogLastFrame();
+		const DynamicResolution& resolution = framePipeline->getDynamicResolution();
+		std::cout << "Resolution de rendu : " << resolution.getRenderWidth() << "x" << resolution.getRenderHeight()
+				  << " (echelle " << resolution.getScale() << "), anticrenelage "
+				  << FramePipeline::GetAntiAliasingName(framePipeline->getAntiAliasing())
+				  << " (" << framePipeline->getSampleCount() << " echantillons)" << std::endl;
+	}
+
+	// Active/Desactive la resolution dynamique
+	if (key == GLFW_KEY_U && action == GLFW_PRESS)
+	{
+		DynamicResolution& resolution = framePipeline->getDynamicResolution();
+		resolution.setEnabled(!resolution.isEnabled());
+		std::cout << "Resolution dynamique : " << (resolution.isEnabled() ? "active" : "desactivee") << std::endl;
+	}
+
+	// Change le filtre d'agrandissement
+	if (key == GLFW_KEY_F && action == GLFW_PRESS)
+	{
+		bool sharpen = framePipeline->getFilter() == UpscaleFilter::Bilinear;
+		framePipeline->setFilter(sharpen ? UpscaleFilter::Sharpen : UpscaleFilter::Bilinear);
+		std::cout << "Filtre d'agrandissement : " << (sharpen ? "rehausse" : "bilineaire") << std::endl;
+	}
+
+	// Passe au mode d'anticrenelage suivant
+	if (key == GLFW_KEY_M && action == GLFW_PRESS)
+	{
+		const AntiAliasing modes[] = { AntiAliasing::Off, AntiAliasing::Msaa2, AntiAliasing::Msaa4, AntiAliasing::Msaa8, AntiAliasing::Fxaa };
+		const size_t modeCount = sizeof(modes) / sizeof(modes[0]);
+		size_t current = std::find(modes, modes + modeCount, framePipeline->getAntiAliasing()) - modes;
+		framePipeline->setAntiAliasing(modes[(current + 1) % modeCount]);
+		std::cout << "Anticrenelage : " << FramePipeline::GetAntiAliasingName(framePipeline->getAntiAliasing())
+				  << " (" << framePipeline->getSampleCount() << " echantillons)" << std::endl;
+	}
+
+	// Demarre/Arrete l'ecriture des statistiques de rendu
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		if (RenderCounters::IsWritingCsv())
+		{
+			RenderCounters::StopCsv();
+		}
+		else
+		{
+			RenderCounters::StartCsv("RenderStats.csv");
+		}
+	}
+
 	// Affiche le menu
 	if (key == GLFW_KEY_H && action == GLFW_PRESS)
 	{
@@ -640,15 +846,48 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
+    if (!InputRecorder::OnMouseButton(button, action, mods))
+    {
+        return;
+    }
+
     mouse.updateButtonState(button, action == GLFW_PRESS);
     if (action != GLFW_PRESS)
     {
         scene->getCamera().log();
     }
+
+    // En mode transformation, le bouton du milieu selectionne l'objet sous le curseur
+    if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS && engineMode == Mode::Transformation)
+    {
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+        if (width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        Point3<Metre> origin;
+        Vector3<Real> direction;
+        scene->getViewRay(mouse.xPos() / width, mouse.yPos() / height, origin, direction);
+
+        RaycastHit hit;
+        if (scene->raycast(origin, direction, hit) && scene->selectObject(hit.Object))
+        {
+            std::cout << "Objet selectionne : " << scene->getCurrentSelectedObject()->getName()
+                      << " (" << hit.Object->getName() << ", triangle " << hit.Triangle
+                      << ", " << (float)hit.Distance << " m)" << std::endl;
+        }
+    }
 }
 
 void mouse_position_callback(GLFWwindow* window, double xpos, double ypos)
 {
+    if (!InputRecorder::OnMousePosition(xpos, ypos))
+    {
+        return;
+    }
+
     mouse.updatePosition((float)xpos, (float)ypos);
     if (mouse.LButtonPressed())
     {
@@ -668,6 +907,11 @@ void mouse_position_callback(GLFWwindow* window, double xpos, double ypos)
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    if (!InputRecorder::OnScroll(xoffset, yoffset))
+    {
+        return;
+    }
+
     scene->getCamera().forward(Metre((float)yoffset * 0.5f));
 }
 